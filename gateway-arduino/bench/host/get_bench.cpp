@@ -0,0 +1,239 @@
+// Benchmark do GET /telemetry: String por request (antes) vs. cache + ETag/304 (ver Makefile).
+//
+//   ./get_bench [polls]
+//
+// "legacy" é o HttpServer::makeTelemetryJson de antes do cache, chamado a cada
+// GET (concatenação de String + String(float, n)). "cache" reproduz
+// HttpServer::cachedTelemetry/writeTelemetryJson/handleTelemetryGet (membros
+// privados, copiados daqui de HttpServer.cpp) sobre o HttpResponse real.
+// O String do shim segue a política de alocação do WString do arduino-esp32, então
+// as contagens de heap são as do ESP32; o tempo é do host (só comparação relativa).
+//
+// Flood: um dashboard consulta o mesmo device 50x por amostra nova (polls a
+// 50 Hz, device a 1 Hz). Só o handler é medido; o transporte é igual nos dois.
+
+#include <chrono>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HttpMessage.h"
+
+namespace {
+
+volatile size_t gSink = 0;
+
+struct Telemetry {
+    char deviceId[24] = "vehicle-01";
+    bool hasData = true;
+    float temperature = 23.57f;
+    float humidity = 61.2f;
+    int fuelLevel = 73;
+    float stepperSpeed = 512.5f;
+    float stepperRpm = 153.75f;
+    uint32_t counter = 1234;
+    uint32_t lastUpdateMs = 3600123;
+    uint32_t sampleTs = 1790000000u;
+};
+
+namespace legacy {
+
+// HttpServer::makeTelemetryJson (antes do cache), sem alterações
+String makeTelemetryJson(const Telemetry &t) {
+    String s = "{";
+    s += "\"hasData\":" + String(t.hasData ? "true" : "false");
+    s += ",\"temperature\":" + (isnan(t.temperature) ? String("null") : String(t.temperature, 2));
+    s += ",\"humidity\":" + (isnan(t.humidity) ? String("null") : String(t.humidity, 2));
+
+    // novos campos
+    s += ",\"fuelLevel\":" + String(t.fuelLevel < 0 ? "null" : String(t.fuelLevel));
+    s += ",\"stepperSpeed\":" + (isnan(t.stepperSpeed) ? String("null") : String(t.stepperSpeed, 1));
+    s += ",\"stepperRpm\":" + (isnan(t.stepperRpm) ? String("null") : String(t.stepperRpm, 2));
+
+    s += ",\"counter\":" + String(t.counter);
+    s += ",\"lastUpdateMs\":" + String(t.lastUpdateMs);
+    s += "}";
+    return s;
+}
+
+// handleTelemetryGet: _server.send(200, "application/json", makeTelemetryJson(_telemetry))
+size_t get(const Telemetry &t) {
+    const String json = makeTelemetryJson(t);
+    return json.length();
+}
+
+} // namespace legacy
+
+namespace cache {
+
+const size_t kTelemetryJsonBytes = 448;
+
+void appendf(char *out, size_t cap, size_t &len, const char *fmt, ...) {
+    if (len + 1 >= cap) return;
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(out + len, cap - len, fmt, args);
+    va_end(args);
+    if (n > 0) len = ((size_t) n < cap - len) ? len + (size_t) n : cap - 1;
+}
+
+void appendFloat(char *out, size_t cap, size_t &len, const char *key, float v, int decimals) {
+    if (isnan(v)) appendf(out, cap, len, ",\"%s\":null", key);
+    else appendf(out, cap, len, ",\"%s\":%.*f", key, decimals, (double) v);
+}
+
+size_t writeTelemetryJson(const Telemetry &t, char *out, size_t cap) {
+    size_t n = 0;
+    appendf(out, cap, n, "{\"deviceId\":\"%s\",\"hasData\":%s", t.deviceId, t.hasData ? "true" : "false");
+    appendFloat(out, cap, n, "temperature", t.temperature, 2);
+    appendFloat(out, cap, n, "humidity", t.humidity, 2);
+
+    if (t.fuelLevel < 0) appendf(out, cap, n, ",\"fuelLevel\":null");
+    else appendf(out, cap, n, ",\"fuelLevel\":%d", t.fuelLevel);
+    appendFloat(out, cap, n, "stepperSpeed", t.stepperSpeed, 1);
+    appendFloat(out, cap, n, "stepperRpm", t.stepperRpm, 2);
+
+    appendf(out, cap, n, ",\"counter\":%lu,\"lastUpdateMs\":%lu,\"sampleTs\":%lu}",
+            (unsigned long) t.counter, (unsigned long) t.lastUpdateMs, (unsigned long) t.sampleTs);
+    return n;
+}
+
+struct TelemetryCache {
+    bool valid = false;
+    uint32_t counter = 0;
+    uint32_t lastUpdateMs = 0;
+    char etag[32] = {};
+    char json[kTelemetryJsonBytes] = {};
+    uint16_t jsonLen = 0;
+};
+
+TelemetryCache gCache;
+
+const TelemetryCache &cachedTelemetry(uint8_t row, const Telemetry &t) {
+    TelemetryCache &c = gCache;
+    if (c.valid && c.counter == t.counter && c.lastUpdateMs == t.lastUpdateMs) {
+        return c;
+    }
+
+    c.jsonLen = (uint16_t) writeTelemetryJson(t, c.json, sizeof(c.json));
+    c.counter = t.counter;
+    c.lastUpdateMs = t.lastUpdateMs;
+    snprintf(c.etag, sizeof(c.etag), "\"%x-%lx-%lx\"",
+             (unsigned) row, (unsigned long) t.counter, (unsigned long) t.lastUpdateMs);
+    c.valid = true;
+    return c;
+}
+
+// handleTelemetryGet depois de achar a row; retorna o status
+int get(const Telemetry &t, const HttpRequest &req, HttpResponse &resp) {
+    const TelemetryCache &c = cachedTelemetry(0, t);
+    resp.addHeader("ETag", c.etag);
+    resp.addHeader("Cache-Control", "no-cache");
+
+    const char *inm = req.header(HttpHeader::IfNoneMatch);
+    if (inm[0] != '\0' && (strstr(inm, c.etag) != nullptr || strcmp(inm, "*") == 0)) {
+        resp.send(304, "application/json", String());
+        return 304;
+    }
+
+    resp.sendCached(200, "application/json", c.json, c.jsonLen);
+    return 200;
+}
+
+} // namespace cache
+
+enum class Path { Legacy, Cache200, Cache304 };
+
+struct Result {
+    double ns = 0;
+    double heapOps = 0; // malloc + realloc + free por GET
+    double bodyBytes = 0;
+};
+
+// updateEvery = polls por amostra nova (1 = toda consulta vê dado novo)
+Result run(Path path, long polls, long updateEvery) {
+    Telemetry t;
+    cache::gCache = cache::TelemetryCache();
+
+    HttpRequest req;
+    char etag[32] = "";
+    if (path == Path::Cache304) req.headers[(size_t) HttpHeader::IfNoneMatch] = etag;
+
+    const StringHeapStats before = gStringHeap;
+    size_t body = 0;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < polls; i++) {
+        if (i % updateEvery == 0) {
+            t.counter++;
+            t.lastUpdateMs += 1000;
+            t.temperature += 0.01f;
+        }
+
+        if (path == Path::Legacy) {
+            body += legacy::get(t);
+            continue;
+        }
+
+        HttpResponse resp;
+        cache::get(t, req, resp);
+        body += resp.length();
+
+        // Cliente guarda o ETag da última resposta 200 e manda no próximo poll
+        if (path == Path::Cache304 && resp.code == 200) strcpy(etag, resp.headerValues[0]);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    gSink = body;
+
+    Result r;
+    r.ns = ns / (double) polls;
+    r.heapOps = (double) ((gStringHeap.mallocs - before.mallocs) + (gStringHeap.reallocs - before.reallocs) +
+                          (gStringHeap.frees - before.frees)) / (double) polls;
+    r.bodyBytes = (double) body / (double) polls;
+    return r;
+}
+
+void row(const char *name, const Result &r) {
+    printf("%-32s %9.0f %9.1f %9.1f\n", name, r.ns, r.heapOps, r.bodyBytes);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const long polls = (argc > 1) ? strtol(argv[1], nullptr, 10) : 500000;
+    if (polls <= 0) {
+        fprintf(stderr, "polls: > 0\n");
+        return 2;
+    }
+
+    // Conferência: o cache devolve o mesmo JSON que o writer e 304 com o ETag certo
+    {
+        Telemetry t;
+        char json[cache::kTelemetryJsonBytes];
+        const size_t n = cache::writeTelemetryJson(t, json, sizeof(json));
+        HttpRequest req;
+        HttpResponse first;
+        cache::gCache = cache::TelemetryCache();
+        cache::get(t, req, first);
+        req.headers[(size_t) HttpHeader::IfNoneMatch] = first.headerValues[0];
+        HttpResponse second;
+        if (first.length() != n || memcmp(first.data(), json, n) != 0 || cache::get(t, req, second) != 304 ||
+            second.length() != 0) {
+            printf("MISMATCH cache\n");
+            return 1;
+        }
+    }
+
+    printf("%ld polls per row, per GET /telemetry handler call\n", polls);
+    printf("%-32s %9s %9s %9s\n", "path", "ns", "heap ops", "body B");
+
+    row("legacy String, every poll", run(Path::Legacy, polls, 50));
+    row("cache, 200 (no If-None-Match)", run(Path::Cache200, polls, 50));
+    row("cache, 304 (If-None-Match)", run(Path::Cache304, polls, 50));
+
+    printf("\nworst case: new sample before every poll\n");
+    row("legacy String", run(Path::Legacy, polls, 1));
+    row("cache miss (rebuild + 200)", run(Path::Cache200, polls, 1));
+    return 0;
+}
@@ -0,0 +1,356 @@
+// Teste de carga do servidor HTTP do gateway no host (ver Makefile).
+//
+//   ./http_load [seconds] [service_us]
+//
+// Sobe o servidor numa thread (loop() do gateway) nos dois modos do HttpServer:
+//   - Sync:  WebServer::handleClient() (modelo do core 2.0.x em shim/WebServer.cpp)
+//   - Async: AsyncHttpServer real (lib/HttpServer), mesma configuração do firmware
+// e N devices simulados (threads) fazendo POST /telemetry em laço fechado, no
+// formato do vehicle-device (cabeçalhos SecureHttp + ciphertext em hex). Cada
+// device reaproveita a conexão enquanto o servidor mantiver keep-alive, como o
+// GatewayClient. A rota gasta service_us de CPU por POST (verificação +
+// decriptação + parse) e responde como o gateway.
+//
+// Linhas "slow": um dos devices manda o cabeçalho, espera kSlowMs e só então o
+// body (enlace WiFi ruim / retransmissão). A latência reportada é a dos outros.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncHttpServer.h"
+#include "HttpMessage.h"
+
+namespace {
+
+const uint16_t kPortBase = 18200;
+const int kSlowMs = 300; // atraso entre cabeçalho e body do device lento
+const int kBackoffMs = 20; // device espera isso após um 503 antes de tentar de novo
+const size_t kCipherHexChars = 220; // 110 B de texto claro (amostra única) em hex
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<uint32_t> gServiceUs(1500);
+
+void burnCpu(uint32_t us) {
+    const auto end = Clock::now() + std::chrono::microseconds(us);
+    while (Clock::now() < end) {
+    }
+}
+
+// Rota comum aos dois modos (o HttpServer também despacha os dois por route())
+void route(const HttpRequest &req, HttpResponse &resp) {
+    static const char ok[] = "{\"ok\":true,\"accepted\":1,\"rejected\":0}";
+    static const char bad[] = "{\"ok\":false,\"error\":\"missing_headers\"}";
+
+    if (strcmp(req.path, "/telemetry") != 0 || req.method != HTTP_POST) {
+        resp.send(404, "application/json", "{\"error\":\"Not found\"}");
+        return;
+    }
+    if (!req.hasHeader(HttpHeader::DeviceId) || !req.hasHeader(HttpHeader::Signature) || req.bodyLen == 0) {
+        resp.sendCached(400, "application/json", bad, sizeof(bad) - 1);
+        return;
+    }
+
+    burnCpu(gServiceUs.load());
+    resp.sendCached(200, "application/json", ok, sizeof(ok) - 1);
+}
+
+// ===== Servidor =====
+
+enum class Mode { Sync, Async };
+
+// HttpServer::serveSync(): WebServer -> HttpRequest -> route()
+void serveSync(WebServer &server) {
+    String headerValues[(size_t) HttpHeader::Count];
+    const String uri = server.uri();
+    const String body = server.arg("plain");
+
+    HttpRequest req;
+    req.method = server.method();
+    req.path = uri.c_str();
+    for (size_t i = 0; i < (size_t) HttpHeader::Count; i++) {
+        headerValues[i] = server.header(httpHeaderName((HttpHeader) i));
+        req.headers[i] = headerValues[i].c_str();
+    }
+    req.body = body.c_str();
+    req.bodyLen = body.length();
+    req.remoteIP = server.client().remoteIP();
+    req.client = &server.client();
+
+    HttpResponse resp;
+    route(req, resp);
+
+    for (uint8_t i = 0; i < resp.headerCount; i++) server.sendHeader(resp.headerNames[i], resp.headerValues[i]);
+    server.send_P(resp.code, resp.contentType, resp.data(), resp.length());
+}
+
+void runServer(Mode mode, uint16_t port, std::atomic<bool> &ready, std::atomic<bool> &stop) {
+    if (mode == Mode::Sync) {
+        WebServer server(port);
+        static const char *keys[(size_t) HttpHeader::Count];
+        for (size_t i = 0; i < (size_t) HttpHeader::Count; i++) keys[i] = httpHeaderName((HttpHeader) i);
+        server.collectHeaders(keys, (size_t) HttpHeader::Count);
+        server.on("/telemetry", HTTP_POST, [&server]() { serveSync(server); });
+        server.onNotFound([&server]() { serveSync(server); });
+        server.begin();
+        ready = true;
+        while (!stop) server.handleClient();
+        return;
+    }
+
+    // Mesma configuração do asyncConfigFor() do HttpServer
+    AsyncHttpServer::Config cfg;
+    cfg.port = port;
+    cfg.maxRequestBytes = 1024;
+    AsyncHttpServer server(cfg);
+    server.onRequest(route);
+    server.begin();
+    ready = true;
+    while (!stop) server.update();
+}
+
+// ===== Devices =====
+
+struct DeviceStats {
+    std::vector<uint32_t> latencyUs; // POSTs 200 terminados dentro da janela
+    uint32_t ok = 0;
+    uint32_t busy = 0; // 503 (pool cheio)
+    uint32_t errors = 0; // conexão caiu / timeout / outro status
+    uint32_t connects = 0;
+};
+
+int connectTo(uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    timeval tv = {10, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+bool writeAll(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        const ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        p += w;
+        len -= (size_t) w;
+    }
+    return true;
+}
+
+// Lê uma resposta inteira. Retorna o status (-1 = nada lido, -2 = resposta incompleta).
+int readResponse(int fd, bool &closeAfter) {
+    char buf[1024];
+    size_t len = 0;
+    size_t headEnd = 0;
+
+    while (headEnd == 0) {
+        if (len == sizeof(buf)) return -2;
+        const ssize_t r = recv(fd, buf + len, sizeof(buf) - len, 0);
+        if (r <= 0) return len == 0 ? -1 : -2;
+        len += (size_t) r;
+        for (size_t i = 0; i + 3 < len; i++) {
+            if (memcmp(buf + i, "\r\n\r\n", 4) == 0) {
+                headEnd = i + 4;
+                break;
+            }
+        }
+    }
+
+    buf[headEnd - 1] = '\0';
+    const int status = atoi(buf + 9); // "HTTP/1.1 200"
+    const char *cl = strcasestr(buf, "\r\nContent-Length:");
+    const size_t contentLength = cl ? (size_t) strtoul(cl + 17, nullptr, 10) : 0;
+    closeAfter = strcasestr(buf, "\r\nConnection: close") != nullptr;
+
+    size_t body = len - headEnd;
+    while (body < contentLength) {
+        const ssize_t r = recv(fd, buf, sizeof(buf), 0);
+        if (r <= 0) return -2;
+        body += (size_t) r;
+    }
+    return status;
+}
+
+void runDevice(int index, bool slow, uint16_t port, const std::atomic<bool> &stop, Clock::time_point windowEnd,
+               DeviceStats &st) {
+    char id[24];
+    snprintf(id, sizeof(id), "vehicle-%02d", index);
+    const std::string body(kCipherHexChars, 'a');
+
+    int fd = -1;
+    uint32_t ts = 1790000000u;
+
+    while (!stop) {
+        char head[512];
+        const int headLen = snprintf(head, sizeof(head),
+                                     "POST /telemetry HTTP/1.1\r\n"
+                                     "Host: 127.0.0.1\r\n"
+                                     "Content-Type: text/plain\r\n"
+                                     "X-Device-Id: %s\r\n"
+                                     "X-Timestamp: %u\r\n"
+                                     "X-Nonce: 6b1f0c2e9a7d4f3b8e5a1c0d2f4b6a8c\r\n"
+                                     "X-IV: 0a1b2c3d4e5f60718293a4b5\r\n"
+                                     "X-Tag: 00112233445566778899aabbccddeeff\r\n"
+                                     "X-Signature: 3f1e2d4c5b6a79880f1e2d3c4b5a69788f9e0d1c2b3a49586776a5b4c3d2e1f0\r\n"
+                                     "Content-Length: %u\r\n\r\n",
+                                     id, (unsigned) ts++, (unsigned) body.size());
+
+        const Clock::time_point t0 = Clock::now();
+        int status = -1;
+        bool closeAfter = true;
+
+        // Conexão keep-alive fechada pelo servidor (ociosa/evicted): reconecta uma vez
+        for (int attempt = 0; attempt < 2 && status == -1; attempt++) {
+            const bool reused = fd >= 0;
+            if (fd < 0) {
+                fd = connectTo(port);
+                if (fd < 0) break;
+                st.connects++;
+            }
+
+            bool sent;
+            if (slow) {
+                sent = writeAll(fd, head, (size_t) headLen);
+                std::this_thread::sleep_for(std::chrono::milliseconds(kSlowMs));
+                sent = sent && writeAll(fd, body.data(), body.size());
+            } else {
+                std::string req(head, (size_t) headLen);
+                req += body;
+                sent = writeAll(fd, req.data(), req.size());
+            }
+
+            status = sent ? readResponse(fd, closeAfter) : -1;
+            if (status < 0) {
+                close(fd);
+                fd = -1;
+                if (!reused) break; // conexão nova também falhou: erro
+            }
+        }
+
+        const Clock::time_point t1 = Clock::now();
+        if (t1 > windowEnd) break;
+
+        if (status == 200) {
+            st.ok++;
+            st.latencyUs.push_back((uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+        } else if (status == 503) {
+            st.busy++;
+        } else {
+            st.errors++;
+        }
+
+        if (fd >= 0 && closeAfter) {
+            close(fd);
+            fd = -1;
+        }
+        if (status == 503) std::this_thread::sleep_for(std::chrono::milliseconds(kBackoffMs));
+        if (status < 0 && fd < 0) std::this_thread::sleep_for(std::chrono::milliseconds(kBackoffMs));
+    }
+
+    if (fd >= 0) close(fd);
+}
+
+void runScenario(Mode mode, int devices, bool withSlow, int seconds, uint16_t port) {
+    std::atomic<bool> ready(false);
+    std::atomic<bool> stopServer(false);
+    std::thread server(runServer, mode, port, std::ref(ready), std::ref(stopServer));
+    while (!ready) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::atomic<bool> stopDevices(false);
+    std::vector<DeviceStats> stats((size_t) devices);
+    std::vector<std::thread> threads;
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point windowEnd = start + std::chrono::seconds(seconds);
+    for (int i = 0; i < devices; i++) {
+        const bool slow = withSlow && i == 0;
+        threads.emplace_back(runDevice, i, slow, port, std::cref(stopDevices), windowEnd, std::ref(stats[(size_t) i]));
+    }
+
+    std::this_thread::sleep_until(windowEnd);
+    stopDevices = true;
+    for (std::thread &t : threads) t.join();
+    stopServer = true;
+    server.join();
+
+    uint32_t ok = 0, busy = 0, errors = 0, connects = 0;
+    std::vector<uint32_t> lat;
+    for (int i = 0; i < devices; i++) {
+        const DeviceStats &s = stats[(size_t) i];
+        ok += s.ok;
+        busy += s.busy;
+        errors += s.errors;
+        connects += s.connects;
+        if (withSlow && i == 0) continue;
+        lat.insert(lat.end(), s.latencyUs.begin(), s.latencyUs.end());
+    }
+    std::sort(lat.begin(), lat.end());
+
+    const auto pct = [&lat](double p) -> double {
+        if (lat.empty()) return 0.0;
+        size_t i = (size_t) (p * (double) lat.size());
+        if (i >= lat.size()) i = lat.size() - 1;
+        return lat[i] / 1000.0;
+    };
+
+    printf("%-6s %7d %5s %9.0f %8.2f %8.2f %9.2f %6u %6u %9u\n", mode == Mode::Sync ? "sync" : "async", devices,
+           withSlow ? "1" : "-", ok / (double) seconds, pct(0.50), pct(0.99), lat.empty() ? 0.0 : lat.back() / 1000.0,
+           (unsigned) busy, (unsigned) errors, (unsigned) connects);
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const long seconds = (argc > 1) ? strtol(argv[1], nullptr, 10) : 5;
+    const long serviceUs = (argc > 2) ? strtol(argv[2], nullptr, 10) : 1500;
+    if (seconds <= 0 || serviceUs < 0) {
+        fprintf(stderr, "usage: http_load [seconds>0] [service_us>=0]\n");
+        return 2;
+    }
+    gServiceUs = (uint32_t) serviceUs;
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%ld s per row, %ld us of route CPU per POST, slow device: %d ms between head and body\n", seconds,
+           serviceUs, kSlowMs);
+    printf("%-6s %7s %5s %9s %8s %8s %9s %6s %6s %9s\n", "mode", "devices", "slow", "req/s", "p50 ms", "p99 ms",
+           "max ms", "503", "errors", "connects");
+
+    const int counts[] = {1, 8, 32};
+    uint16_t port = kPortBase;
+    for (int slow = 0; slow <= 1; slow++) {
+        for (int mode = 0; mode <= 1; mode++) {
+            for (int devices : counts) {
+                if (slow && devices == 1) continue; // só o próprio device lento
+                runScenario(mode == 0 ? Mode::Sync : Mode::Async, devices, slow != 0, (int) seconds, port++);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,5 @@
+// Estado global do shim do core Arduino (ver Arduino.h).
+
+#include "Arduino.h"
+
+StringHeapStats gStringHeap;
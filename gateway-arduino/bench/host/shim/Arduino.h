@@ -0,0 +1,266 @@
+// Shim do core Arduino para os benchmarks do gateway no host (só o que o HttpServer usa).
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+// Operações de heap feitas por String (ver StringHeap)
+struct StringHeapStats {
+    unsigned long mallocs = 0;
+    unsigned long reallocs = 0; // crescimento de um buffer já no heap
+    unsigned long frees = 0;
+};
+
+extern StringHeapStats gStringHeap;
+
+// String com a política de alocação do WString do arduino-esp32 2.x:
+//   - SSO: até 10 caracteres sem heap (SSOSIZE = 11 em 32 bits);
+//   - reserve()/concat() crescem para o tamanho exato arredondado a 16 bytes
+//     (realloc a cada vez que a capacidade acaba, sem crescimento geométrico);
+//   - String(float/double, n) usa um buffer temporário de malloc().
+// Os contadores de gStringHeap medem o "heap churn" de cada caminho.
+class String {
+public:
+    String() { _sso[0] = '\0'; }
+
+    String(const char *s) {
+        _sso[0] = '\0';
+        if (s) copy(s, (unsigned) strlen(s));
+    }
+
+    String(const char *s, size_t n) {
+        _sso[0] = '\0';
+        copy(s, (unsigned) n);
+    }
+
+    String(const String &o) {
+        _sso[0] = '\0';
+        copy(o.c_str(), o._len);
+    }
+
+    String(String &&o) noexcept {
+        _sso[0] = '\0';
+        move(o);
+    }
+
+    explicit String(char c) {
+        const char s[2] = {c, '\0'};
+        _sso[0] = '\0';
+        copy(s, 1);
+    }
+
+    explicit String(int v) { fromFormat("%d", v); }
+
+    explicit String(unsigned v) { fromFormat("%u", v); }
+
+    explicit String(long v) { fromFormat("%ld", v); }
+
+    explicit String(unsigned long v) { fromFormat("%lu", v); }
+
+    String(float v, unsigned decimals) { fromFloat((double) v, decimals); }
+
+    String(double v, unsigned decimals) { fromFloat(v, decimals); }
+
+    ~String() { release(); }
+
+    String &operator=(const String &o) {
+        if (this != &o) copy(o.c_str(), o._len);
+        return *this;
+    }
+
+    String &operator=(String &&o) noexcept {
+        if (this != &o) move(o);
+        return *this;
+    }
+
+    String &operator=(const char *s) {
+        copy(s ? s : "", s ? (unsigned) strlen(s) : 0);
+        return *this;
+    }
+
+    unsigned length() const { return _len; }
+
+    const char *c_str() const { return _heap ? _heap : _sso; }
+
+    bool isEmpty() const { return _len == 0; }
+
+    bool reserve(unsigned n) {
+        if (capacity() >= n) return true;
+        return changeBuffer(n);
+    }
+
+    bool concat(const char *s, unsigned n) {
+        if (n == 0) return true;
+        if (!reserve(_len + n)) return false;
+        char *b = buffer();
+        memmove(b + _len, s, n);
+        _len += n;
+        b[_len] = '\0';
+        return true;
+    }
+
+    String &operator+=(const String &o) {
+        concat(o.c_str(), o._len);
+        return *this;
+    }
+
+    String &operator+=(const char *o) {
+        concat(o, (unsigned) strlen(o));
+        return *this;
+    }
+
+    String &operator+=(char c) {
+        concat(&c, 1);
+        return *this;
+    }
+
+    // StringSumHelper: cópia do lado esquerdo + concat
+    friend String operator+(const String &a, const String &b) {
+        String r(a);
+        r += b;
+        return r;
+    }
+
+    friend String operator+(const String &a, const char *b) {
+        String r(a);
+        r += b;
+        return r;
+    }
+
+    friend String operator+(const char *a, const String &b) {
+        String r(a);
+        r += b;
+        return r;
+    }
+
+    bool operator==(const char *o) const { return strcmp(c_str(), o) == 0; }
+
+    bool operator==(const String &o) const { return _len == o._len && strcmp(c_str(), o.c_str()) == 0; }
+
+    bool operator!=(const String &o) const { return !(*this == o); }
+
+    bool equalsIgnoreCase(const String &o) const { return strcasecmp(c_str(), o.c_str()) == 0; }
+
+private:
+    static const unsigned kSsoSize = 11;
+
+    unsigned capacity() const { return _heap ? _cap : kSsoSize - 1; }
+
+    char *buffer() { return _heap ? _heap : _sso; }
+
+    bool changeBuffer(unsigned n) {
+        if (n < kSsoSize - 1 && !_heap) return true;
+
+        const unsigned size = (n + 16) & ~0xFu;
+        char *b = (char *) realloc(_heap, size);
+        if (!b) return false;
+        if (_heap) {
+            gStringHeap.reallocs++;
+        } else {
+            gStringHeap.mallocs++;
+            memcpy(b, _sso, kSsoSize);
+        }
+        _heap = b;
+        _cap = size - 1;
+        return true;
+    }
+
+    void copy(const char *s, unsigned n) {
+        if (!reserve(n)) return;
+        char *b = buffer();
+        memmove(b, s, n);
+        b[n] = '\0';
+        _len = n;
+    }
+
+    void move(String &o) {
+        release();
+        if (o._heap) {
+            _heap = o._heap;
+            _cap = o._cap;
+            o._heap = nullptr;
+            o._cap = 0;
+        } else {
+            memcpy(_sso, o._sso, kSsoSize);
+        }
+        _len = o._len;
+        o._len = 0;
+        o._sso[0] = '\0';
+    }
+
+    void release() {
+        if (_heap) {
+            free(_heap);
+            gStringHeap.frees++;
+        }
+        _heap = nullptr;
+        _cap = 0;
+        _len = 0;
+        _sso[0] = '\0';
+    }
+
+    template<typename T>
+    void fromFormat(const char *fmt, T v) {
+        char b[24]; // ultoa() em buffer da pilha
+        _sso[0] = '\0';
+        const int n = snprintf(b, sizeof(b), fmt, v);
+        copy(b, (unsigned) n);
+    }
+
+    void fromFloat(double v, unsigned decimals) {
+        _sso[0] = '\0';
+        char *b = (char *) malloc(decimals + 42); // dtostrf() num buffer do heap
+        gStringHeap.mallocs++;
+        const int n = snprintf(b, decimals + 42, "%*.*f", (int) decimals + 2, (int) decimals, v);
+        copy(b, (unsigned) n);
+        free(b);
+        gStringHeap.frees++;
+    }
+
+    char *_heap = nullptr;
+    unsigned _cap = 0;
+    unsigned _len = 0;
+    char _sso[kSsoSize];
+};
+
+class IPAddress {
+public:
+    IPAddress() {}
+
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _b[0] = a;
+        _b[1] = b;
+        _b[2] = c;
+        _b[3] = d;
+    }
+
+    uint8_t operator[](int i) const { return _b[i]; }
+
+private:
+    uint8_t _b[4] = {};
+};
+
+inline unsigned long micros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long) ((uint64_t) ts.tv_sec * 1000000ull + (uint64_t) ts.tv_nsec / 1000ull);
+}
+
+inline unsigned long millis() {
+    return micros() / 1000ul;
+}
+
+inline void delay(unsigned long ms) {
+    usleep((useconds_t) (ms * 1000ul));
+}
+
+inline void yield() {
+}
@@ -0,0 +1,131 @@
+// Modelo do WebServer::handleClient() do arduino-esp32 2.0.x (ver WebServer.h).
+
+#include "WebServer.h"
+
+void WebServer::handleClient() {
+    if (_status == HC_NONE) {
+        WiFiClient c = _server.available();
+        if (!c) {
+            delay(1); // _nullDelay
+            return;
+        }
+        _client = c;
+        _status = HC_WAIT_READ;
+        _statusChange = millis();
+    }
+
+    bool keepCurrentClient = false;
+    if (_client.connected()) {
+        if (_client.available()) {
+            if (parseRequest()) {
+                _client.setTimeout(HTTP_MAX_SEND_WAIT);
+                handleRequest();
+            }
+        } else if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
+            keepCurrentClient = true; // próximo handleClient() volta a este cliente
+        }
+    }
+
+    if (!keepCurrentClient) {
+        _client = WiFiClient(); // último handle: fecha o socket
+        _status = HC_NONE;
+    }
+}
+
+bool WebServer::parseRequest() {
+    // Request line: METHOD SP URI SP VERSION
+    const String line = _client.readStringUntil('\r');
+    _client.readStringUntil('\n');
+
+    for (size_t i = 0; i < _headers.size(); i++) _headers[i].value = String();
+    _plain = String();
+    _extra = String();
+
+    const char *l = line.c_str();
+    const char *sp1 = strchr(l, ' ');
+    const char *sp2 = sp1 ? strchr(sp1 + 1, ' ') : nullptr;
+    if (!sp1 || !sp2) return false;
+
+    const std::string method(l, (size_t) (sp1 - l));
+    _method = method == "GET" ? HTTP_GET : (method == "POST" ? HTTP_POST : HTTP_ANY);
+
+    const char *uri = sp1 + 1;
+    const char *q = (const char *) memchr(uri, '?', (size_t) (sp2 - uri));
+    _uri = String(uri, (size_t) ((q ? q : sp2) - uri));
+
+    size_t contentLength = 0;
+    for (;;) {
+        const String h = _client.readStringUntil('\r');
+        _client.readStringUntil('\n');
+        if (h.isEmpty()) break;
+
+        const char *s = h.c_str();
+        const char *colon = strchr(s, ':');
+        if (!colon) continue;
+
+        const String name(s, (size_t) (colon - s));
+        const char *value = colon + 1;
+        while (*value == ' ') value++;
+
+        if (name.equalsIgnoreCase("Content-Length")) contentLength = (size_t) strtoul(value, nullptr, 10);
+        for (size_t i = 0; i < _headers.size(); i++) {
+            if (_headers[i].name.equalsIgnoreCase(name)) _headers[i].value = value;
+        }
+    }
+
+    if (contentLength == 0) return true;
+
+    // readBytesWithTimeout(): até HTTP_MAX_POST_WAIT sem nenhum byte novo
+    std::string body;
+    body.reserve(contentLength);
+    while (body.size() < contentLength) {
+        int tries = HTTP_MAX_POST_WAIT;
+        int avail = 0;
+        while ((avail = _client.available()) == 0 && tries--) delay(1);
+        if (avail == 0) return false;
+
+        uint8_t buf[512];
+        size_t n = (size_t) avail;
+        if (n > sizeof(buf)) n = sizeof(buf);
+        if (n > contentLength - body.size()) n = contentLength - body.size();
+        const int got = _client.read(buf, n);
+        if (got <= 0) return false;
+        body.append((const char *) buf, (size_t) got);
+    }
+    _plain = String(body.c_str(), body.size());
+    return true;
+}
+
+void WebServer::handleRequest() {
+    for (size_t i = 0; i < _routes.size(); i++) {
+        const Route &r = _routes[i];
+        if ((r.method == HTTP_ANY || r.method == _method) && r.uri == _uri) {
+            r.fn();
+            return;
+        }
+    }
+    if (_notFound) _notFound();
+}
+
+String WebServer::header(const char *name) const {
+    for (size_t i = 0; i < _headers.size(); i++) {
+        if (_headers[i].name.equalsIgnoreCase(name)) return _headers[i].value;
+    }
+    return String();
+}
+
+void WebServer::send_P(int code, const char *contentType, const char *content, size_t len) {
+    char head[160];
+    const int n = snprintf(head, sizeof(head),
+                           "HTTP/1.1 %d %s\r\n"
+                           "Content-Type: %s\r\n"
+                           "Content-Length: %u\r\n",
+                           code, code == 200 ? "OK" : "Error", contentType, (unsigned) len);
+
+    String out(head, (size_t) n);
+    out += _extra;
+    out += "Connection: close\r\n\r\n";
+
+    _client.write((const uint8_t *) out.c_str(), out.length());
+    if (len > 0) _client.write((const uint8_t *) content, len);
+}
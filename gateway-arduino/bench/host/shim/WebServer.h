@@ -0,0 +1,121 @@
+// Modelo do WebServer do arduino-esp32 2.0.x para o teste de carga no host.
+//
+// Reproduz o caminho de handleClient() que o modo Sync do HttpServer usa: um
+// cliente por vez, espera até HTTP_MAX_DATA_WAIT pelo 1º byte, lê request line,
+// cabeçalhos (Stream::readStringUntil, timeout de 1 s) e body (até
+// HTTP_MAX_POST_WAIT) de forma bloqueante, chama a rota e responde sempre com
+// "Connection: close". Sem cliente pendente, handleClient() faz delay(1).
+// Só o necessário para o HttpServer: sem query args, upload ou autenticação.
+
+#pragma once
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+#include <functional>
+#include <vector>
+
+enum HTTPMethod {
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_POST
+};
+
+#define HTTP_MAX_DATA_WAIT 5000 // ms até o 1º byte do request
+#define HTTP_MAX_POST_WAIT 5000 // ms de espera pelo body
+#define HTTP_MAX_SEND_WAIT 5000 // ms de timeout de escrita
+
+class WebServer {
+public:
+    using THandlerFunction = std::function<void(void)>;
+
+    explicit WebServer(uint16_t port) : _server(port) {}
+
+    void begin() { _server.begin(); }
+
+    void handleClient();
+
+    void on(const char *uri, HTTPMethod method, THandlerFunction fn) {
+        Route r;
+        r.uri = uri;
+        r.method = method;
+        r.fn = fn;
+        _routes.push_back(r);
+    }
+
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+    void collectHeaders(const char *keys[], size_t count) {
+        _headers.clear();
+        for (size_t i = 0; i < count; i++) {
+            Header h;
+            h.name = keys[i];
+            _headers.push_back(h);
+        }
+    }
+
+    String header(const char *name) const;
+
+    String uri() const { return _uri; }
+
+    HTTPMethod method() const { return _method; }
+
+    // Só o body ("plain")
+    String arg(const char *name) const { return strcmp(name, "plain") == 0 ? _plain : String(); }
+
+    String arg(int) const { return _plain; }
+
+    String argName(int) const { return String("plain"); }
+
+    int args() const { return _plain.isEmpty() ? 0 : 1; }
+
+    WiFiClient &client() { return _client; }
+
+    void sendHeader(const char *name, const char *value) {
+        _extra += name;
+        _extra += ": ";
+        _extra += value;
+        _extra += "\r\n";
+    }
+
+    void send(int code, const char *contentType, const String &content) {
+        send_P(code, contentType, content.c_str(), content.length());
+    }
+
+    void send_P(int code, const char *contentType, const char *content, size_t len);
+
+private:
+    enum Status {
+        HC_NONE,
+        HC_WAIT_READ
+    };
+
+    struct Route {
+        String uri;
+        HTTPMethod method = HTTP_ANY;
+        THandlerFunction fn;
+    };
+
+    struct Header {
+        String name;
+        String value;
+    };
+
+    bool parseRequest();
+
+    void handleRequest();
+
+    WiFiServer _server;
+    WiFiClient _client;
+    Status _status = HC_NONE;
+    unsigned long _statusChange = 0;
+
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    std::vector<Header> _headers;
+
+    String _uri;
+    HTTPMethod _method = HTTP_ANY;
+    String _plain;
+    String _extra;
+};
@@ -0,0 +1,7 @@
+// Shim do WiFi.h (arduino-esp32) para o teste de carga no host.
+
+#pragma once
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
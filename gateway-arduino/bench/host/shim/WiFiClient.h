@@ -0,0 +1,138 @@
+// Shim do WiFiClient (arduino-esp32) sobre sockets POSIX.
+//
+// Como no core, cópias compartilham o socket e o último handle fecha o fd.
+
+#pragma once
+
+#include "Arduino.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+
+class WiFiClient {
+public:
+    WiFiClient() {}
+
+    explicit WiFiClient(int fd) : _sock(std::make_shared<Socket>(fd)) {}
+
+    explicit operator bool() const { return _sock && _sock->fd >= 0; }
+
+    uint8_t connected() {
+        if (!*this) return 0;
+        if (available() > 0) return 1;
+        char b;
+        const ssize_t r = recv(_sock->fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (r == 0) return 0; // FIN
+        return (r > 0 || errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : 0;
+    }
+
+    int available() {
+        if (!*this) return 0;
+        int n = 0;
+        if (ioctl(_sock->fd, FIONREAD, &n) < 0) return 0;
+        return n;
+    }
+
+    int read(uint8_t *buf, size_t len) {
+        if (!*this) return -1;
+        const ssize_t r = recv(_sock->fd, buf, len, MSG_DONTWAIT);
+        return r > 0 ? (int) r : -1;
+    }
+
+    int read() {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+
+    // lwIP copia para o buffer de envio e bloqueia quando ele enche
+    size_t write(const uint8_t *buf, size_t len) {
+        if (!*this) return 0;
+        size_t done = 0;
+        while (done < len) {
+            const ssize_t w = send(_sock->fd, buf + done, len - done, MSG_NOSIGNAL);
+            if (w <= 0) break;
+            done += (size_t) w;
+        }
+        return done;
+    }
+
+    size_t write(const char *s) { return write((const uint8_t *) s, strlen(s)); }
+
+    // Stream::timedRead(): espera até _timeoutMs por 1 byte
+    int timedRead() {
+        const unsigned long start = millis();
+        do {
+            const int c = read();
+            if (c >= 0) return c;
+            if (!connected()) return -1;
+            pollIn(1);
+        } while (millis() - start < _timeoutMs);
+        return -1;
+    }
+
+    String readStringUntil(char terminator) {
+        std::string s;
+        int c = timedRead();
+        while (c >= 0 && c != terminator) {
+            s += (char) c;
+            c = timedRead();
+        }
+        return String(s.c_str(), s.size());
+    }
+
+    size_t readBytes(uint8_t *buf, size_t len) {
+        size_t n = 0;
+        while (n < len) {
+            const int c = timedRead();
+            if (c < 0) break;
+            buf[n++] = (uint8_t) c;
+        }
+        return n;
+    }
+
+    void setTimeout(unsigned long ms) { _timeoutMs = ms; }
+
+    void setNoDelay(bool on) {
+        if (!*this) return;
+        const int v = on ? 1 : 0;
+        setsockopt(_sock->fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+    }
+
+    // Todos os clientes saem de 127.0.0.1: reporta a sub-rede do gateway
+    IPAddress remoteIP() const { return IPAddress(192, 168, 3, 20); }
+
+    void stop() {
+        if (!_sock) return;
+        _sock->close();
+        _sock.reset();
+    }
+
+private:
+    struct Socket {
+        int fd;
+
+        explicit Socket(int f) : fd(f) {}
+
+        ~Socket() { close(); }
+
+        void close() {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    };
+
+    void pollIn(int ms) {
+        pollfd p = {_sock->fd, POLLIN, 0};
+        poll(&p, 1, ms);
+    }
+
+    std::shared_ptr<Socket> _sock;
+    unsigned long _timeoutMs = 1000; // Stream: 1 s por padrão
+};
@@ -0,0 +1,57 @@
+// Shim do WiFiServer (arduino-esp32): socket de escuta não bloqueante em 127.0.0.1.
+
+#pragma once
+
+#include "WiFiClient.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+
+class WiFiServer {
+public:
+    // Mesmo padrão do core: backlog do listen() = max_clients
+    explicit WiFiServer(uint16_t port, uint8_t maxClients = 4) : _port(port), _maxClients(maxClients) {}
+
+    ~WiFiServer() { end(); }
+
+    void begin() {
+        if (_fd >= 0) return;
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_fd, (sockaddr *) &addr, sizeof(addr)) < 0 || listen(_fd, _maxClients) < 0) {
+            perror("WiFiServer");
+            exit(1);
+        }
+        fcntl(_fd, F_SETFL, O_NONBLOCK);
+    }
+
+    void end() {
+        if (_fd >= 0) ::close(_fd);
+        _fd = -1;
+    }
+
+    void setNoDelay(bool on) { _noDelay = on; }
+
+    // Não bloqueia: cliente vazio se não há conexão pendente
+    WiFiClient available() {
+        if (_fd < 0) return WiFiClient();
+        const int fd = accept(_fd, nullptr, nullptr);
+        if (fd < 0) return WiFiClient();
+
+        WiFiClient c(fd);
+        if (_noDelay) c.setNoDelay(true);
+        return c;
+    }
+
+private:
+    uint16_t _port;
+    uint8_t _maxClients;
+    int _fd = -1;
+    bool _noDelay = false;
+};
@@ -0,0 +1,102 @@
+/**
+ * @file DeviceTable.h
+ * @brief Fixed-capacity per-device telemetry table (struct-of-arrays).
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_DEVICETABLE_H
+#define GATEWAY_ARDUINO_DEVICETABLE_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef DEVICE_TABLE_CAPACITY
+#define DEVICE_TABLE_CAPACITY 16
+#endif
+
+/**
+ * @brief Latest telemetry of every device, keyed by X-Device-Id.
+ *
+ * - Rows live in a fixed array (no heap, no per-request allocation).
+ * - Numeric fields are stored column-wise (struct-of-arrays) so scans such as
+ *   GET /devices touch only the columns they need.
+ * - Lookup goes through an open-addressing index (FNV-1a, linear probing,
+ *   2x the row capacity), so it is O(1) expected instead of a linear scan.
+ * - When the table is full the least recently updated device is evicted.
+ */
+class DeviceTable {
+public:
+    static constexpr uint8_t kCapacity = DEVICE_TABLE_CAPACITY;
+    static constexpr size_t kMaxIdLen = 31;
+    static constexpr uint8_t kNone = 0xFF;
+
+    static_assert(kCapacity > 0 && kCapacity < kNone, "DEVICE_TABLE_CAPACITY must be 1..254");
+
+    DeviceTable();
+
+    /**
+     * @brief Find a device row.
+     *
+     * @param id Device ID bytes.
+     * @param len ID length.
+     * @return Row index or kNone.
+     */
+    uint8_t find(const char *id, size_t len) const;
+
+    /**
+     * @brief Find a device row, creating it (possibly evicting the LRU row).
+     *
+     * @return Row index or kNone if the ID is empty/too long.
+     */
+    uint8_t findOrInsert(const char *id, size_t len, uint32_t nowMs);
+
+    /**
+     * @brief Number of rows in use; rows are always 0..count()-1.
+     */
+    uint8_t count() const noexcept { return _count; }
+
+    const char *id(uint8_t row) const { return _ids[row]; }
+
+    // FNV-1a do ID (estável entre evictions; usado como tag no histórico)
+    uint32_t idHash(uint8_t row) const { return _hash[row]; }
+
+    uint32_t evictions() const noexcept { return _evictions; }
+
+    // ===== Columns (struct-of-arrays) =====
+    float temperature[kCapacity];
+    float humidity[kCapacity];
+    int16_t fuelLevel[kCapacity]; // <0 = ausente
+    float stepperSpeed[kCapacity];
+    float stepperRpm[kCapacity];
+    uint32_t counter[kCapacity];
+    uint32_t lastUpdateMs[kCapacity];
+    uint32_t sampleTs[kCapacity]; // epoch da amostra (0 = não enviado)
+
+private:
+    // potência de 2 >= 2 * kCapacity (carga <= 50%)
+    static constexpr uint16_t kIndexSize =
+            kCapacity <= 16 ? 32 : (kCapacity <= 32 ? 64 : (kCapacity <= 64 ? 128 : (kCapacity <= 128 ? 256 : 512)));
+
+    static uint32_t hashId(const char *id, size_t len);
+
+    uint16_t probe(uint32_t hash, const char *id, size_t len) const;
+
+    void resetRow(uint8_t row);
+
+    void rebuildIndex();
+
+    char _ids[kCapacity][kMaxIdLen + 1];
+    uint8_t _idLen[kCapacity];
+    uint32_t _hash[kCapacity];
+
+    uint8_t _index[kIndexSize]; // slot -> row (kNone = vazio)
+    uint8_t _count = 0;
+    uint32_t _evictions = 0;
+};
+
+#endif // GATEWAY_ARDUINO_DEVICETABLE_H
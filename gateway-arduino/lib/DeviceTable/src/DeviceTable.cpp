@@ -0,0 +1,107 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "DeviceTable.h"
+
+#include <math.h>
+#include <string.h>
+
+constexpr uint8_t DeviceTable::kCapacity;
+constexpr uint8_t DeviceTable::kNone;
+constexpr size_t DeviceTable::kMaxIdLen;
+
+DeviceTable::DeviceTable() {
+    memset(_index, kNone, sizeof(_index));
+    for (uint8_t r = 0; r < kCapacity; r++) resetRow(r);
+}
+
+uint32_t DeviceTable::hashId(const char *id, size_t len) {
+    // FNV-1a 32 bits
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t) id[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint16_t DeviceTable::probe(uint32_t hash, const char *id, size_t len) const {
+    uint16_t slot = (uint16_t) (hash & (kIndexSize - 1));
+    for (;;) {
+        const uint8_t row = _index[slot];
+        if (row == kNone) return slot;
+        if (_hash[row] == hash && _idLen[row] == len && memcmp(_ids[row], id, len) == 0) return slot;
+        slot = (uint16_t) ((slot + 1) & (kIndexSize - 1));
+    }
+}
+
+uint8_t DeviceTable::find(const char *id, size_t len) const {
+    if (!id || len == 0 || len > kMaxIdLen) return kNone;
+    return _index[probe(hashId(id, len), id, len)];
+}
+
+uint8_t DeviceTable::findOrInsert(const char *id, size_t len, uint32_t nowMs) {
+    if (!id || len == 0 || len > kMaxIdLen) return kNone;
+
+    const uint32_t h = hashId(id, len);
+    const uint16_t slot = probe(h, id, len);
+    if (_index[slot] != kNone) return _index[slot];
+
+    uint8_t row;
+    bool evicted = false;
+    if (_count < kCapacity) {
+        row = _count++;
+    } else {
+        // Tabela cheia: reaproveita o device há mais tempo sem atualização
+        row = 0;
+        uint32_t oldestAge = 0;
+        for (uint8_t r = 0; r < kCapacity; r++) {
+            const uint32_t age = nowMs - lastUpdateMs[r];
+            if (age >= oldestAge) {
+                oldestAge = age;
+                row = r;
+            }
+        }
+        _evictions++;
+        evicted = true;
+    }
+
+    resetRow(row);
+    memcpy(_ids[row], id, len);
+    _ids[row][len] = '\0';
+    _idLen[row] = (uint8_t) len;
+    _hash[row] = h;
+    lastUpdateMs[row] = nowMs;
+
+    if (evicted) {
+        // Remoção em open addressing quebra cadeias: reconstrói (raro, O(capacidade))
+        rebuildIndex();
+    } else {
+        _index[slot] = row;
+    }
+    return row;
+}
+
+void DeviceTable::resetRow(uint8_t row) {
+    _ids[row][0] = '\0';
+    _idLen[row] = 0;
+    _hash[row] = 0;
+
+    temperature[row] = NAN;
+    humidity[row] = NAN;
+    fuelLevel[row] = -1;
+    stepperSpeed[row] = NAN;
+    stepperRpm[row] = NAN;
+    counter[row] = 0;
+    lastUpdateMs[row] = 0;
+    sampleTs[row] = 0;
+}
+
+void DeviceTable::rebuildIndex() {
+    memset(_index, kNone, sizeof(_index));
+    for (uint8_t r = 0; r < _count; r++) {
+        if (_idLen[r] == 0) continue;
+        _index[probe(_hash[r], _ids[r], _idLen[r])] = r;
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file GatewayMetrics.h
+ * @brief Counters, latency histograms and gauges exported as GET /metrics.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_GATEWAYMETRICS_H
+#define GATEWAY_ARDUINO_GATEWAYMETRICS_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * @brief Fixed-bucket latency histogram (microseconds, no heap).
+ */
+class LatencyHistogram {
+public:
+    static constexpr uint8_t kBuckets = 12;
+
+    /**
+     * @brief Upper bound (inclusive, us) of bucket @p i; the last implicit bucket is +Inf.
+     */
+    static uint32_t bound(uint8_t i);
+
+    void observe(uint32_t us);
+
+    uint32_t bucket(uint8_t i) const { return _counts[i]; } // i in [0, kBuckets] (kBuckets = +Inf)
+    uint32_t count() const noexcept { return _count; }
+    uint64_t sumUs() const noexcept { return _sumUs; }
+
+private:
+    uint32_t _counts[kBuckets + 1] = {};
+    uint32_t _count = 0;
+    uint64_t _sumUs = 0;
+};
+
+/**
+ * @brief Gateway instrumentation rendered in Prometheus text format.
+ *
+ * - One counter per SecureAuthResult.error code (plus "other").
+ * - One histogram per stage of the telemetry POST path.
+ * - Heap gauges, and gauges/counters registered by their owners (queue
+ *   depths, connections, ...), read at scrape time.
+ *
+ * Each histogram is written by a single task (HTTP stages by loop(),
+ * uplink stages by the uplink task); a scrape may see a value a few
+ * increments stale, which is fine for monitoring.
+ */
+class GatewayMetrics {
+public:
+    enum class Stage : uint8_t {
+        Headers = 0, // cópia + presença/allow-list dos headers
+        Replay, // janela de timestamp + nonce
+        Hmac,
+        BodyDecode, // hex/base64url + IV/tag
+        Decrypt, // AES-GCM
+        Parse, // TelemetryParser
+        Ubidots, // publish (task de uplink)
+        ThingSpeak, // publish (task de uplink)
+        Count
+    };
+
+    static constexpr uint8_t kMaxGauges = 16;
+
+    using GaugeFn = std::function<double()>;
+
+    /**
+     * @brief Record one stage duration.
+     */
+    void observe(Stage stage, uint32_t us);
+
+    /**
+     * @brief Count a SecureHttp outcome (@p error empty = accepted).
+     */
+    void countAuth(const String &error);
+
+    /**
+     * @brief Register a value read at scrape time.
+     *
+     * @param name Metric name (literal; e.g. "gateway_uplink_queue_depth").
+     * @param help One-line description (literal).
+     * @param counter true => TYPE counter, false => TYPE gauge.
+     * @return false if the gauge table is full.
+     */
+    bool addGauge(const char *name, const char *help, bool counter, GaugeFn fn);
+
+    /**
+     * @brief Render everything in Prometheus text exposition format 0.0.4.
+     */
+    String render() const;
+
+    const LatencyHistogram &histogram(Stage s) const { return _stages[(size_t) s]; }
+
+private:
+    static const char *stageName(Stage s);
+
+    struct Gauge {
+        const char *name;
+        const char *help;
+        bool counter;
+        GaugeFn fn;
+    };
+
+    LatencyHistogram _stages[(size_t) Stage::Count];
+
+    uint32_t _authOk = 0;
+    uint32_t _authErrors[24] = {}; // índice = posição em kAuthErrors (último = other)
+
+    Gauge _gauges[kMaxGauges];
+    uint8_t _gaugeCount = 0;
+};
+
+#endif // GATEWAY_ARDUINO_GATEWAYMETRICS_H
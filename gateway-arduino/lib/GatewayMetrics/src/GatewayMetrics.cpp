@@ -0,0 +1,174 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "GatewayMetrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+constexpr uint8_t LatencyHistogram::kBuckets;
+constexpr uint8_t GatewayMetrics::kMaxGauges;
+
+namespace {
+    // Códigos estáveis de SecureAuthResult.error (SecureGatewayAuth)
+    const char *const kAuthErrors[] = {
+        "missing_headers",
+        "unknown_device",
+        "bad_timestamp",
+        "timestamp_out_of_window",
+        "replay_nonce",
+        "bad_body",
+        "hmac_failed",
+        "bad_signature",
+        "bad_iv_or_tag",
+        "bad_cipher_hex",
+        "decrypt_failed",
+        "bad_nonce",
+        "body_too_large",
+        "bad_headers",
+        "unsupported_encoding",
+        "replay_cache_full",
+        "unknown_session",
+        "bad_seq",
+        "seq_too_old",
+        "replay_seq",
+        "unknown_key",
+        "unsupported_protocol",
+        "other"
+    };
+
+    constexpr size_t kAuthErrorCount = sizeof(kAuthErrors) / sizeof(kAuthErrors[0]);
+    static_assert(kAuthErrorCount <= 24, "grow GatewayMetrics::_authErrors");
+
+    void appendHeader(String &out, const char *name, const char *help, const char *type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+} // namespace
+
+uint32_t LatencyHistogram::bound(uint8_t i) {
+    // 100us .. 1s (escala ~1-2.5-5)
+    static const uint32_t bounds[kBuckets] = {
+        100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+    };
+    return (i < kBuckets) ? bounds[i] : UINT32_MAX;
+}
+
+void LatencyHistogram::observe(uint32_t us) {
+    uint8_t i = 0;
+    while (i < kBuckets && us > bound(i)) i++;
+    _counts[i]++;
+    _count++;
+    _sumUs += us;
+}
+
+const char *GatewayMetrics::stageName(Stage s) {
+    switch (s) {
+        case Stage::Headers: return "headers";
+        case Stage::Replay: return "replay_check";
+        case Stage::Hmac: return "hmac";
+        case Stage::BodyDecode: return "body_decode";
+        case Stage::Decrypt: return "gcm_decrypt";
+        case Stage::Parse: return "parse";
+        case Stage::Ubidots: return "ubidots_publish";
+        case Stage::ThingSpeak: return "thingspeak_publish";
+        default: return "unknown";
+    }
+}
+
+void GatewayMetrics::observe(Stage stage, uint32_t us) {
+    if (stage >= Stage::Count) return;
+    _stages[(size_t) stage].observe(us);
+}
+
+void GatewayMetrics::countAuth(const String &error) {
+    if (error.isEmpty()) {
+        _authOk++;
+        return;
+    }
+
+    size_t i = 0;
+    while (i < kAuthErrorCount - 1 && strcmp(error.c_str(), kAuthErrors[i]) != 0) i++;
+    _authErrors[i]++; // não encontrado => "other"
+}
+
+bool GatewayMetrics::addGauge(const char *name, const char *help, bool counter, GaugeFn fn) {
+    if (_gaugeCount >= kMaxGauges || !name || !fn) return false;
+    _gauges[_gaugeCount++] = Gauge{name, help ? help : "", counter, fn};
+    return true;
+}
+
+String GatewayMetrics::render() const {
+    char line[112];
+
+    String out;
+    out.reserve(6144);
+
+    // ===== SecureHttp =====
+    appendHeader(out, "gateway_secure_auth_ok_total", "Requests accepted by SecureGatewayAuth.", "counter");
+    snprintf(line, sizeof(line), "gateway_secure_auth_ok_total %lu\n", (unsigned long) _authOk);
+    out += line;
+
+    appendHeader(out, "gateway_secure_auth_errors_total", "SecureHttp rejections by SecureAuthResult.error.", "counter");
+    for (size_t i = 0; i < kAuthErrorCount; i++) {
+        snprintf(line, sizeof(line), "gateway_secure_auth_errors_total{error=\"%s\"} %lu\n",
+                 kAuthErrors[i], (unsigned long) _authErrors[i]);
+        out += line;
+    }
+
+    // ===== Latência por estágio (buckets cumulativos) =====
+    appendHeader(out, "gateway_stage_latency_us", "Wall time per telemetry pipeline stage (microseconds).",
+                 "histogram");
+    for (size_t s = 0; s < (size_t) Stage::Count; s++) {
+        const LatencyHistogram &h = _stages[s];
+        const char *name = stageName((Stage) s);
+
+        uint32_t cumulative = 0;
+        for (uint8_t b = 0; b < LatencyHistogram::kBuckets; b++) {
+            cumulative += h.bucket(b);
+            snprintf(line, sizeof(line), "gateway_stage_latency_us_bucket{stage=\"%s\",le=\"%lu\"} %lu\n",
+                     name, (unsigned long) LatencyHistogram::bound(b), (unsigned long) cumulative);
+            out += line;
+        }
+        snprintf(line, sizeof(line), "gateway_stage_latency_us_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n",
+                 name, (unsigned long) h.count());
+        out += line;
+        snprintf(line, sizeof(line), "gateway_stage_latency_us_sum{stage=\"%s\"} %llu\n",
+                 name, (unsigned long long) h.sumUs());
+        out += line;
+        snprintf(line, sizeof(line), "gateway_stage_latency_us_count{stage=\"%s\"} %lu\n",
+                 name, (unsigned long) h.count());
+        out += line;
+    }
+
+    // ===== Heap =====
+    appendHeader(out, "gateway_heap_free_bytes", "Free heap now.", "gauge");
+    snprintf(line, sizeof(line), "gateway_heap_free_bytes %lu\n", (unsigned long) ESP.getFreeHeap());
+    out += line;
+
+    appendHeader(out, "gateway_heap_min_free_bytes", "Lowest free heap since boot.", "gauge");
+    snprintf(line, sizeof(line), "gateway_heap_min_free_bytes %lu\n", (unsigned long) ESP.getMinFreeHeap());
+    out += line;
+
+    appendHeader(out, "gateway_heap_max_alloc_bytes", "Largest allocatable block (fragmentation).", "gauge");
+    snprintf(line, sizeof(line), "gateway_heap_max_alloc_bytes %lu\n", (unsigned long) ESP.getMaxAllocHeap());
+    out += line;
+
+    // ===== Registrados pelos donos (filas, conexões, ...) =====
+    for (uint8_t i = 0; i < _gaugeCount; i++) {
+        const Gauge &g = _gauges[i];
+        appendHeader(out, g.name, g.help, g.counter ? "counter" : "gauge");
+        snprintf(line, sizeof(line), "%s %.10g\n", g.name, g.fn());
+        out += line;
+    }
+
+    return out;
+}
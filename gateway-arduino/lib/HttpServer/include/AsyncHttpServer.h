@@ -0,0 +1,196 @@
+/**
+ * @file AsyncHttpServer.h
+ * @brief Non-blocking, multi-connection HTTP/1.1 server for the gateway ingest path.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_ASYNCHTTPSERVER_H
+#define GATEWAY_ARDUINO_ASYNCHTTPSERVER_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+
+#include "HttpMessage.h"
+
+/**
+ * @brief Event-driven HTTP server built on WiFiServer.
+ *
+ * Unlike WebServer::handleClient(), which serves one client until it is done,
+ * update() accepts every pending connection and advances each one only with the
+ * bytes already available on its socket. A slow or stalled client therefore
+ * never blocks the others (nor the rest of loop()); it is dropped once
+ * @c requestTimeoutMs expires.
+ *
+ * Each connection owns a fixed request buffer allocated once in begin(), so the
+ * request line, headers and body are parsed in place.
+ *
+ * Streamed bodies: with onBody() set, the head handler sees every request as
+ * soon as its headers are parsed (req.bodyLen = Content-Length, no body yet)
+ * and picks a BodyMode. Stream hands the body to the body handler chunk by
+ * chunk as it arrives and never keeps it, so the connection buffer only has to
+ * fit the headers; Reject answers at once without reading the body.
+ *
+ * Keep-alive: HTTP/1.1 connections (and HTTP/1.0 ones that ask for it) stay
+ * open after the response, so a device pays the TCP handshake once instead of
+ * per sample. Requests pipelined behind the current one are kept in the buffer
+ * and answered in order, one per update(). Errors that leave the body unread
+ * (4xx before the body, timeouts) still close. A connection idle for
+ * @c keepAliveIdleMs is closed, and when the pool is full the longest-idle one
+ * makes room for a new client instead of a 503.
+ */
+class AsyncHttpServer {
+public:
+    /**
+     * @brief struct Config.
+     */
+    struct Config {
+        uint16_t port = 80;
+        uint8_t maxConnections = 8; // conexões simultâneas
+        size_t maxRequestBytes = 2048; // request line + headers (+ body, se não for streamed)
+        uint32_t requestTimeoutMs = 3000; // derruba clientes lentos/parados
+        size_t maxReadPerUpdate = 1024; // fairness entre conexões
+        uint32_t keepAliveIdleMs = 15000; // ociosa entre requests (0 = sempre Connection: close)
+        uint16_t maxRequestsPerConnection = 100; // depois responde com Connection: close
+    };
+
+    using Handler = std::function<void(const HttpRequest &, HttpResponse &)>;
+
+    /**
+     * @brief What to do with the body of a request whose headers were just parsed.
+     */
+    enum class BodyMode : uint8_t {
+        Buffer = 0, // body inteiro no buffer da conexão (padrão)
+        Stream, // body em pedaços para o BodyHandler, sem ficar no buffer
+        Reject // responde já com a HttpResponse preenchida, sem ler o body
+    };
+
+    using HeadHandler = std::function<BodyMode(const HttpRequest &, HttpResponse &)>;
+
+    // false: resp preenchida com o erro; a conexão é respondida e fechada
+    using BodyHandler = std::function<bool(const HttpRequest &, const uint8_t *, size_t, HttpResponse &)>;
+
+    // Conexão de um body Stream fechada antes do dispatch (timeout, peer, erro)
+    using AbortHandler = std::function<void(const HttpRequest &)>;
+
+    /**
+     * @brief AsyncHttpServer.
+     */
+    explicit AsyncHttpServer(const Config &cfg);
+
+    ~AsyncHttpServer();
+
+    AsyncHttpServer(const AsyncHttpServer &) = delete;
+
+    AsyncHttpServer &operator=(const AsyncHttpServer &) = delete;
+
+    /**
+     * @brief begin.
+     */
+    void begin();
+
+    /**
+     * @brief update (non-blocking; call in loop()).
+     */
+    void update();
+
+    /**
+     * @brief onRequest.
+     */
+    void onRequest(Handler h);
+
+    /**
+     * @brief onBody (streamed bodies; see the class description).
+     *
+     * A Stream request reaches the request handler once the whole body went
+     * through @p body, with req.body empty.
+     */
+    void onBody(HeadHandler head, BodyHandler body, AbortHandler abort);
+
+    uint8_t activeConnections() const;
+
+    uint32_t rejectedConnections() const noexcept { return _rejected; }
+    uint32_t timedOutConnections() const noexcept { return _timedOut; }
+
+    // Requests atendidos numa conexão já usada (keep-alive)
+    uint32_t reusedRequests() const noexcept { return _reused; }
+
+private:
+    enum class State : uint8_t {
+        Idle = 0,
+        Reading
+    };
+
+    struct Connection {
+        WiFiClient client;
+        State state = State::Idle;
+
+        char *buf = nullptr;
+        size_t len = 0;
+
+        size_t headEnd = 0; // 0 = cabeçalho ainda incompleto
+        size_t contentLength = 0;
+        bool streaming = false; // body entregue ao BodyHandler
+        size_t bodyRead = 0; // bytes do body já entregues (streaming)
+        uint32_t startedMs = 0; // início do request (ou da espera pelo próximo)
+
+        bool keepAlive = false; // resposta atual mantém a conexão aberta
+        bool pending = false; // request pipelined já no buffer, ainda não analisado
+        uint16_t served = 0; // requests respondidos nesta conexão
+
+        HttpRequest req;
+    };
+
+    void acceptPending();
+
+    void serviceConnection(Connection &c);
+
+    bool parseHead(Connection &c);
+
+    // Decide o BodyMode logo após o cabeçalho; true = seguir bufferizando o body
+    bool startBody(Connection &c);
+
+    void serviceStream(Connection &c);
+
+    bool feedBody(Connection &c, const char *data, size_t len);
+
+    void dispatch(Connection &c);
+
+    // Após a resposta: fecha ou prepara a conexão para o próximo request
+    void finishRequest(Connection &c);
+
+    // Keep-alive sem request em andamento
+    static bool waitingNext(const Connection &c) { return c.served > 0 && c.len == 0; }
+
+    // Fecha a conexão keep-alive ociosa há mais tempo (pool cheio)
+    Connection *evictIdle();
+
+    void sendResponse(Connection &c, const HttpResponse &resp);
+
+    void sendError(Connection &c, int code, const char *error);
+
+    void closeConnection(Connection &c);
+
+    // Libera o slot sem fechar o socket (conexão assumida pela rota)
+    void releaseConnection(Connection &c);
+
+    Config _cfg{};
+    WiFiServer _listener;
+    Handler _handler;
+    HeadHandler _onHead;
+    BodyHandler _onBody;
+    AbortHandler _onAbort;
+
+    Connection *_conns = nullptr;
+
+    uint32_t _rejected = 0;
+    uint32_t _timedOut = 0;
+    uint32_t _reused = 0;
+};
+
+#endif // GATEWAY_ARDUINO_ASYNCHTTPSERVER_H
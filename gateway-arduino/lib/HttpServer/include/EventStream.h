@@ -0,0 +1,90 @@
+/**
+ * @file EventStream.h
+ * @brief Bounded Server-Sent Events fan-out (GET /telemetry/stream).
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_EVENTSTREAM_H
+#define GATEWAY_ARDUINO_EVENTSTREAM_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+/**
+ * @brief Holds open SSE connections and pushes events to them.
+ *
+ * - At most Config::maxSubscribers connections (fixed slots, no heap).
+ * - Writes go straight to the socket with MSG_DONTWAIT: a subscriber whose
+ *   TCP send buffer cannot take the whole event is dropped immediately, so a
+ *   slow consumer never blocks telemetry ingest.
+ * - update() sends a heartbeat comment and reaps closed connections.
+ */
+class EventStream {
+public:
+    static constexpr uint8_t kMaxSlots = 8;
+
+    struct Config {
+        uint8_t maxSubscribers = 4; // <= kMaxSlots
+        uint32_t heartbeatMs = 15000; // comentário ": ping" (mantém proxies/NAT vivos)
+        uint32_t retryMs = 3000; // "retry:" sugerido ao EventSource
+    };
+
+    static constexpr size_t kMaxEventBytes = 576; // evento montado na pilha
+
+    explicit EventStream(const Config &cfg);
+
+    /**
+     * @brief Take over a client: writes the SSE response head.
+     *
+     * @param client Connection of the current request (copied; socket is shared).
+     * @param filterHash FNV-1a of the device ID to follow (0 = all devices).
+     * @return false if all slots are busy or the head could not be written.
+     */
+    bool subscribe(WiFiClient &client, uint32_t filterHash);
+
+    /**
+     * @brief Push one event to every matching subscriber.
+     *
+     * @param event SSE event name.
+     * @param id Event id (e.g. telemetry counter).
+     * @param deviceHash FNV-1a of the source device (matched against filters).
+     * @param data Single-line payload (JSON).
+     * @param len Payload length (event framing must fit kMaxEventBytes).
+     * @return Number of subscribers that received the event.
+     */
+    uint8_t publish(const char *event, uint32_t id, uint32_t deviceHash, const char *data, size_t len);
+
+    /**
+     * @brief Heartbeat + cleanup (call from loop).
+     */
+    void update();
+
+    uint8_t subscribers() const noexcept { return _active; }
+    uint32_t dropped() const noexcept { return _dropped; }
+
+private:
+    struct Slot {
+        WiFiClient client;
+        bool used = false;
+        uint32_t filterHash = 0;
+    };
+
+    // Escrita não bloqueante; false = não coube inteiro (consumidor lento/fechado)
+    static bool writeAll(WiFiClient &client, const char *data, size_t len);
+
+    void drop(Slot &s);
+
+    Config _cfg;
+    Slot _slots[kMaxSlots];
+
+    uint8_t _active = 0;
+    uint32_t _dropped = 0;
+    uint32_t _lastHeartbeatMs = 0;
+};
+
+#endif // GATEWAY_ARDUINO_EVENTSTREAM_H
@@ -0,0 +1,150 @@
+/**
+ * @file HttpMessage.h
+ * @brief Transport-agnostic HTTP request/response used by HttpServer routes.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_HTTPMESSAGE_H
+#define GATEWAY_ARDUINO_HTTPMESSAGE_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h> // HTTPMethod
+#include <WiFiClient.h>
+
+/**
+ * @brief Headers the gateway reads (everything else is ignored).
+ *
+ * The same list feeds WebServer::collectHeaders() (sync mode) and the
+ * in-place header parser of AsyncHttpServer.
+ */
+enum class HttpHeader : uint8_t {
+    DeviceId = 0,
+    Timestamp,
+    Nonce,
+    Iv,
+    Tag,
+    Signature,
+    ContentType,
+    Origin,
+    IfNoneMatch,
+    BodyEncoding, // X-Body-Encoding (SecureHttp: hex | raw | base64url)
+    Session, // X-Session (SecureHttp, modo sessão)
+    Seq, // X-Seq
+    KeyVersion, // X-Key-Version (SecureKeyStore: chave usada pelo device)
+    SecureVersion, // X-Secure-Version (SecureHttp: 1 = GCM + HMAC, 2 = só GCM)
+    SecurePacked, // X-SecureHttp (SecureHttp v2: metadados do envelope num header só)
+    Count
+};
+
+/**
+ * @brief Wire name of a collected header.
+ */
+const char *httpHeaderName(HttpHeader h);
+
+/**
+ * @brief Parsed request view.
+ *
+ * All pointers reference storage owned by the transport (WebServer Strings or
+ * the connection buffer of AsyncHttpServer) and are valid only while the
+ * route handler runs. Strings are NUL-terminated; absent headers are "".
+ */
+struct HttpRequest {
+    HTTPMethod method = HTTP_ANY;
+    const char *path = "";
+    const char *query = ""; ///< Raw query string without '?'.
+
+    const char *headers[(size_t) HttpHeader::Count] = {};
+
+    const char *body = "";
+    size_t bodyLen = 0;
+
+    IPAddress remoteIP;
+
+    WiFiClient *client = nullptr; ///< Underlying connection (streaming routes only).
+
+    uint8_t connection = 0; ///< AsyncHttpServer slot (ties a streamed body to its request).
+
+    const char *header(HttpHeader h) const {
+        const char *v = headers[(size_t) h];
+        return v ? v : "";
+    }
+
+    bool hasHeader(HttpHeader h) const { return header(h)[0] != '\0'; }
+
+    /**
+     * @brief Read and URL-decode one query parameter.
+     *
+     * @param name Parameter name.
+     * @param out Destination buffer (always NUL-terminated on success).
+     * @param outLen Destination size.
+     * @return true if the parameter is present and fits in @p out.
+     */
+    bool queryParam(const char *name, char *out, size_t outLen) const;
+};
+
+/**
+ * @brief Response filled by a route handler and written by the transport.
+ */
+struct HttpResponse {
+    static constexpr uint8_t kMaxHeaders = 4;
+    static constexpr uint8_t kMaxHeaderValue = 40;
+
+    int code = 200;
+    const char *contentType = "application/json";
+    String body;
+    const char *bodyPtr = nullptr; ///< Set by sendCached(); takes precedence over body.
+    size_t bodyPtrLen = 0;
+
+    // Headers extras (ETag, Cache-Control, ...); nomes devem ser literais
+    const char *headerNames[kMaxHeaders] = {};
+    char headerValues[kMaxHeaders][kMaxHeaderValue + 1] = {};
+    uint8_t headerCount = 0;
+
+    bool detached = false; ///< Route took over req.client (SSE): transport must not reply.
+
+    void send(int httpCode, const char *type, const String &content) {
+        code = httpCode;
+        contentType = type;
+        body = content;
+        bodyPtr = nullptr;
+        bodyPtrLen = 0;
+    }
+
+    /**
+     * @brief Send a body owned by the caller without copying it (no heap).
+     *
+     * @p content must outlive the transport write (e.g. a cache or reply
+     * buffer member of the server).
+     */
+    void sendCached(int httpCode, const char *type, const char *content, size_t len) {
+        code = httpCode;
+        contentType = type;
+        body = String();
+        bodyPtr = content;
+        bodyPtrLen = len;
+    }
+
+    const char *data() const { return bodyPtr ? bodyPtr : body.c_str(); }
+
+    size_t length() const { return bodyPtr ? bodyPtrLen : body.length(); }
+
+    bool addHeader(const char *name, const char *value) {
+        if (headerCount >= kMaxHeaders || strlen(value) > kMaxHeaderValue) return false;
+        headerNames[headerCount] = name;
+        strcpy(headerValues[headerCount], value);
+        headerCount++;
+        return true;
+    }
+};
+
+/**
+ * @brief Standard reason phrase for the status codes the gateway emits.
+ */
+const char *httpReasonPhrase(int code);
+
+#endif // GATEWAY_ARDUINO_HTTPMESSAGE_H
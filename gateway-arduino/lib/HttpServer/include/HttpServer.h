@@ -19,6 +19,35 @@
 // SecureHttp (gateway side)
 #include <SecureGatewayAuth.h>
 
+#include "HttpMessage.h"
+#include "AsyncHttpServer.h"
+#include "EventStream.h"
+
+#include <DeviceTable.h>
+#include <TelemetryParser.h>
+#include <TelemetryHistory.h>
+#include <GatewayMetrics.h>
+
+#ifndef TELEMETRY_BATCH_MAX
+#define TELEMETRY_BATCH_MAX 10 // amostras por POST /telemetry/batch
+#endif
+
+#ifndef TELEMETRY_TS_MAX_FUTURE_SEC
+#define TELEMETRY_TS_MAX_FUTURE_SEC 300 // "ts" da amostra à frente do relógio do gateway (além disso: 400)
+#endif
+
+#ifndef TELEMETRY_WORK_BYTES
+#define TELEMETRY_WORK_BYTES 1600 // texto claro de 1 POST (SecureStreamVerifier::plaintextBytesFor)
+#endif
+
+#ifndef TELEMETRY_STREAM_SLOTS
+#define TELEMETRY_STREAM_SLOTS 2 // POSTs SecureHttp verificados em paralelo enquanto o body chega (Async)
+#endif
+
+#ifndef TELEMETRY_REPLY_BYTES
+#define TELEMETRY_REPLY_BYTES 640 // resposta dos POSTs (montada sem heap)
+#endif
+
 /**
  * @brief class HttpServer.
  */
@@ -28,6 +57,8 @@ public:
      * @brief struct Telemetry.
      */
     struct Telemetry {
+        char deviceId[DeviceTable::kMaxIdLen + 1] = {}; // X-Device-Id de origem
+
         bool hasData = false;
 
         float temperature = NAN;
@@ -40,14 +71,30 @@ public:
 
         uint32_t counter = 0;
         uint32_t lastUpdateMs = 0;
+        uint32_t sampleTs = 0; // epoch informado pelo device (0 = não enviado)
     };
 
     using TelemetryCallback = std::function<void(const Telemetry &)>;
 
+    /**
+     * @brief Transport used to serve requests.
+     *
+     * - Sync:  WebServer::handleClient() (one client at a time).
+     * - Async: AsyncHttpServer (many connections, non-blocking update()).
+     *
+     * Routes and SecureHttp checks are identical in both modes.
+     */
+    enum class Mode : uint8_t {
+        Sync = 0,
+        Async
+    };
+
     /**
      * @brief HttpServer.
      */
-    explicit HttpServer(uint16_t port);
+    explicit HttpServer(uint16_t port, Mode mode = Mode::Sync);
+
+    Mode mode() const noexcept { return _mode; }
 
     /**
      * @brief begin.
@@ -59,8 +106,28 @@ public:
      */
     void update();
 
+    // Último device atualizado (compatível com o gateway de device único)
     const Telemetry &telemetry() const;
 
+    /**
+     * @brief Snapshot of one device by ID.
+     *
+     * @return false if the device is unknown.
+     */
+    bool telemetryFor(const char *deviceId, Telemetry &out) const;
+
+    const DeviceTable &devices() const noexcept { return _devices; }
+
+    const TelemetryHistory &history() const noexcept { return _history; }
+
+    const EventStream &stream() const noexcept { return _stream; }
+
+    // Instrumentação (GET /metrics); main registra gauges/estágios do uplink
+    GatewayMetrics &metrics() noexcept { return _metrics; }
+
+    // Chaves SecureHttp por device (put/rotate/remove gravam no NVS); main expõe a rotação no Serial
+    SecureKeyStore &keys() { return _secureAuth.keys(); }
+
     // Ubidots (imediato)
     /**
      * @brief onTelemetryUpdated.
@@ -89,35 +156,139 @@ public:
 private:
     void registerRoutes();
 
+    /**
+     * @brief serveSync (adapts WebServer's current request to route()).
+     */
+    void serveSync();
+
+    /**
+     * @brief route (single dispatch point for both transports).
+     */
+    void route(const HttpRequest &req, HttpResponse &resp);
+
     /**
      * @brief handleRoot.
      */
-    void handleRoot();
+    void handleRoot(const HttpRequest &req, HttpResponse &resp);
 
     /**
      * @brief handleTelemetryGet.
      */
-    void handleTelemetryGet();
+    void handleTelemetryGet(const HttpRequest &req, HttpResponse &resp);
 
     /**
      * @brief handleTelemetryPost.
      */
-    void handleTelemetryPost();
+    void handleTelemetryPost(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief handleTelemetryBatchPost.
+     */
+    void handleTelemetryBatchPost(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief handleSessionPost (POST /session: handshake do modo sessão SecureHttp).
+     */
+    void handleSessionPost(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief handleHistoryGet (GET /telemetry/history?since=&step=&device=).
+     */
+    void handleHistoryGet(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief handleStreamGet (GET /telemetry/stream, Server-Sent Events).
+     */
+    void handleStreamGet(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief handleMetricsGet (GET /metrics, formato Prometheus).
+     */
+    void handleMetricsGet(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief handleDevicesGet.
+     */
+    void handleDevicesGet(const HttpRequest &req, HttpResponse &resp);
 
     /**
      * @brief handleNotFound.
      */
-    void handleNotFound();
+    void handleNotFound(const HttpRequest &req, HttpResponse &resp);
 
     /**
-     * @brief tryExtractJsonNumber.
+     * @brief verifySecurePost (origem + SecureHttp; preenche resp em caso de erro).
+     *
+     * Async: conclui a verificação iniciada em beginSecureBody().
      */
-    bool tryExtractJsonNumber(const String &json, const char *key, float &out);
+    bool verifySecurePost(const HttpRequest &req, const char *path, SecureAuthResult &res, HttpResponse &resp);
 
     /**
-     * @brief makeTelemetryJson.
+     * @brief precheckSecurePost (origem, JSON sem SecureHttp, encoding; só cabeçalhos).
      */
-    String makeTelemetryJson(const Telemetry &t);
+    bool precheckSecurePost(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief reportSecureAuth (métricas do SecureGatewayAuth; resposta de erro se !res.ok).
+     */
+    bool reportSecureAuth(const SecureAuthResult &res, HttpResponse &resp);
+
+    /**
+     * @brief beginSecureBody (Async: cabeçalho de um POST SecureHttp -> slot de streaming).
+     */
+    AsyncHttpServer::BodyMode beginSecureBody(const HttpRequest &req, HttpResponse &resp);
+
+    /**
+     * @brief feedSecureBody (Async: HMAC/GCM sobre cada pedaço do body).
+     */
+    bool feedSecureBody(const HttpRequest &req, const uint8_t *data, size_t len, HttpResponse &resp);
+
+    /**
+     * @brief abortSecureBody (Async: conexão caiu no meio do body).
+     */
+    void abortSecureBody(const HttpRequest &req);
+
+    /**
+     * @brief applySample (histórico + campos presentes na row do device).
+     * @param stored Lote "stored":true (reenvio do flash do device): só histórico.
+     * @return false se a amostra é guardada ou mais antiga que a row (só entrou no
+     *         histórico) ou tem "ts" no futuro (descartada).
+     */
+    bool applySample(uint8_t row, const TelemetryParser::Sample &sample, uint32_t nowMs, bool stored = false);
+
+    /**
+     * @brief publishRow (snapshot + callbacks após atualizar um device).
+     */
+    void publishRow(uint8_t row);
+
+    /**
+     * @brief snapshot (row da DeviceTable -> Telemetry).
+     */
+    void snapshot(uint8_t row, Telemetry &out) const;
+
+    static constexpr size_t kTelemetryJsonBytes = 448;
+
+    /**
+     * @brief writeTelemetryJson (snprintf em buffer fixo; retorna o tamanho escrito).
+     */
+    static size_t writeTelemetryJson(const Telemetry &t, char *out, size_t cap);
+
+    /**
+     * @brief JSON serializado de um device, reconstruído só quando counter muda.
+     */
+    struct TelemetryCache {
+        bool valid = false;
+        uint32_t counter = 0;
+        uint32_t lastUpdateMs = 0; // distingue row reaproveitada após eviction
+        char etag[32] = {};
+        char json[kTelemetryJsonBytes] = {};
+        uint16_t jsonLen = 0;
+    };
+
+    /**
+     * @brief cachedTelemetry (hit: nenhuma concatenação/float->texto).
+     */
+    const TelemetryCache &cachedTelemetry(uint8_t row);
 
     /**
      * @brief tickThingSpeakTimer.
@@ -127,16 +298,44 @@ private:
     // ====== Security helpers ======
     void setupSecureHeadersCollection();
 
-    // ❗removido const (WebServer::client() não é const)
-    bool isClientAllowed();
+    bool isClientAllowed(const HttpRequest &req) const;
 
 private:
+    Mode _mode;
+
     WebServer _server;
+    AsyncHttpServer _async;
 
     // SecureHttp verifier/decryptor (uses SecureHttpConfig.h)
     SecureGatewayAuth _secureAuth;
 
-    Telemetry _telemetry;
+    DeviceTable _devices; // estado por device (X-Device-Id)
+    Telemetry _telemetry; // snapshot do último device atualizado
+    uint8_t _lastRow = DeviceTable::kNone; // row do último device atualizado
+
+    GatewayMetrics _metrics;
+
+    EventStream _stream; // assinantes SSE (push a cada update aceito)
+
+    TelemetryHistory _history; // últimas amostras (todos os devices), GET /telemetry/history
+
+    TelemetryCache _telemetryCache[DeviceTable::kCapacity]; // GET /telemetry (ETag/304)
+
+    /**
+     * @brief POST SecureHttp em andamento: verificador + texto claro (memória fixa).
+     */
+    struct SecureSlot {
+        bool busy = false;
+        uint8_t connection = 0; // HttpRequest::connection dono do slot
+        SecureStreamVerifier verifier;
+        uint8_t work[TELEMETRY_WORK_BYTES];
+    };
+
+    SecureSlot *slotFor(const HttpRequest &req);
+
+    // Buffers do POST: nenhum malloc no caminho de ingestão (Sync usa o slot 0)
+    SecureSlot _secureSlots[TELEMETRY_STREAM_SLOTS];
+    char _reply[TELEMETRY_REPLY_BYTES];
 
     TelemetryCallback _onTelemetryUpdated; // Ubidots
     TelemetryCallback _onThingSpeakDue; // ThingSpeak
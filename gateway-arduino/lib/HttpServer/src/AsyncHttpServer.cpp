@@ -0,0 +1,503 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "AsyncHttpServer.h"
+
+#include <string.h>
+#include <strings.h>
+
+namespace {
+    char *trimInPlace(char *s) {
+        while (*s == ' ' || *s == '\t') s++;
+        char *e = s + strlen(s);
+        while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) *--e = '\0';
+        return s;
+    }
+
+    HTTPMethod parseMethod(const char *m) {
+        if (strcmp(m, "GET") == 0) return HTTP_GET;
+        if (strcmp(m, "POST") == 0) return HTTP_POST;
+        return HTTP_ANY; // não suportado pelas rotas do gateway
+    }
+
+    // Procura "\r\n\r\n" a partir de `from`; retorna o offset do início do body ou 0.
+    size_t findHeadEnd(const char *buf, size_t len, size_t from) {
+        for (size_t i = from; i + 3 < len; i++) {
+            if (buf[i] == '\r' && buf[i + 1] == '\n' && buf[i + 2] == '\r' && buf[i + 3] == '\n') {
+                return i + 4;
+            }
+        }
+        return 0;
+    }
+} // namespace
+
+AsyncHttpServer::AsyncHttpServer(const Config &cfg)
+    : _cfg(cfg), _listener(cfg.port) {
+    if (_cfg.maxConnections == 0) _cfg.maxConnections = 1;
+    if (_cfg.maxRequestBytes < 256) _cfg.maxRequestBytes = 256;
+}
+
+AsyncHttpServer::~AsyncHttpServer() {
+    if (!_conns) return;
+    for (uint8_t i = 0; i < _cfg.maxConnections; i++) {
+        _conns[i].client.stop();
+        delete[] _conns[i].buf;
+    }
+    delete[] _conns;
+}
+
+void AsyncHttpServer::begin() {
+    // Buffers alocados uma única vez (sem heap por request)
+    if (!_conns) {
+        _conns = new Connection[_cfg.maxConnections];
+        for (uint8_t i = 0; i < _cfg.maxConnections; i++) {
+            _conns[i].buf = new char[_cfg.maxRequestBytes + 1];
+        }
+    }
+
+    _listener.begin();
+    _listener.setNoDelay(true);
+}
+
+void AsyncHttpServer::onRequest(Handler h) {
+    _handler = h;
+}
+
+void AsyncHttpServer::onBody(HeadHandler head, BodyHandler body, AbortHandler abort) {
+    _onHead = head;
+    _onBody = body;
+    _onAbort = abort;
+}
+
+uint8_t AsyncHttpServer::activeConnections() const {
+    if (!_conns) return 0;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _cfg.maxConnections; i++) {
+        if (_conns[i].state != State::Idle) n++;
+    }
+    return n;
+}
+
+void AsyncHttpServer::update() {
+    if (!_conns) return;
+
+    acceptPending();
+
+    for (uint8_t i = 0; i < _cfg.maxConnections; i++) {
+        if (_conns[i].state != State::Idle) serviceConnection(_conns[i]);
+    }
+}
+
+void AsyncHttpServer::acceptPending() {
+    for (;;) {
+        WiFiClient incoming = _listener.available();
+        if (!incoming) return;
+
+        Connection *slot = nullptr;
+        for (uint8_t i = 0; i < _cfg.maxConnections; i++) {
+            if (_conns[i].state == State::Idle) {
+                slot = &_conns[i];
+                break;
+            }
+        }
+        if (!slot) slot = evictIdle();
+
+        if (!slot) {
+            // Sem slot livre: responde 503 e fecha (não bloqueia quem já está conectado)
+            _rejected++;
+            static const char busy[] =
+                    "HTTP/1.1 503 Service Unavailable\r\n"
+                    "Content-Type: application/json\r\n"
+                    "Content-Length: 27\r\n"
+                    "Connection: close\r\n\r\n"
+                    "{\"ok\":false,\"error\":\"busy\"}";
+            incoming.write((const uint8_t *) busy, sizeof(busy) - 1);
+            incoming.stop();
+            continue;
+        }
+
+        slot->client = incoming;
+        slot->req = HttpRequest();
+        slot->req.connection = (uint8_t) (slot - _conns);
+        slot->client.setNoDelay(true);
+        slot->state = State::Reading;
+        slot->len = 0;
+        slot->headEnd = 0;
+        slot->contentLength = 0;
+        slot->streaming = false;
+        slot->bodyRead = 0;
+        slot->keepAlive = false;
+        slot->pending = false;
+        slot->served = 0;
+        slot->startedMs = millis();
+    }
+}
+
+AsyncHttpServer::Connection *AsyncHttpServer::evictIdle() {
+    Connection *oldest = nullptr;
+    const uint32_t now = millis();
+    for (uint8_t i = 0; i < _cfg.maxConnections; i++) {
+        Connection &c = _conns[i];
+        if (c.state == State::Idle || !waitingNext(c)) continue;
+        if (!oldest || now - c.startedMs > now - oldest->startedMs) oldest = &c;
+    }
+    if (oldest) closeConnection(*oldest);
+    return oldest;
+}
+
+void AsyncHttpServer::serviceConnection(Connection &c) {
+    if (waitingNext(c)) {
+        // Keep-alive ocioso: fecha sem resposta (não é um request atrasado)
+        if (millis() - c.startedMs > _cfg.keepAliveIdleMs) {
+            closeConnection(c);
+            return;
+        }
+    } else if (millis() - c.startedMs > _cfg.requestTimeoutMs) {
+        _timedOut++;
+        sendError(c, 408, "request_timeout");
+        return;
+    }
+
+    if (c.streaming) {
+        serviceStream(c);
+        return;
+    }
+
+    // Request pipelined: o buffer inteiro ainda não foi analisado
+    const size_t before = c.pending ? 0 : c.len;
+    c.pending = false;
+    size_t budget = _cfg.maxReadPerUpdate;
+
+    while (budget > 0) {
+        const int avail = c.client.available();
+        if (avail <= 0) break;
+
+        const size_t space = _cfg.maxRequestBytes - c.len;
+        if (space == 0) break; // cabeçalho pode já estar completo (body streamed)
+
+        size_t n = (size_t) avail;
+        if (n > space) n = space;
+        if (n > budget) n = budget;
+
+        const int got = c.client.read((uint8_t *) c.buf + c.len, n);
+        if (got <= 0) break;
+
+        c.len += (size_t) got;
+        budget -= (size_t) got;
+    }
+
+    if (c.len == before) {
+        // Nada novo: se o peer fechou, libera o slot
+        if (!c.client.connected()) closeConnection(c);
+        return;
+    }
+
+    // 1º byte de um novo request numa conexão keep-alive: conta o timeout daqui
+    if (before == 0 && c.served > 0) c.startedMs = millis();
+
+    if (c.headEnd == 0) {
+        const size_t from = (before >= 3) ? before - 3 : 0;
+        const size_t end = findHeadEnd(c.buf, c.len, from);
+        if (end == 0) {
+            // Cabeçalho incompleto; buffer cheio sem "\r\n\r\n" não tem conserto
+            if (c.len >= _cfg.maxRequestBytes) sendError(c, 413, "request_too_large");
+            return;
+        }
+
+        c.headEnd = end;
+        if (!parseHead(c)) {
+            sendError(c, 400, "bad_request");
+            return;
+        }
+
+        if (!startBody(c)) return;
+    }
+
+    if (c.len - c.headEnd >= c.contentLength) dispatch(c);
+}
+
+bool AsyncHttpServer::startBody(Connection &c) {
+    c.req.bodyLen = c.contentLength; // body ainda não lido
+
+    BodyMode mode = BodyMode::Buffer;
+    HttpResponse resp;
+    if (_onHead) mode = _onHead(c.req, resp);
+    c.req.bodyLen = 0;
+
+    if (mode == BodyMode::Reject) {
+        // Ex.: Content-Length acima do limite: 413 antes de ler o body
+        c.keepAlive = false; // body não lido fica no socket
+        sendResponse(c, resp);
+        closeConnection(c);
+        return false;
+    }
+
+    if (mode == BodyMode::Buffer) {
+        if (c.headEnd + c.contentLength > _cfg.maxRequestBytes) {
+            sendError(c, 413, "request_too_large");
+            return false;
+        }
+        return true;
+    }
+
+    c.streaming = true; // daqui em diante fechar a conexão chama o AbortHandler
+    c.bodyRead = 0;
+
+    if (c.headEnd >= _cfg.maxRequestBytes) {
+        // Nenhum espaço para ler o body depois do cabeçalho
+        sendError(c, 413, "request_too_large");
+        return false;
+    }
+
+    // Bytes do body que chegaram junto com o cabeçalho
+    size_t early = c.len - c.headEnd;
+    if (early > c.contentLength) early = c.contentLength;
+    if (!feedBody(c, c.buf + c.headEnd, early)) return false;
+
+    if (c.bodyRead == c.contentLength) {
+        dispatch(c); // bytes após o body (pipelined) continuam no buffer
+        return false;
+    }
+
+    c.len = c.headEnd;
+    return false; // resto do body em serviceStream()
+}
+
+void AsyncHttpServer::serviceStream(Connection &c) {
+    // O body passa pelo espaço após o cabeçalho e é descartado a cada pedaço
+    char *chunk = c.buf + c.headEnd;
+    const size_t cap = _cfg.maxRequestBytes - c.headEnd;
+    size_t budget = _cfg.maxReadPerUpdate;
+    bool progressed = false;
+
+    while (budget > 0 && c.bodyRead < c.contentLength) {
+        const int avail = c.client.available();
+        if (avail <= 0) break;
+
+        size_t n = (size_t) avail;
+        if (n > cap) n = cap;
+        if (n > budget) n = budget;
+        if (n > c.contentLength - c.bodyRead) n = c.contentLength - c.bodyRead;
+
+        const int got = c.client.read((uint8_t *) chunk, n);
+        if (got <= 0) break;
+
+        budget -= (size_t) got;
+        progressed = true;
+        if (!feedBody(c, chunk, (size_t) got)) return;
+    }
+
+    if (c.bodyRead == c.contentLength) {
+        dispatch(c);
+        return;
+    }
+
+    if (!progressed && !c.client.connected()) closeConnection(c);
+}
+
+bool AsyncHttpServer::feedBody(Connection &c, const char *data, size_t len) {
+    c.bodyRead += len;
+    if (len == 0 || !_onBody) return true;
+
+    HttpResponse resp;
+    if (_onBody(c.req, (const uint8_t *) data, len, resp)) return true;
+
+    // Handler já descartou o estado do body: responde sem chamar o AbortHandler
+    c.streaming = false;
+    c.keepAlive = false;
+    sendResponse(c, resp);
+    closeConnection(c);
+    return false;
+}
+
+bool AsyncHttpServer::parseHead(Connection &c) {
+    // Termina o bloco de cabeçalho (o "\r\n\r\n" vira separadores)
+    c.buf[c.headEnd - 2] = '\0';
+
+    char *line = c.buf;
+    char *eol = strstr(line, "\r\n");
+    if (eol) *eol = '\0';
+
+    // Request line: METHOD SP TARGET SP VERSION
+    char *sp1 = strchr(line, ' ');
+    if (!sp1) return false;
+    *sp1 = '\0';
+
+    char *target = sp1 + 1;
+    char *sp2 = strchr(target, ' ');
+    if (!sp2) return false;
+    *sp2 = '\0';
+
+    // HTTP/1.1: keep-alive salvo "Connection: close"; HTTP/1.0 só se pedir
+    const bool http11 = strcmp(sp2 + 1, "HTTP/1.1") == 0;
+    bool keepAlive = http11;
+
+    c.req.method = parseMethod(line);
+
+    char *q = strchr(target, '?');
+    if (q) {
+        *q = '\0';
+        c.req.query = q + 1;
+    }
+    c.req.path = target;
+
+    // Header lines
+    char *p = eol ? eol + 2 : nullptr;
+    while (p && *p) {
+        char *next = strstr(p, "\r\n");
+        if (next) *next = '\0';
+
+        char *colon = strchr(p, ':');
+        if (colon) {
+            *colon = '\0';
+            char *name = trimInPlace(p);
+            char *value = trimInPlace(colon + 1);
+
+            if (strcasecmp(name, "Content-Length") == 0) {
+                c.contentLength = (size_t) strtoul(value, nullptr, 10);
+            } else if (strcasecmp(name, "Connection") == 0) {
+                if (strcasecmp(value, "close") == 0) keepAlive = false;
+                else if (strcasecmp(value, "keep-alive") == 0) keepAlive = true;
+            } else {
+                for (size_t i = 0; i < (size_t) HttpHeader::Count; i++) {
+                    if (strcasecmp(name, httpHeaderName((HttpHeader) i)) == 0) {
+                        c.req.headers[i] = value;
+                        break;
+                    }
+                }
+            }
+        }
+
+        p = next ? next + 2 : nullptr;
+    }
+
+    c.keepAlive = keepAlive && _cfg.keepAliveIdleMs > 0 && c.served + 1 < _cfg.maxRequestsPerConnection;
+    return true;
+}
+
+void AsyncHttpServer::dispatch(Connection &c) {
+    char *tail = nullptr; // byte trocado pelo NUL do body
+    char saved = '\0';
+
+    if (c.streaming) {
+        // Body já consumido pelo BodyHandler
+        c.streaming = false;
+        c.req.body = "";
+        c.req.bodyLen = 0;
+    } else {
+        // Body termina em NUL; o byte seguinte pode ser o início de um request pipelined
+        tail = c.buf + c.headEnd + c.contentLength;
+        saved = *tail;
+        *tail = '\0';
+
+        c.req.body = c.buf + c.headEnd;
+        c.req.bodyLen = c.contentLength;
+    }
+    c.req.remoteIP = c.client.remoteIP();
+    c.req.client = &c.client;
+    if (c.served > 0) _reused++;
+
+    HttpResponse resp;
+    if (_handler) {
+        _handler(c.req, resp);
+    } else {
+        resp.send(404, "application/json", "{\"error\":\"Not found\"}");
+    }
+
+    if (resp.detached) {
+        releaseConnection(c);
+        return;
+    }
+
+    sendResponse(c, resp);
+    if (tail) *tail = saved;
+    finishRequest(c);
+}
+
+void AsyncHttpServer::finishRequest(Connection &c) {
+    if (!c.keepAlive) {
+        closeConnection(c);
+        return;
+    }
+
+    // Bytes após este request = próximo request (pipelining), movidos para o início
+    const size_t end = c.headEnd + c.contentLength;
+    const size_t rest = (c.len > end) ? c.len - end : 0;
+    if (rest > 0) memmove(c.buf, c.buf + end, rest);
+
+    const uint8_t index = c.req.connection;
+    c.req = HttpRequest();
+    c.req.connection = index;
+    c.len = rest;
+    c.headEnd = 0;
+    c.contentLength = 0;
+    c.bodyRead = 0;
+    c.keepAlive = false;
+    c.pending = rest > 0; // analisado no próximo update() (fairness)
+    c.served++;
+    c.startedMs = millis();
+}
+
+void AsyncHttpServer::sendResponse(Connection &c, const HttpResponse &resp) {
+    const char *body = resp.data();
+    const size_t bodyLen = resp.length();
+
+    char head[320];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %u\r\n",
+                     resp.code, httpReasonPhrase(resp.code),
+                     resp.contentType ? resp.contentType : "text/plain",
+                     (unsigned) bodyLen);
+    if (n <= 0 || (size_t) n >= sizeof(head)) return;
+
+    for (uint8_t i = 0; i < resp.headerCount; i++) {
+        const int m = snprintf(head + n, sizeof(head) - (size_t) n, "%s: %s\r\n",
+                               resp.headerNames[i], resp.headerValues[i]);
+        if (m <= 0 || (size_t) (n + m) >= sizeof(head)) return;
+        n += m;
+    }
+
+    const int m = snprintf(head + n, sizeof(head) - (size_t) n, "Connection: %s\r\n\r\n",
+                           c.keepAlive ? "keep-alive" : "close");
+    if (m <= 0 || (size_t) (n + m) >= sizeof(head)) return;
+    n += m;
+
+    c.client.write((const uint8_t *) head, (size_t) n);
+    if (bodyLen > 0) {
+        c.client.write((const uint8_t *) body, bodyLen);
+    }
+}
+
+void AsyncHttpServer::sendError(Connection &c, int code, const char *error) {
+    c.keepAlive = false; // estado do request é desconhecido: fecha
+    HttpResponse resp;
+    resp.send(code, "application/json", String("{\"ok\":false,\"error\":\"") + error + "\"}");
+    sendResponse(c, resp);
+    closeConnection(c);
+}
+
+void AsyncHttpServer::closeConnection(Connection &c) {
+    if (c.streaming) {
+        // Body incompleto: quem recebia os pedaços libera o que reservou
+        c.streaming = false;
+        if (_onAbort) _onAbort(c.req);
+    }
+    c.client.stop();
+    releaseConnection(c);
+}
+
+void AsyncHttpServer::releaseConnection(Connection &c) {
+    c.client = WiFiClient();
+    c.state = State::Idle;
+    c.len = 0;
+    c.headEnd = 0;
+    c.contentLength = 0;
+    c.streaming = false;
+    c.bodyRead = 0;
+    c.keepAlive = false;
+    c.pending = false;
+    c.served = 0;
+}
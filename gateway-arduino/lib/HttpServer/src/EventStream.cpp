@@ -0,0 +1,122 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "EventStream.h"
+
+#include <lwip/sockets.h>
+#include <stdio.h>
+#include <string.h>
+
+constexpr uint8_t EventStream::kMaxSlots;
+constexpr size_t EventStream::kMaxEventBytes;
+
+EventStream::EventStream(const Config &cfg) : _cfg(cfg) {
+    if (_cfg.maxSubscribers == 0) _cfg.maxSubscribers = 1;
+    if (_cfg.maxSubscribers > kMaxSlots) _cfg.maxSubscribers = kMaxSlots;
+}
+
+bool EventStream::writeAll(WiFiClient &client, const char *data, size_t len) {
+    const int fd = client.fd();
+    if (fd < 0) return false;
+
+    // Escrita parcial deixaria o stream SSE corrompido: trata como falha
+    const ssize_t n = send(fd, data, len, MSG_DONTWAIT);
+    return n == (ssize_t) len;
+}
+
+void EventStream::drop(Slot &s) {
+    s.client.stop();
+    s.client = WiFiClient();
+    s.used = false;
+    if (_active > 0) _active--;
+}
+
+bool EventStream::subscribe(WiFiClient &client, uint32_t filterHash) {
+    if (_active >= _cfg.maxSubscribers) return false;
+
+    Slot *slot = nullptr;
+    for (uint8_t i = 0; i < _cfg.maxSubscribers; i++) {
+        if (!_slots[i].used) {
+            slot = &_slots[i];
+            break;
+        }
+    }
+    if (!slot) return false;
+
+    char head[192];
+    const int n = snprintf(head, sizeof(head),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/event-stream\r\n"
+                           "Cache-Control: no-cache\r\n"
+                           "Connection: keep-alive\r\n\r\n"
+                           "retry: %lu\n\n",
+                           (unsigned long) _cfg.retryMs);
+    if (n <= 0 || (size_t) n >= sizeof(head)) return false;
+
+    if (!writeAll(client, head, (size_t) n)) return false;
+
+    slot->client = client; // cópia compartilha o socket com a conexão da requisição
+    slot->filterHash = filterHash;
+    slot->used = true;
+    _active++;
+    return true;
+}
+
+uint8_t EventStream::publish(const char *event, uint32_t id, uint32_t deviceHash, const char *data, size_t len) {
+    if (_active == 0) return 0;
+
+    // Monta o evento uma vez (pilha, sem heap) e reaproveita para todos os assinantes
+    char msg[kMaxEventBytes];
+    const int head = snprintf(msg, sizeof(msg), "event: %s\nid: %lu\ndata: ", event, (unsigned long) id);
+    if (head <= 0 || (size_t) head + len + 2 > sizeof(msg)) return 0;
+
+    size_t msgLen = (size_t) head;
+    memcpy(msg + msgLen, data, len);
+    msgLen += len;
+    msg[msgLen++] = '\n';
+    msg[msgLen++] = '\n';
+
+    uint8_t delivered = 0;
+    for (uint8_t i = 0; i < _cfg.maxSubscribers; i++) {
+        Slot &s = _slots[i];
+        if (!s.used) continue;
+        if (s.filterHash != 0 && s.filterHash != deviceHash) continue;
+
+        if (writeAll(s.client, msg, msgLen)) {
+            delivered++;
+        } else {
+            drop(s);
+            _dropped++;
+        }
+    }
+    return delivered;
+}
+
+void EventStream::update() {
+    if (_active == 0) return;
+
+    const uint32_t now = millis();
+    const bool heartbeat = (now - _lastHeartbeatMs) >= _cfg.heartbeatMs;
+    if (heartbeat) _lastHeartbeatMs = now;
+
+    static const char ping[] = ": ping\n\n";
+
+    for (uint8_t i = 0; i < _cfg.maxSubscribers; i++) {
+        Slot &s = _slots[i];
+        if (!s.used) continue;
+
+        if (!s.client.connected()) {
+            drop(s);
+            continue;
+        }
+
+        // Descarta o que o cliente enviar (EventSource não envia nada)
+        while (s.client.available() > 0) s.client.read();
+
+        if (heartbeat && !writeAll(s.client, ping, sizeof(ping) - 1)) {
+            drop(s);
+            _dropped++;
+        }
+    }
+}
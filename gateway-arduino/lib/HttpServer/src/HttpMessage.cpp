@@ -0,0 +1,95 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "HttpMessage.h"
+
+#include <string.h>
+
+const char *httpHeaderName(HttpHeader h) {
+    static const char *const names[(size_t) HttpHeader::Count] = {
+        "X-Device-Id",
+        "X-Timestamp",
+        "X-Nonce",
+        "X-IV",
+        "X-Tag",
+        "X-Signature",
+        "Content-Type",
+        "Origin",
+        "If-None-Match",
+        "X-Body-Encoding",
+        "X-Session",
+        "X-Seq",
+        "X-Key-Version",
+        "X-Secure-Version",
+        "X-SecureHttp"
+    };
+
+    const size_t i = (size_t) h;
+    return (i < (size_t) HttpHeader::Count) ? names[i] : "";
+}
+
+const char *httpReasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 415: return "Unsupported Media Type";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
+    if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+    return -1;
+}
+
+bool HttpRequest::queryParam(const char *name, char *out, size_t outLen) const {
+    if (!name || !out || outLen == 0 || !query) return false;
+
+    const size_t nameLen = strlen(name);
+    const char *p = query;
+
+    while (*p) {
+        const char *amp = strchr(p, '&');
+        const char *end = amp ? amp : p + strlen(p);
+        const char *eq = (const char *) memchr(p, '=', (size_t) (end - p));
+        const char *keyEnd = eq ? eq : end;
+
+        if ((size_t) (keyEnd - p) == nameLen && memcmp(p, name, nameLen) == 0) {
+            size_t n = 0;
+            for (const char *v = eq ? eq + 1 : end; v < end; v++) {
+                char c = *v;
+                if (c == '+') {
+                    c = ' ';
+                } else if (c == '%' && v + 2 < end) {
+                    const int hi = hexValue(v[1]);
+                    const int lo = hexValue(v[2]);
+                    if (hi >= 0 && lo >= 0) {
+                        c = (char) ((hi << 4) | lo);
+                        v += 2;
+                    }
+                }
+                if (n + 1 >= outLen) return false;
+                out[n++] = c;
+            }
+            out[n] = '\0';
+            return true;
+        }
+
+        if (!amp) break;
+        p = amp + 1;
+    }
+    return false;
+}
@@ -4,29 +4,63 @@
 
 #include "HttpServer.h"
 
-HttpServer::HttpServer(uint16_t port)
-    : _server(port) {
+#include <TelemetryParser.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static_assert((size_t) SecureAuthTiming::StageCount == (size_t) GatewayMetrics::Stage::Parse,
+              "SecureAuthTiming stages must map 1:1 onto the first GatewayMetrics stages");
+
+constexpr size_t HttpServer::kTelemetryJsonBytes;
+
+// snprintf acumulando em buffer fixo (trunca em cap - 1)
+static void appendf(char *out, size_t cap, size_t &len, const char *fmt, ...) {
+    if (len + 1 >= cap) return;
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(out + len, cap - len, fmt, args);
+    va_end(args);
+    if (n > 0) len = ((size_t) n < cap - len) ? len + (size_t) n : cap - 1;
+}
+
+static void appendFloat(char *out, size_t cap, size_t &len, const char *key, float v, int decimals) {
+    if (isnan(v)) appendf(out, cap, len, ",\"%s\":null", key);
+    else appendf(out, cap, len, ",\"%s\":%.*f", key, decimals, (double) v);
+}
+
+static void sendLiteral(HttpResponse &resp, int code, const char *json) {
+    resp.sendCached(code, "application/json", json, strlen(json));
+}
+
+static AsyncHttpServer::Config asyncConfigFor(uint16_t port) {
+    AsyncHttpServer::Config cfg;
+    cfg.port = port;
+    // Só cabeçalho: bodies SecureHttp passam em streaming pelo verificador (SECURE_MAX_BODY_BYTES)
+    cfg.maxRequestBytes = 1024;
+    return cfg;
+}
+
+HttpServer::HttpServer(uint16_t port, Mode mode)
+    : _mode(mode), _server(port), _async(asyncConfigFor(port)), _stream(EventStream::Config()) {
 }
 
 void HttpServer::setupSecureHeadersCollection() {
     // IMPORTANTE: WebServer só expõe headers "coletados"
-    static const char *keys[] = {
-        "X-Device-Id",
-        "X-Timestamp",
-        "X-Nonce",
-        "X-IV",
-        "X-Tag",
-        "X-Signature",
-        "Content-Type",
-        "Origin"
-    };
+    // (mesma lista usada pelo parser do AsyncHttpServer)
+    static const char *keys[(size_t) HttpHeader::Count];
+    for (size_t i = 0; i < (size_t) HttpHeader::Count; i++) {
+        keys[i] = httpHeaderName((HttpHeader) i);
+    }
 
-    _server.collectHeaders(keys, sizeof(keys) / sizeof(keys[0]));
+    _server.collectHeaders(keys, (size_t) HttpHeader::Count);
 }
 
-// ✅ removido const aqui
-bool HttpServer::isClientAllowed() {
-    IPAddress rip = _server.client().remoteIP();
+bool HttpServer::isClientAllowed(const HttpRequest &req) const {
+    const IPAddress &rip = req.remoteIP;
 
     // Permite apenas 192.168.3.0/24 (ajuste conforme sua rede)
     const bool sameSubnet = (rip[0] == 192) && (rip[1] == 168) && (rip[2] == 3);
@@ -40,19 +74,53 @@ bool HttpServer::isClientAllowed() {
 }
 
 void HttpServer::begin() {
-    setupSecureHeadersCollection(); // <<< garante leitura dos headers X-*
+    if (_mode == Mode::Async) {
+        _async.onRequest([this](const HttpRequest &req, HttpResponse &resp) { route(req, resp); });
+        _async.onBody([this](const HttpRequest &req, HttpResponse &resp) { return beginSecureBody(req, resp); },
+                      [this](const HttpRequest &req, const uint8_t *data, size_t len, HttpResponse &resp) {
+                          return feedSecureBody(req, data, len, resp);
+                      },
+                      [this](const HttpRequest &req) { abortSecureBody(req); });
+        _async.begin();
+    } else {
+        setupSecureHeadersCollection(); // <<< garante leitura dos headers X-*
+
+        registerRoutes();
+        _server.begin();
+    }
 
-    registerRoutes();
-    _server.begin();
+    // Gauges lidos no scrape do /metrics
+    _metrics.addGauge("gateway_http_active_connections", "Open AsyncHttpServer connections.", false,
+                      [this]() { return (double) _async.activeConnections(); });
+    _metrics.addGauge("gateway_http_rejected_connections_total", "Connections refused (pool full).", true,
+                      [this]() { return (double) _async.rejectedConnections(); });
+    _metrics.addGauge("gateway_http_timed_out_connections_total", "Connections closed by request timeout.", true,
+                      [this]() { return (double) _async.timedOutConnections(); });
+    _metrics.addGauge("gateway_http_keepalive_requests_total", "Requests served on a reused (keep-alive) connection.",
+                      true, [this]() { return (double) _async.reusedRequests(); });
+    _metrics.addGauge("gateway_sse_subscribers", "Open /telemetry/stream subscribers.", false,
+                      [this]() { return (double) _stream.subscribers(); });
+    _metrics.addGauge("gateway_sse_dropped_total", "SSE subscribers dropped as slow/closed.", true,
+                      [this]() { return (double) _stream.dropped(); });
+    _metrics.addGauge("gateway_devices", "Rows in use in the DeviceTable.", false,
+                      [this]() { return (double) _devices.count(); });
+    _metrics.addGauge("gateway_history_samples", "Samples stored in TelemetryHistory.", false,
+                      [this]() { return (double) _history.size(); });
+    _metrics.addGauge("gateway_nonce_cache_entries", "Nonces held by the SecureHttp replay cache.", false,
+                      [this]() { return (double) _secureAuth.nonceCache().size(); });
+    _metrics.addGauge("gateway_secure_sessions", "Live SecureHttp sessions (X-Session).", false,
+                      [this]() { return (double) _secureAuth.sessions().size(millis()); });
 
     // Libera o 1º envio do ThingSpeak assim que chegar o 1º dado válido
     _lastThingSpeakSendMs = 0;
 
-    Serial.println("[HTTP] Server started");
+    Serial.println(_mode == Mode::Async ? "[HTTP] Server started (async)" : "[HTTP] Server started");
 }
 
 void HttpServer::update() {
-    _server.handleClient();
+    if (_mode == Mode::Async) _async.update(); // nunca bloqueia em um cliente
+    else _server.handleClient();
+    _stream.update(); // heartbeat + limpeza dos assinantes SSE
     tickThingSpeakTimer(); // timer do ThingSpeak roda no loop
 }
 
@@ -60,6 +128,31 @@ const HttpServer::Telemetry &HttpServer::telemetry() const {
     return _telemetry;
 }
 
+bool HttpServer::telemetryFor(const char *deviceId, Telemetry &out) const {
+    if (!deviceId) return false;
+    const uint8_t row = _devices.find(deviceId, strlen(deviceId));
+    if (row == DeviceTable::kNone) return false;
+    snapshot(row, out);
+    return true;
+}
+
+void HttpServer::snapshot(uint8_t row, Telemetry &out) const {
+    strncpy(out.deviceId, _devices.id(row), sizeof(out.deviceId) - 1);
+    out.deviceId[sizeof(out.deviceId) - 1] = '\0';
+
+    out.temperature = _devices.temperature[row];
+    out.humidity = _devices.humidity[row];
+    out.fuelLevel = _devices.fuelLevel[row];
+    out.stepperSpeed = _devices.stepperSpeed[row];
+    out.stepperRpm = _devices.stepperRpm[row];
+    out.counter = _devices.counter[row];
+    out.lastUpdateMs = _devices.lastUpdateMs[row];
+    out.sampleTs = _devices.sampleTs[row];
+
+    // Mantém seu comportamento: hasData=true somente quando temp e hum são válidos
+    out.hasData = !isnan(out.temperature) && !isnan(out.humidity);
+}
+
 // Ubidots (imediato)
 void HttpServer::onTelemetryUpdated(TelemetryCallback cb) {
     _onTelemetryUpdated = cb;
@@ -87,113 +180,529 @@ void HttpServer::markThingSpeakSent() {
 }
 
 void HttpServer::registerRoutes() {
-    _server.on("/", HTTP_GET, [this]() { handleRoot(); });
+    // Todas as rotas passam por route(): o mesmo código atende Sync e Async
+    _server.on("/", HTTP_GET, [this]() { serveSync(); });
+
+    _server.on("/telemetry", HTTP_GET, [this]() { serveSync(); });
+    _server.on("/telemetry", HTTP_POST, [this]() { serveSync(); });
+    _server.on("/telemetry/batch", HTTP_POST, [this]() { serveSync(); });
+    _server.on(SECURE_SESSION_PATH, HTTP_POST, [this]() { serveSync(); });
+    _server.on("/telemetry/history", HTTP_GET, [this]() { serveSync(); });
+    _server.on("/telemetry/stream", HTTP_GET, [this]() { serveSync(); });
+    _server.on("/devices", HTTP_GET, [this]() { serveSync(); });
+    _server.on("/metrics", HTTP_GET, [this]() { serveSync(); });
+
+    _server.onNotFound([this]() { serveSync(); });
+}
+
+void HttpServer::serveSync() {
+    String headerValues[(size_t) HttpHeader::Count];
+    const String uri = _server.uri();
+    const String body = _server.arg("plain");
+
+    // WebServer já separa os args; remonta a query para o parser comum
+    String query;
+    for (int i = 0; i < _server.args(); i++) {
+        const String name = _server.argName(i);
+        if (name == "plain") continue;
+        if (!query.isEmpty()) query += '&';
+        query += name;
+        query += '=';
+        query += _server.arg(i);
+    }
+
+    HttpRequest req;
+    req.method = _server.method();
+    req.path = uri.c_str();
+    req.query = query.c_str();
 
-    _server.on("/telemetry", HTTP_GET, [this]() { handleTelemetryGet(); });
-    _server.on("/telemetry", HTTP_POST, [this]() { handleTelemetryPost(); });
+    for (size_t i = 0; i < (size_t) HttpHeader::Count; i++) {
+        headerValues[i] = _server.header(httpHeaderName((HttpHeader) i));
+        req.headers[i] = headerValues[i].c_str();
+    }
+
+    req.body = body.c_str();
+    req.bodyLen = body.length();
+    req.remoteIP = _server.client().remoteIP();
+    req.client = &_server.client();
+
+    HttpResponse resp;
+    route(req, resp);
 
-    _server.onNotFound([this]() { handleNotFound(); });
+    // Rota assumiu a conexão (SSE): WebServer só solta sua referência
+    if (resp.detached) return;
+
+    for (uint8_t i = 0; i < resp.headerCount; i++) {
+        _server.sendHeader(resp.headerNames[i], resp.headerValues[i]);
+    }
+    _server.send_P(resp.code, resp.contentType, resp.data(), resp.length());
 }
 
-void HttpServer::handleRoot() {
-    _server.send(200, "text/plain",
-                 "gateway-arduino\n"
-                 "GET  /telemetry\n"
-                 "POST /telemetry (SecureHttp)\n"
-                 "\n"
-                 "POST /telemetry expects:\n"
-                 "  - Body: ciphertext HEX (AES-256-GCM)\n"
-                 "  - Headers: X-Device-Id, X-Timestamp, X-Nonce, X-IV, X-Tag, X-Signature\n");
+void HttpServer::route(const HttpRequest &req, HttpResponse &resp) {
+    if (strcmp(req.path, "/") == 0 && req.method == HTTP_GET) {
+        handleRoot(req, resp);
+        return;
+    }
+
+    if (strcmp(req.path, "/telemetry") == 0) {
+        if (req.method == HTTP_GET) {
+            handleTelemetryGet(req, resp);
+            return;
+        }
+        if (req.method == HTTP_POST) {
+            handleTelemetryPost(req, resp);
+            return;
+        }
+    }
+
+    if (strcmp(req.path, "/telemetry/batch") == 0 && req.method == HTTP_POST) {
+        handleTelemetryBatchPost(req, resp);
+        return;
+    }
+
+    if (strcmp(req.path, SECURE_SESSION_PATH) == 0 && req.method == HTTP_POST) {
+        handleSessionPost(req, resp);
+        return;
+    }
+
+    if (strcmp(req.path, "/telemetry/history") == 0 && req.method == HTTP_GET) {
+        handleHistoryGet(req, resp);
+        return;
+    }
+
+    if (strcmp(req.path, "/telemetry/stream") == 0 && req.method == HTTP_GET) {
+        handleStreamGet(req, resp);
+        return;
+    }
+
+    if (strcmp(req.path, "/devices") == 0 && req.method == HTTP_GET) {
+        handleDevicesGet(req, resp);
+        return;
+    }
+
+    if (strcmp(req.path, "/metrics") == 0 && req.method == HTTP_GET) {
+        handleMetricsGet(req, resp);
+        return;
+    }
+
+    handleNotFound(req, resp);
 }
 
-void HttpServer::handleTelemetryGet() {
-    _server.send(200, "application/json", makeTelemetryJson(_telemetry));
+void HttpServer::handleRoot(const HttpRequest &req, HttpResponse &resp) {
+    resp.send(200, "text/plain",
+              "gateway-arduino\n"
+              "GET  /telemetry[?device=<id>]\n"
+              "GET  /telemetry/history[?since=<epoch>&step=<s>&device=<id>]\n"
+              "GET  /telemetry/stream[?device=<id>] (Server-Sent Events)\n"
+              "GET  /devices\n"
+              "GET  /metrics (Prometheus)\n"
+              "POST /telemetry (SecureHttp)\n"
+              "POST /telemetry/batch (SecureHttp)\n"
+              "POST /session (SecureHttp session handshake)\n"
+              "\n"
+              "POST /telemetry expects:\n"
+              "  - Body: ciphertext (AES-256-GCM) as HEX, or raw/base64url with X-Body-Encoding\n"
+              "  - Headers: X-Device-Id, X-Timestamp, X-Nonce, X-IV, X-Tag, X-Signature\n"
+              "    (or X-Secure-Version: 2 without X-Signature: AES-GCM only, see SecureProtocol.h;\n"
+              "     or all of them packed in X-SecureHttp)\n"
+              "POST /telemetry/batch: same envelope, plaintext {\"samples\":[{\"ts\":...},...]}\n"
+              "Session mode: POST /session with plaintext {\"cr\":\"<hex>\"}, then\n"
+              "  X-Session + X-Seq only, body ciphertext||tag (see SecureSession.h)\n");
 }
 
-void HttpServer::handleTelemetryPost() {
-    // 1) Restrição de origem (por IP)
-    if (!isClientAllowed()) {
-        _server.send(403, "application/json", "{\"ok\":false,\"error\":\"forbidden_origin\"}");
+void HttpServer::handleTelemetryGet(const HttpRequest &req, HttpResponse &resp) {
+    uint8_t row = _lastRow; // sem ?device=: último device atualizado (comportamento anterior)
+
+    char deviceId[DeviceTable::kMaxIdLen + 1];
+    if (req.queryParam("device", deviceId, sizeof(deviceId))) {
+        row = _devices.find(deviceId, strlen(deviceId));
+        if (row == DeviceTable::kNone) {
+            resp.send(404, "application/json", "{\"ok\":false,\"error\":\"unknown_device\"}");
+            return;
+        }
+    }
+
+    if (row == DeviceTable::kNone) {
+        // Nenhum dado recebido ainda
+        resp.sendCached(200, "application/json", _reply, writeTelemetryJson(_telemetry, _reply, sizeof(_reply)));
         return;
     }
 
+    const TelemetryCache &cache = cachedTelemetry(row);
+    resp.addHeader("ETag", cache.etag);
+    resp.addHeader("Cache-Control", "no-cache"); // browser sempre revalida (barato: 304)
+
+    // If-None-Match pode trazer lista/W/; basta conter a tag atual
+    const char *inm = req.header(HttpHeader::IfNoneMatch);
+    if (inm[0] != '\0' && (strstr(inm, cache.etag) != nullptr || strcmp(inm, "*") == 0)) {
+        resp.send(304, "application/json", String());
+        return;
+    }
+
+    resp.sendCached(200, "application/json", cache.json, cache.jsonLen);
+}
+
+const HttpServer::TelemetryCache &HttpServer::cachedTelemetry(uint8_t row) {
+    TelemetryCache &c = _telemetryCache[row];
+    if (c.valid && c.counter == _devices.counter[row] && c.lastUpdateMs == _devices.lastUpdateMs[row]) {
+        return c;
+    }
+
+    Telemetry t;
+    snapshot(row, t);
+
+    c.jsonLen = (uint16_t) writeTelemetryJson(t, c.json, sizeof(c.json));
+    c.counter = t.counter;
+    c.lastUpdateMs = t.lastUpdateMs;
+    snprintf(c.etag, sizeof(c.etag), "\"%x-%lx-%lx\"",
+             (unsigned) row, (unsigned long) t.counter, (unsigned long) t.lastUpdateMs);
+    c.valid = true;
+    return c;
+}
+
+void HttpServer::handleHistoryGet(const HttpRequest &req, HttpResponse &resp) {
+    static const char *const fieldNames[TelemetryHistory::kFields] = {
+        "temperature", "humidity", "fuelLevel", "stepperSpeed", "stepperRpm"
+    };
+
+    char arg[DeviceTable::kMaxIdLen + 1];
+
+    bool filterDevice = false;
+    uint16_t deviceTag = 0;
+    if (req.queryParam("device", arg, sizeof(arg))) {
+        const uint8_t row = _devices.find(arg, strlen(arg));
+        if (row == DeviceTable::kNone) {
+            resp.send(404, "application/json", "{\"ok\":false,\"error\":\"unknown_device\"}");
+            return;
+        }
+        filterDevice = true;
+        deviceTag = (uint16_t) _devices.idHash(row);
+    }
+
+    const uint32_t until = _history.newestTs();
+    uint32_t since = _history.oldestTs();
+    if (req.queryParam("since", arg, sizeof(arg))) since = (uint32_t) strtoul(arg, nullptr, 10);
+
+    uint32_t step = 60;
+    if (req.queryParam("step", arg, sizeof(arg))) step = (uint32_t) strtoul(arg, nullptr, 10);
+    if (step == 0) step = 1;
+
+    String out;
+    out.reserve(96 + (size_t) TelemetryHistory::kMaxBuckets * 160);
+    out += "{\"buckets\":[";
+
+    bool first = true;
+    const uint16_t n = _history.query(since, until, step, filterDevice, deviceTag,
+                                      [&](const TelemetryHistory::Bucket &b) {
+                                          if (!first) out += ',';
+                                          first = false;
+
+                                          out += "{\"t\":";
+                                          out += String(b.start);
+                                          out += ",\"n\":";
+                                          out += String(b.samples);
+
+                                          // campo: [min,max,mean] ou null
+                                          for (size_t f = 0; f < TelemetryHistory::kFields; f++) {
+                                              out += ",\"";
+                                              out += fieldNames[f];
+                                              out += "\":";
+                                              if (b.count[f] == 0) {
+                                                  out += "null";
+                                                  continue;
+                                              }
+                                              out += '[';
+                                              out += String(b.min[f], 2);
+                                              out += ',';
+                                              out += String(b.max[f], 2);
+                                              out += ',';
+                                              out += String(b.mean[f], 2);
+                                              out += ']';
+                                          }
+                                          out += '}';
+                                      });
+
+    // step efetivo (query() alarga se o intervalo exigir buckets demais)
+    out += "],\"since\":";
+    out += String(since);
+    out += ",\"until\":";
+    out += String(until);
+    out += ",\"step\":";
+    out += String(step);
+    out += ",\"count\":";
+    out += String(n);
+    out += ",\"stored\":";
+    out += String(_history.size());
+    out += ",\"capacity\":";
+    out += String(TelemetryHistory::kCapacity);
+    out += '}';
+
+    resp.send(200, "application/json", out);
+}
+
+void HttpServer::handleStreamGet(const HttpRequest &req, HttpResponse &resp) {
+    if (!req.client) {
+        resp.send(500, "application/json", "{\"ok\":false,\"error\":\"stream_unsupported\"}");
+        return;
+    }
+
+    uint32_t filterHash = 0; // 0 = todos os devices
+    char deviceId[DeviceTable::kMaxIdLen + 1];
+    if (req.queryParam("device", deviceId, sizeof(deviceId))) {
+        const uint8_t row = _devices.find(deviceId, strlen(deviceId));
+        if (row == DeviceTable::kNone) {
+            resp.send(404, "application/json", "{\"ok\":false,\"error\":\"unknown_device\"}");
+            return;
+        }
+        filterHash = _devices.idHash(row);
+    }
+
+    if (!_stream.subscribe(*req.client, filterHash)) {
+        resp.send(503, "application/json", "{\"ok\":false,\"error\":\"stream_full\"}");
+        return;
+    }
+
+    // A partir daqui a conexão pertence ao EventStream
+    resp.detached = true;
+}
+
+void HttpServer::handleMetricsGet(const HttpRequest &req, HttpResponse &resp) {
+    resp.send(200, "text/plain; version=0.0.4", _metrics.render());
+}
+
+void HttpServer::handleDevicesGet(const HttpRequest &req, HttpResponse &resp) {
+    const uint32_t now = millis();
+    const uint8_t n = _devices.count();
+
+    String out;
+    out.reserve(48 + (size_t) n * 96);
+    out += "{\"count\":";
+    out += String(n);
+    out += ",\"capacity\":";
+    out += String(DeviceTable::kCapacity);
+    out += ",\"devices\":[";
+
+    for (uint8_t row = 0; row < n; row++) {
+        if (row > 0) out += ',';
+        const bool hasData = !isnan(_devices.temperature[row]) && !isnan(_devices.humidity[row]);
+
+        out += "{\"id\":\"";
+        out += _devices.id(row);
+        out += "\",\"hasData\":";
+        out += hasData ? "true" : "false";
+        out += ",\"counter\":";
+        out += String(_devices.counter[row]);
+        out += ",\"lastUpdateMs\":";
+        out += String(_devices.lastUpdateMs[row]);
+        out += ",\"ageMs\":";
+        out += String(now - _devices.lastUpdateMs[row]);
+        out += '}';
+    }
+
+    out += "]}";
+    resp.send(200, "application/json", out);
+}
+
+static SecureRequestView secureViewOf(const HttpRequest &req) {
+    SecureRequestView view;
+    view.deviceId = req.header(HttpHeader::DeviceId);
+    view.timestamp = req.header(HttpHeader::Timestamp);
+    view.nonce = req.header(HttpHeader::Nonce);
+    view.ivHex = req.header(HttpHeader::Iv);
+    view.tagHex = req.header(HttpHeader::Tag);
+    view.signature = req.header(HttpHeader::Signature);
+    view.keyVersion = req.header(HttpHeader::KeyVersion);
+    view.protocol = req.header(HttpHeader::SecureVersion);
+    view.packed = req.header(HttpHeader::SecurePacked);
+    view.bodyEncoding = req.header(HttpHeader::BodyEncoding);
+    view.session = req.header(HttpHeader::Session);
+    view.seq = req.header(HttpHeader::Seq);
+    view.body = req.body;
+    view.bodyLen = req.bodyLen;
+    return view;
+}
+
+static bool isSecurePostPath(const char *path) {
+    return strcmp(path, "/telemetry") == 0 || strcmp(path, "/telemetry/batch") == 0 ||
+           strcmp(path, SECURE_SESSION_PATH) == 0;
+}
+
+bool HttpServer::precheckSecurePost(const HttpRequest &req, HttpResponse &resp) {
+    // 1) Restrição de origem (por IP)
+    if (!isClientAllowed(req)) {
+        sendLiteral(resp, 403, "{\"ok\":false,\"error\":\"forbidden_origin\"}");
+        return false;
+    }
+
     // 2) Bloqueio explícito de JSON plain (exige SecureHttp)
-    const String ct = _server.header("Content-Type");
-    const bool looksJson = (ct.indexOf("application/json") >= 0);
+    const bool looksJson = (strstr(req.header(HttpHeader::ContentType), "application/json") != nullptr);
 
     const bool hasSecureHeaders =
-            !_server.header("X-Device-Id").isEmpty() &&
-            !_server.header("X-Timestamp").isEmpty() &&
-            !_server.header("X-Nonce").isEmpty() &&
-            !_server.header("X-IV").isEmpty() &&
-            !_server.header("X-Tag").isEmpty() &&
-            !_server.header("X-Signature").isEmpty();
-
-    if (looksJson && !hasSecureHeaders) {
-        _server.send(400, "application/json", "{\"ok\":false,\"error\":\"secure_required\"}");
-        return;
+            req.hasHeader(HttpHeader::DeviceId) &&
+            req.hasHeader(HttpHeader::Timestamp) &&
+            req.hasHeader(HttpHeader::Nonce) &&
+            req.hasHeader(HttpHeader::Iv) &&
+            req.hasHeader(HttpHeader::Tag) &&
+            (req.hasHeader(HttpHeader::Signature) || req.hasHeader(HttpHeader::SecureVersion));
+    const bool hasPackedHeader = req.hasHeader(HttpHeader::SecurePacked);
+    const bool hasSessionHeaders = req.hasHeader(HttpHeader::Session) && req.hasHeader(HttpHeader::Seq);
+
+    if (looksJson && !hasSecureHeaders && !hasPackedHeader && !hasSessionHeaders) {
+        sendLiteral(resp, 400, "{\"ok\":false,\"error\":\"secure_required\"}");
+        return false;
     }
 
-    // 3) SecureHttp: verify + decrypt
-    auto res = _secureAuth.verifyAndDecrypt(_server, "POST", "/telemetry");
+    // 3) Body binário cru só no modo Async (WebServer trata o body como C string)
+    // (com X-SecureHttp o encoding vem dentro do bloco compacto)
+    SecureBodyEncoding enc = SecureBodyEncoding::Hex;
+    SecurePackedMeta packed;
+    if (hasPackedHeader) {
+        if (parseSecurePackedHeader(req.header(HttpHeader::SecurePacked), packed)) enc = packed.encoding;
+    } else {
+        parseSecureBodyEncoding(req.header(HttpHeader::BodyEncoding), enc);
+    }
+    if (_mode == Mode::Sync && enc == SecureBodyEncoding::Raw) {
+        _metrics.countAuth("unsupported_encoding");
+        sendLiteral(resp, 415, "{\"ok\":false,\"error\":\"unsupported_encoding\"}");
+        return false;
+    }
+    return true;
+}
+
+bool HttpServer::reportSecureAuth(const SecureAuthResult &res, HttpResponse &resp) {
+    // Estágios do SecureGatewayAuth têm a mesma ordem de GatewayMetrics::Stage
+    for (uint8_t i = 0; i < SecureAuthTiming::StageCount; i++) {
+        if (res.timing.ran(i)) _metrics.observe((GatewayMetrics::Stage) i, res.timing.us[i]);
+    }
+    _metrics.countAuth(res.ok ? String() : res.error);
+
     if (!res.ok) {
-        _server.send(res.httpCode, "application/json",
-                     "{\"ok\":false,\"error\":\"" + res.error + "\"}");
-        return;
+        const int n = snprintf(_reply, sizeof(_reply), "{\"ok\":false,\"error\":\"%s\"}", res.error.c_str());
+        resp.sendCached(res.httpCode, "application/json", _reply, (size_t) n < sizeof(_reply) ? (size_t) n : 0);
+        return false;
     }
+    return true;
+}
 
-    String body = res.plaintextJson;
-    body.trim();
+HttpServer::SecureSlot *HttpServer::slotFor(const HttpRequest &req) {
+    for (size_t i = 0; i < TELEMETRY_STREAM_SLOTS; i++) {
+        if (_secureSlots[i].busy && _secureSlots[i].connection == req.connection) return &_secureSlots[i];
+    }
+    return nullptr;
+}
 
-    bool okTemp = false;
-    bool okHum = false;
-    bool okFuel = false;
-    bool okSpeed = false;
-    bool okRpm = false;
+AsyncHttpServer::BodyMode HttpServer::beginSecureBody(const HttpRequest &req, HttpResponse &resp) {
+    if (req.method != HTTP_POST || !isSecurePostPath(req.path)) return AsyncHttpServer::BodyMode::Buffer;
+    if (!precheckSecurePost(req, resp)) return AsyncHttpServer::BodyMode::Reject;
 
-    float temp = NAN;
-    float hum = NAN;
+    SecureSlot *slot = nullptr;
+    for (size_t i = 0; i < TELEMETRY_STREAM_SLOTS && !slot; i++) {
+        if (!_secureSlots[i].busy) slot = &_secureSlots[i];
+    }
+    if (!slot) {
+        sendLiteral(resp, 503, "{\"ok\":false,\"error\":\"busy\"}");
+        return AsyncHttpServer::BodyMode::Reject;
+    }
 
-    float fuelF = NAN;
-    float speed = NAN;
-    float rpm = NAN;
+    // Cabeçalhos, replay e Content-Length checados antes de ler 1 byte do body (413 cedo)
+    if (!slot->verifier.begin(_secureAuth, secureViewOf(req), "POST", req.path, slot->work, sizeof(slot->work))) {
+        reportSecureAuth(slot->verifier.result(), resp);
+        return AsyncHttpServer::BodyMode::Reject;
+    }
+
+    slot->busy = true;
+    slot->connection = req.connection;
+    return AsyncHttpServer::BodyMode::Stream;
+}
 
-    if (body.length() > 0) {
-        okTemp = tryExtractJsonNumber(body, "temperature", temp);
-        okHum = tryExtractJsonNumber(body, "humidity", hum);
-        okFuel = tryExtractJsonNumber(body, "fuelLevel", fuelF);
-        okSpeed = tryExtractJsonNumber(body, "stepperSpeed", speed);
-        okRpm = tryExtractJsonNumber(body, "stepperRpm", rpm);
+bool HttpServer::feedSecureBody(const HttpRequest &req, const uint8_t *data, size_t len, HttpResponse &resp) {
+    SecureSlot *slot = slotFor(req);
+    if (!slot) {
+        sendLiteral(resp, 500, "{\"ok\":false,\"error\":\"stream_lost\"}");
+        return false;
     }
 
-    // If nothing came, reject
-    if (!okTemp && !okHum && !okFuel && !okSpeed && !okRpm) {
-        _server.send(400, "application/json",
-                     "{\"ok\":false,\"error\":\"Missing telemetry fields\",\"hint\":\"Send encrypted JSON with fields: temperature, humidity, fuelLevel, stepperSpeed, stepperRpm\"}");
-        return;
+    if (slot->verifier.update(data, len)) return true;
+
+    slot->busy = false;
+    reportSecureAuth(slot->verifier.result(), resp);
+    return false;
+}
+
+void HttpServer::abortSecureBody(const HttpRequest &req) {
+    SecureSlot *slot = slotFor(req);
+    if (!slot) return;
+    slot->verifier.abort();
+    slot->busy = false;
+}
+
+bool HttpServer::verifySecurePost(const HttpRequest &req, const char *path, SecureAuthResult &res,
+                                  HttpResponse &resp) {
+    // Async: body já passou pelo verificador; só falta conferir HMAC/tag e o anti-replay
+    SecureSlot *slot = (_mode == Mode::Async) ? slotFor(req) : nullptr;
+    if (slot) {
+        res = slot->verifier.finish();
+        slot->busy = false; // res.plaintext segue em slot->work até a resposta
+        return reportSecureAuth(res, resp);
     }
 
-    // Update stored telemetry (only update fields present)
-    if (okTemp) _telemetry.temperature = temp;
-    if (okHum) _telemetry.humidity = hum;
+    if (!precheckSecurePost(req, resp)) return false;
+
+    // 4) SecureHttp: verify + decrypt (plaintext fica no slot 0)
+    SecureSlot &work = _secureSlots[0];
+    res = _secureAuth.verifyAndDecryptInto(secureViewOf(req), "POST", path, work.work, sizeof(work.work));
+    return reportSecureAuth(res, resp);
+}
+
+// "ts" vem do device e vira chave do histórico e da row: no futuro além da tolerância é
+// recusado (0 = não enviado)
+static bool sampleTsPlausible(const TelemetryParser::Sample &sample, uint32_t nowEpoch) {
+    return sample.ts == 0 || (uint64_t) sample.ts <= (uint64_t) nowEpoch + TELEMETRY_TS_MAX_FUTURE_SEC;
+}
+
+bool HttpServer::applySample(uint8_t row, const TelemetryParser::Sample &sample, uint32_t nowMs, bool stored) {
+    const uint32_t nowEpoch = (uint32_t) time(nullptr);
+    if (!sampleTsPlausible(sample, nowEpoch)) return false;
 
-    if (okFuel) {
-        int fl = (int) fuelF;
+    // Histórico: usa o ts do device (lote) ou o relógio do gateway
+    const uint32_t ts = sample.ts ? sample.ts : nowEpoch;
+    _history.append(ts, (uint16_t) _devices.idHash(row), sample);
+
+    // Lote guardado no flash do device (reenvio após queda): leitura passada, só histórico
+    if (stored) return false;
+
+    // Amostra mais antiga que a da row (ex.: drenada do SampleLog depois de uma ao vivo)
+    // fica só no histórico; não volta o estado atual do device
+    if (sample.ts != 0 && sample.ts < _devices.sampleTs[row]) return false;
+
+    // Update stored telemetry of this device (only update fields present)
+    if (sample.has(TelemetryParser::Temperature)) _devices.temperature[row] = sample.get(TelemetryParser::Temperature);
+    if (sample.has(TelemetryParser::Humidity)) _devices.humidity[row] = sample.get(TelemetryParser::Humidity);
+
+    if (sample.has(TelemetryParser::FuelLevel)) {
+        int fl = (int) sample.get(TelemetryParser::FuelLevel);
         if (fl < 0) fl = 0;
         if (fl > 100) fl = 100;
-        _telemetry.fuelLevel = fl;
+        _devices.fuelLevel[row] = (int16_t) fl;
     }
 
-    if (okSpeed) _telemetry.stepperSpeed = speed;
-    if (okRpm) _telemetry.stepperRpm = rpm;
+    if (sample.has(TelemetryParser::StepperSpeed)) _devices.stepperSpeed[row] = sample.get(TelemetryParser::StepperSpeed);
+    if (sample.has(TelemetryParser::StepperRpm)) _devices.stepperRpm[row] = sample.get(TelemetryParser::StepperRpm);
 
-    _telemetry.counter++;
-    _telemetry.lastUpdateMs = millis();
+    if (sample.ts != 0) _devices.sampleTs[row] = sample.ts;
 
-    // Mantém seu comportamento: hasData=true somente quando temp e hum são válidos
-    const bool hasTemp = !isnan(_telemetry.temperature);
-    const bool hasHum = !isnan(_telemetry.humidity);
-    _telemetry.hasData = hasTemp && hasHum;
+    _devices.counter[row]++;
+    _devices.lastUpdateMs[row] = nowMs;
+    return true;
+}
+
+void HttpServer::publishRow(uint8_t row) {
+    _lastRow = row;
+    snapshot(row, _telemetry);
+
+    // SSE primeiro: uplinks (Ubidots) podem demorar
+    const TelemetryCache &cache = cachedTelemetry(row);
+    _stream.publish("telemetry", _telemetry.counter, _devices.idHash(row), cache.json, cache.jsonLen);
 
     // Ubidots: envia imediatamente quando telemetria é publicável
     if (_telemetry.hasData && _onTelemetryUpdated) {
@@ -204,21 +713,135 @@ void HttpServer::handleTelemetryPost() {
     if (_telemetry.hasData) {
         _thingSpeakPending = true;
     }
+}
+
+void HttpServer::handleTelemetryPost(const HttpRequest &req, HttpResponse &resp) {
+    SecureAuthResult res;
+    if (!verifySecurePost(req, "/telemetry", res, resp)) return;
+
+    // Parser single-pass direto no span decifrado (_work), sem Strings no heap
+    TelemetryParser::Sample sample;
+    const uint32_t t0 = micros();
+    const bool parsed = TelemetryParser::parse(res.plaintext, res.plaintextLen, sample);
+    _metrics.observe(GatewayMetrics::Stage::Parse, micros() - t0);
+
+    // If nothing came, reject
+    if (!parsed || sample.empty()) {
+        sendLiteral(resp, 400,
+                  "{\"ok\":false,\"error\":\"Missing telemetry fields\",\"hint\":\"Send encrypted JSON with fields: temperature, humidity, fuelLevel, stepperSpeed, stepperRpm\"}");
+        return;
+    }
+
+    if (!sampleTsPlausible(sample, (uint32_t) time(nullptr))) {
+        sendLiteral(resp, 400, "{\"ok\":false,\"error\":\"bad_ts\"}");
+        return;
+    }
+
+    // Device autenticado (X-Device-Id ou dono da sessão)
+    const char *deviceId = res.deviceId;
+    const uint32_t nowMs = millis();
+    const uint8_t row = _devices.findOrInsert(deviceId, strlen(deviceId), nowMs);
+    if (row == DeviceTable::kNone) {
+        sendLiteral(resp, 400, "{\"ok\":false,\"error\":\"bad_device_id\"}");
+        return;
+    }
+
+    if (applySample(row, sample, nowMs)) publishRow(row);
 
     // Reply com debug + telemetry (não ecoa plaintext recebido)
-    String resp = "{";
-    resp += "\"ok\":true";
-    resp += ",\"updated\":{";
-    resp += "\"temperature\":" + String(okTemp ? "true" : "false");
-    resp += ",\"humidity\":" + String(okHum ? "true" : "false");
-    resp += ",\"fuelLevel\":" + String(okFuel ? "true" : "false");
-    resp += ",\"stepperSpeed\":" + String(okSpeed ? "true" : "false");
-    resp += ",\"stepperRpm\":" + String(okRpm ? "true" : "false");
-    resp += "}";
-    resp += ",\"telemetry\":" + makeTelemetryJson(_telemetry);
-    resp += "}";
+    auto flag = [&sample](TelemetryParser::Field f) { return sample.has(f) ? "true" : "false"; };
+    size_t n = 0;
+    appendf(_reply, sizeof(_reply), n,
+            "{\"ok\":true,\"updated\":{\"temperature\":%s,\"humidity\":%s,\"fuelLevel\":%s,"
+            "\"stepperSpeed\":%s,\"stepperRpm\":%s},\"telemetry\":%s}",
+            flag(TelemetryParser::Temperature), flag(TelemetryParser::Humidity), flag(TelemetryParser::FuelLevel),
+            flag(TelemetryParser::StepperSpeed), flag(TelemetryParser::StepperRpm), cachedTelemetry(row).json);
+
+    resp.sendCached(200, "application/json", _reply, n);
+}
+
+void HttpServer::handleTelemetryBatchPost(const HttpRequest &req, HttpResponse &resp) {
+    // Mesmo envelope SecureHttp do /telemetry: 1 HMAC + 1 AES-GCM para N amostras
+    SecureAuthResult res;
+    if (!verifySecurePost(req, "/telemetry/batch", res, resp)) return;
+
+    TelemetryParser::Sample samples[TELEMETRY_BATCH_MAX];
+    size_t count = 0;
+    bool stored = false; // "stored":true = reenvio do flash do device
+    const uint32_t t0 = micros();
+    const bool parsed = TelemetryParser::parseBatch(res.plaintext, res.plaintextLen,
+                                                    samples, TELEMETRY_BATCH_MAX, count, &stored);
+    _metrics.observe(GatewayMetrics::Stage::Parse, micros() - t0);
+
+    if (!parsed) {
+        size_t n = 0;
+        appendf(_reply, sizeof(_reply), n, "{\"ok\":false,\"error\":\"bad_batch\",\"max\":%u}",
+                (unsigned) TELEMETRY_BATCH_MAX);
+        resp.sendCached(400, "application/json", _reply, n);
+        return;
+    }
 
-    _server.send(200, "application/json", resp);
+    // Lote com "ts" no futuro é recusado inteiro (conteúdo inválido: o device não reenvia)
+    const uint32_t nowEpoch = (uint32_t) time(nullptr);
+    for (size_t i = 0; i < count; i++) {
+        if (sampleTsPlausible(samples[i], nowEpoch)) continue;
+        size_t n = 0;
+        appendf(_reply, sizeof(_reply), n, "{\"ok\":false,\"error\":\"bad_batch\",\"badTs\":%lu}",
+                (unsigned long) samples[i].ts);
+        resp.sendCached(400, "application/json", _reply, n);
+        return;
+    }
+
+    // Device autenticado (X-Device-Id ou dono da sessão)
+    const char *deviceId = res.deviceId;
+    const uint32_t nowMs = millis();
+    const uint8_t row = _devices.findOrInsert(deviceId, strlen(deviceId), nowMs);
+    if (row == DeviceTable::kNone) {
+        sendLiteral(resp, 400, "{\"ok\":false,\"error\":\"bad_device_id\"}");
+        return;
+    }
+
+    // Aplica em ordem de captura; amostras vazias são ignoradas, e as guardadas sem "ts"
+    // também (não há como datá-las: o relógio do gateway diria que são atuais)
+    size_t applied = 0;
+    bool current = false; // alguma amostra atualizou a row (as antigas vão só para o histórico)
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i].empty() || (stored && samples[i].ts == 0)) continue;
+        if (applySample(row, samples[i], nowMs, stored)) current = true;
+        applied++;
+    }
+
+    if (applied == 0) {
+        sendLiteral(resp, 400, "{\"ok\":false,\"error\":\"empty_batch\"}");
+        return;
+    }
+
+    // Callbacks uma vez por lote, com o estado final (evita rajada de publish no uplink)
+    if (current) publishRow(row);
+
+    size_t n = 0;
+    appendf(_reply, sizeof(_reply), n, "{\"ok\":true,\"applied\":%u,\"telemetry\":%s}",
+            (unsigned) applied, cachedTelemetry(row).json);
+
+    resp.sendCached(200, "application/json", _reply, n);
+}
+
+void HttpServer::handleSessionPost(const HttpRequest &req, HttpResponse &resp) {
+    // Handshake vai no envelope completo (timestamp + nonce + HMAC); o resto da sessão não
+    SecureAuthResult res;
+    if (!verifySecurePost(req, SECURE_SESSION_PATH, res, resp)) return;
+
+    const SecureSessionGrant grant = _secureAuth.openSession(res, res.plaintext, res.plaintextLen);
+    size_t n = 0;
+    if (!grant.ok) {
+        appendf(_reply, sizeof(_reply), n, "{\"ok\":false,\"error\":\"%s\"}", grant.error.c_str());
+        resp.sendCached(grant.httpCode, "application/json", _reply, n);
+        return;
+    }
+
+    appendf(_reply, sizeof(_reply), n, "{\"ok\":true,\"sid\":\"%s\",\"sr\":\"%s\",\"ttl\":%lu,\"mac\":\"%s\"}",
+            grant.sid, grant.sr, (unsigned long) grant.ttlSec, grant.mac.c_str());
+    resp.sendCached(200, "application/json", _reply, n);
 }
 
 void HttpServer::tickThingSpeakTimer() {
@@ -234,54 +857,24 @@ void HttpServer::tickThingSpeakTimer() {
     _onThingSpeakDue(_telemetry);
 }
 
-void HttpServer::handleNotFound() {
-    String msg = "{\"error\":\"Not found\",\"path\":\"" + _server.uri() + "\"}";
-    _server.send(404, "application/json", msg);
-}
-
-// Minimal JSON number extractor for simple payloads.
-// Example: {"temperature": 25.3, "humidity": 50}
-bool HttpServer::tryExtractJsonNumber(const String &json, const char *key, float &out) {
-    String needle = String("\"") + key + String("\"");
-    int k = json.indexOf(needle);
-    if (k < 0) return false;
-
-    int colon = json.indexOf(':', k + needle.length());
-    if (colon < 0) return false;
-
-    int i = colon + 1;
-    while (i < (int) json.length() && isspace((unsigned char) json[i])) i++;
-
-    int j = i;
-    while (j < (int) json.length()) {
-        char c = json[j];
-        if (c == ',' || c == '}' || isspace((unsigned char) json[j])) break;
-        j++;
-    }
-
-    if (j <= i) return false;
-
-    String num = json.substring(i, j);
-    num.trim();
-    if (num.isEmpty()) return false;
-
-    out = num.toFloat();
-    return true;
+void HttpServer::handleNotFound(const HttpRequest &req, HttpResponse &resp) {
+    String msg = "{\"error\":\"Not found\",\"path\":\"" + String(req.path) + "\"}";
+    resp.send(404, "application/json", msg);
 }
 
-String HttpServer::makeTelemetryJson(const Telemetry &t) {
-    String s = "{";
-    s += "\"hasData\":" + String(t.hasData ? "true" : "false");
-    s += ",\"temperature\":" + (isnan(t.temperature) ? String("null") : String(t.temperature, 2));
-    s += ",\"humidity\":" + (isnan(t.humidity) ? String("null") : String(t.humidity, 2));
+size_t HttpServer::writeTelemetryJson(const Telemetry &t, char *out, size_t cap) {
+    size_t n = 0;
+    appendf(out, cap, n, "{\"deviceId\":\"%s\",\"hasData\":%s", t.deviceId, t.hasData ? "true" : "false");
+    appendFloat(out, cap, n, "temperature", t.temperature, 2);
+    appendFloat(out, cap, n, "humidity", t.humidity, 2);
 
     // novos campos
-    s += ",\"fuelLevel\":" + String(t.fuelLevel < 0 ? "null" : String(t.fuelLevel));
-    s += ",\"stepperSpeed\":" + (isnan(t.stepperSpeed) ? String("null") : String(t.stepperSpeed, 1));
-    s += ",\"stepperRpm\":" + (isnan(t.stepperRpm) ? String("null") : String(t.stepperRpm, 2));
-
-    s += ",\"counter\":" + String(t.counter);
-    s += ",\"lastUpdateMs\":" + String(t.lastUpdateMs);
-    s += "}";
-    return s;
+    if (t.fuelLevel < 0) appendf(out, cap, n, ",\"fuelLevel\":null");
+    else appendf(out, cap, n, ",\"fuelLevel\":%d", t.fuelLevel);
+    appendFloat(out, cap, n, "stepperSpeed", t.stepperSpeed, 1);
+    appendFloat(out, cap, n, "stepperRpm", t.stepperRpm, 2);
+
+    appendf(out, cap, n, ",\"counter\":%lu,\"lastUpdateMs\":%lu,\"sampleTs\":%lu}",
+            (unsigned long) t.counter, (unsigned long) t.lastUpdateMs, (unsigned long) t.sampleTs);
+    return n;
 }
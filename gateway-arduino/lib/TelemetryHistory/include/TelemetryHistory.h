@@ -0,0 +1,123 @@
+/**
+ * @file TelemetryHistory.h
+ * @brief Fixed-size in-memory telemetry history with downsampling queries.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_TELEMETRYHISTORY_H
+#define GATEWAY_ARDUINO_TELEMETRYHISTORY_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+#include <TelemetryParser.h>
+
+#ifndef TELEMETRY_HISTORY_CAPACITY
+#define TELEMETRY_HISTORY_CAPACITY 512
+#endif
+
+#ifndef TELEMETRY_HISTORY_MAX_BUCKETS
+#define TELEMETRY_HISTORY_MAX_BUCKETS 60
+#endif
+
+/**
+ * @brief Ring buffer of the last samples received by the gateway.
+ *
+ * - Struct-of-arrays: one timestamp column, one device-tag column and one
+ *   int16 column per field, so a query touches only what it aggregates.
+ * - Values are quantized with a fixed scale per field (e.g. temperature in
+ *   0.01 C); absent fields are stored as kAbsent.
+ * - query() downsamples into step buckets (min/max/mean per field) using a
+ *   fixed accumulator table, so out-of-order samples (batches) still land in
+ *   the right bucket and nothing is allocated.
+ *
+ * ~15 bytes per sample: 512 samples ~= 7.5 KB + ~3 KB of accumulators.
+ */
+class TelemetryHistory {
+public:
+    static constexpr uint16_t kCapacity = TELEMETRY_HISTORY_CAPACITY;
+    static constexpr uint16_t kMaxBuckets = TELEMETRY_HISTORY_MAX_BUCKETS;
+    static constexpr int16_t kAbsent = INT16_MIN;
+
+    static constexpr size_t kFields = TelemetryParser::FieldCount;
+
+    static_assert(kCapacity > 0, "TELEMETRY_HISTORY_CAPACITY must be > 0");
+    static_assert(kMaxBuckets > 0, "TELEMETRY_HISTORY_MAX_BUCKETS must be > 0");
+
+    /**
+     * @brief One downsampled bucket [start, start + step).
+     */
+    struct Bucket {
+        uint32_t start = 0;
+        uint16_t samples = 0; ///< Samples in the bucket (any field).
+        uint16_t count[kFields] = {}; ///< Samples carrying each field.
+        float min[kFields] = {};
+        float max[kFields] = {};
+        float mean[kFields] = {};
+    };
+
+    using BucketCallback = std::function<void(const Bucket &)>;
+
+    /**
+     * @brief Record one sample (overwrites the oldest when full).
+     *
+     * @param ts Sample time (epoch seconds).
+     * @param deviceTag 16-bit tag of the source device (see DeviceTable::idHash).
+     * @param sample Parsed fields; only present ones are stored.
+     */
+    void append(uint32_t ts, uint16_t deviceTag, const TelemetryParser::Sample &sample);
+
+    /**
+     * @brief Downsample [since, until] into step-second buckets.
+     *
+     * @param since First second (inclusive).
+     * @param until Last second (inclusive).
+     * @param step Bucket width in seconds; raised when the range would need
+     *             more than kMaxBuckets buckets (effective value returned).
+     * @param filterDevice Only count samples whose tag is @p deviceTag.
+     * @param deviceTag Device tag used when @p filterDevice is true.
+     * @param emit Called once per non-empty bucket, in time order.
+     * @return Number of buckets emitted.
+     */
+    uint16_t query(uint32_t since, uint32_t until, uint32_t &step,
+                   bool filterDevice, uint16_t deviceTag, const BucketCallback &emit);
+
+    uint16_t size() const noexcept { return _count; }
+
+    uint32_t oldestTs() const;
+
+    uint32_t newestTs() const;
+
+    /**
+     * @brief Quantization scale of a field (stored = round(value * scale)).
+     */
+    static float scaleOf(size_t field);
+
+private:
+    static int16_t quantize(size_t field, float v);
+
+    struct Acc {
+        int16_t min;
+        int16_t max;
+        int32_t sum;
+        uint16_t n;
+    };
+
+    uint32_t _ts[kCapacity];
+    uint16_t _device[kCapacity];
+    int16_t _values[kFields][kCapacity];
+
+    uint16_t _head = 0; // próxima posição de escrita
+    uint16_t _count = 0;
+
+    Acc _acc[kMaxBuckets][kFields];
+    uint16_t _bucketSamples[kMaxBuckets];
+};
+
+#endif // GATEWAY_ARDUINO_TELEMETRYHISTORY_H
@@ -0,0 +1,136 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "TelemetryHistory.h"
+
+#include <math.h>
+#include <string.h>
+
+constexpr uint16_t TelemetryHistory::kCapacity;
+constexpr uint16_t TelemetryHistory::kMaxBuckets;
+constexpr int16_t TelemetryHistory::kAbsent;
+constexpr size_t TelemetryHistory::kFields;
+
+float TelemetryHistory::scaleOf(size_t field) {
+    // temperature/humidity: 0.01 | fuelLevel: 1 % | stepperSpeed: 0.1 | stepperRpm: 1 rpm
+    static const float scales[kFields] = {100.0f, 100.0f, 1.0f, 10.0f, 1.0f};
+    return (field < kFields) ? scales[field] : 1.0f;
+}
+
+int16_t TelemetryHistory::quantize(size_t field, float v) {
+    if (isnan(v)) return kAbsent;
+
+    float q = roundf(v * scaleOf(field));
+    if (q > 32767.0f) q = 32767.0f;
+    if (q < -32767.0f) q = -32767.0f; // -32768 é reservado para kAbsent
+    return (int16_t) q;
+}
+
+void TelemetryHistory::append(uint32_t ts, uint16_t deviceTag, const TelemetryParser::Sample &sample) {
+    const uint16_t i = _head;
+
+    _ts[i] = ts;
+    _device[i] = deviceTag;
+    for (size_t f = 0; f < kFields; f++) {
+        const TelemetryParser::Field field = (TelemetryParser::Field) f;
+        _values[f][i] = sample.has(field) ? quantize(f, sample.get(field)) : kAbsent;
+    }
+
+    _head = (uint16_t) ((_head + 1) % kCapacity);
+    if (_count < kCapacity) _count++;
+}
+
+uint32_t TelemetryHistory::oldestTs() const {
+    if (_count == 0) return 0;
+    const uint16_t first = (uint16_t) ((_head + kCapacity - _count) % kCapacity);
+
+    // Lotes podem chegar fora de ordem: varre para achar o menor
+    uint32_t t = _ts[first];
+    for (uint16_t k = 1; k < _count; k++) {
+        const uint32_t v = _ts[(first + k) % kCapacity];
+        if (v < t) t = v;
+    }
+    return t;
+}
+
+uint32_t TelemetryHistory::newestTs() const {
+    if (_count == 0) return 0;
+    const uint16_t first = (uint16_t) ((_head + kCapacity - _count) % kCapacity);
+
+    uint32_t t = _ts[first];
+    for (uint16_t k = 1; k < _count; k++) {
+        const uint32_t v = _ts[(first + k) % kCapacity];
+        if (v > t) t = v;
+    }
+    return t;
+}
+
+uint16_t TelemetryHistory::query(uint32_t since, uint32_t until, uint32_t &step,
+                                 bool filterDevice, uint16_t deviceTag, const BucketCallback &emit) {
+    if (until < since || _count == 0) return 0;
+    if (step == 0) step = 1;
+
+    // Limita o número de buckets (acumuladores fixos): alarga o step se preciso.
+    // Em 64 bits: [0, 0xFFFFFFFF] tem 2^32 segundos e span + step estoura uint32_t
+    const uint64_t span = (uint64_t) until - since + 1;
+    if ((span + step - 1) / step > kMaxBuckets) {
+        step = (uint32_t) ((span + kMaxBuckets - 1) / kMaxBuckets);
+    }
+    const uint32_t buckets = (uint32_t) ((span + step - 1) / step);
+
+    for (uint32_t b = 0; b < buckets; b++) {
+        _bucketSamples[b] = 0;
+        for (size_t f = 0; f < kFields; f++) {
+            _acc[b][f].min = INT16_MAX;
+            _acc[b][f].max = INT16_MIN;
+            _acc[b][f].sum = 0;
+            _acc[b][f].n = 0;
+        }
+    }
+
+    // 1) Coluna de timestamps decide o bucket; colunas de valores só são lidas se entrar
+    for (uint16_t i = 0; i < _count; i++) {
+        const uint32_t t = _ts[i];
+        if (t < since || t > until) continue;
+        if (filterDevice && _device[i] != deviceTag) continue;
+
+        const uint32_t b = (t - since) / step;
+        if (b >= buckets) continue;
+        _bucketSamples[b]++;
+
+        for (size_t f = 0; f < kFields; f++) {
+            const int16_t v = _values[f][i];
+            if (v == kAbsent) continue;
+
+            Acc &a = _acc[b][f];
+            if (v < a.min) a.min = v;
+            if (v > a.max) a.max = v;
+            a.sum += v;
+            a.n++;
+        }
+    }
+
+    // 2) Emite os buckets não vazios, em ordem de tempo
+    uint16_t emitted = 0;
+    Bucket out;
+    for (uint32_t b = 0; b < buckets; b++) {
+        if (_bucketSamples[b] == 0) continue;
+
+        out.start = (uint32_t) (since + (uint64_t) b * step);
+        out.samples = _bucketSamples[b];
+        for (size_t f = 0; f < kFields; f++) {
+            const Acc &a = _acc[b][f];
+            const float scale = scaleOf(f);
+
+            out.count[f] = a.n;
+            out.min[f] = a.n ? (float) a.min / scale : NAN;
+            out.max[f] = a.n ? (float) a.max / scale : NAN;
+            out.mean[f] = a.n ? ((float) a.sum / (float) a.n) / scale : NAN;
+        }
+
+        if (emit) emit(out);
+        emitted++;
+    }
+    return emitted;
+}
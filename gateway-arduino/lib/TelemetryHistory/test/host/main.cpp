@@ -0,0 +1,165 @@
+// Teste do TelemetryHistory com timestamps nos limites do uint32_t (ver Makefile).
+//
+//   ./history_test
+//
+// O "ts" vem do device: um valor perto de 0xFFFFFFFF no histórico não pode fazer
+// query() dividir por zero, dar a volta no span nem escrever fora dos buckets.
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "TelemetryHistory.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(cond)                                                  \
+    do {                                                             \
+        if (!(cond)) {                                               \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                             \
+        }                                                            \
+    } while (0)
+
+TelemetryHistory gHistory; // ~10 KB: fora da pilha
+
+TelemetryParser::Sample sampleWith(float temperature) {
+    TelemetryParser::Sample s;
+    s.values[TelemetryParser::Temperature] = temperature;
+    s.present = 1u << TelemetryParser::Temperature;
+    return s;
+}
+
+std::vector<TelemetryHistory::Bucket> query(uint32_t since, uint32_t until, uint32_t &step) {
+    std::vector<TelemetryHistory::Bucket> out;
+    gHistory.query(since, until, step, false, 0,
+                   [&](const TelemetryHistory::Bucket &b) { out.push_back(b); });
+    return out;
+}
+
+void testRegularBuckets() {
+    printf("regular buckets\n");
+    gHistory = TelemetryHistory();
+    gHistory.append(1000, 1, sampleWith(20.0f));
+    gHistory.append(1065, 1, sampleWith(30.0f));
+    gHistory.append(1001, 1, sampleWith(22.0f)); // fora de ordem (lote)
+
+    uint32_t step = 60;
+    const std::vector<TelemetryHistory::Bucket> b = query(1000, 1065, step);
+    CHECK(step == 60);
+    CHECK(b.size() == 2);
+    if (b.size() != 2) return;
+    CHECK(b[0].start == 1000 && b[0].samples == 2);
+    CHECK(fabsf(b[0].mean[TelemetryParser::Temperature] - 21.0f) < 0.01f);
+    CHECK(b[1].start == 1060 && b[1].samples == 1);
+}
+
+// ts = 0xFFFFFFC4 e step = 1 desde 0: o step alargado estourava e virava 0 (divisão por zero)
+void testStepNearMax() {
+    printf("step near UINT32_MAX\n");
+    gHistory = TelemetryHistory();
+    gHistory.append(0xFFFFFFC4u, 1, sampleWith(25.0f));
+
+    uint32_t step = 1;
+    const std::vector<TelemetryHistory::Bucket> b = query(0, gHistory.newestTs(), step);
+    CHECK(step > 1);
+    CHECK(b.size() == 1);
+    if (b.size() == 1) CHECK(b[0].start <= 0xFFFFFFC4u && 0xFFFFFFC4u - b[0].start < step);
+}
+
+// ts = 0xFFFFFFFF desde 0: span de 2^32 dava 0 buckets e a amostra caía fora da tabela
+void testFullRange() {
+    printf("full uint32 range\n");
+    gHistory = TelemetryHistory();
+    gHistory.append(0, 1, sampleWith(10.0f));
+    gHistory.append(0xFFFFFFFFu, 1, sampleWith(40.0f));
+
+    uint32_t step = 1;
+    std::vector<TelemetryHistory::Bucket> b = query(0, 0xFFFFFFFFu, step);
+    CHECK(step >= 0xFFFFFFFFu / TelemetryHistory::kMaxBuckets);
+    CHECK(b.size() == 2);
+    if (b.size() == 2) {
+        CHECK(b[0].start == 0 && b[0].samples == 1);
+        CHECK(b[1].samples == 1 && b[1].start <= 0xFFFFFFFFu);
+    }
+
+    // step máximo: 2^32 segundos não cabem num bucket de 0xFFFFFFFF s
+    step = 0xFFFFFFFFu;
+    b = query(0, 0xFFFFFFFFu, step);
+    CHECK(b.size() == 2 && step == 0xFFFFFFFFu); // [0, 0xFFFFFFFE] e [0xFFFFFFFF]
+
+    // Intervalo de 1 s no último segundo
+    step = 60;
+    b = query(0xFFFFFFFFu, 0xFFFFFFFFu, step);
+    CHECK(b.size() == 1);
+    if (b.size() == 1) CHECK(b[0].start == 0xFFFFFFFFu);
+}
+
+bool parseTs(const char *json, uint32_t &ts) {
+    TelemetryParser::Sample s;
+    const bool ok = TelemetryParser::parse(json, strlen(json), s);
+    ts = s.ts;
+    return ok;
+}
+
+// "ts" acima de UINT32_MAX dava a volta em silêncio (ex.: 4294967296 -> 0)
+void testParserTsBounds() {
+    printf("parser ts bounds\n");
+    uint32_t ts = 0;
+    CHECK(parseTs("{\"ts\":4294967295,\"temperature\":1}", ts) && ts == 0xFFFFFFFFu);
+    CHECK(parseTs("{\"ts\":1760000000.75,\"temperature\":1}", ts) && ts == 1760000000u);
+    CHECK(!parseTs("{\"ts\":4294967296,\"temperature\":1}", ts));
+    CHECK(!parseTs("{\"ts\":99999999999999999999,\"temperature\":1}", ts));
+    CHECK(!parseTs("{\"ts\":-1,\"temperature\":1}", ts));
+    CHECK(!parseTs("{\"ts\":1.76e9,\"temperature\":1}", ts));
+}
+
+// Lote reenviado do flash do device: "stored":true marca leituras passadas (só histórico)
+void testParserStoredBatch() {
+    printf("parser stored batch\n");
+    TelemetryParser::Sample out[4];
+    size_t count = 0;
+    bool stored = true;
+
+    const char *live = "{\"samples\":[{\"ts\":1760000000,\"temperature\":1}]}";
+    CHECK(TelemetryParser::parseBatch(live, strlen(live), out, 4, count, &stored));
+    CHECK(count == 1 && !stored);
+
+    const char *flash = "{\"stored\":true,\"samples\":[{\"ts\":1760000000,\"temperature\":1},"
+                        "{\"temperature\":2}]}";
+    CHECK(TelemetryParser::parseBatch(flash, strlen(flash), out, 4, count, &stored));
+    CHECK(count == 2 && stored && out[0].ts == 1760000000u && out[1].ts == 0);
+
+    const char *after = "{\"samples\":[{\"temperature\":1}],\"stored\":true}";
+    CHECK(TelemetryParser::parseBatch(after, strlen(after), out, 4, count, &stored) && stored);
+
+    const char *no = "{\"stored\":false,\"samples\":[{\"temperature\":1}]}";
+    CHECK(TelemetryParser::parseBatch(no, strlen(no), out, 4, count, &stored) && !stored);
+
+    const char *bad = "{\"stored\":tru,\"samples\":[]}";
+    CHECK(!TelemetryParser::parseBatch(bad, strlen(bad), out, 4, count, &stored));
+
+    // Sem o ponteiro (chamadas antigas) continua aceitando a chave
+    CHECK(TelemetryParser::parseBatch(flash, strlen(flash), out, 4, count) && count == 2);
+}
+
+} // namespace
+
+int main() {
+    testRegularBuckets();
+    testStepNearMax();
+    testFullRange();
+    testParserTsBounds();
+    testParserStoredBatch();
+
+    if (gFailures) {
+        printf("%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all TelemetryHistory tests passed\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Benchmark do TelemetryParser contra o extrator antigo (ver Makefile).
+//
+//   ./parser_bench [iterations]
+//
+// "legacy" reproduz o HttpServer::tryExtractJsonNumber de antes do parser: para
+// cada chave monta a agulha "\"key\"", procura com indexOf, corta o número com
+// substring + trim e converte com toFloat (5 varreduras e ~10 Strings por
+// amostra). std::string faz o papel do String do Arduino; com SSO as Strings
+// curtas não alocam aqui, então o custo real no ESP32 (heap) é maior.
+//
+// Payloads no formato que o vehicle-device envia (appendSampleJson).
+
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "TelemetryParser.h"
+
+namespace legacy {
+
+bool tryExtractJsonNumber(const std::string &json, const char *key, float &out) {
+    std::string needle = std::string("\"") + key + std::string("\"");
+    size_t k = json.find(needle);
+    if (k == std::string::npos) return false;
+
+    size_t colon = json.find(':', k + needle.length());
+    if (colon == std::string::npos) return false;
+
+    size_t i = colon + 1;
+    while (i < json.length() && isspace((unsigned char) json[i])) i++;
+
+    size_t j = i;
+    while (j < json.length()) {
+        char c = json[j];
+        if (c == ',' || c == '}' || isspace((unsigned char) json[j])) break;
+        j++;
+    }
+
+    if (j <= i) return false;
+
+    std::string num = json.substr(i, j - i);
+    while (!num.empty() && isspace((unsigned char) num.back())) num.pop_back();
+    if (num.empty()) return false;
+
+    out = (float) atof(num.c_str());
+    return true;
+}
+
+// handleTelemetryPost antigo: o body vinha num String e cada campo era buscado à parte
+int extractAll(const char *body, size_t len, float *v) {
+    const std::string json(body, len);
+    int found = 0;
+    found += tryExtractJsonNumber(json, "temperature", v[0]);
+    found += tryExtractJsonNumber(json, "humidity", v[1]);
+    found += tryExtractJsonNumber(json, "fuelLevel", v[2]);
+    found += tryExtractJsonNumber(json, "stepperSpeed", v[3]);
+    found += tryExtractJsonNumber(json, "stepperRpm", v[4]);
+    return found;
+}
+
+} // namespace legacy
+
+namespace {
+
+volatile float gSink; // impede o compilador de descartar os laços
+
+double nowSec() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ns por payload
+template <typename F>
+double nsPerCall(long iterations, F fn) {
+    const double t0 = nowSec();
+    for (long i = 0; i < iterations; i++) fn();
+    return (nowSec() - t0) * 1e9 / (double) iterations;
+}
+
+std::string sampleJson(uint32_t ts, int i) {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "{\"ts\":%lu,\"temperature\":%.2f,\"humidity\":%.2f,\"fuelLevel\":%d,"
+             "\"stepperSpeed\":%.1f,\"stepperRpm\":%.2f}",
+             (unsigned long) ts, 27.1 + i * 0.1, 74.3 - i * 0.2, 70 - i, 40.9 + i, 3273.0 + i * 10);
+    return buf;
+}
+
+void row(const char *name, size_t bytes, double oldNs, double newNs) {
+    printf("%-22s %6zu %10.0f %10.0f %7.1fx\n", name, bytes, oldNs, newNs, newNs > 0 ? oldNs / newNs : 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const long iterations = (argc > 1) ? strtol(argv[1], nullptr, 10) : 200000;
+    if (iterations <= 0) {
+        fprintf(stderr, "iterations: > 0\n");
+        return 2;
+    }
+
+    int failed = 0;
+    printf("%ld iterations, ns per payload (legacy -> TelemetryParser)\n", iterations);
+    printf("%-22s %6s %10s %10s %8s\n", "payload", "bytes", "legacy", "parser", "speedup");
+
+    // Amostra única (POST /telemetry)
+    {
+        const std::string one = sampleJson(1760000000u, 0);
+        float v[5];
+        TelemetryParser::Sample s;
+        if (legacy::extractAll(one.data(), one.size(), v) != 5 || !TelemetryParser::parse(one.data(), one.size(), s) ||
+            s.present != 0x1F || s.values[TelemetryParser::StepperRpm] != v[4]) {
+            printf("MISMATCH single sample\n");
+            failed++;
+        }
+
+        row("single sample", one.size(),
+            nsPerCall(iterations, [&] {
+                legacy::extractAll(one.data(), one.size(), v);
+                gSink = v[0];
+            }),
+            nsPerCall(iterations, [&] {
+                TelemetryParser::parse(one.data(), one.size(), s);
+                gSink = s.values[0];
+            }));
+    }
+
+    // Lote (POST /telemetry/batch). O legado não tinha lote: conta um extractAll por amostra,
+    // com as amostras já separadas (o corte não entra no tempo)
+    static const size_t kBatches[] = {5, 10};
+    for (size_t n : kBatches) {
+        std::vector<std::string> parts;
+        std::string batch = "{\"samples\":[";
+        for (size_t i = 0; i < n; i++) {
+            parts.push_back(sampleJson(1760000000u + (uint32_t) i, (int) i));
+            if (i > 0) batch += ',';
+            batch += parts.back();
+        }
+        batch += "]}";
+
+        TelemetryParser::Sample out[16];
+        size_t count = 0;
+        if (!TelemetryParser::parseBatch(batch.data(), batch.size(), out, 16, count) || count != n ||
+            out[n - 1].ts != 1760000000u + n - 1) {
+            printf("MISMATCH batch of %zu\n", n);
+            failed++;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "batch of %zu", n);
+        const long it = iterations / (long) n + 1;
+        row(name, batch.size(),
+            nsPerCall(it, [&] {
+                float v[5];
+                for (const std::string &p : parts) legacy::extractAll(p.data(), p.size(), v);
+                gSink = v[0];
+            }),
+            nsPerCall(it, [&] {
+                TelemetryParser::parseBatch(batch.data(), batch.size(), out, 16, count);
+                gSink = out[0].values[0];
+            }));
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file TelemetryParser.h
+ * @brief Single-pass, allocation-free parser for the decrypted telemetry JSON.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_TELEMETRYPARSER_H
+#define GATEWAY_ARDUINO_TELEMETRYPARSER_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Flat JSON telemetry tokenizer.
+ *
+ * Scans the plaintext once, left to right, and fills every known field in a
+ * single pass. Keys are dispatched through a compile-time perfect hash and
+ * numbers are parsed in place, so no heap String is ever created.
+ *
+ * Accepted payload (any order, any subset):
+ * @code
+ *   {"temperature":28.30,"humidity":68.30,"fuelLevel":77,"stepperSpeed":40.0,"stepperRpm":800.00}
+ * @endcode
+ *
+ * Unknown keys are skipped (including nested objects/arrays and strings) and a
+ * @c null value leaves the field absent. An optional integer @c "ts" carries
+ * the capture time (epoch seconds) of the sample; a negative value, an
+ * exponent or a value above UINT32_MAX is a syntax error.
+ *
+ * Batches wrap several samples, applied in array order:
+ * @code
+ *   {"samples":[{"ts":1760000000,"temperature":28.3,...},{"ts":1760000001,...}]}
+ * @endcode
+ *
+ * A batch replayed from the device's flash log carries @c "stored":true: its
+ * samples are past readings, not the current state of the device.
+ *
+ * @note Depends only on the C standard headers so it can also be built on the
+ *       host (benchmarks / simulations).
+ */
+class TelemetryParser {
+public:
+    /**
+     * @brief Known telemetry fields (index into Sample::values).
+     */
+    enum Field : uint8_t {
+        Temperature = 0,
+        Humidity,
+        FuelLevel,
+        StepperSpeed,
+        StepperRpm,
+        FieldCount
+    };
+
+    /**
+     * @brief Parsed sample: values plus a presence bitmask.
+     */
+    struct Sample {
+        uint8_t present = 0; ///< Bit i set => values[i] was found in the payload.
+        float values[FieldCount] = {};
+        uint32_t ts = 0; ///< Capture time (epoch seconds); 0 = not sent.
+
+        bool has(Field f) const { return (present & (1u << f)) != 0; }
+        float get(Field f) const { return values[f]; }
+        bool empty() const { return present == 0; }
+    };
+
+    /**
+     * @brief Parse one flat JSON object.
+     *
+     * @param json Pointer to the payload (does not need to be NUL-terminated).
+     * @param len Payload length in bytes.
+     * @param out Receives the parsed fields (reset on entry).
+     * @return true if the object is well formed; false on syntax error.
+     */
+    static bool parse(const char *json, size_t len, Sample &out);
+
+    /**
+     * @brief Parse a batch object: {"samples":[{...},{...}]}.
+     *
+     * @param json Pointer to the payload.
+     * @param len Payload length in bytes.
+     * @param out Caller-provided sample array.
+     * @param cap Capacity of @p out.
+     * @param count Receives the number of samples parsed.
+     * @param stored Optional; receives true if the batch has "stored":true.
+     * @return false on syntax error or if the batch holds more than @p cap samples.
+     */
+    static bool parseBatch(const char *json, size_t len, Sample *out, size_t cap, size_t &count,
+                           bool *stored = nullptr);
+
+    /**
+     * @brief Map a key to its field.
+     *
+     * @param key Key bytes (without quotes).
+     * @param len Key length.
+     * @return The matching Field, or FieldCount when the key is unknown.
+     */
+    static Field lookupKey(const char *key, size_t len);
+};
+
+#endif // GATEWAY_ARDUINO_TELEMETRYPARSER_H
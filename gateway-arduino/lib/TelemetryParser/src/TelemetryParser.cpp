@@ -0,0 +1,385 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "TelemetryParser.h"
+
+#include <string.h>
+
+namespace {
+    // ------------------------------------------------------------------
+    // Perfect hash (compile-time)
+    // h = (2 * len + key[0] + 3 * key[len-1]) & 15
+    // ------------------------------------------------------------------
+    constexpr uint8_t kHashSlots = 16;
+
+    constexpr uint8_t keyHash(const char *s, size_t n) {
+        return (uint8_t) ((2u * n + (uint8_t) s[0] + 3u * (uint8_t) s[n - 1]) & (kHashSlots - 1));
+    }
+
+    constexpr size_t constLen(const char *s) {
+        return *s ? 1 + constLen(s + 1) : 0;
+    }
+
+    // Ids < FieldCount são campos de telemetria; os demais são chaves de controle
+    constexpr uint8_t kKeyTs = 0x20;
+    constexpr uint8_t kKeySamples = 0x21;
+    constexpr uint8_t kKeyStored = 0x22;
+    constexpr uint8_t kKeyUnknown = 0xFF;
+
+    struct KeyDef {
+        const char *name;
+        uint8_t id;
+    };
+
+    constexpr KeyDef kKeys[] = {
+        {"temperature", TelemetryParser::Temperature},
+        {"humidity", TelemetryParser::Humidity},
+        {"fuelLevel", TelemetryParser::FuelLevel},
+        {"stepperSpeed", TelemetryParser::StepperSpeed},
+        {"stepperRpm", TelemetryParser::StepperRpm},
+        {"ts", kKeyTs},
+        {"samples", kKeySamples},
+        {"stored", kKeyStored},
+    };
+
+    constexpr size_t kKeyCount = sizeof(kKeys) / sizeof(kKeys[0]);
+
+    constexpr uint8_t hashOf(size_t i) {
+        return keyHash(kKeys[i].name, constLen(kKeys[i].name));
+    }
+
+    constexpr bool collidesAfter(size_t i, size_t j) {
+        return j >= kKeyCount ? false : (hashOf(i) == hashOf(j) || collidesAfter(i, j + 1));
+    }
+
+    constexpr bool hashIsPerfect(size_t i = 0) {
+        return i >= kKeyCount ? true : (!collidesAfter(i, i + 1) && hashIsPerfect(i + 1));
+    }
+
+    static_assert(hashIsPerfect(), "TelemetryParser: key hash collision, adjust keyHash()");
+
+    // slot -> index em kKeys (-1 = vazio)
+    constexpr int8_t keyForSlot(uint8_t h, size_t i = 0) {
+        return i >= kKeyCount ? (int8_t) -1 : (hashOf(i) == h ? (int8_t) i : keyForSlot(h, i + 1));
+    }
+
+    constexpr int8_t kSlotToKey[kHashSlots] = {
+        keyForSlot(0), keyForSlot(1), keyForSlot(2), keyForSlot(3),
+        keyForSlot(4), keyForSlot(5), keyForSlot(6), keyForSlot(7),
+        keyForSlot(8), keyForSlot(9), keyForSlot(10), keyForSlot(11),
+        keyForSlot(12), keyForSlot(13), keyForSlot(14), keyForSlot(15)
+    };
+
+    // ------------------------------------------------------------------
+    // Cursor helpers
+    // ------------------------------------------------------------------
+    struct Cursor {
+        const char *p;
+        const char *end;
+
+        char peek() const { return p < end ? *p : '\0'; }
+    };
+
+    inline bool isWs(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    inline void skipWs(Cursor &c) {
+        while (c.p < c.end && isWs(*c.p)) c.p++;
+    }
+
+    inline bool consume(Cursor &c, char ch) {
+        skipWs(c);
+        if (c.p < c.end && *c.p == ch) {
+            c.p++;
+            return true;
+        }
+        return false;
+    }
+
+    // Reads a string starting at the opening quote; returns the raw span.
+    bool readString(Cursor &c, const char *&s, size_t &n) {
+        if (c.peek() != '"') return false;
+        c.p++;
+        s = c.p;
+        while (c.p < c.end) {
+            const char ch = *c.p;
+            if (ch == '\\') {
+                c.p += 2;
+                continue;
+            }
+            if (ch == '"') {
+                n = (size_t) (c.p - s);
+                c.p++;
+                return true;
+            }
+            c.p++;
+        }
+        return false;
+    }
+
+    bool matchLiteral(Cursor &c, const char *lit, size_t n) {
+        if ((size_t) (c.end - c.p) < n) return false;
+        if (memcmp(c.p, lit, n) != 0) return false;
+        c.p += n;
+        return true;
+    }
+
+    // Skips any nested object/array (string-aware).
+    bool skipComposite(Cursor &c) {
+        int depth = 0;
+        while (c.p < c.end) {
+            const char ch = *c.p;
+            if (ch == '"') {
+                const char *s;
+                size_t n;
+                if (!readString(c, s, n)) return false;
+                continue;
+            }
+            if (ch == '{' || ch == '[') depth++;
+            else if (ch == '}' || ch == ']') {
+                depth--;
+                if (depth == 0) {
+                    c.p++;
+                    return true;
+                }
+            }
+            c.p++;
+        }
+        return false;
+    }
+
+    static const float kPow10[] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+        1e11f, 1e12f, 1e13f, 1e14f, 1e15f, 1e16f, 1e17f, 1e18f, 1e19f, 1e20f
+    };
+
+    inline float scalePow10(float v, int e) {
+        while (e > 20) {
+            v *= 1e20f;
+            e -= 20;
+        }
+        while (e < -20) {
+            v /= 1e20f;
+            e += 20;
+        }
+        return (e >= 0) ? v * kPow10[e] : v / kPow10[-e];
+    }
+
+    // In-place number parser: [-+]digits[.digits][(e|E)[-+]digits]
+    bool parseNumber(Cursor &c, float &out) {
+        const char *start = c.p;
+        bool neg = false;
+        if (c.p < c.end && (*c.p == '-' || *c.p == '+')) {
+            neg = (*c.p == '-');
+            c.p++;
+        }
+
+        uint32_t mant = 0;
+        int exp10 = 0;
+        int digits = 0;
+
+        while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+            if (mant < 100000000u) mant = mant * 10u + (uint32_t) (*c.p - '0');
+            else exp10++; // além da precisão de float: só ajusta a escala
+            digits++;
+            c.p++;
+        }
+
+        if (c.p < c.end && *c.p == '.') {
+            c.p++;
+            while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+                if (mant < 100000000u) {
+                    mant = mant * 10u + (uint32_t) (*c.p - '0');
+                    exp10--;
+                }
+                digits++;
+                c.p++;
+            }
+        }
+
+        if (digits == 0) {
+            c.p = start;
+            return false;
+        }
+
+        if (c.p < c.end && (*c.p == 'e' || *c.p == 'E')) {
+            c.p++;
+            bool eneg = false;
+            if (c.p < c.end && (*c.p == '-' || *c.p == '+')) {
+                eneg = (*c.p == '-');
+                c.p++;
+            }
+            int e = 0;
+            int edigits = 0;
+            while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+                if (e < 1000) e = e * 10 + (*c.p - '0');
+                edigits++;
+                c.p++;
+            }
+            if (edigits == 0) return false;
+            exp10 += eneg ? -e : e;
+        }
+
+        float v = (float) mant;
+        if (exp10 != 0 && mant != 0) v = scalePow10(v, exp10);
+        out = neg ? -v : v;
+        return true;
+    }
+
+    // Inteiro sem sinal (ex.: epoch); parte fracionária é descartada. Acima de
+    // UINT32_MAX, negativo ou com expoente é erro (não dá a volta em silêncio).
+    bool parseUint32(Cursor &c, uint32_t &out) {
+        uint32_t v = 0;
+        int digits = 0;
+        while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+            const uint32_t d = (uint32_t) (*c.p - '0');
+            if (v > (UINT32_MAX - d) / 10u) return false;
+            v = v * 10u + d;
+            digits++;
+            c.p++;
+        }
+        if (digits == 0) return false;
+
+        if (c.p < c.end && *c.p == '.') {
+            c.p++;
+            while (c.p < c.end && *c.p >= '0' && *c.p <= '9') c.p++;
+        }
+        if (c.p < c.end && (*c.p == 'e' || *c.p == 'E')) return false;
+        out = v;
+        return true;
+    }
+
+    // Skips one value of any type. Returns false on syntax error.
+    bool skipValue(Cursor &c) {
+        skipWs(c);
+        const char ch = c.peek();
+        if (ch == '"') {
+            const char *s;
+            size_t n;
+            return readString(c, s, n);
+        }
+        if (ch == '{' || ch == '[') return skipComposite(c);
+        if (ch == 't') return matchLiteral(c, "true", 4);
+        if (ch == 'f') return matchLiteral(c, "false", 5);
+        if (ch == 'n') return matchLiteral(c, "null", 4);
+        float ignored;
+        return parseNumber(c, ignored);
+    }
+} // namespace
+
+namespace {
+    uint8_t lookupKeyId(const char *key, size_t len) {
+        if (!key || len == 0) return kKeyUnknown;
+        const int8_t idx = kSlotToKey[keyHash(key, len)];
+        if (idx < 0) return kKeyUnknown;
+
+        const KeyDef &k = kKeys[idx];
+        if (strlen(k.name) != len || memcmp(k.name, key, len) != 0) return kKeyUnknown;
+        return k.id;
+    }
+
+    inline bool startsNumber(char ch) {
+        return ch == '-' || ch == '+' || (ch >= '0' && ch <= '9');
+    }
+
+    // Objeto plano de uma amostra, a partir do cursor (consome o '}' final).
+    bool parseObjectAt(Cursor &c, TelemetryParser::Sample &out) {
+        out = TelemetryParser::Sample{};
+        if (!consume(c, '{')) return false;
+
+        skipWs(c);
+        if (consume(c, '}')) return true;
+
+        for (;;) {
+            skipWs(c);
+            const char *key;
+            size_t keyLen;
+            if (!readString(c, key, keyLen)) return false;
+            if (!consume(c, ':')) return false;
+            skipWs(c);
+
+            const uint8_t id = lookupKeyId(key, keyLen);
+            const bool numeric = startsNumber(c.peek());
+
+            if (id < TelemetryParser::FieldCount && numeric) {
+                float v;
+                if (!parseNumber(c, v)) return false;
+                out.values[id] = v;
+                out.present |= (uint8_t) (1u << id);
+            } else if (id == kKeyTs && numeric) {
+                if (!parseUint32(c, out.ts)) return false;
+            } else if (!skipValue(c)) {
+                return false;
+            }
+
+            if (consume(c, ',')) continue;
+            if (consume(c, '}')) return true;
+            return false;
+        }
+    }
+} // namespace
+
+TelemetryParser::Field TelemetryParser::lookupKey(const char *key, size_t len) {
+    const uint8_t id = lookupKeyId(key, len);
+    return (id < FieldCount) ? (Field) id : FieldCount;
+}
+
+bool TelemetryParser::parse(const char *json, size_t len, Sample &out) {
+    if (!json) {
+        out = Sample{};
+        return false;
+    }
+
+    Cursor c{json, json + len};
+    return parseObjectAt(c, out);
+}
+
+bool TelemetryParser::parseBatch(const char *json, size_t len, Sample *out, size_t cap, size_t &count,
+                                 bool *stored) {
+    count = 0;
+    if (stored) *stored = false;
+    if (!json || !out) return false;
+
+    Cursor c{json, json + len};
+    if (!consume(c, '{')) return false;
+
+    skipWs(c);
+    if (consume(c, '}')) return true;
+
+    for (;;) {
+        skipWs(c);
+        const char *key;
+        size_t keyLen;
+        if (!readString(c, key, keyLen)) return false;
+        if (!consume(c, ':')) return false;
+        skipWs(c);
+
+        const uint8_t id = lookupKeyId(key, keyLen);
+        if (id == kKeySamples) {
+            if (!consume(c, '[')) return false;
+            skipWs(c);
+            if (!consume(c, ']')) {
+                for (;;) {
+                    if (count >= cap) return false; // lote maior que o suportado
+                    if (!parseObjectAt(c, out[count])) return false;
+                    count++;
+
+                    if (consume(c, ',')) continue;
+                    if (consume(c, ']')) break;
+                    return false;
+                }
+            }
+        } else if (id == kKeyStored && c.peek() == 't') {
+            if (!matchLiteral(c, "true", 4)) return false;
+            if (stored) *stored = true;
+        } else if (!skipValue(c)) {
+            return false;
+        }
+
+        if (consume(c, ',')) continue;
+        if (consume(c, '}')) return true;
+        return false;
+    }
+}
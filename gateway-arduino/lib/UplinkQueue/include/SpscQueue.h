@@ -0,0 +1,85 @@
+/**
+ * @file SpscQueue.h
+ * @brief Bounded lock-free single-producer/single-consumer ring.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_SPSCQUEUE_H
+#define GATEWAY_ARDUINO_SPSCQUEUE_H
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Fixed-capacity SPSC queue (no locks, no heap).
+ *
+ * Exactly one task may call push() and exactly one (other) task may call
+ * pop(). Indices grow monotonically and are masked on access; the producer
+ * publishes with a release store on _tail and the consumer with a release
+ * store on _head, so items are fully written before they become visible.
+ *
+ * @tparam T Item type (copied in/out).
+ * @tparam N Capacity, power of two.
+ */
+template<typename T, size_t N>
+class SpscQueue {
+public:
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    static constexpr size_t kCapacity = N;
+
+    /**
+     * @brief Producer side.
+     *
+     * @return false if the queue is full (item not enqueued).
+     */
+    bool push(const T &item) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        const uint32_t head = _head.load(std::memory_order_acquire);
+        if ((uint32_t) (tail - head) >= N) return false;
+
+        _items[tail & (N - 1)] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer side.
+     *
+     * @return false if the queue is empty.
+     */
+    bool pop(T &out) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        const uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (head == tail) return false;
+
+        out = _items[head & (N - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Approximate size (exact only from the producer or consumer side).
+     */
+    size_t size() const {
+        return (size_t) (uint32_t) (_tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire));
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    T _items[N];
+    std::atomic<uint32_t> _head{0}; // escrito só pelo consumidor
+    std::atomic<uint32_t> _tail{0}; // escrito só pelo produtor
+};
+
+template<typename T, size_t N>
+constexpr size_t SpscQueue<T, N>::kCapacity;
+
+#endif // GATEWAY_ARDUINO_SPSCQUEUE_H
@@ -0,0 +1,119 @@
+/**
+ * @file UplinkQueue.h
+ * @brief Cloud uplink task fed by a lock-free SPSC queue.
+ */
+
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef GATEWAY_ARDUINO_UPLINKQUEUE_H
+#define GATEWAY_ARDUINO_UPLINKQUEUE_H
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <HttpServer.h>
+
+#include "SpscQueue.h"
+
+#ifndef UPLINK_QUEUE_CAPACITY
+#define UPLINK_QUEUE_CAPACITY 16
+#endif
+
+/**
+ * @brief Moves cloud publishing (Ubidots / ThingSpeak) off the HTTP path.
+ *
+ * - The HTTP/loop task only push()es a Telemetry snapshot (O(1), never
+ *   blocks). When the queue is full the new item is rejected and counted as
+ *   an overflow, so ingest latency never depends on the cloud.
+ * - A FreeRTOS task pinned to Config::core (0 = PRO_CPU; Arduino's loop()
+ *   runs on core 1) pops items and runs the handler. The handler owns the
+ *   cloud clients; the idle hook keeps them alive (MQTT loop, reconnects).
+ *
+ * Exactly one producer task and one consumer task (SpscQueue contract).
+ */
+class UplinkQueue {
+public:
+    enum class Kind : uint8_t {
+        Ubidots = 0,
+        ThingSpeak
+    };
+
+    struct Item {
+        Kind kind = Kind::Ubidots;
+        HttpServer::Telemetry telemetry;
+    };
+
+    struct Config {
+        const char *taskName = "uplink";
+        uint32_t stackBytes = 8192; // TLS/MQTT precisam de pilha
+        UBaseType_t priority = 1;
+        BaseType_t core = 0;
+        uint32_t idleMs = 50; // intervalo do onIdle sem itens
+    };
+
+    /**
+     * @brief Runs on the uplink task for each item; false = upload failed (item dropped).
+     */
+    using ItemHandler = std::function<bool(const Item &)>;
+
+    /**
+     * @brief Runs on the uplink task between items (client keep-alive).
+     */
+    using IdleHandler = std::function<void()>;
+
+    static constexpr size_t kCapacity = UPLINK_QUEUE_CAPACITY;
+
+    explicit UplinkQueue(const Config &cfg);
+
+    void onItem(ItemHandler cb);
+
+    void onIdle(IdleHandler cb);
+
+    /**
+     * @brief Create the uplink task (call after the handlers are set).
+     */
+    bool begin();
+
+    /**
+     * @brief Producer side (HTTP/loop task only).
+     *
+     * @return false if the queue is full (counted in overflows()).
+     */
+    bool push(Kind kind, const HttpServer::Telemetry &t);
+
+    size_t pending() const { return _queue.size(); }
+
+    uint32_t pushed() const { return _pushed.load(std::memory_order_relaxed); }
+    uint32_t overflows() const { return _overflows.load(std::memory_order_relaxed); }
+    uint32_t delivered() const { return _delivered.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    static void taskEntry(void *arg);
+
+    void run();
+
+    Config _cfg;
+
+    SpscQueue<Item, kCapacity> _queue;
+
+    ItemHandler _onItem;
+    IdleHandler _onIdle;
+
+    TaskHandle_t _task = nullptr;
+
+    std::atomic<uint32_t> _pushed{0};
+    std::atomic<uint32_t> _overflows{0}; // fila cheia: item rejeitado no push
+    std::atomic<uint32_t> _delivered{0};
+    std::atomic<uint32_t> _dropped{0}; // handler falhou: item descartado (sem retry)
+};
+
+#endif // GATEWAY_ARDUINO_UPLINKQUEUE_H
@@ -0,0 +1,69 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#include "UplinkQueue.h"
+
+constexpr size_t UplinkQueue::kCapacity;
+
+UplinkQueue::UplinkQueue(const Config &cfg) : _cfg(cfg) {
+    if (_cfg.idleMs == 0) _cfg.idleMs = 1;
+}
+
+void UplinkQueue::onItem(ItemHandler cb) {
+    _onItem = cb;
+}
+
+void UplinkQueue::onIdle(IdleHandler cb) {
+    _onIdle = cb;
+}
+
+bool UplinkQueue::begin() {
+    if (_task) return true;
+
+    const BaseType_t rc = xTaskCreatePinnedToCore(&UplinkQueue::taskEntry, _cfg.taskName, _cfg.stackBytes,
+                                                  this, _cfg.priority, &_task, _cfg.core);
+    if (rc != pdPASS) {
+        _task = nullptr;
+        Serial.println("[Uplink] task create failed");
+        return false;
+    }
+
+    Serial.printf("[Uplink] task started (core %d, queue %u)\n", (int) _cfg.core, (unsigned) kCapacity);
+    return true;
+}
+
+bool UplinkQueue::push(Kind kind, const HttpServer::Telemetry &t) {
+    Item item;
+    item.kind = kind;
+    item.telemetry = t;
+
+    if (!_queue.push(item)) {
+        _overflows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _pushed.fetch_add(1, std::memory_order_relaxed);
+    if (_task) xTaskNotifyGive(_task); // acorda a task sem esperar o idleMs
+    return true;
+}
+
+void UplinkQueue::taskEntry(void *arg) {
+    static_cast<UplinkQueue *>(arg)->run();
+}
+
+void UplinkQueue::run() {
+    Item item;
+    for (;;) {
+        // Dorme até um push() ou até o próximo tick de manutenção
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(_cfg.idleMs));
+
+        while (_queue.pop(item)) {
+            const bool ok = _onItem ? _onItem(item) : false;
+            if (ok) _delivered.fetch_add(1, std::memory_order_relaxed);
+            else _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (_onIdle) _onIdle();
+    }
+}
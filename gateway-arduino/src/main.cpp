@@ -10,13 +10,17 @@
 #include "HttpServer.h"
 #include "UbidotsClient.h"
 #include "ThingSpeakClient.h"
+#include "UplinkQueue.h"
+
+#include <SecureCodec.h> // hexDecodeSpan()
 
 #define LED_PIN 2
 #define HTTP_PORT 8045
 
 LedStatus led(LED_PIN);
 WiFiManager *wifi = nullptr;
-HttpServer http(HTTP_PORT);
+// Async: atende vários devices em paralelo sem travar o loop()
+HttpServer http(HTTP_PORT, HttpServer::Mode::Async);
 
 // Ubidots
 UbidotsClient *ubidots = nullptr;
@@ -24,6 +28,9 @@ UbidotsClient *ubidots = nullptr;
 // ThingSpeak
 ThingSpeakClient *thingspeak = nullptr;
 
+// Task de uplink (core 0): dona de ubidots/thingspeak; o HTTP só enfileira
+UplinkQueue *uplink = nullptr;
+
 static bool lastWifiConnected = false;
 
 // -----------------------------
@@ -75,7 +82,9 @@ static void printHttpUrl() {
 }
 
 static void logTelemetryShort(const HttpServer::Telemetry &t) {
-    Serial.print("[TEL] T=");
+    Serial.print("[TEL] ");
+    Serial.print(t.deviceId);
+    Serial.print(" T=");
     Serial.print(t.temperature, 2);
     Serial.print(" H=");
     Serial.print(t.humidity, 2);
@@ -94,6 +103,83 @@ static void logTelemetryShort(const HttpServer::Telemetry &t) {
     Serial.println();
 }
 
+// -----------------------------
+// Console serial: chaves SecureHttp por device (só quem tem a USB, que já lê o flash)
+//   key <deviceId>                               versões aceitas hoje
+//   rotate <deviceId> <versão> <aes> <hmac>      AES em hex (32 bytes), segredo HMAC em hex (1..64 bytes);
+//                                                a chave anterior vale por SECURE_KEY_GRACE_SEC
+// -----------------------------
+static char consoleLine[256];
+static size_t consoleLen = 0;
+
+static void printKey(const char *deviceId) {
+    const SecureKeyStore::Entry *e = http.keys().find(deviceId);
+    if (!e) {
+        Serial.printf("[Keys] %s: unknown device\n", deviceId);
+        return;
+    }
+
+    const uint32_t now = SecureGatewayAuth::nowSec();
+    Serial.printf("[Keys] %s: current v%u", e->id, (unsigned) e->current.version);
+    if (e->previous.valid() && now < e->previousUntil) {
+        Serial.printf(", previous v%u for %lu s", (unsigned) e->previous.version,
+                      (unsigned long) (e->previousUntil - now));
+    }
+    Serial.println();
+}
+
+static void rotateKey(char *args) {
+    char *deviceId = strtok(args, " ");
+    char *version = strtok(nullptr, " ");
+    char *aesHex = strtok(nullptr, " ");
+    char *hmacHex = strtok(nullptr, " ");
+    if (!hmacHex) {
+        Serial.println("[Keys] usage: rotate <deviceId> <version> <aes-hex> <hmac-hex>");
+        return;
+    }
+
+    uint8_t aes[CryptoBackend::kAeadKeyBytes];
+    uint8_t hmac[SecureKeyStore::kMaxHmacBytes];
+    const long v = strtol(version, nullptr, 10);
+    const size_t hmacHexLen = strlen(hmacHex);
+    const size_t hmacLen = hmacHexLen / 2;
+
+    const bool ok = v >= 1 && v <= 255 &&
+                    hexDecodeSpan(aesHex, strlen(aesHex), aes, sizeof(aes)) &&
+                    hmacLen > 0 && hmacLen <= sizeof(hmac) &&
+                    hexDecodeSpan(hmacHex, hmacHexLen, hmac, hmacLen) &&
+                    http.keys().rotate(deviceId, (uint8_t) v, aes, hmac, hmacLen, SECURE_KEY_GRACE_SEC,
+                                       SecureGatewayAuth::nowSec());
+    memset(aes, 0, sizeof(aes));
+    memset(hmac, 0, sizeof(hmac));
+
+    if (ok) printKey(deviceId);
+    else Serial.printf("[Keys] rotate %s failed (unknown device, same version or bad hex)\n", deviceId);
+}
+
+static void handleConsoleLine(char *line) {
+    if (strncmp(line, "key ", 4) == 0) printKey(line + 4);
+    else if (strncmp(line, "rotate ", 7) == 0) rotateKey(line + 7);
+    else if (line[0] != '\0') Serial.println("[Keys] commands: key <deviceId> | rotate <deviceId> <version> ...");
+}
+
+static void pollConsole() {
+    while (Serial.available() > 0) {
+        const int c = Serial.read();
+        if (c == '\r') continue;
+
+        if (c != '\n') {
+            if (consoleLen + 1 < sizeof(consoleLine)) consoleLine[consoleLen++] = (char) c;
+            continue;
+        }
+
+        consoleLine[consoleLen] = '\0';
+        handleConsoleLine(consoleLine);
+        memset(consoleLine, 0, sizeof(consoleLine)); // linha pode ter segredos
+        consoleLen = 0;
+    }
+}
+
 void setup() {
     Serial.begin(115200);
     delay(300);
@@ -151,14 +237,22 @@ void setup() {
     }
 
     // ============================================================
-    // 1) Ubidots: IMEDIATO quando chega POST /telemetry válido
+    // Uplink: roda na task do core 0. Ubidots/ThingSpeak só são usados
+    // aqui, então um broker lento/reconectando não atrasa o POST do device.
     // ============================================================
-    http.onTelemetryUpdated([](const HttpServer::Telemetry &t) {
-        if (!t.hasData) return;
+    UplinkQueue::Config qcfg;
+    qcfg.core = 0; // loop()/HTTP ficam no core 1
 
-        logTelemetryShort(t);
+    uplink = new UplinkQueue(qcfg);
+
+    uplink->onItem([](const UplinkQueue::Item &item) -> bool {
+        if (WiFi.status() != WL_CONNECTED) return false;
+
+        const HttpServer::Telemetry &t = item.telemetry;
 
-        if (ubidots) {
+        if (item.kind == UplinkQueue::Kind::Ubidots) {
+            if (!ubidots) return false;
+            const uint32_t t0 = micros();
             const bool ok = ubidots->publishTelemetry(
                 t.temperature,
                 t.humidity,
@@ -166,7 +260,58 @@ void setup() {
                 t.stepperSpeed, // float (NAN se ausente)
                 t.stepperRpm // float (NAN se ausente)
             );
+            http.metrics().observe(GatewayMetrics::Stage::Ubidots, micros() - t0);
             Serial.println(ok ? "[Ubidots] Telemetry sent" : "[Ubidots] Send failed");
+            return ok;
+        }
+
+        if (!thingspeak) return false;
+        const uint32_t t0 = micros();
+        const bool ok = thingspeak->publishTelemetry(t);
+        http.metrics().observe(GatewayMetrics::Stage::ThingSpeak, micros() - t0);
+        Serial.println(ok ? "[ThingSpeak] Telemetry sent" : "[ThingSpeak] Send failed");
+
+        if (!ok) {
+            Serial.print("[ThingSpeak] err=");
+            Serial.print((int) thingspeak->lastError());
+            Serial.print(" http=");
+            Serial.print(thingspeak->lastHttpStatus());
+            Serial.print(" entry_id=");
+            Serial.println(thingspeak->lastEntryId());
+        }
+        return ok;
+    });
+
+    // Mantém MQTT vivo (loop/reconnect) fora do loop() principal
+    uplink->onIdle([]() {
+        if (WiFi.status() != WL_CONNECTED) return;
+        if (ubidots) ubidots->update();
+        if (thingspeak) thingspeak->update();
+    });
+
+    uplink->begin();
+
+    // Profundidade/perdas da fila no GET /metrics
+    http.metrics().addGauge("gateway_uplink_queue_depth", "Items waiting for the uplink task.", false,
+                            []() { return (double) uplink->pending(); });
+    http.metrics().addGauge("gateway_uplink_overflows_total", "Items rejected because the queue was full.", true,
+                            []() { return (double) uplink->overflows(); });
+    http.metrics().addGauge("gateway_uplink_dropped_total", "Items whose cloud publish failed.", true,
+                            []() { return (double) uplink->dropped(); });
+    http.metrics().addGauge("gateway_uplink_delivered_total", "Items published to the cloud.", true,
+                            []() { return (double) uplink->delivered(); });
+
+    // ============================================================
+    // 1) Ubidots: IMEDIATO quando chega POST /telemetry válido
+    // ============================================================
+    http.onTelemetryUpdated([](const HttpServer::Telemetry &t) {
+        if (!t.hasData) return;
+
+        logTelemetryShort(t);
+
+        // Só enfileira (O(1)); publish acontece na task de uplink
+        if (uplink && !uplink->push(UplinkQueue::Kind::Ubidots, t)) {
+            Serial.println("[Uplink] queue full, Ubidots sample dropped");
         }
 
         // >>> NÃO enviar ThingSpeak aqui (evita rate-limit)
@@ -180,18 +325,8 @@ void setup() {
 
         logTelemetryShort(t);
 
-        if (thingspeak) {
-            const bool ok = thingspeak->publishTelemetry(t);
-            Serial.println(ok ? "[ThingSpeak] Telemetry sent" : "[ThingSpeak] Send failed");
-
-            if (!ok) {
-                Serial.print("[ThingSpeak] err=");
-                Serial.print((int) thingspeak->lastError());
-                Serial.print(" http=");
-                Serial.print(thingspeak->lastHttpStatus());
-                Serial.print(" entry_id=");
-                Serial.println(thingspeak->lastEntryId());
-            }
+        if (uplink && !uplink->push(UplinkQueue::Kind::ThingSpeak, t)) {
+            Serial.println("[Uplink] queue full, ThingSpeak sample dropped");
         }
     });
 }
@@ -221,10 +356,10 @@ void loop() {
     // http.update() precisa rodar para processar requisições E para o timer do ThingSpeak.
     http.update();
 
-    if (connectedNow) {
-        if (ubidots) ubidots->update();
-        if (thingspeak) thingspeak->update();
-    }
+    // Mesma task do http.update(): rotate() nunca roda no meio de uma chamada do verificador
+    pollConsole();
+
+    // ubidots/thingspeak->update() rodam na task de uplink (onIdle)
 
     led.update();
 }
@@ -0,0 +1,230 @@
+// Benchmark do SecureCodec contra as rotinas antigas (ver Makefile).
+//
+//   ./codec_bench [iterations]
+//
+// As versões "legacy" reproduzem o que havia antes do SecureCodec: um char
+// por append numa string (hexEncode/toHex/sha256Hex) e sscanf("%02x") sobre
+// um substring por byte (hexDecodeFixed). std::string faz o papel do String
+// do Arduino.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "SecureCodec.h"
+
+namespace legacy {
+
+std::string hexEncode(const uint8_t* data, size_t len) {
+  static const char* hex = "0123456789abcdef";
+  std::string out;
+  out.reserve(len * 2);
+  for (size_t i = 0; i < len; i++) {
+    out += hex[(data[i] >> 4) & 0xF];
+    out += hex[data[i] & 0xF];
+  }
+  return out;
+}
+
+bool hexDecodeFixed(const std::string& hexStr, uint8_t* out, size_t outLen) {
+  if (hexStr.length() != outLen * 2) return false;
+  for (size_t i = 0; i < outLen; i++) {
+    unsigned int v = 0;
+    if (sscanf(hexStr.substr(i * 2, 2).c_str(), "%02x", &v) != 1) return false;
+    out[i] = (uint8_t)v;
+  }
+  return true;
+}
+
+int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
+  if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+  return -1;
+}
+
+bool hexDecodeSpan(const char* hex, size_t hexLen, uint8_t* out, size_t outLen) {
+  if (!hex || !out || hexLen != outLen * 2) return false;
+  for (size_t i = 0; i < outLen; i++) {
+    const int hi = hexNibble(hex[i * 2]);
+    const int lo = hexNibble(hex[i * 2 + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
+
+const char kB64Url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+int b64UrlValue(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return 26 + (c - 'a');
+  if (c >= '0' && c <= '9') return 52 + (c - '0');
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+std::string base64UrlEncode(const uint8_t* data, size_t len) {
+  std::string out;
+  out.reserve((len / 3) * 4 + 3);
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3) {
+    const uint32_t v = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+    out += kB64Url[(v >> 18) & 0x3F];
+    out += kB64Url[(v >> 12) & 0x3F];
+    out += kB64Url[(v >> 6) & 0x3F];
+    out += kB64Url[v & 0x3F];
+  }
+  const size_t rest = len - i;
+  if (rest > 0) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    if (rest == 2) v |= (uint32_t)data[i + 1] << 8;
+    out += kB64Url[(v >> 18) & 0x3F];
+    out += kB64Url[(v >> 12) & 0x3F];
+    if (rest == 2) out += kB64Url[(v >> 6) & 0x3F];
+  }
+  return out;
+}
+
+bool base64UrlDecodeSpan(const char* in, size_t inLen, uint8_t* out, size_t outCap, size_t& outLen) {
+  outLen = 0;
+  if ((inLen % 4) == 1) return false;
+  const size_t need = (inLen / 4) * 3 + ((inLen % 4) ? (inLen % 4) - 1 : 0);
+  if (need > outCap) return false;
+  size_t o = 0, i = 0;
+  for (; i + 4 <= inLen; i += 4) {
+    const int a = b64UrlValue(in[i]), b = b64UrlValue(in[i + 1]);
+    const int c = b64UrlValue(in[i + 2]), d = b64UrlValue(in[i + 3]);
+    if ((a | b | c | d) < 0) return false;
+    const uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+    out[o++] = (uint8_t)(v >> 16);
+    out[o++] = (uint8_t)(v >> 8);
+    out[o++] = (uint8_t)v;
+  }
+  const size_t rest = inLen - i;
+  if (rest > 0) {
+    const int a = b64UrlValue(in[i]), b = b64UrlValue(in[i + 1]);
+    const int c = (rest == 3) ? b64UrlValue(in[i + 2]) : 0;
+    if ((a | b | c) < 0) return false;
+    const uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6);
+    out[o++] = (uint8_t)(v >> 16);
+    if (rest == 3) out[o++] = (uint8_t)(v >> 8);
+  }
+  outLen = o;
+  return true;
+}
+
+} // namespace legacy
+
+namespace {
+
+volatile size_t gSink; // impede o compilador de descartar os laços
+
+double nowSec() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// MB/s de bytes binários processados
+template <typename F>
+double mbPerSec(size_t bytes, long iterations, F fn) {
+  const double t0 = nowSec();
+  for (long i = 0; i < iterations; i++) fn();
+  const double dt = nowSec() - t0;
+  return dt > 0 ? (double)bytes * iterations / dt / 1e6 : 0;
+}
+
+void row(const char* name, size_t len, double oldMb, double newMb) {
+  printf("%-20s %6zu %10.1f %10.1f %7.1fx\n", name, len, oldMb, newMb, oldMb > 0 ? newMb / oldMb : 0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const long iterations = (argc > 1) ? strtol(argv[1], nullptr, 10) : 20000;
+  if (iterations <= 0) {
+    fprintf(stderr, "iterations: > 0\n");
+    return 2;
+  }
+
+  static const size_t kSizes[] = {16, 32, 256, 1024};
+  int failed = 0;
+
+  printf("%ld iterations, MB/s of binary data (legacy -> SecureCodec)\n", iterations);
+  printf("%-20s %6s %10s %10s %8s\n", "routine", "bytes", "legacy", "codec", "speedup");
+
+  for (size_t len : kSizes) {
+    std::vector<uint8_t> data(len), back(len);
+    for (size_t i = 0; i < len; i++) data[i] = (uint8_t)(i * 131u + 7u);
+
+    std::vector<char> hex(2 * len + 1), b64(base64UrlEncodedLen(len) + 1);
+    hexEncodeTo(data.data(), len, hex.data(), hex.size());
+    base64UrlEncodeTo(data.data(), len, b64.data(), b64.size());
+
+    // Mesma saída das rotinas antigas
+    const std::string oldHex = legacy::hexEncode(data.data(), len);
+    const std::string oldB64 = legacy::base64UrlEncode(data.data(), len);
+    size_t n = 0;
+    if (oldHex != hex.data() || oldB64 != b64.data() ||
+        !hexDecodeSpan(hex.data(), 2 * len, back.data(), len) || back != data ||
+        !base64UrlDecodeSpan(b64.data(), oldB64.size(), back.data(), len, n) || n != len || back != data) {
+      printf("MISMATCH at %zu bytes\n", len);
+      failed++;
+    }
+
+    row("hex encode", len,
+        mbPerSec(len, iterations, [&] { gSink += legacy::hexEncode(data.data(), len).size(); }),
+        mbPerSec(len, iterations, [&] { gSink += hexEncodeTo(data.data(), len, hex.data(), hex.size()); }));
+    row("hex decode (sscanf)", len,
+        mbPerSec(len, iterations / 10 + 1, [&] { gSink += legacy::hexDecodeFixed(oldHex, back.data(), len); }),
+        mbPerSec(len, iterations, [&] { gSink += hexDecodeSpan(hex.data(), 2 * len, back.data(), len); }));
+    row("hex decode (span)", len,
+        mbPerSec(len, iterations, [&] { gSink += legacy::hexDecodeSpan(hex.data(), 2 * len, back.data(), len); }),
+        mbPerSec(len, iterations, [&] { gSink += hexDecodeSpan(hex.data(), 2 * len, back.data(), len); }));
+    row("base64url encode", len,
+        mbPerSec(len, iterations, [&] { gSink += legacy::base64UrlEncode(data.data(), len).size(); }),
+        mbPerSec(len, iterations, [&] { gSink += base64UrlEncodeTo(data.data(), len, b64.data(), b64.size()); }));
+    row("base64url decode", len,
+        mbPerSec(len, iterations, [&] {
+          size_t m = 0;
+          gSink += legacy::base64UrlDecodeSpan(b64.data(), oldB64.size(), back.data(), len, m) + m;
+        }),
+        mbPerSec(len, iterations, [&] {
+          size_t m = 0;
+          gSink += base64UrlDecodeSpan(b64.data(), oldB64.size(), back.data(), len, m) + m;
+        }));
+  }
+
+  // Inválidos continuam recusados
+  uint8_t o[4];
+  size_t m = 0;
+  if (hexDecodeSpan("0g", 2, o, 1) || hexDecodeSpan("000000zz", 8, o, 4) ||
+      base64UrlDecodeSpan("AA=A", 4, o, sizeof(o), m) || base64UrlDecodeSpan("A", 1, o, sizeof(o), m)) {
+    printf("invalid input accepted\n");
+    failed++;
+  }
+
+  // Todos os 256 bytes: só [0-9a-fA-F] / [A-Za-z0-9-_] decodificam, com o valor certo
+  for (int c = 0; c < 256; c++) {
+    const bool isHex = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    const int nibble = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+    const char hexIn[2] = {'0', (char) c};
+    const bool hexOk = hexDecodeSpan(hexIn, 2, o, 1);
+
+    const char* pos = (c != 0) ? strchr(legacy::kB64Url, c) : nullptr;
+    const char b64In[2] = {(char) c, 'A'};
+    const bool b64Ok = base64UrlDecodeSpan(b64In, 2, o + 1, 1, m);
+
+    if (hexOk != isHex || (isHex && o[0] != nibble) || b64Ok != (pos != nullptr) ||
+        (pos && o[1] != (uint8_t) ((pos - legacy::kB64Url) << 2))) {
+      printf("decode table mismatch at byte 0x%02x\n", c);
+      failed++;
+    }
+  }
+
+  return failed ? 1 : 0;
+}
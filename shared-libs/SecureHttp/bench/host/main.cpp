@@ -0,0 +1,41 @@
+// Self-test + benchmark dos CryptoBackend no host (ver Makefile).
+//
+//   ./crypto_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CryptoBackend.h"
+#include "SecureHttpBench.h"
+
+int main(int argc, char** argv) {
+  const long iterations = (argc > 1) ? strtol(argv[1], nullptr, 10) : 20000;
+  if (iterations <= 0 || iterations > 65535) {
+    fprintf(stderr, "iterations: 1..65535\n");
+    return 2;
+  }
+
+  const CryptoBackend* backends[4];
+  const size_t count = cryptoBackends(backends, 4);
+
+  int failed = 0;
+  for (size_t b = 0; b < count; b++) {
+    const bool ok = cryptoBackendSelfTest(*backends[b]);
+    printf("backend %-8s self-test %s\n", backends[b]->name(), ok ? "ok" : "FAILED");
+    if (!ok) failed++;
+  }
+
+  SecureHttpBenchRow rows[12];
+  const size_t n = secureHttpCryptoBenchAll(rows, 12, (uint16_t) iterations);
+
+  printf("\n%ld msgs/size, ns per message (one-shot -> persistent)\n", iterations);
+  printf("%-8s %6s %18s %18s\n", "backend", "bytes", "aes-256-gcm", "hmac-sha256");
+  for (size_t i = 0; i < n; i++) {
+    const SecureHttpBenchRow& r = rows[i];
+    printf("%-8s %6u %8lu -> %6lu %8lu -> %6lu\n", r.backend, (unsigned) r.payloadBytes,
+           (unsigned long) r.gcmOneShotNs, (unsigned long) r.gcmPersistentNs,
+           (unsigned long) r.hmacOneShotNs, (unsigned long) r.hmacPersistentNs);
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+// Teste do NonceCache no host na taxa configurada (ver Makefile).
+//
+//   ./nonce_test
+//
+// Dirige o cache com SECURE_NONCE_RATE_PER_SEC nonces novos por segundo (o que o
+// gateway recebe de devices sem sessão) e confere que nenhum request leva 503
+// (replay_cache_full) e que todo nonce aceito continua "visto" por SECURE_NONCE_TTL_SEC.
+// Acima da taxa o cache recusa (fail closed) em vez de esquecer nonces vivos.
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "NonceCache.h"
+#include "SecureHttpConfig.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(cond)                                                  \
+    do {                                                             \
+        if (!(cond)) {                                               \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                             \
+        }                                                            \
+    } while (0)
+
+// Nonce no formato do device: 16 hex
+struct NonceGen {
+    uint64_t next = 0x1234000000000000ull;
+
+    void make(char out[17]) {
+        static const char hex[] = "0123456789abcdef";
+        const uint64_t v = next++;
+        for (int i = 0; i < 16; i++) out[i] = hex[(v >> (60 - 4 * i)) & 0xF];
+        out[16] = '\0';
+    }
+};
+
+// Largura da fatia de tempo do NonceCache (ttl / (kBuckets - 2), arredondada para cima)
+const uint32_t kSliceSec = (SECURE_NONCE_TTL_SEC + NonceCache::kBuckets - 3) / (NonceCache::kBuckets - 2);
+
+struct Accepted {
+    uint32_t at;
+    char nonce[17];
+};
+
+struct RunStats {
+    unsigned long offered = 0;
+    unsigned long accepted = 0;
+    unsigned long rejectedFull = 0; // 503 replay_cache_full
+    unsigned long forgotten = 0; // aceito e não visto antes do TTL
+};
+
+// `ratePerSec` requests por segundo por `seconds`, a partir de `start`; cada aceito é
+// conferido TTL - 1 s depois (ainda tem de ser replay)
+RunStats drive(NonceCache &cache, NonceGen &gen, uint32_t start, uint32_t seconds, uint32_t ratePerSec) {
+    RunStats st;
+    std::vector<Accepted> log;
+    size_t checked = 0;
+
+    for (uint32_t now = start; now < start + seconds; now++) {
+        while (checked < log.size() && log[checked].at + SECURE_NONCE_TTL_SEC - 1 <= now) {
+            if (!cache.seenRecently(now, log[checked].nonce, 16)) st.forgotten++;
+            checked++;
+        }
+
+        for (uint32_t i = 0; i < ratePerSec; i++) {
+            Accepted a;
+            a.at = now;
+            gen.make(a.nonce);
+            st.offered++;
+
+            // Mesma ordem do SecureGatewayAuth: replay, espaço, remember
+            if (cache.seenRecently(now, a.nonce, 16)) continue;
+            if (!cache.hasRoom(now) || !cache.remember(now, a.nonce, 16)) {
+                st.rejectedFull++;
+                continue;
+            }
+            st.accepted++;
+            log.push_back(a);
+        }
+    }
+    return st;
+}
+
+void print(const char *name, const RunStats &st) {
+    printf("  %-28s offered=%lu accepted=%lu 503=%lu forgotten=%lu\n", name, st.offered, st.accepted,
+           st.rejectedFull, st.forgotten);
+}
+
+void testConfiguredRate() {
+    printf("configured rate: %u/s, TTL %u s\n", (unsigned) SECURE_NONCE_RATE_PER_SEC,
+           (unsigned) SECURE_NONCE_TTL_SEC);
+    NonceCache cache(NonceCache::capacityFor(SECURE_NONCE_RATE_PER_SEC, SECURE_NONCE_TTL_SEC),
+                     SECURE_NONCE_TTL_SEC);
+    printf("  capacity=%zu slots (%zu bytes)\n", cache.capacity(), cache.capacity() * sizeof(uint32_t));
+
+    NonceGen gen;
+    const RunStats st = drive(cache, gen, 1760000000u, 4 * SECURE_NONCE_TTL_SEC, SECURE_NONCE_RATE_PER_SEC);
+    print("sustained", st);
+    CHECK(st.rejectedFull == 0);
+    CHECK(st.forgotten == 0);
+    CHECK(cache.size() <= (size_t) SECURE_NONCE_RATE_PER_SEC * (SECURE_NONCE_TTL_SEC + 2 * kSliceSec));
+}
+
+// Depois de um período ocioso, o dobro da taxa por uma fatia cabe (spill para a tabela anterior)
+void testBurstAfterIdle() {
+    printf("burst after idle\n");
+    NonceCache cache(NonceCache::capacityFor(SECURE_NONCE_RATE_PER_SEC, SECURE_NONCE_TTL_SEC),
+                     SECURE_NONCE_TTL_SEC);
+    NonceGen gen;
+    const RunStats st = drive(cache, gen, 1760000000u, kSliceSec, 2 * SECURE_NONCE_RATE_PER_SEC);
+    print("2x rate, one slice", st);
+    CHECK(st.rejectedFull == 0);
+}
+
+// Acima da capacidade: recusa com 503, nunca esquece um nonce aceito antes do TTL
+void testOverload() {
+    printf("overload\n");
+    NonceCache cache(NonceCache::capacityFor(SECURE_NONCE_RATE_PER_SEC, SECURE_NONCE_TTL_SEC),
+                     SECURE_NONCE_TTL_SEC);
+    NonceGen gen;
+    const RunStats st = drive(cache, gen, 1760000000u, 2 * SECURE_NONCE_TTL_SEC, 4 * SECURE_NONCE_RATE_PER_SEC);
+    print("4x rate", st);
+    CHECK(st.rejectedFull > 0);
+    CHECK(st.forgotten == 0);
+    // Ainda aceita pelo menos a taxa configurada
+    CHECK(st.accepted >= (unsigned long) SECURE_NONCE_RATE_PER_SEC * 2 * SECURE_NONCE_TTL_SEC);
+}
+
+// Replay direto: o mesmo nonce é recusado até o TTL e aceito depois que expira
+void testReplayWindow() {
+    printf("replay window\n");
+    NonceCache cache(NonceCache::capacityFor(SECURE_NONCE_RATE_PER_SEC, SECURE_NONCE_TTL_SEC),
+                     SECURE_NONCE_TTL_SEC);
+    const uint32_t t0 = 1760000000u;
+    CHECK(cache.remember(t0, "00112233aabbccdd", 16));
+    CHECK(cache.seenRecently(t0 + SECURE_NONCE_TTL_SEC, "00112233aabbccdd", 16));
+    CHECK(!cache.seenRecently(t0 + 2 * SECURE_NONCE_TTL_SEC, "00112233aabbccdd", 16));
+}
+
+} // namespace
+
+int main() {
+    testConfiguredRate();
+    testBurstAfterIdle();
+    testOverload();
+    testReplayWindow();
+
+    if (gFailures) {
+        printf("%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all NonceCache tests passed\n");
+    return 0;
+}
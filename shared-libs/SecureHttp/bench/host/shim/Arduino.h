@@ -0,0 +1,21 @@
+// Shim do core Arduino para os testes do SecureHttp no host (só o que NonceCache usa).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+class String {
+public:
+    String(const char *s = "") : _s(s ? s : "") {}
+
+    const char *c_str() const { return _s.c_str(); }
+
+    unsigned length() const { return (unsigned) _s.size(); }
+
+private:
+    std::string _s;
+};
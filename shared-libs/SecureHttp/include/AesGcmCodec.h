@@ -7,6 +7,9 @@
 
 #pragma once
 #include <Arduino.h>
+#include <memory>
+
+#include "CryptoBackend.h"
 
 /**
  * @file AesGcmCodec.h
@@ -17,6 +20,8 @@
  * - Key: 32 bytes (AES-256)
  * - IV:  12 bytes (recommended length for GCM)
  * - Tag: 16 bytes
+ *
+ * The cipher itself comes from cryptoBackend() (see CryptoBackend.h).
  */
 
 struct AesGcmEncrypted {
@@ -51,6 +56,82 @@ public:
         const uint8_t* aad, size_t aadLen,
         const uint8_t* cipher, size_t cipherLen,
         const uint8_t* tag, size_t tagLen);
+
+    /**
+     * @brief Allocation-free decryptWithAad() into a caller buffer.
+     *
+     * @p out receives @p cipherLen bytes (not NUL-terminated). Inside one
+     * buffer the output must start at least 8 bytes before the input (e.g.
+     * out = buf, cipher = buf + 16); see CryptoBackend::AeadKey.
+     *
+     * @return false on bad parameters or authentication failure.
+     */
+    static bool decryptWithAadTo(
+        const uint8_t* key, size_t keyLen,
+        const uint8_t* iv, size_t ivLen,
+        const uint8_t* aad, size_t aadLen,
+        const uint8_t* cipher, size_t cipherLen,
+        const uint8_t* tag, size_t tagLen,
+        uint8_t* out);
+};
+
+/**
+ * @brief Long-lived AES-256-GCM context: the key schedule is expanded once.
+ *
+ * The static AesGcmCodec helpers create a CryptoBackend::AeadKey (context
+ * allocation + AES key expansion + GHASH table) on every message; an
+ * AesGcmContext does that in setKey() and each message only runs the
+ * cipher. One message at a time (not thread-safe).
+ */
+class AesGcmContext {
+public:
+    AesGcmContext() = default;
+
+    AesGcmContext(const AesGcmContext&) = delete;
+    AesGcmContext& operator=(const AesGcmContext&) = delete;
+
+    /**
+     * @brief Expand @p key (32 bytes) on @p backend. Can be called again to rotate keys.
+     */
+    bool setKey(const uint8_t* key, size_t keyLen, const CryptoBackend& backend = cryptoBackend());
+
+    bool ready() const { return _key != nullptr; }
+
+    /**
+     * @brief Drop the key (frees the expanded schedule).
+     */
+    void reset() { _key.reset(); }
+
+    /**
+     * @brief Encrypt @p len bytes and produce a 16-byte tag.
+     */
+    bool encrypt(const uint8_t* iv, size_t ivLen,
+                 const uint8_t* aad, size_t aadLen,
+                 const uint8_t* plain, size_t len,
+                 uint8_t* cipher,
+                 uint8_t* tag, size_t tagLen);
+
+    /**
+     * @brief Authenticated decrypt (same buffer rules as AesGcmCodec::decryptWithAadTo()).
+     */
+    bool decrypt(const uint8_t* iv, size_t ivLen,
+                 const uint8_t* aad, size_t aadLen,
+                 const uint8_t* cipher, size_t len,
+                 const uint8_t* tag, size_t tagLen,
+                 uint8_t* out);
+
+    /**
+     * @brief Streaming decrypt (see CryptoBackend::AeadKey::openStart()).
+     *
+     * Chunks passed to decryptUpdate() must be multiples of 16 bytes except
+     * the last; the plaintext is valid only if decryptFinish() returns true.
+     */
+    bool decryptStart(const uint8_t* iv, size_t ivLen, const uint8_t* aad, size_t aadLen);
+    bool decryptUpdate(const uint8_t* cipher, size_t len, uint8_t* out);
+    bool decryptFinish(const uint8_t* tag, size_t tagLen);
+
+private:
+    std::unique_ptr<CryptoBackend::AeadKey> _key;
 };
 
 #endif //SHARED_LIBS_AESGCMCODEC_H
\ No newline at end of file
@@ -0,0 +1,149 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_CRYPTOBACKEND_H
+#define SHARED_LIBS_CRYPTOBACKEND_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file CryptoBackend.h
+ * @brief Crypto primitives used by SecureHttp, behind one replaceable interface.
+ *
+ * Everything SecureHttp needs from a crypto library goes through a
+ * CryptoBackend: AES-256-GCM seal/open, SHA-256 (streaming, so HMAC keys can
+ * be prepared once) and random bytes. Two backends are built in:
+ * - "mbedtls": mbedtls 2.x; on ESP32 it runs on the hardware AES/SHA engines.
+ * - "software": portable C++, no dependencies (builds on Linux).
+ *
+ * This header does not depend on Arduino, so the backends, the self-test and
+ * the benchmark also build on a host (see bench/host).
+ *
+ * Default backend: mbedtls, or software when built with
+ * -DSECUREHTTP_CRYPTO_SOFTWARE. Hosts without mbedtls headers build with
+ * -DSECUREHTTP_NO_MBEDTLS.
+ */
+
+class CryptoBackend {
+public:
+  static constexpr size_t kSha256Bytes = 32;
+  static constexpr size_t kSha256BlockBytes = 64;
+  static constexpr size_t kAeadKeyBytes = 32; ///< AES-256
+  static constexpr size_t kAeadIvBytes = 12;
+  static constexpr size_t kAeadTagBytes = 16;
+  static constexpr size_t kAeadBlockBytes = 16;
+  static constexpr size_t kHashStateBytes = 160; ///< >= SHA-256 context of every backend
+
+  /**
+   * @brief Opaque SHA-256 state (layout owned by the backend; no heap).
+   */
+  struct HashState {
+    alignas(8) uint8_t raw[kHashStateBytes];
+  };
+
+  /**
+   * @brief AES-256-GCM key with its schedule already expanded.
+   *
+   * IV is kAeadIvBytes and tag kAeadTagBytes. A failed open() leaves no
+   * plaintext in @p out. @p out must not overlap @p cipher unless it starts
+   * 8+ bytes before it inside one buffer (the rule every backend supports).
+   */
+  class AeadKey {
+  public:
+    virtual ~AeadKey() {}
+
+    virtual bool seal(const uint8_t* iv,
+                      const uint8_t* aad, size_t aadLen,
+                      const uint8_t* plain, size_t len,
+                      uint8_t* cipher, uint8_t* tag) = 0;
+
+    virtual bool open(const uint8_t* iv,
+                      const uint8_t* aad, size_t aadLen,
+                      const uint8_t* cipher, size_t len,
+                      const uint8_t* tag, uint8_t* out) = 0;
+
+    /**
+     * @brief Streaming open: openStart(), openUpdate() per chunk, openFinish().
+     *
+     * The stream state lives in the key: one stream at a time, and no
+     * seal()/open() in between. Every openUpdate() but the last must be a
+     * multiple of kAeadBlockBytes; @p out must not overlap @p cipher.
+     * Plaintext comes out before the tag is checked, so callers must drop
+     * it unless openFinish() returns true.
+     */
+    virtual bool openStart(const uint8_t* iv, const uint8_t* aad, size_t aadLen) = 0;
+    virtual bool openUpdate(const uint8_t* cipher, size_t len, uint8_t* out) = 0;
+    virtual bool openFinish(const uint8_t* tag) = 0;
+  };
+
+  virtual ~CryptoBackend() {}
+
+  virtual const char* name() const = 0;
+
+  /**
+   * @brief Expand @p key (kAeadKeyBytes). Caller owns the result; nullptr on error.
+   */
+  virtual AeadKey* newAeadKey(const uint8_t* key, size_t keyLen) const = 0;
+
+  // SHA-256 em HashState: start/copy inicializam, release libera (sempre chamar)
+  virtual void sha256Start(HashState& s) const = 0;
+  virtual void sha256Copy(HashState& dst, const HashState& src) const = 0;
+  virtual void sha256Update(HashState& s, const void* data, size_t len) const = 0;
+  virtual void sha256Finish(HashState& s, uint8_t out[kSha256Bytes]) const = 0;
+  virtual void sha256Release(HashState& s) const = 0;
+
+  /**
+   * @brief Fill @p out with random bytes (default: esp_fill_random / /dev/urandom).
+   */
+  virtual bool random(uint8_t* out, size_t len) const;
+
+  /**
+   * @brief One-shot SHA-256.
+   */
+  void sha256(const void* data, size_t len, uint8_t out[kSha256Bytes]) const;
+
+  /**
+   * @brief Absorb k ^ ipad into @p inner and k ^ opad into @p outer (both get started).
+   */
+  void hmacSha256Pads(const uint8_t* key, size_t keyLen, HashState& inner, HashState& outer) const;
+
+  /**
+   * @brief One-shot HMAC-SHA256.
+   */
+  void hmacSha256(const uint8_t* key, size_t keyLen, const void* data, size_t len,
+                  uint8_t out[kSha256Bytes]) const;
+};
+
+#ifndef SECUREHTTP_NO_MBEDTLS
+const CryptoBackend& mbedtlsCryptoBackend();
+#endif
+const CryptoBackend& softwareCryptoBackend();
+
+/**
+ * @brief Backend used by AesGcmCodec, AesGcmContext, HmacSha256 and friends.
+ */
+const CryptoBackend& cryptoBackend();
+
+/**
+ * @brief Select the backend. Contexts keep the backend they were keyed with,
+ *        so call this before the first request.
+ */
+void setCryptoBackend(const CryptoBackend& backend);
+
+/**
+ * @brief Built-in backends (mbedtls first when compiled in).
+ *
+ * @return Number written to @p out (at most @p cap).
+ */
+size_t cryptoBackends(const CryptoBackend** out, size_t cap);
+
+/**
+ * @brief Known-answer test: SHA-256 ("abc"), HMAC (RFC 4231 #2) and
+ *        AES-256-GCM (GCM spec test case 16, seal + open + tamper).
+ */
+bool cryptoBackendSelfTest(const CryptoBackend& backend);
+
+#endif //SHARED_LIBS_CRYPTOBACKEND_H
@@ -1,9 +1,10 @@
 #pragma once
 #include <Arduino.h>
+#include "CryptoBackend.h"
 
 /**
  * @file CryptoUtils.h
- * @brief SHA-256 and HMAC-SHA256 helpers for SecureHttp.
+ * @brief SHA-256 and HMAC-SHA256 helpers for SecureHttp (on cryptoBackend()).
  */
 
 /**
@@ -33,3 +34,90 @@ String hmacSha256Hex(const String& key, const String& msg);
  * @return true if equal; false otherwise.
  */
 bool constantTimeEquals(const String& a, const String& b);
+
+/**
+ * @brief Constant-time comparison of two byte buffers of the same length.
+ */
+bool constantTimeEqualsBytes(const uint8_t* a, const uint8_t* b, size_t len);
+
+/**
+ * @brief HMAC-SHA256 key with the ipad/opad blocks already absorbed.
+ *
+ * Preparing a key costs two SHA-256 compressions (plus hashing keys longer
+ * than a block); a long-lived HmacSha256Key pays that once, and each message
+ * only clones the two prepared contexts. Not thread-safe to set() while
+ * messages are being computed from it.
+ */
+class HmacSha256Key {
+public:
+  HmacSha256Key() = default;
+  HmacSha256Key(const uint8_t* key, size_t keyLen);
+  ~HmacSha256Key();
+
+  HmacSha256Key(const HmacSha256Key&) = delete;
+  HmacSha256Key& operator=(const HmacSha256Key&) = delete;
+
+  /**
+   * @brief (Re)prepare for @p key; messages from this key run on @p backend.
+   */
+  void set(const uint8_t* key, size_t keyLen, const CryptoBackend& backend = cryptoBackend());
+
+  bool ready() const { return _backend != nullptr; }
+
+private:
+  friend class HmacSha256;
+
+  const CryptoBackend* _backend = nullptr;
+  CryptoBackend::HashState _inner; // após SHA-256(k ^ ipad) parcial
+  CryptoBackend::HashState _outer; // após SHA-256(k ^ opad) parcial
+};
+
+/**
+ * @brief Incremental HMAC-SHA256 on stack-held SHA-256 states.
+ *
+ * Lets the caller feed a message in pieces (e.g. the SecureHttp canonical
+ * string field by field) without building it in memory. The SHA-256 states
+ * live inside the object (CryptoBackend::HashState), so nothing is allocated.
+ */
+class HmacSha256 {
+public:
+  static constexpr size_t kBlockSize = CryptoBackend::kSha256BlockBytes;
+  static constexpr size_t kDigestSize = CryptoBackend::kSha256Bytes;
+
+  HmacSha256(const uint8_t* key, size_t keyLen, const CryptoBackend& backend = cryptoBackend());
+
+  /**
+   * @brief Start a message from a prepared key (no key setup per message).
+   */
+  explicit HmacSha256(const HmacSha256Key& key);
+
+  /**
+   * @brief Idle object (e.g. a member kept across calls); start() before update().
+   */
+  HmacSha256() = default;
+
+  ~HmacSha256();
+
+  /**
+   * @brief (Re)start a message from a prepared key.
+   */
+  void start(const HmacSha256Key& key);
+
+  HmacSha256(const HmacSha256&) = delete;
+  HmacSha256& operator=(const HmacSha256&) = delete;
+
+  void update(const void* data, size_t len);
+  void update(const char* s);
+
+  /**
+   * @brief Finish and write the 32-byte MAC (object must not be reused).
+   */
+  void finish(uint8_t out[kDigestSize]);
+
+private:
+  void release();
+
+  const CryptoBackend* _backend = nullptr;
+  CryptoBackend::HashState _inner;
+  CryptoBackend::HashState _outer;
+};
@@ -8,9 +8,11 @@
 #pragma once
 #include <Arduino.h>
 
+#include "SecureCodec.h" // hexEncodeTo(), hexDecodeSpan()
+
 /**
  * @file HexUtils.h
- * @brief HEX encoding/decoding helpers used by SecureHttp.
+ * @brief HEX encoding/decoding helpers used by SecureHttp (String wrappers over SecureCodec.h).
  */
 
 /**
@@ -10,32 +10,55 @@
 
 /**
  * @file NonceCache.h
- * @brief Small in-memory replay cache for request nonces.
+ * @brief In-memory replay cache for request nonces.
  *
  * The gateway uses this to reject replayed requests within a TTL window.
  */
 
-/**
- * @brief Nonce cache entry.
- */
-struct NonceEntry {
-    uint32_t ts;  ///< Stored timestamp in seconds.
-    String nonce; ///< Stored nonce string.
-};
+/** @brief Longest nonce the cache accepts (the device sends 16 hex chars). */
+#define SECURE_NONCE_MAX_LEN 32
 
 /**
- * @brief Fixed-capacity nonce cache with TTL eviction.
+ * @brief Fixed-memory nonce cache: hashed fingerprints, time-bucketed expiry.
+ *
+ * Each nonce is reduced to a 32-bit fingerprint (a 16-hex-char nonce is
+ * decoded to its 8 bytes first, anything else is hashed) and stored in one
+ * of kBuckets open-addressing tables (linear probing, 4 bytes per slot).
+ * The tables form a timing wheel: each one holds the nonces of one time
+ * slice of ttl / (kBuckets - 2) seconds, and a table is wiped as a whole
+ * when its slice falls out of the window. So there are no per-entry
+ * deletes or tombstones, and lookup/insert/expiry are amortized O(1).
  *
- * This class is designed for constrained devices. It keeps up to @p cap entries.
- * Entries older than @p ttlSec are removed during cache operations.
+ * Inserts go to the current slice's table and spill into the previous
+ * slice's table when it is full; both still have at least @p ttlSec to
+ * live, so every nonce is kept for at least @p ttlSec (up to two slices
+ * longer). A burst may therefore use two tables' worth of slots, and the
+ * sustained rate is set by the table size (see capacityFor()). Two
+ * different nonces share a fingerprint with probability ~2^-32 per probe;
+ * the cost is a false "replay" for the second one. Nothing is allocated
+ * after construction.
  */
 class NonceCache {
 public:
+    static constexpr uint8_t kBuckets = 16;
+
+    /**
+     * @brief Total slots that take @p ratePerSec new nonces per second, for
+     *        as long as it lasts, without a full table.
+     *
+     * One table per slice, filled to 3/4 (e.g. 16/s with a 300 s TTL:
+     * 22 s slices, 470 slots per table, 7520 slots = ~30 KB).
+     */
+    static constexpr size_t capacityFor(uint32_t ratePerSec, uint32_t ttlSec) {
+        return (size_t)kBuckets * tableSlotsFor((uint64_t)ratePerSec * sliceSecFor(ttlSec));
+    }
+
     /**
      * @brief Construct a nonce cache.
      *
-     * @param cap Maximum number of entries kept.
-     * @param ttlSec Time-to-live (seconds) for each entry.
+     * @param cap Total slots (split evenly across kBuckets tables, min 16
+     *            each); about 3/4 of a table can be filled.
+     * @param ttlSec Minimum time-to-live (seconds) for each entry.
      */
     NonceCache(size_t cap, uint32_t ttlSec);
 
@@ -44,6 +67,9 @@ public:
      */
     ~NonceCache();
 
+    NonceCache(const NonceCache&) = delete;
+    NonceCache& operator=(const NonceCache&) = delete;
+
     /**
      * @brief Check whether a nonce has been seen recently (within TTL).
      *
@@ -54,26 +80,74 @@ public:
     bool seenRecently(uint32_t now, const String& nonce);
 
     /**
-     * @brief Store a nonce as seen at time @p now.
+     * @brief Same as seenRecently(uint32_t, const String&) for a char span.
+     */
+    bool seenRecently(uint32_t now, const char* nonce, size_t len);
+
+    /**
+     * @brief Whether remember() at @p now has room (current or previous table not full).
      *
-     * If the cache is full, the oldest entry is replaced.
+     * Check this before accepting a request: a nonce that cannot be stored
+     * could be replayed.
+     */
+    bool hasRoom(uint32_t now);
+
+    /**
+     * @brief Store a nonce as seen at time @p now.
      *
      * @param now Current time in seconds.
      * @param nonce Nonce to store.
+     * @return false if the current and previous tables are full (nothing is evicted).
+     */
+    bool remember(uint32_t now, const String& nonce);
+
+    /**
+     * @brief Same as remember(uint32_t, const String&) for a char span.
+     *
+     * Nonces longer than SECURE_NONCE_MAX_LEN are not stored.
      */
-    void remember(uint32_t now, const String& nonce);
+    bool remember(uint32_t now, const char* nonce, size_t len);
+
+    /** @brief Live entries (all tables). */
+    size_t size() const;
+
+    /** @brief Total slots. */
+    size_t capacity() const { return _bucketSlots * kBuckets; }
 
 private:
+    // kBuckets - 2 fatias cobrem o TTL: a corrente e a anterior (spill) ainda vivem >= TTL
+    static constexpr uint32_t sliceSecFor(uint32_t ttlSec) {
+        return ttlSec < kBuckets - 2 ? 1 : (ttlSec + kBuckets - 3) / (kBuckets - 2);
+    }
+
+    static constexpr size_t tableSlotsFor(uint64_t perSlice) {
+        return (perSlice * 4 + 2) / 3 < 16 ? 16 : (size_t)((perSlice * 4 + 2) / 3);
+    }
+
     /**
-     * @brief Evict expired entries.
+     * @brief Wipe the tables whose time slice left the window.
      *
      * @param now Current time in seconds.
      */
-    void cleanup(uint32_t now);
+    void advance(uint32_t now);
+
+    static uint64_t hashNonce(const char* nonce, size_t len);
+
+    bool findIn(uint8_t bucket, uint32_t fp, uint32_t home) const;
+
+    // Grava fp na tabela (true também se já estava); false se cheia
+    bool insertIn(uint8_t bucket, uint32_t fp, uint32_t home);
+
+    uint32_t* table(uint8_t bucket) const { return _slots + (size_t)bucket * _bucketSlots; }
+
+    size_t _bucketSlots;  // slots por tabela
+    size_t _maxLoad;      // entradas por tabela (3/4 dos slots)
+    uint32_t _sliceSec;   // largura de cada fatia de tempo
+    uint32_t _slice;      // fatia corrente (now / _sliceSec)
+    bool _started = false;
 
-    size_t _cap;
-    uint32_t _ttl;
-    NonceEntry* _entries;
+    uint32_t* _slots;     // kBuckets tabelas contíguas; 0 = vazio
+    uint32_t _count[kBuckets] = {};
 };
 
-#endif //SHARED_LIBS_NONCECACHE_H
\ No newline at end of file
+#endif //SHARED_LIBS_NONCECACHE_H
@@ -0,0 +1,54 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_SECUREBODYENCODING_H
+#define SHARED_LIBS_SECUREBODYENCODING_H
+
+#pragma once
+#include <Arduino.h>
+
+#include "SecureCodec.h" // base64UrlEncodeTo(), base64UrlDecodeSpan(), base64UrlEncodedLen()
+
+/**
+ * @file SecureBodyEncoding.h
+ * @brief Wire encodings of the SecureHttp ciphertext body.
+ *
+ * Selected by the @c X-Body-Encoding request header (absent = hex, which is
+ * what older devices send):
+ * - hex:       lowercase hex (2 chars per byte); HMAC over the hex text.
+ * - raw:       ciphertext bytes as-is; HMAC over the bytes.
+ * - base64url: RFC 4648 §5 without padding; HMAC over the decoded bytes.
+ *
+ * The body is sent as Content-Type: application/octet-stream in every mode.
+ * A gateway that cannot handle the requested encoding answers
+ * 415 "unsupported_encoding" so the device can fall back.
+ */
+
+/** @brief Request header carrying the body encoding. */
+#define SECURE_BODY_ENCODING_HEADER "X-Body-Encoding"
+
+enum class SecureBodyEncoding : uint8_t {
+    Hex = 0,
+    Raw,
+    Base64Url
+};
+
+/**
+ * @brief Header value for @p e ("hex", "raw", "base64url").
+ */
+const char* secureBodyEncodingName(SecureBodyEncoding e);
+
+/**
+ * @brief Parse an X-Body-Encoding value (case-insensitive; nullptr/"" = hex).
+ *
+ * @return false for unknown values.
+ */
+bool parseSecureBodyEncoding(const char* value, SecureBodyEncoding& out);
+
+/**
+ * @brief Encode bytes as unpadded base64url.
+ */
+String base64UrlEncode(const uint8_t* data, size_t len);
+
+#endif //SHARED_LIBS_SECUREBODYENCODING_H
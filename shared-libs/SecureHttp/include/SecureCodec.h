@@ -0,0 +1,81 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_SECURECODEC_H
+#define SHARED_LIBS_SECURECODEC_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file SecureCodec.h
+ * @brief Hex and base64url codecs over caller-provided buffers.
+ *
+ * The one implementation behind every SecureHttp encoder/decoder
+ * (HexUtils.h, SecureBodyEncoding.h, the hex digests in CryptoUtils.h, the
+ * envelope fields). No allocation and no Arduino dependency, so it also
+ * builds in bench/host.
+ *
+ * Encoders use a lookup table (hex: one 2-char pair per byte) and work on
+ * 4 bytes (hex) or 3 bytes (base64url) per iteration. Decoders map each char
+ * through a 256-entry table in which invalid chars have the top bit set; the
+ * bits are OR-ed across the span and checked once at the end, so validation
+ * costs no branch per char. On failure the contents of the output buffer are
+ * unspecified.
+ */
+
+/**
+ * @brief Lowercase hex of @p len bytes, NUL-terminated.
+ *
+ * @param outCap Must be at least 2 * @p len + 1.
+ * @return Chars written (2 * @p len, without the NUL), or 0 if @p out is too small.
+ */
+size_t hexEncodeTo(const uint8_t* data, size_t len, char* out, size_t outCap);
+
+/**
+ * @brief Decode exactly @p outLen bytes from a non-terminated hex span.
+ *
+ * @p out may alias @p hex (decoding in place is safe because bytes are
+ * written only after the chars that produce them were read).
+ *
+ * @param hex Hex chars (case-insensitive).
+ * @param hexLen Number of chars; must be exactly 2 * @p outLen.
+ * @param out Output buffer.
+ * @param outLen Number of bytes to produce.
+ * @return false on length mismatch or non-hex char.
+ */
+bool hexDecodeSpan(const char* hex, size_t hexLen, uint8_t* out, size_t outLen);
+
+/**
+ * @brief Unpadded base64url length of @p n bytes.
+ */
+size_t base64UrlEncodedLen(size_t n);
+
+/**
+ * @brief Bytes decoded from @p n unpadded base64url chars (n % 4 != 1).
+ */
+size_t base64UrlDecodedLen(size_t n);
+
+/**
+ * @brief Unpadded base64url (RFC 4648 §5) of @p len bytes, NUL-terminated.
+ *
+ * @param outCap Must be at least base64UrlEncodedLen(@p len) + 1.
+ * @return Chars written (without the NUL), or 0 if @p out is too small.
+ */
+size_t base64UrlEncodeTo(const uint8_t* data, size_t len, char* out, size_t outCap);
+
+/**
+ * @brief Decode an unpadded base64url span (no allocation).
+ *
+ * @param in Encoded chars ('=' padding is not accepted).
+ * @param inLen Number of chars.
+ * @param out Output buffer (must not overlap @p in).
+ * @param outCap Size of @p out.
+ * @param outLen Bytes written.
+ * @return false on bad char, impossible length or @p outCap too small.
+ */
+bool base64UrlDecodeSpan(const char* in, size_t inLen, uint8_t* out, size_t outCap, size_t& outLen);
+
+#endif //SHARED_LIBS_SECURECODEC_H
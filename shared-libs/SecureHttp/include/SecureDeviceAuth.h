@@ -4,11 +4,14 @@
  *
  * This module:
  *  - Encrypts plaintext JSON using AES-256-GCM
- *  - Signs a canonical string using HMAC-SHA256
+ *  - Signs a canonical string using HMAC-SHA256 (protocol v1 only; v2 puts
+ *    those fields in the GCM AAD, see SecureProtocol.h)
  *
  * Output is suitable to send via HTTP:
- *  - Body: ciphertextHex
- *  - Headers: X-Device-Id, X-Timestamp, X-Nonce, X-IV, X-Tag, X-Signature
+ *  - Body: bodyData()/bodyLen() (hex, raw or base64url ciphertext)
+ *  - Headers: X-Device-Id, X-Timestamp, X-Nonce, X-IV, X-Tag, X-Key-Version,
+ *    X-Signature (v1) or X-Secure-Version: 2 (v2), and X-Body-Encoding when
+ *    the encoding is not hex
  */
 
 #ifndef SHARED_LIBS_SECUREDEVICEAUTH_H
@@ -16,6 +19,12 @@
 
 #pragma once
 #include <Arduino.h>
+#include <memory>
+
+#include "SecureBodyEncoding.h"
+#include "SecureProtocol.h"
+#include "AesGcmCodec.h"
+#include "CryptoUtils.h"
 
 class SecureDeviceAuth {
 public:
@@ -28,31 +37,43 @@ public:
         String nonce;          // 16 hex chars (8 bytes)
         String ivHex;          // 24 hex chars (12 bytes)
         String tagHex;         // 32 hex chars (16 bytes)
-        String signatureHex;   // 64 hex chars (HMAC-SHA256)
-        String ciphertextHex;  // body hex
+        String signatureHex;   // 64 hex chars (HMAC-SHA256); vazio em v2
+        SecureProtocol protocol = SecureProtocol::V1; // X-Secure-Version
+        uint8_t keyVersion = 0; // X-Key-Version (SECURE_KEY_VERSION das chaves usadas)
+
+        SecureBodyEncoding encoding = SecureBodyEncoding::Hex;
+        String ciphertextHex;  // body hex (Hex)
+        String ciphertextB64;  // body base64url sem padding (Base64Url)
+        std::unique_ptr<uint8_t[]> ciphertext; // bytes crus (sempre; body do modo Raw)
+        size_t ciphertextLen = 0;
+
+        // Body a enviar conforme encoding
+        const uint8_t *bodyData() const;
+        size_t bodyLen() const;
+
+        // v2: valor do header X-SecureHttp (substitui os headers avulsos); vazio em v1
+        String packedHeader() const;
     };
 
+    /**
+     * @brief Encrypt @p plaintextJson and sign the envelope.
+     *
+     * @param encoding Body encoding; hex signs the hex text, raw/base64url
+     *                 sign the ciphertext bytes (see SecureBodyEncoding.h).
+     * @param protocol V1 (GCM + HMAC) or V2 (GCM only, no signatureHex).
+     */
     Result encryptAndSign(const char *deviceId,
                           const char *method,
                           const char *path,
-                          const String &plaintextJson) const;
+                          const String &plaintextJson,
+                          SecureBodyEncoding encoding = SecureBodyEncoding::Hex,
+                          SecureProtocol protocol = SecureProtocol::V1) const;
 
 private:
-    static String toHex(const uint8_t *data, size_t len);
-    static bool fromHex(const String &hex, uint8_t *out, size_t outLen);
-
     static String randomHex(size_t bytesLen);
 
-    static bool aes256gcmEncrypt(const uint8_t *key32,
-                                 const uint8_t *iv12,
-                                 const uint8_t *aad, size_t aadLen,
-                                 const uint8_t *pt, size_t ptLen,
-                                 uint8_t *ct,
-                                 uint8_t *tag16);
-
-    static bool hmacSha256Hex(const uint8_t *key, size_t keyLen,
-                              const uint8_t *msg, size_t msgLen,
-                              String &outHex);
+    // Prepara os contextos no 1º envio (fora da inicialização estática)
+    void ensureKeys() const;
 
     static String canonicalToSign(const char *method,
                                   const char *path,
@@ -62,6 +83,10 @@ private:
                                   const String &ivHex,
                                   const String &tagHex,
                                   const String &ciphertextHex);
+
+    // Contextos reaproveitados entre mensagens (encryptAndSign é const)
+    mutable AesGcmContext _gcm;      // key schedule AES expandido uma vez
+    mutable HmacSha256Key _hmacKey;  // ipad/opad já absorvidos
 };
 
 #endif // SHARED_LIBS_SECUREDEVICEAUTH_H
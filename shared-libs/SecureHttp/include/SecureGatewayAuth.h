@@ -11,33 +11,211 @@
 
 #include "SecureHttpConfig.h" // user-provided (copy from .example)
 #include "NonceCache.h"
+#include "SecureSession.h"
+#include "SecureKeyStore.h"
+#include "SecureBodyEncoding.h"
+#include "SecureProtocol.h"
+#include "AesGcmCodec.h"
+#include "CryptoUtils.h"
 
 /**
  * @file SecureGatewayAuth.h
  * @brief Gateway-side verification and decryption for SecureHttp requests.
  *
  * The gateway expects:
- * - HTTP body: ciphertext hex string (not JSON)
+ * - HTTP body: ciphertext as hex, raw bytes or base64url (see SecureBodyEncoding.h)
  * - Headers:
  *   - X-Device-Id
  *   - X-Timestamp (uint seconds)
  *   - X-Nonce
  *   - X-IV (12 bytes hex)
  *   - X-Tag (16 bytes hex)
- *   - X-Signature (HMAC-SHA256 hex)
+ *   - X-Signature (HMAC-SHA256 hex; v1 only)
+ *   - X-Key-Version (optional: device key version; default current)
+ *   - X-Secure-Version (optional: 1 | 2; default 1, see SecureProtocol.h)
+ *   - X-Body-Encoding (optional: hex | raw | base64url; default hex)
+ * or all of the above (v2) packed in one X-SecureHttp header (SecureProtocol.h),
+ * or, inside a session (see SecureSession.h), only X-Session + X-Seq
+ * (+ X-Body-Encoding) with body ciphertext || tag.
  *
- * HMAC canonical string:
- *   deviceId + "\n" + timestamp + "\n" + nonce + "\n" + method + "\n" + path + "\n" + sha256Hex(bodyCipherHex)
+ * HMAC canonical string (v1):
+ *   METHOD\nPATH\nDEVICE\nTS\nNONCE\nIV\nTAG\nCIPHERTEXT (hex text, or bytes for raw/base64url)
+ * v2 has no HMAC: the same fields go into the GCM AAD (secureEnvelopeAadV2()).
  */
 
+/**
+ * @brief Per-stage wall time of one verifyAndDecrypt() call (microseconds).
+ *
+ * Only stages whose bit is set in @c mask were executed (a stage that rejects
+ * the request still counts, since its time was spent). Body decoding runs
+ * before the HMAC for base64url and after it for hex; v2 and session
+ * requests have no HMAC stage.
+ */
+struct SecureAuthTiming {
+  enum Stage : uint8_t { Headers = 0, Replay, Hmac, BodyDecode, Decrypt, StageCount };
+
+  uint32_t us[StageCount] = {}; ///< Headers, timestamp/nonce (session: lookup/window), HMAC, body/IV/tag decode, GCM decrypt.
+  uint8_t mask = 0;             ///< Bit i set => stage i ran.
+
+  bool ran(uint8_t stage) const { return (mask & (1u << stage)) != 0; }
+};
+
 /**
  * @brief Result object returned by SecureGatewayAuth.
  */
 struct SecureAuthResult {
+  static constexpr size_t kMaxDeviceIdLen = 31;
+
   bool ok = false;        ///< true on success.
   int httpCode = 401;     ///< HTTP status code suggested for response.
   String error;           ///< Error code string (stable identifiers).
   String plaintextJson;   ///< Decrypted JSON payload (only valid if ok==true).
+  char deviceId[kMaxDeviceIdLen + 1] = {}; ///< Authenticated device (X-Device-Id or the session owner).
+  bool session = false;   ///< Authenticated by a session (X-Session / X-Seq).
+  uint8_t keyVersion = 0; ///< Device key that authenticated the envelope (0 in session mode).
+  SecureProtocol protocol = SecureProtocol::V1; ///< Envelope version (X-Secure-Version).
+  const char* plaintext = nullptr; ///< verifyAndDecryptInto(): JSON span inside the work buffer (NUL-terminated).
+  size_t plaintextLen = 0;         ///< verifyAndDecryptInto(): span length.
+  SecureAuthTiming timing; ///< Stage timings (instrumentation).
+};
+
+/**
+ * @brief Transport-independent view of a SecureHttp request.
+ *
+ * Lets servers other than WebServer (e.g. a non-blocking multi-connection
+ * server) feed already-parsed headers and body. Header pointers must be
+ * NUL-terminated strings (nullptr or "" when absent).
+ */
+struct SecureRequestView {
+  const char* deviceId = nullptr;   ///< X-Device-Id
+  const char* timestamp = nullptr;  ///< X-Timestamp
+  const char* nonce = nullptr;      ///< X-Nonce
+  const char* ivHex = nullptr;      ///< X-IV
+  const char* tagHex = nullptr;     ///< X-Tag
+  const char* signature = nullptr;  ///< X-Signature (v1)
+  const char* keyVersion = nullptr; ///< X-Key-Version (nullptr/"" = current key)
+  const char* protocol = nullptr;   ///< X-Secure-Version (nullptr/"" = 1)
+  const char* packed = nullptr;     ///< X-SecureHttp (set => envelope fields above ignored, v2)
+  const char* bodyEncoding = nullptr; ///< X-Body-Encoding (nullptr/"" = hex)
+  const char* session = nullptr;    ///< X-Session (set => session mode, envelope headers ignored)
+  const char* seq = nullptr;        ///< X-Seq
+  const char* body = nullptr;       ///< Raw body (ciphertext in bodyEncoding; may hold NULs when raw).
+  size_t bodyLen = 0;               ///< Body length in bytes (SecureStreamVerifier: Content-Length).
+};
+
+/**
+ * @brief Answer to a session handshake (JSON fields of the /session reply).
+ */
+struct SecureSessionGrant {
+  bool ok = false;
+  int httpCode = 400;
+  String error;
+  char sid[9] = {};                                   ///< 8 hex chars
+  char sr[2 * SecureSessionKeys::kRandomBytes + 1] = {}; ///< gateway random (hex)
+  uint32_t ttlSec = 0;
+  String mac;                                         ///< secureSessionProofHex()
+};
+
+class SecureGatewayAuth;
+
+/**
+ * @brief Verifies and decrypts one request body as it is read from the socket.
+ *
+ * begin() checks the headers (device, timestamp window and nonce, or session
+ * and sequence number) and the declared body length against
+ * SECURE_MAX_BODY_BYTES before any body byte is read. update() decodes each
+ * chunk in a small stack buffer and feeds it to the HMAC (v1) and to AES-GCM,
+ * writing plaintext straight into the caller's buffer, so the encoded body
+ * is never stored. finish() checks the HMAC (v1) and the GCM tag, and only then
+ * records the nonce / sequence number and exposes the plaintext.
+ *
+ * Each verifier owns its stream state (HMAC, GCM context), so one verifier
+ * per concurrent request. Memory is fixed: nothing grows with the body.
+ */
+class SecureStreamVerifier {
+public:
+  SecureStreamVerifier() = default;
+  ~SecureStreamVerifier();
+
+  SecureStreamVerifier(const SecureStreamVerifier&) = delete;
+  SecureStreamVerifier& operator=(const SecureStreamVerifier&) = delete;
+
+  /**
+   * @brief Bytes of plaintext buffer a @p bodyLen body needs (plaintext + NUL).
+   */
+  static size_t plaintextBytesFor(size_t bodyLen, SecureBodyEncoding encoding = SecureBodyEncoding::Hex);
+
+  /**
+   * @brief Start a request; @p req.body is ignored, @p req.bodyLen is the Content-Length.
+   *
+   * @param out Plaintext destination (see plaintextBytesFor()); holds no
+   *            valid data unless finish() succeeds.
+   * @return false if rejected already (see result(); do not read the body).
+   */
+  bool begin(SecureGatewayAuth& auth, const SecureRequestView& req, const char* method, const char* path,
+             uint8_t* out, size_t outCap);
+
+  /**
+   * @brief Feed the next body bytes (any split).
+   *
+   * @return false once the request is rejected (see result()).
+   */
+  bool update(const void* data, size_t len);
+
+  /**
+   * @brief Verify after the whole body was fed; plaintext span in result().
+   */
+  const SecureAuthResult& finish();
+
+  const SecureAuthResult& result() const { return _r; }
+
+  /** @brief begin() accepted the headers and finish() was not called yet. */
+  bool active() const { return _auth != nullptr; }
+
+  /** @brief Drop the request (e.g. connection closed); plaintext is wiped. */
+  void abort();
+
+private:
+  bool fail(int httpCode, const char* error, SecureAuthTiming::Stage stage);
+  bool beginEnvelope(const SecureRequestView& req, const char* method, const char* path);
+  bool beginSession(const SecureRequestView& req, const char* method, const char* path);
+  bool useKey(const uint8_t* key);
+  void lap(SecureAuthTiming::Stage s);
+  void feedDecoded(const uint8_t* data, size_t len);
+  void decryptBlocks(const uint8_t* data, size_t len);
+  bool decodeChunk(const char* data, size_t len, bool last);
+
+  SecureGatewayAuth* _auth = nullptr;
+  SecureAuthResult _r;
+  uint32_t _t0 = 0;
+
+  bool _session = false;
+  bool _hmac = false;     // envelope v1: HMAC além da tag GCM
+  SecureBodyEncoding _enc = SecureBodyEncoding::Hex;
+  size_t _bodyLen = 0;
+  size_t _received = 0;
+  size_t _cipherLen = 0;  // bytes para o GCM (sessão: sem a tag final)
+  size_t _decoded = 0;    // bytes decodificados até agora
+
+  char _carry[4] = {};    // hex/base64url: caracteres de um grupo incompleto
+  uint8_t _carryLen = 0;
+  uint8_t _block[CryptoBackend::kAeadBlockBytes] = {}; // ciphertext até completar 16 bytes
+  uint8_t _blockLen = 0;
+
+  uint8_t* _out = nullptr;
+  size_t _outLen = 0;
+
+  uint8_t _tag[CryptoBackend::kAeadTagBytes] = {};
+  uint8_t _signature[HmacSha256::kDigestSize] = {};
+  HmacSha256 _mac;
+  AesGcmContext _gcm;
+  uint8_t _gcmKey[CryptoBackend::kAeadKeyBytes] = {}; // chave em _gcm (evita re-expandir)
+
+  uint32_t _now = 0;      // envelope: instante do begin() (janela do nonce)
+  char _nonce[SECURE_NONCE_MAX_LEN + 1] = {};
+  size_t _nonceLen = 0;
+  char _sid[9] = {};      // sessão
+  uint64_t _seq = 0;
 };
 
 /**
@@ -70,8 +248,89 @@ public:
    */
   SecureAuthResult verifyAndDecrypt(WebServer& server, const String& method, const String& path);
 
+  /**
+   * @brief Same as verifyAndDecrypt(WebServer&, ...) for an already-parsed request.
+   *
+   * @param req Headers and body of the request.
+   * @param method HTTP method used by the client (e.g. "POST").
+   * @param path HTTP path used by the client (e.g. "/telemetry").
+   * @return SecureAuthResult with decrypted JSON on success.
+   */
+  SecureAuthResult verifyAndDecrypt(const SecureRequestView& req, const String& method, const String& path);
+
+  /**
+   * @brief Bytes of work buffer verifyAndDecryptInto() needs for a @p bodyLen body
+   *        (the plaintext + NUL; see SecureStreamVerifier::plaintextBytesFor()).
+   */
+  static size_t workBytesFor(size_t bodyLen, SecureBodyEncoding encoding = SecureBodyEncoding::Hex);
+
+  /**
+   * @brief Heap-free verifyAndDecrypt(): the plaintext stays in @p work.
+   *
+   * Runs a SecureStreamVerifier over the already-buffered body: the HMAC is
+   * computed incrementally over the request fields (no canonical copy), the
+   * ciphertext is decoded chunk by chunk and decrypted into @p work, and the
+   * result is returned as a span (SecureAuthResult::plaintext /
+   * plaintextLen, NUL-terminated) valid until @p work is reused.
+   * plaintextJson is left empty.
+   *
+   * @param req Headers and body of the request.
+   * @param method HTTP method used by the client (e.g. "POST").
+   * @param path HTTP path used by the client (e.g. "/telemetry").
+   * @param work Request-scoped scratch buffer (see workBytesFor()).
+   * @param workCap Size of @p work; too small, or a body over
+   *        SECURE_MAX_BODY_BYTES => error "body_too_large" (413).
+   *
+   * Unknown X-Body-Encoding => error "unsupported_encoding" (415); unknown
+   * X-Secure-Version => "unsupported_protocol" (400); malformed X-SecureHttp
+   * => "bad_headers" (400); replay
+   * cache full => "replay_cache_full" (503, the nonce could not be stored).
+   * Known device with an X-Key-Version that is neither its current key nor
+   * its previous key inside the rotation window => "unknown_key" (401).
+   * Session requests fail with "unknown_session" (expired or evicted: the
+   * device handshakes again), "bad_seq", "seq_too_old" or "replay_seq".
+   */
+  SecureAuthResult verifyAndDecryptInto(const SecureRequestView& req, const char* method, const char* path,
+                                        uint8_t* work, size_t workCap);
+
+  /**
+   * @brief Open a session for an authenticated /session request.
+   *
+   * @param auth Successful result of the /session request (full envelope).
+   * @param plaintext Its decrypted body, {"cr":"<32 hex chars>"}.
+   * @return Grant for the reply; "bad_session_request" (400) if cr is
+   *         missing, "session_failed" (503) if no session could be set up.
+   */
+  SecureSessionGrant openSession(const SecureAuthResult& auth, const char* plaintext, size_t plaintextLen);
+
+  /**
+   * @brief Session table (read-only; e.g. for metrics).
+   */
+  const SecureSessionTable& sessions() const { return _sessions; }
+
+  /**
+   * @brief Replay cache (read-only; e.g. for metrics).
+   */
+  const NonceCache& nonceCache() const { return _nonceCache; }
+
+  /**
+   * @brief Per-device keys (loaded from NVS on first use; put/rotate/remove persist).
+   */
+  SecureKeyStore& keys() {
+    ensureKeys();
+    return _keys;
+  }
+
 private:
+  friend class SecureStreamVerifier;
+
+  // Carrega as chaves na 1ª request (fora da inicialização estática)
+  void ensureKeys();
+
   NonceCache _nonceCache;
+  SecureSessionTable _sessions;
+  SecureKeyStore _keys;           // chaves por device, pads HMAC já preparados
+  SecureStreamVerifier _buffered; // verifyAndDecryptInto()
 };
 
 #endif //SHARED_LIBS_SECUREGATEWAYAUTH_H
\ No newline at end of file
@@ -0,0 +1,67 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_SECUREHTTPBENCH_H
+#define SHARED_LIBS_SECUREHTTPBENCH_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#include "CryptoBackend.h"
+
+/**
+ * @file SecureHttpBench.h
+ * @brief Microbenchmark: per-message crypto cost per CryptoBackend.
+ *
+ * For each backend and payload size it times, per message:
+ * - AES-256-GCM seal with a fresh AeadKey every time (what the static
+ *   AesGcmCodec helpers do) vs a long-lived key (AesGcmContext);
+ * - HMAC-SHA256 with the key set up every time vs prepared pads
+ *   (HmacSha256Key).
+ *
+ * Builds with or without Arduino: the firmware runs it at boot with
+ * -DSECUREHTTP_BENCH, and bench/host runs it on Linux.
+ */
+
+/**
+ * @brief One backend x payload size (times in nanoseconds per message).
+ */
+struct SecureHttpBenchRow {
+  const char* backend = "";
+  uint16_t payloadBytes = 0;
+  uint32_t gcmOneShotNs = 0;
+  uint32_t gcmPersistentNs = 0;
+  uint32_t hmacOneShotNs = 0;
+  uint32_t hmacPersistentNs = 0;
+};
+
+/**
+ * @brief Run the benchmark on @p backend for 64, 256 and 1024-byte payloads.
+ *
+ * @param rows Output (3 rows per backend).
+ * @param cap Size of @p rows.
+ * @param iterations Messages per measurement.
+ * @return Number of rows written.
+ */
+size_t secureHttpCryptoBench(const CryptoBackend& backend, SecureHttpBenchRow* rows, size_t cap,
+                             uint16_t iterations = 200);
+
+/**
+ * @brief secureHttpCryptoBench() on every built-in backend that passes
+ *        cryptoBackendSelfTest() (failing backends are skipped).
+ */
+size_t secureHttpCryptoBenchAll(SecureHttpBenchRow* rows, size_t cap, uint16_t iterations = 200);
+
+#ifdef ARDUINO
+/**
+ * @brief Run secureHttpCryptoBenchAll() and print a table.
+ */
+void secureHttpCryptoBenchPrint(Print& out, uint16_t iterations = 200);
+#endif
+
+#endif //SHARED_LIBS_SECUREHTTPBENCH_H
@@ -15,6 +15,16 @@
 
 static const char *const SECURE_DEVICE_ID = "vehicle-device-01";
 
+// Devices aceitos pelo gateway (todos compartilham os segredos abaixo).
+// Adicione uma entrada por veículo do pátio.
+static const char *const SECURE_ALLOWED_DEVICE_IDS[] = {
+    "vehicle-device-01",
+    "vehicle-device-02",
+    "vehicle-device-03"
+};
+
+#define SECURE_ALLOWED_DEVICE_COUNT (sizeof(SECURE_ALLOWED_DEVICE_IDS) / sizeof(SECURE_ALLOWED_DEVICE_IDS[0]))
+
 // ---------------------------------------------------------------------------
 // HMAC secret (ASCII)
 // IMPORTANTE:
@@ -35,13 +45,33 @@ static const uint8_t SECURE_AES_KEY[32] = {
     0x8a, 0x9b, 0xac, 0xbd, 0xce, 0xdf, 0xe0, 0xf1
 };
 
+// Versão das chaves acima (device: enviada em X-Key-Version; gateway: versão do
+// 1º boot, depois as chaves de cada device vêm do SecureKeyStore/NVS)
+static const uint8_t  SECURE_KEY_VERSION = 1;
+
+static const size_t   SECURE_KEYSTORE_CAPACITY = 16; // devices com chave própria no gateway
+static const uint32_t SECURE_KEY_GRACE_SEC = 86400;  // chave anterior aceita após uma rotação
+
 // ---------------------------------------------------------------------------
 // Anti-replay configuration
 // ---------------------------------------------------------------------------
 
 static const uint32_t SECURE_TS_WINDOW_SEC = 180;
-static const size_t   SECURE_NONCE_CACHE_CAP = 48;
 static const uint32_t SECURE_NONCE_TTL_SEC = 300;
+// Requests com nonce (sem sessão, handshakes) por segundo que o gateway sustenta sem
+// 503 replay_cache_full: ex. 16 devices a 1 Hz. Dimensiona o cache de nonces
+// (NonceCache::capacityFor: 16/s e 300 s -> 7520 slots de 4 bytes, ~30 KB, até ~5600 nonces vivos)
+static const uint32_t SECURE_NONCE_RATE_PER_SEC = 16;
+
+// Maior body (Content-Length) aceito; acima disso 413 antes de ler o body
+static const size_t   SECURE_MAX_BODY_BYTES = 4096;
+
+// ---------------------------------------------------------------------------
+// Session mode (X-Session / X-Seq, ver SecureSession.h)
+// ---------------------------------------------------------------------------
+
+static const size_t   SECURE_SESSION_MAX = 8;        // sessões simultâneas no gateway (~100 B cada)
+static const uint32_t SECURE_SESSION_TTL_SEC = 3600; // depois disso o device refaz o handshake
 
 // ---------------------------------------------------------------------------
 // Compatibility symbols expected by SecureDeviceAuth / SecureGatewayAuth
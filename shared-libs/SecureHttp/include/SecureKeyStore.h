@@ -0,0 +1,144 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_SECUREKEYSTORE_H
+#define SHARED_LIBS_SECUREKEYSTORE_H
+
+#pragma once
+#include <Arduino.h>
+
+#include "CryptoBackend.h"
+#include "CryptoUtils.h"
+
+/**
+ * @file SecureKeyStore.h
+ * @brief Gateway-side per-device keys (AES-256 + HMAC secret), persisted in NVS.
+ *
+ * Every device has a current key and, during a rotation, the previous one
+ * until its grace window ends. The device says which key it used in the
+ * X-Key-Version header (absent = current), so the gateway never has to try
+ * both. The HMAC pads of each key are prepared when the key is loaded, so a
+ * request only pays for its own bytes.
+ *
+ * On every boot, each SECURE_ALLOWED_DEVICE_IDS entry missing from NVS gets
+ * the compiled-in secrets from SecureHttpConfig.h as version
+ * SECURE_KEY_VERSION (the whole list on the first boot, later only IDs added
+ * to it). Devices already in NVS keep their stored, possibly rotated, keys;
+ * a device removed with remove() comes back while it is still listed.
+ */
+
+/** @brief Request header with the version of the key the device used (decimal 1..255). */
+#define SECURE_KEY_VERSION_HEADER "X-Key-Version"
+
+/**
+ * @brief Device ID -> keys, fixed capacity, O(1) expected lookup.
+ *
+ * Lookup goes through an open-addressing index (FNV-1a, linear probing,
+ * 2x the capacity). Rows and index are allocated once in the constructor.
+ */
+class SecureKeyStore {
+public:
+  static constexpr size_t kMaxIdLen = 31;
+  static constexpr size_t kMaxHmacBytes = 64;
+  static constexpr uint8_t kNone = 0xFF;
+
+  /**
+   * @brief One key generation of a device.
+   */
+  struct Key {
+    uint8_t version = 0; ///< 0 = empty
+    uint8_t aes[CryptoBackend::kAeadKeyBytes] = {};
+    uint8_t hmacSecret[kMaxHmacBytes] = {}; ///< IKM do handshake de sessão
+    uint8_t hmacLen = 0;
+    HmacSha256Key hmac;  ///< ipad/opad já absorvidos
+
+    bool valid() const { return version != 0; }
+  };
+
+  struct Entry {
+    char id[kMaxIdLen + 1] = {};
+    uint8_t idLen = 0;
+    uint32_t hash = 0;
+    Key current;
+    Key previous;
+    uint32_t previousUntil = 0; ///< epoch (s); previous aceita até aqui
+  };
+
+  /**
+   * @param capacity Devices (1..254).
+   * @param nvsNamespace Preferences namespace (nullptr: memory only).
+   */
+  explicit SecureKeyStore(size_t capacity, const char* nvsNamespace = "securehttp");
+  ~SecureKeyStore();
+
+  SecureKeyStore(const SecureKeyStore&) = delete;
+  SecureKeyStore& operator=(const SecureKeyStore&) = delete;
+
+  /**
+   * @brief Load from NVS, then add configured devices missing from it.
+   *
+   * @return Devices loaded.
+   */
+  size_t begin();
+
+  bool loaded() const { return _loaded; }
+
+  /**
+   * @brief Device row, or nullptr.
+   */
+  const Entry* find(const char* deviceId) const;
+
+  /**
+   * @brief Key @p version of @p deviceId (0 = current); the previous key only
+   *        while @p nowSec < previousUntil. nullptr if none matches.
+   */
+  const Key* key(const char* deviceId, uint8_t version, uint32_t nowSec) const;
+
+  /**
+   * @brief Add a device or replace all its keys (no grace for the old ones).
+   */
+  bool put(const char* deviceId, uint8_t version, const uint8_t* aes,
+           const uint8_t* hmacSecret, size_t hmacLen);
+
+  /**
+   * @brief New current key; the old current stays valid for @p graceSec.
+   *
+   * @return false if the device is unknown, @p version is 0 or equals the
+   *         current one, or the secrets are malformed.
+   */
+  bool rotate(const char* deviceId, uint8_t version, const uint8_t* aes,
+              const uint8_t* hmacSecret, size_t hmacLen, uint32_t graceSec, uint32_t nowSec);
+
+  /**
+   * @brief Forget a device (also in NVS).
+   */
+  bool remove(const char* deviceId);
+
+  size_t size() const { return _count; }
+  size_t capacity() const { return _capacity; }
+
+private:
+  static uint32_t hashId(const char* id, size_t len);
+  static bool setKey(Key& k, uint8_t version, const uint8_t* aes, const uint8_t* hmacSecret, size_t hmacLen);
+  static void clearKey(Key& k);
+
+  uint16_t probe(uint32_t hash, const char* id, size_t len) const;
+  uint8_t insertRow(const char* id, size_t len);
+  void rebuildIndex();
+
+  // NVS: uma chave por row ("k<row>") + "n" (quantidade)
+  bool persist(uint8_t row);
+  void persistCount();
+  bool loadRow(uint8_t row);
+
+  Entry* _rows = nullptr;
+  uint8_t* _index = nullptr; // slot -> row (kNone = vazio)
+  uint16_t _indexSize = 0;
+  uint8_t _capacity = 0;
+  uint8_t _count = 0;
+  const char* _ns = nullptr;
+  bool _loaded = false;
+};
+
+#endif //SHARED_LIBS_SECUREKEYSTORE_H
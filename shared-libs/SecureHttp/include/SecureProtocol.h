@@ -0,0 +1,126 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_SECUREPROTOCOL_H
+#define SHARED_LIBS_SECUREPROTOCOL_H
+
+#pragma once
+#include <Arduino.h>
+
+#include "SecureBodyEncoding.h"
+
+/**
+ * @file SecureProtocol.h
+ * @brief Versions of the SecureHttp request envelope.
+ *
+ * Selected per request by the @c X-Secure-Version header (absent = 1, which
+ * is what older devices send):
+ * - 1: AES-256-GCM + HMAC-SHA256 over the canonical string (X-Signature).
+ * - 2: AES-256-GCM only. The fields the HMAC used to cover go into the AAD
+ *      and X-Signature is not sent; the GCM tag authenticates everything.
+ *
+ * v2 AAD (see secureEnvelopeAadV2()):
+ *   "securehttp-v2|" DEVICE "|" TS "|" NONCE "|" KEYVERSION "|" METHOD "|" PATH
+ * The "securehttp-v2" label keeps a v1 ciphertext (whose AAD has no label)
+ * from being replayed as v2 with the X-Signature stripped. The IV is bound by
+ * GCM itself; the body encoding needs no binding (a different decoding
+ * changes the ciphertext and fails the tag).
+ *
+ * A gateway that does not know the version answers 400
+ * "unsupported_protocol"; a v1-only gateway answers 400 "missing_headers"
+ * (no X-Signature). Either way the device can fall back to v1.
+ *
+ * Compact metadata (optional, v2 only): the envelope headers packed in one
+ * @c X-SecureHttp header, base64url of (big-endian, fixed offsets):
+ *   [0]      format (1)
+ *   [1]      key version (0 = current)
+ *   [2]      body encoding (0 hex, 1 raw, 2 base64url)
+ *   [3..6]   timestamp (epoch s)
+ *   [7..14]  nonce (8 bytes)
+ *   [15..26] IV (12 bytes)
+ *   [27..42] tag (16 bytes)
+ *   [43]     device id length n (1..31)
+ *   [44..]   device id (n bytes)
+ * It replaces X-Device-Id, X-Timestamp, X-Nonce, X-IV, X-Tag, X-Key-Version,
+ * X-Secure-Version and X-Body-Encoding (~100 header bytes instead of ~215).
+ * The AAD is still built from the text form (decimal timestamp, lowercase hex
+ * nonce), so the packed and the plain v2 requests authenticate the same way.
+ */
+
+/** @brief Request header carrying the envelope version. */
+#define SECURE_VERSION_HEADER "X-Secure-Version"
+
+enum class SecureProtocol : uint8_t {
+    V1 = 1,
+    V2 = 2
+};
+
+/**
+ * @brief Header value for @p p ("1", "2").
+ */
+const char* secureProtocolName(SecureProtocol p);
+
+/**
+ * @brief Parse an X-Secure-Version value (nullptr/"" = 1).
+ *
+ * @return false for unknown versions.
+ */
+bool parseSecureProtocol(const char* value, SecureProtocol& out);
+
+/**
+ * @brief Write the v2 AAD (see file header) into @p out.
+ *
+ * @return Length, or 0 if it does not fit in @p cap.
+ */
+size_t secureEnvelopeAadV2(char* out, size_t cap, const char* deviceId, const char* timestamp,
+                           const char* nonce, uint8_t keyVersion, const char* method, const char* path);
+
+/** @brief Request header with the packed envelope metadata (v2). */
+#define SECURE_PACKED_HEADER "X-SecureHttp"
+
+/**
+ * @brief Binary form of the X-SecureHttp header (see file header).
+ */
+struct SecurePackedMeta {
+  static constexpr uint8_t kFormat = 1;
+  static constexpr size_t kNonceBytes = 8;
+  static constexpr size_t kFixedBytes = 44; ///< everything before the device id
+  static constexpr size_t kMaxDeviceIdLen = 31;
+  static constexpr size_t kMaxBytes = kFixedBytes + kMaxDeviceIdLen;
+
+  uint8_t keyVersion = 0;
+  SecureBodyEncoding encoding = SecureBodyEncoding::Hex;
+  uint32_t timestamp = 0;
+  uint8_t nonce[kNonceBytes] = {};
+  uint8_t iv[12] = {};
+  uint8_t tag[16] = {};
+  char deviceId[kMaxDeviceIdLen + 1] = {};
+  uint8_t deviceIdLen = 0;
+
+  /**
+   * @brief Serialize into @p out.
+   *
+   * @return Bytes written, or 0 if the device id is empty/too long or @p cap is too small.
+   */
+  size_t pack(uint8_t* out, size_t cap) const;
+
+  /**
+   * @brief Parse @p len bytes (format, encoding and id length are checked).
+   */
+  bool unpack(const uint8_t* in, size_t len);
+};
+
+/**
+ * @brief X-SecureHttp value of @p meta (empty if it cannot be packed).
+ */
+String securePackedHeaderValue(const SecurePackedMeta& meta);
+
+/**
+ * @brief Decode an X-SecureHttp value (no allocation).
+ *
+ * @return false on bad base64url or layout.
+ */
+bool parseSecurePackedHeader(const char* value, SecurePackedMeta& out);
+
+#endif //SHARED_LIBS_SECUREPROTOCOL_H
@@ -0,0 +1,250 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef SHARED_LIBS_SECURESESSION_H
+#define SHARED_LIBS_SECURESESSION_H
+
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+#include "SecureBodyEncoding.h"
+#include "AesGcmCodec.h"
+
+/**
+ * @file SecureSession.h
+ * @brief SecureHttp session mode: one key per session, sequence numbers per message.
+ *
+ * Handshake (once per session, inside a normal SecureHttp envelope):
+ *   POST /session   plaintext {"cr":"<16 bytes hex>"}
+ *   200 {"ok":true,"sid":"<4 bytes hex>","sr":"<16 bytes hex>","ttl":<s>,"mac":"<hex>"}
+ *
+ * Both sides derive the session keys with HKDF-SHA256 (RFC 5869), IKM = the
+ * device's HMAC secret (the key that authenticated the handshake):
+ *   PRK  = HMAC(cr || sr, secret)
+ *   info = "securehttp-session-v1|" deviceId "|" sid
+ *   T1   = HMAC(PRK, info || 0x01)       -> AES-256 key
+ *   T2   = HMAC(PRK, T1 || info || 0x02) -> IV salt (first 4 bytes)
+ * and the device checks
+ *   mac  = HMAC(secret, "securehttp-session-ok|" deviceId "|" sid "|" cr "|" sr "|" ttl)
+ *
+ * Requests inside the session carry only:
+ *   X-Session: sid, X-Seq: 1, 2, 3... (decimal), X-Body-Encoding (optional)
+ *   Body: ciphertext || tag (16 bytes) in the body encoding
+ * with IV = salt || seq (64-bit big-endian) and AAD = sid|seq|METHOD|PATH.
+ * The GCM tag is the only authenticator: no HMAC, nonce, clock or RNG per
+ * message. The gateway keeps a 64-message sliding window per session
+ * (RFC 4303 §3.4.3): reordered requests are accepted once; replays and
+ * sequence numbers older than the window are refused.
+ */
+
+/** @brief Request header with the session id (8 hex chars). */
+#define SECURE_SESSION_HEADER "X-Session"
+
+/** @brief Request header with the message sequence number (decimal, > 0). */
+#define SECURE_SEQ_HEADER "X-Seq"
+
+/** @brief Handshake route (POST, regular SecureHttp envelope). */
+#define SECURE_SESSION_PATH "/session"
+
+/**
+ * @brief AES key and IV salt of one session (same on both sides).
+ */
+struct SecureSessionKeys {
+  static constexpr size_t kRandomBytes = 16; ///< cr / sr
+  static constexpr size_t kSaltBytes = 4;
+
+  uint8_t aesKey[CryptoBackend::kAeadKeyBytes];
+  uint8_t ivSalt[kSaltBytes];
+
+  /**
+   * @brief HKDF from the HMAC @p secret, @p cr and @p sr (see file header).
+   */
+  void derive(const uint8_t* secret, size_t secretLen,
+              const char* deviceId, const char* sidHex,
+              const uint8_t* cr, const uint8_t* sr,
+              const CryptoBackend& backend = cryptoBackend());
+
+  void wipe();
+};
+
+/**
+ * @brief Handshake proof sent by the gateway (64 hex chars).
+ */
+String secureSessionProofHex(const uint8_t* secret, size_t secretLen,
+                             const char* deviceId, const char* sidHex,
+                             const char* crHex, const char* srHex, uint32_t ttlSec);
+
+/**
+ * @brief Write the AAD sid|seq|method|path into @p out.
+ *
+ * @return Length, or 0 if it does not fit in @p cap.
+ */
+size_t secureSessionAad(char* out, size_t cap, const char* sidHex, const char* seq,
+                        const char* method, const char* path);
+
+/**
+ * @brief Anti-replay window over sequence numbers (64 entries, no heap).
+ */
+class SequenceWindow {
+public:
+  static constexpr uint32_t kSize = 64;
+
+  enum class Verdict : uint8_t {
+    Ok = 0,
+    Invalid,  ///< seq 0
+    TooOld,   ///< older than the window
+    Replayed  ///< already accepted
+  };
+
+  /**
+   * @brief Whether @p seq may be accepted (does not change the window).
+   */
+  Verdict check(uint64_t seq) const;
+
+  /**
+   * @brief Mark @p seq as seen. Call only after the message authenticated.
+   */
+  void accept(uint64_t seq);
+
+  uint64_t highest() const { return _top; }
+
+  void reset() {
+    _top = 0;
+    _bits = 0;
+  }
+
+private:
+  uint64_t _top = 0;  // maior seq aceito
+  uint64_t _bits = 0; // bit i => seq (_top - i) já aceito
+};
+
+/**
+ * @brief Gateway-side sessions: fixed table, evicts the least recently used.
+ *
+ * A device holds at most one session; opening a new one (e.g. after a
+ * reboot) replaces the old. Expiry uses millis(), not the wall clock.
+ */
+class SecureSessionTable {
+public:
+  struct Entry {
+    uint32_t sid = 0;     ///< 0 = free slot
+    char sidHex[9] = {};
+    char deviceId[32] = {};
+    uint8_t key[CryptoBackend::kAeadKeyBytes] = {}; ///< expandido por quem decifra
+    uint8_t ivSalt[SecureSessionKeys::kSaltBytes] = {};
+    SequenceWindow window;
+    uint32_t openedMs = 0;
+    uint32_t lastUsedMs = 0;
+
+    /** @brief IV of message @p seq: ivSalt || seq (big-endian). */
+    void iv(uint64_t seq, uint8_t out[CryptoBackend::kAeadIvBytes]) const;
+  };
+
+  /**
+   * @param capacity Concurrent sessions (min 1).
+   * @param ttlSec Session lifetime counted from the handshake.
+   */
+  SecureSessionTable(size_t capacity, uint32_t ttlSec);
+  ~SecureSessionTable();
+
+  SecureSessionTable(const SecureSessionTable&) = delete;
+  SecureSessionTable& operator=(const SecureSessionTable&) = delete;
+
+  /**
+   * @brief Create a session for @p deviceId from the device random @p cr.
+   *
+   * Keys come from the device HMAC @p secret. Writes the gateway random to
+   * @p srOut. Returns nullptr when the RNG fails or @p deviceId does not
+   * fit Entry::deviceId.
+   */
+  Entry* open(const char* deviceId, const uint8_t* secret, size_t secretLen,
+              const uint8_t* cr, uint32_t nowMs, uint8_t* srOut);
+
+  /**
+   * @brief Live session by its 8-hex-char id (nullptr if unknown or expired).
+   */
+  Entry* find(const char* sidHex, uint32_t nowMs);
+
+  /** @brief Live sessions. */
+  size_t size(uint32_t nowMs) const;
+
+  size_t capacity() const { return _capacity; }
+  uint32_t ttlSec() const { return _ttlMs / 1000; }
+
+private:
+  bool expired(const Entry& e, uint32_t nowMs) const { return e.sid == 0 || nowMs - e.openedMs >= _ttlMs; }
+  static void clear(Entry& e);
+
+  Entry* _entries = nullptr;
+  size_t _capacity = 0;
+  uint32_t _ttlMs = 0;
+};
+
+/**
+ * @brief Device-side session: handshake state, key and next sequence number.
+ */
+class SecureSessionClient {
+public:
+  struct Message {
+    bool ok = false;
+    String error;
+
+    String sid;
+    String seq;
+
+    SecureBodyEncoding encoding = SecureBodyEncoding::Hex;
+    std::unique_ptr<uint8_t[]> sealed; // ciphertext || tag (body do modo Raw)
+    size_t sealedLen = 0;
+    String encoded;                    // body hex / base64url
+
+    // Body a enviar conforme encoding
+    const uint8_t* bodyData() const;
+    size_t bodyLen() const;
+  };
+
+  /**
+   * @brief Start a handshake: new client random, returns the /session plaintext.
+   *
+   * Empty string if the RNG fails.
+   */
+  String handshakeBody();
+
+  /**
+   * @brief Check the gateway reply (mac) and derive the session keys.
+   *
+   * @return false if the reply is malformed or not from a gateway holding the secret.
+   */
+  bool accept(const char* deviceId, const String& responseJson, uint32_t nowMs);
+
+  /**
+   * @brief Session usable at @p nowMs (renews a little before the gateway expires it).
+   */
+  bool active(uint32_t nowMs) const;
+
+  /**
+   * @brief Encrypt @p plaintextJson as the next message of the session.
+   */
+  Message seal(const char* method, const char* path, const String& plaintextJson,
+               SecureBodyEncoding encoding);
+
+  void reset();
+
+  const String& sid() const { return _sid; }
+
+private:
+  static constexpr uint32_t kRenewMarginMs = 30000;
+
+  uint8_t _cr[SecureSessionKeys::kRandomBytes] = {};
+  bool _crPending = false;
+
+  String _sid;
+  AesGcmContext _gcm;
+  uint8_t _ivSalt[SecureSessionKeys::kSaltBytes] = {};
+  uint64_t _seq = 0; // último seq usado
+  uint32_t _openedMs = 0;
+  uint32_t _ttlMs = 0;
+};
+
+#endif //SHARED_LIBS_SECURESESSION_H
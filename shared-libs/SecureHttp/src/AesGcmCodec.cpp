@@ -1,18 +1,7 @@
 #include "AesGcmCodec.h"
 #include "HexUtils.h"
-#include "mbedtls/gcm.h"
 #include <memory>
 
-#include "AesGcmCodec.h"
-#include "HexUtils.h"
-#include "mbedtls/gcm.h"
-#include <memory>
-
-static bool setKey(mbedtls_gcm_context* ctx, const uint8_t* key, size_t keyLen) {
-  // keyLen em bytes, mbedtls espera bits
-  return mbedtls_gcm_setkey(ctx, MBEDTLS_CIPHER_ID_AES, key, (unsigned int)(keyLen * 8)) == 0;
-}
-
 AesGcmEncrypted AesGcmCodec::encrypt(
     const uint8_t* key, size_t keyLen,
     const uint8_t* iv, size_t ivLen,
@@ -36,28 +25,10 @@ AesGcmEncrypted AesGcmCodec::encryptWithAad(
   std::unique_ptr<uint8_t[]> cipher(new uint8_t[n]);
   uint8_t tag[16];
 
-  mbedtls_gcm_context ctx;
-  mbedtls_gcm_init(&ctx);
-
-  if (!setKey(&ctx, key, keyLen)) {
-    mbedtls_gcm_free(&ctx);
-    return out;
-  }
+  std::unique_ptr<CryptoBackend::AeadKey> k(cryptoBackend().newAeadKey(key, keyLen));
+  if (!k) return out;
 
-  int ret = mbedtls_gcm_crypt_and_tag(
-      &ctx,
-      MBEDTLS_GCM_ENCRYPT,
-      n,
-      iv, ivLen,
-      aad, aadLen,
-      (const uint8_t*)plaintext.c_str(),
-      cipher.get(),
-      sizeof(tag),
-      tag
-  );
-
-  mbedtls_gcm_free(&ctx);
-  if (ret != 0) return out;
+  if (!k->seal(iv, aad, aadLen, (const uint8_t*)plaintext.c_str(), n, cipher.get(), tag)) return out;
 
   out.cipherHex = hexEncode(cipher.get(), n);
   out.tagHex = hexEncode(tag, sizeof(tag));
@@ -79,33 +50,75 @@ String AesGcmCodec::decryptWithAad(
     const uint8_t* cipher, size_t cipherLen,
     const uint8_t* tag, size_t tagLen) {
 
-  if (!key || !iv || !cipher || !tag) return "";
-  if (keyLen != 32 || ivLen != 12 || tagLen != 16) return "";
+  if (!cipher) return "";
 
   std::unique_ptr<uint8_t[]> plain(new uint8_t[cipherLen + 1]);
   plain.get()[cipherLen] = 0;
 
-  mbedtls_gcm_context ctx;
-  mbedtls_gcm_init(&ctx);
-
-  if (!setKey(&ctx, key, keyLen)) {
-    mbedtls_gcm_free(&ctx);
+  if (!decryptWithAadTo(key, keyLen, iv, ivLen, aad, aadLen, cipher, cipherLen, tag, tagLen, plain.get())) {
     return "";
   }
 
-  int ret = mbedtls_gcm_auth_decrypt(
-      &ctx, cipherLen,
-      iv, ivLen,
-      aad, aadLen,
-      tag, tagLen,
-      cipher,
-      plain.get()
-  );
-
-  mbedtls_gcm_free(&ctx);
-  if (ret != 0) return "";
-
   // String(const char*) para dados binários pode cortar em \0.
   // Aqui esperamos JSON ASCII, então OK. Usamos length explícito para segurança.
   return String((const char*)plain.get()).substring(0, cipherLen);
 }
+
+bool AesGcmCodec::decryptWithAadTo(
+    const uint8_t* key, size_t keyLen,
+    const uint8_t* iv, size_t ivLen,
+    const uint8_t* aad, size_t aadLen,
+    const uint8_t* cipher, size_t cipherLen,
+    const uint8_t* tag, size_t tagLen,
+    uint8_t* out) {
+
+  if (!key || !iv || !cipher || !tag || !out) return false;
+  if (keyLen != 32 || ivLen != 12 || tagLen != 16) return false;
+
+  std::unique_ptr<CryptoBackend::AeadKey> k(cryptoBackend().newAeadKey(key, keyLen));
+  if (!k) return false;
+
+  return k->open(iv, aad, aadLen, cipher, cipherLen, tag, out);
+}
+
+bool AesGcmContext::setKey(const uint8_t* key, size_t keyLen, const CryptoBackend& backend) {
+  _key.reset(backend.newAeadKey(key, keyLen));
+  return ready();
+}
+
+bool AesGcmContext::encrypt(const uint8_t* iv, size_t ivLen,
+                            const uint8_t* aad, size_t aadLen,
+                            const uint8_t* plain, size_t len,
+                            uint8_t* cipher,
+                            uint8_t* tag, size_t tagLen) {
+  if (!_key || !iv || !plain || !cipher || !tag) return false;
+  if (ivLen != CryptoBackend::kAeadIvBytes || tagLen != CryptoBackend::kAeadTagBytes) return false;
+
+  return _key->seal(iv, aad, aadLen, plain, len, cipher, tag);
+}
+
+bool AesGcmContext::decrypt(const uint8_t* iv, size_t ivLen,
+                            const uint8_t* aad, size_t aadLen,
+                            const uint8_t* cipher, size_t len,
+                            const uint8_t* tag, size_t tagLen,
+                            uint8_t* out) {
+  if (!_key || !iv || !cipher || !tag || !out) return false;
+  if (ivLen != CryptoBackend::kAeadIvBytes || tagLen != CryptoBackend::kAeadTagBytes) return false;
+
+  return _key->open(iv, aad, aadLen, cipher, len, tag, out);
+}
+
+bool AesGcmContext::decryptStart(const uint8_t* iv, size_t ivLen, const uint8_t* aad, size_t aadLen) {
+  if (!_key || !iv || ivLen != CryptoBackend::kAeadIvBytes) return false;
+  return _key->openStart(iv, aad, aadLen);
+}
+
+bool AesGcmContext::decryptUpdate(const uint8_t* cipher, size_t len, uint8_t* out) {
+  if (!_key || (len > 0 && (!cipher || !out))) return false;
+  return _key->openUpdate(cipher, len, out);
+}
+
+bool AesGcmContext::decryptFinish(const uint8_t* tag, size_t tagLen) {
+  if (!_key || !tag || tagLen != CryptoBackend::kAeadTagBytes) return false;
+  return _key->openFinish(tag);
+}
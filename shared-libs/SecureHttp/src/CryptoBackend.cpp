@@ -0,0 +1,170 @@
+#include "CryptoBackend.h"
+
+#include "SecureCodec.h"
+
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_system.h>
+#endif
+
+constexpr size_t CryptoBackend::kSha256Bytes;
+constexpr size_t CryptoBackend::kSha256BlockBytes;
+constexpr size_t CryptoBackend::kAeadKeyBytes;
+constexpr size_t CryptoBackend::kAeadIvBytes;
+constexpr size_t CryptoBackend::kAeadTagBytes;
+constexpr size_t CryptoBackend::kAeadBlockBytes;
+constexpr size_t CryptoBackend::kHashStateBytes;
+
+bool CryptoBackend::random(uint8_t* out, size_t len) const {
+  if (!out) return false;
+#ifdef ESP_PLATFORM
+  // RNG de hardware (com Wi-Fi/BT ligado é criptograficamente seguro)
+  esp_fill_random(out, len);
+  return true;
+#else
+  FILE* f = fopen("/dev/urandom", "rb");
+  if (!f) return false;
+  const size_t n = fread(out, 1, len, f);
+  fclose(f);
+  return n == len;
+#endif
+}
+
+void CryptoBackend::sha256(const void* data, size_t len, uint8_t out[kSha256Bytes]) const {
+  HashState s;
+  sha256Start(s);
+  sha256Update(s, data, len);
+  sha256Finish(s, out);
+  sha256Release(s);
+}
+
+void CryptoBackend::hmacSha256Pads(const uint8_t* key, size_t keyLen, HashState& inner, HashState& outer) const {
+  // RFC 2104: chave > bloco vira SHA-256(chave)
+  uint8_t k[kSha256BlockBytes];
+  memset(k, 0, sizeof(k));
+  if (keyLen > sizeof(k)) {
+    sha256(key, keyLen, k);
+  } else if (key && keyLen > 0) {
+    memcpy(k, key, keyLen);
+  }
+
+  uint8_t pad[kSha256BlockBytes];
+  for (size_t i = 0; i < sizeof(pad); i++) pad[i] = (uint8_t)(k[i] ^ 0x36);
+  sha256Start(inner);
+  sha256Update(inner, pad, sizeof(pad));
+
+  for (size_t i = 0; i < sizeof(pad); i++) pad[i] = (uint8_t)(k[i] ^ 0x5c);
+  sha256Start(outer);
+  sha256Update(outer, pad, sizeof(pad));
+
+  memset(k, 0, sizeof(k));
+  memset(pad, 0, sizeof(pad));
+}
+
+void CryptoBackend::hmacSha256(const uint8_t* key, size_t keyLen, const void* data, size_t len,
+                               uint8_t out[kSha256Bytes]) const {
+  HashState inner, outer;
+  hmacSha256Pads(key, keyLen, inner, outer);
+
+  uint8_t innerHash[kSha256Bytes];
+  sha256Update(inner, data, len);
+  sha256Finish(inner, innerHash);
+  sha256Update(outer, innerHash, sizeof(innerHash));
+  sha256Finish(outer, out);
+
+  sha256Release(inner);
+  sha256Release(outer);
+}
+
+// ===== Seleção =====
+
+static const CryptoBackend& defaultBackend() {
+#if defined(SECUREHTTP_CRYPTO_SOFTWARE) || defined(SECUREHTTP_NO_MBEDTLS)
+  return softwareCryptoBackend();
+#else
+  return mbedtlsCryptoBackend();
+#endif
+}
+
+static const CryptoBackend*& selectedBackend() {
+  static const CryptoBackend* selected = &defaultBackend();
+  return selected;
+}
+
+const CryptoBackend& cryptoBackend() {
+  return *selectedBackend();
+}
+
+void setCryptoBackend(const CryptoBackend& backend) {
+  selectedBackend() = &backend;
+}
+
+size_t cryptoBackends(const CryptoBackend** out, size_t cap) {
+  size_t n = 0;
+#ifndef SECUREHTTP_NO_MBEDTLS
+  if (n < cap) out[n++] = &mbedtlsCryptoBackend();
+#endif
+  if (n < cap) out[n++] = &softwareCryptoBackend();
+  return n;
+}
+
+// ===== Self-test (vetores conhecidos) =====
+
+static bool hexEquals(const uint8_t* data, size_t len, const char* hex) {
+  char buf[2 * 64 + 1];
+  return hexEncodeTo(data, len, buf, sizeof(buf)) == strlen(hex) && memcmp(buf, hex, 2 * len) == 0;
+}
+
+static size_t hexToBytes(const char* hex, uint8_t* out, size_t cap) {
+  const size_t n = strlen(hex) / 2;
+  return (n <= cap && hexDecodeSpan(hex, 2 * n, out, n)) ? n : 0;
+}
+
+bool cryptoBackendSelfTest(const CryptoBackend& backend) {
+  uint8_t digest[CryptoBackend::kSha256Bytes];
+
+  // FIPS 180-2, SHA-256("abc")
+  backend.sha256("abc", 3, digest);
+  if (!hexEquals(digest, sizeof(digest),
+                 "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")) return false;
+
+  // RFC 4231, test case 2
+  static const char msg[] = "what do ya want for nothing?";
+  backend.hmacSha256((const uint8_t*)"Jefe", 4, msg, sizeof(msg) - 1, digest);
+  if (!hexEquals(digest, sizeof(digest),
+                 "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843")) return false;
+
+  // GCM spec (McGrew/Viega), test case 16: AES-256, IV 96 bits, AAD 20 bytes
+  uint8_t key[32], iv[12], aad[20], plain[60], cipher[60], tag[16], out[60];
+  hexToBytes("feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308", key, sizeof(key));
+  hexToBytes("cafebabefacedbaddecaf888", iv, sizeof(iv));
+  hexToBytes("feedfacedeadbeeffeedfacedeadbeefabaddad2", aad, sizeof(aad));
+  hexToBytes("d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+             "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39", plain, sizeof(plain));
+
+  std::unique_ptr<CryptoBackend::AeadKey> k(backend.newAeadKey(key, sizeof(key)));
+  if (!k) return false;
+  if (!k->seal(iv, aad, sizeof(aad), plain, sizeof(plain), cipher, tag)) return false;
+  if (!hexEquals(cipher, sizeof(cipher),
+                 "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa"
+                 "8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662")) return false;
+  if (!hexEquals(tag, sizeof(tag), "76fc6ece0f4e1768cddf8853bb2d551b")) return false;
+
+  if (!k->open(iv, aad, sizeof(aad), cipher, sizeof(cipher), tag, out)) return false;
+  if (memcmp(out, plain, sizeof(plain)) != 0) return false;
+
+  // Streaming: blocos de 16 + resto
+  memset(out, 0, sizeof(out));
+  if (!k->openStart(iv, aad, sizeof(aad))) return false;
+  if (!k->openUpdate(cipher, 32, out) || !k->openUpdate(cipher + 32, sizeof(cipher) - 32, out + 32)) return false;
+  if (!k->openFinish(tag) || memcmp(out, plain, sizeof(plain)) != 0) return false;
+
+  // Tag adulterada tem que falhar
+  tag[0] ^= 0x01;
+  if (!k->openStart(iv, aad, sizeof(aad)) || !k->openUpdate(cipher, sizeof(cipher), out)) return false;
+  if (k->openFinish(tag)) return false;
+  return !k->open(iv, aad, sizeof(aad), cipher, sizeof(cipher), tag, out);
+}
@@ -1,49 +1,25 @@
 #include "CryptoUtils.h"
-#include "mbedtls/md.h"
-#include "mbedtls/sha256.h"
+
+#include "SecureCodec.h"
+
+#include <string.h>
 
 String sha256Hex(const String& s) {
   uint8_t hash[32];
-  mbedtls_sha256_context ctx;
-  mbedtls_sha256_init(&ctx);
-  mbedtls_sha256_starts_ret(&ctx, 0);
-  mbedtls_sha256_update_ret(&ctx, (const unsigned char*)s.c_str(), s.length());
-  mbedtls_sha256_finish_ret(&ctx, hash);
-  mbedtls_sha256_free(&ctx);
-
-  static const char* hex = "0123456789abcdef";
-  String out;
-  out.reserve(sizeof(hash) * 2);
-  for (size_t i = 0; i < sizeof(hash); i++) {
-    out += hex[(hash[i] >> 4) & 0xF];
-    out += hex[hash[i] & 0xF];
-  }
-  return out;
+  cryptoBackend().sha256(s.c_str(), s.length(), hash);
+
+  char hex[2 * sizeof(hash) + 1];
+  hexEncodeTo(hash, sizeof(hash), hex, sizeof(hex));
+  return String(hex);
 }
 
 String hmacSha256Hex(const String& key, const String& msg) {
   uint8_t hmac[32];
-  const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-  mbedtls_md_context_t ctx;
-  mbedtls_md_init(&ctx);
-  if (mbedtls_md_setup(&ctx, info, 1) != 0) {
-    mbedtls_md_free(&ctx);
-    return "";
-  }
+  cryptoBackend().hmacSha256((const uint8_t*)key.c_str(), key.length(), msg.c_str(), msg.length(), hmac);
 
-  mbedtls_md_hmac_starts(&ctx, (const unsigned char*)key.c_str(), key.length());
-  mbedtls_md_hmac_update(&ctx, (const unsigned char*)msg.c_str(), msg.length());
-  mbedtls_md_hmac_finish(&ctx, hmac);
-  mbedtls_md_free(&ctx);
-
-  static const char* hex = "0123456789abcdef";
-  String out;
-  out.reserve(sizeof(hmac) * 2);
-  for (size_t i = 0; i < sizeof(hmac); i++) {
-    out += hex[(hmac[i] >> 4) & 0xF];
-    out += hex[hmac[i] & 0xF];
-  }
-  return out;
+  char hex[2 * sizeof(hmac) + 1];
+  hexEncodeTo(hmac, sizeof(hmac), hex, sizeof(hex));
+  return String(hex);
 }
 
 bool constantTimeEquals(const String& a, const String& b) {
@@ -52,3 +28,80 @@ bool constantTimeEquals(const String& a, const String& b) {
   for (size_t i = 0; i < (size_t)a.length(); i++) diff |= (uint8_t)(a[i] ^ b[i]);
   return diff == 0;
 }
+
+bool constantTimeEqualsBytes(const uint8_t* a, const uint8_t* b, size_t len) {
+  uint8_t diff = 0;
+  for (size_t i = 0; i < len; i++) diff |= (uint8_t)(a[i] ^ b[i]);
+  return diff == 0;
+}
+
+constexpr size_t HmacSha256::kBlockSize;
+constexpr size_t HmacSha256::kDigestSize;
+
+HmacSha256Key::~HmacSha256Key() {
+  if (_backend) {
+    _backend->sha256Release(_inner);
+    _backend->sha256Release(_outer);
+  }
+}
+
+HmacSha256Key::HmacSha256Key(const uint8_t* key, size_t keyLen) {
+  set(key, keyLen);
+}
+
+void HmacSha256Key::set(const uint8_t* key, size_t keyLen, const CryptoBackend& backend) {
+  if (_backend) {
+    _backend->sha256Release(_inner);
+    _backend->sha256Release(_outer);
+  }
+  _backend = &backend;
+  _backend->hmacSha256Pads(key, keyLen, _inner, _outer);
+}
+
+HmacSha256::HmacSha256(const uint8_t* key, size_t keyLen, const CryptoBackend& backend) : _backend(&backend) {
+  _backend->hmacSha256Pads(key, keyLen, _inner, _outer);
+}
+
+HmacSha256::HmacSha256(const HmacSha256Key& key) {
+  start(key);
+}
+
+HmacSha256::~HmacSha256() {
+  release();
+}
+
+void HmacSha256::release() {
+  if (!_backend) return;
+  _backend->sha256Release(_inner);
+  _backend->sha256Release(_outer);
+  _backend = nullptr;
+}
+
+void HmacSha256::start(const HmacSha256Key& key) {
+  release();
+  if (key.ready()) {
+    _backend = key._backend;
+    _backend->sha256Copy(_inner, key._inner);
+    _backend->sha256Copy(_outer, key._outer);
+  } else {
+    _backend = &cryptoBackend();
+    _backend->hmacSha256Pads(nullptr, 0, _inner, _outer); // chave vazia: MAC nunca confere
+  }
+}
+
+void HmacSha256::update(const void* data, size_t len) {
+  if (len == 0) return;
+  _backend->sha256Update(_inner, data, len);
+}
+
+void HmacSha256::update(const char* s) {
+  if (s) update(s, strlen(s));
+}
+
+void HmacSha256::finish(uint8_t out[kDigestSize]) {
+  uint8_t innerHash[kDigestSize];
+  _backend->sha256Finish(_inner, innerHash);
+
+  _backend->sha256Update(_outer, innerHash, sizeof(innerHash));
+  _backend->sha256Finish(_outer, out);
+}
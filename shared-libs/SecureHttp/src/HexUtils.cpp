@@ -1,24 +1,22 @@
 #include "HexUtils.h"
 
 String hexEncode(const uint8_t* data, size_t len) {
-  static const char* hex = "0123456789abcdef";
+  // Pedaços na pilha: um concat a cada 32 bytes em vez de um por char
   String out;
   out.reserve(len * 2);
-  for (size_t i = 0; i < len; i++) {
-    out += hex[(data[i] >> 4) & 0xF];
-    out += hex[data[i] & 0xF];
+  char chunk[65];
+  while (len > 0) {
+    const size_t n = (len < 32) ? len : 32;
+    hexEncodeTo(data, n, chunk, sizeof(chunk));
+    out += chunk;
+    data += n;
+    len -= n;
   }
   return out;
 }
 
 bool hexDecodeFixed(const String& hexStr, uint8_t* out, size_t outLen) {
-  if (hexStr.length() != (int)(outLen * 2)) return false;
-  for (size_t i = 0; i < outLen; i++) {
-    unsigned int v = 0;
-    if (sscanf(hexStr.substring(i * 2, i * 2 + 2).c_str(), "%02x", &v) != 1) return false;
-    out[i] = (uint8_t)v;
-  }
-  return true;
+  return hexDecodeSpan(hexStr.c_str(), (size_t)hexStr.length(), out, outLen);
 }
 
 bool isHexStringEven(const String& s) {
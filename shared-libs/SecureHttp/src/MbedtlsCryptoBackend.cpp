@@ -0,0 +1,121 @@
+#include "CryptoBackend.h"
+
+#ifndef SECUREHTTP_NO_MBEDTLS
+
+#include <new>
+
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+
+// No ESP32 o port do IDF (MBEDTLS_AES_ALT / MBEDTLS_SHA256_ALT) leva estas
+// chamadas para os aceleradores de hardware; no host é o mbedtls puro.
+
+static_assert(sizeof(mbedtls_sha256_context) <= CryptoBackend::kHashStateBytes,
+              "grow CryptoBackend::kHashStateBytes");
+static_assert(alignof(mbedtls_sha256_context) <= 8, "HashState alignment");
+
+namespace {
+
+mbedtls_sha256_context* ctxOf(CryptoBackend::HashState& s) {
+  return reinterpret_cast<mbedtls_sha256_context*>(s.raw);
+}
+
+const mbedtls_sha256_context* ctxOf(const CryptoBackend::HashState& s) {
+  return reinterpret_cast<const mbedtls_sha256_context*>(s.raw);
+}
+
+class MbedtlsAeadKey : public CryptoBackend::AeadKey {
+public:
+  MbedtlsAeadKey() { mbedtls_gcm_init(&_ctx); }
+  ~MbedtlsAeadKey() override { mbedtls_gcm_free(&_ctx); }
+
+  bool setKey(const uint8_t* key, size_t keyLen) {
+    // keyLen em bytes, mbedtls espera bits
+    return mbedtls_gcm_setkey(&_ctx, MBEDTLS_CIPHER_ID_AES, key, (unsigned int)(keyLen * 8)) == 0;
+  }
+
+  bool seal(const uint8_t* iv,
+            const uint8_t* aad, size_t aadLen,
+            const uint8_t* plain, size_t len,
+            uint8_t* cipher, uint8_t* tag) override {
+    return mbedtls_gcm_crypt_and_tag(&_ctx, MBEDTLS_GCM_ENCRYPT, len,
+                                     iv, CryptoBackend::kAeadIvBytes, aad, aadLen,
+                                     plain, cipher, CryptoBackend::kAeadTagBytes, tag) == 0;
+  }
+
+  bool open(const uint8_t* iv,
+            const uint8_t* aad, size_t aadLen,
+            const uint8_t* cipher, size_t len,
+            const uint8_t* tag, uint8_t* out) override {
+    return mbedtls_gcm_auth_decrypt(&_ctx, len, iv, CryptoBackend::kAeadIvBytes, aad, aadLen,
+                                    tag, CryptoBackend::kAeadTagBytes, cipher, out) == 0;
+  }
+
+  bool openStart(const uint8_t* iv, const uint8_t* aad, size_t aadLen) override {
+    return mbedtls_gcm_starts(&_ctx, MBEDTLS_GCM_DECRYPT, iv, CryptoBackend::kAeadIvBytes, aad, aadLen) == 0;
+  }
+
+  bool openUpdate(const uint8_t* cipher, size_t len, uint8_t* out) override {
+    // mbedtls 2.x: múltiplos de 16 exceto na última chamada (mesma regra da interface)
+    return len == 0 || mbedtls_gcm_update(&_ctx, len, cipher, out) == 0;
+  }
+
+  bool openFinish(const uint8_t* tag) override {
+    uint8_t expected[CryptoBackend::kAeadTagBytes];
+    if (mbedtls_gcm_finish(&_ctx, expected, sizeof(expected)) != 0) return false;
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(expected); i++) diff |= (uint8_t)(expected[i] ^ tag[i]);
+    return diff == 0;
+  }
+
+private:
+  mbedtls_gcm_context _ctx;
+};
+
+class MbedtlsCryptoBackend : public CryptoBackend {
+public:
+  const char* name() const override { return "mbedtls"; }
+
+  AeadKey* newAeadKey(const uint8_t* key, size_t keyLen) const override {
+    if (!key || keyLen != kAeadKeyBytes) return nullptr;
+
+    MbedtlsAeadKey* k = new (std::nothrow) MbedtlsAeadKey();
+    if (k && !k->setKey(key, keyLen)) {
+      delete k;
+      k = nullptr;
+    }
+    return k;
+  }
+
+  void sha256Start(HashState& s) const override {
+    mbedtls_sha256_init(ctxOf(s));
+    mbedtls_sha256_starts_ret(ctxOf(s), 0);
+  }
+
+  void sha256Copy(HashState& dst, const HashState& src) const override {
+    mbedtls_sha256_init(ctxOf(dst));
+    mbedtls_sha256_clone(ctxOf(dst), ctxOf(src));
+  }
+
+  void sha256Update(HashState& s, const void* data, size_t len) const override {
+    mbedtls_sha256_update_ret(ctxOf(s), (const unsigned char*)data, len);
+  }
+
+  void sha256Finish(HashState& s, uint8_t out[kSha256Bytes]) const override {
+    mbedtls_sha256_finish_ret(ctxOf(s), out);
+  }
+
+  void sha256Release(HashState& s) const override {
+    mbedtls_sha256_free(ctxOf(s));
+  }
+};
+
+} // namespace
+
+const CryptoBackend& mbedtlsCryptoBackend() {
+  static const MbedtlsCryptoBackend backend;
+  return backend;
+}
+
+#endif // SECUREHTTP_NO_MBEDTLS
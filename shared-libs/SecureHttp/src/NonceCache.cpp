@@ -1,43 +1,150 @@
 #include "NonceCache.h"
 
-NonceCache::NonceCache(size_t cap, uint32_t ttlSec)
-  : _cap(cap), _ttl(ttlSec) {
-  _entries = new NonceEntry[_cap];
-  for (size_t i = 0; i < _cap; i++) _entries[i] = {0, ""};
+#include <string.h>
+
+constexpr uint8_t NonceCache::kBuckets;
+
+// Finalizador do splitmix64: espalha os bits para o índice e o fingerprint
+static uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
+  if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+  return -1;
+}
+
+NonceCache::NonceCache(size_t cap, uint32_t ttlSec) {
+  _bucketSlots = cap / kBuckets;
+  if (_bucketSlots < 16) _bucketSlots = 16;
+  _maxLoad = _bucketSlots - _bucketSlots / 4;
+
+  _sliceSec = sliceSecFor(ttlSec);
+  _slice = 0;
+
+  _slots = new uint32_t[_bucketSlots * kBuckets];
+  memset(_slots, 0, sizeof(uint32_t) * _bucketSlots * kBuckets);
 }
 
 NonceCache::~NonceCache() {
-  delete[] _entries;
+  delete[] _slots;
 }
 
-void NonceCache::cleanup(uint32_t now) {
-  for (size_t i = 0; i < _cap; i++) {
-    if (_entries[i].ts != 0 && (now - _entries[i].ts) > _ttl) {
-      _entries[i].ts = 0;
-      _entries[i].nonce = "";
+uint64_t NonceCache::hashNonce(const char* nonce, size_t len) {
+  // Formato do device: 16 hex = 8 bytes, usados direto
+  if (len == 16) {
+    uint64_t v = 0;
+    size_t i = 0;
+    for (; i < len; i++) {
+      const int d = hexValue(nonce[i]);
+      if (d < 0) break;
+      v = (v << 4) | (uint64_t)d;
     }
+    if (i == len) return mix64(v);
+  }
+
+  // Outros formatos: FNV-1a 64
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)nonce[i];
+    h *= 0x100000001b3ULL;
+  }
+  return mix64(h ^ 0x9e3779b97f4a7c15ULL);
+}
+
+void NonceCache::advance(uint32_t now) {
+  const uint32_t cur = now / _sliceSec;
+
+  if (!_started) {
+    _started = true;
+    _slice = cur;
+    return;
+  }
+
+  // Relógio voltou (ex.: millis -> SNTP): mantém a fatia corrente
+  if (cur <= _slice) return;
+
+  // Limpa as tabelas das fatias que entram (no máximo kBuckets)
+  const uint32_t first = (cur - _slice > kBuckets) ? (cur - kBuckets + 1) : (_slice + 1);
+  for (uint32_t s = first; s <= cur; s++) {
+    const uint8_t b = (uint8_t)(s % kBuckets);
+    if (_count[b] > 0) memset(table(b), 0, sizeof(uint32_t) * _bucketSlots);
+    _count[b] = 0;
   }
+  _slice = cur;
+}
+
+bool NonceCache::findIn(uint8_t bucket, uint32_t fp, uint32_t home) const {
+  if (_count[bucket] == 0) return false;
+
+  const uint32_t* t = table(bucket);
+  for (size_t i = home % _bucketSlots;; i = (i + 1 == _bucketSlots) ? 0 : i + 1) {
+    if (t[i] == 0) return false;
+    if (t[i] == fp) return true;
+  }
+}
+
+bool NonceCache::insertIn(uint8_t bucket, uint32_t fp, uint32_t home) {
+  uint32_t* t = table(bucket);
+  size_t i = home % _bucketSlots;
+  for (; t[i] != 0; i = (i + 1 == _bucketSlots) ? 0 : i + 1) {
+    if (t[i] == fp) return true;
+  }
+
+  if (_count[bucket] >= _maxLoad) return false;
+  t[i] = fp;
+  _count[bucket]++;
+  return true;
 }
 
 bool NonceCache::seenRecently(uint32_t now, const String& nonce) {
-  cleanup(now);
-  for (size_t i = 0; i < _cap; i++) {
-    if (_entries[i].ts != 0 && _entries[i].nonce == nonce) return true;
+  return seenRecently(now, nonce.c_str(), nonce.length());
+}
+
+bool NonceCache::seenRecently(uint32_t now, const char* nonce, size_t len) {
+  if (!nonce) return false;
+  advance(now);
+
+  const uint64_t h = hashNonce(nonce, len);
+  const uint32_t fp = (uint32_t)(h >> 32) | 1u; // 0 marca slot vazio
+  for (uint8_t b = 0; b < kBuckets; b++) {
+    if (findIn(b, fp, (uint32_t)h)) return true;
   }
   return false;
 }
 
-void NonceCache::remember(uint32_t now, const String& nonce) {
-  cleanup(now);
+bool NonceCache::hasRoom(uint32_t now) {
+  advance(now);
+  return _count[_slice % kBuckets] < _maxLoad || _count[(_slice - 1) % kBuckets] < _maxLoad;
+}
+
+bool NonceCache::remember(uint32_t now, const String& nonce) {
+  return remember(now, nonce.c_str(), nonce.length());
+}
 
-  size_t idx = 0;
-  uint32_t oldest = UINT32_MAX;
+bool NonceCache::remember(uint32_t now, const char* nonce, size_t len) {
+  if (!nonce || len > SECURE_NONCE_MAX_LEN) return false;
+  advance(now);
 
-  for (size_t i = 0; i < _cap; i++) {
-    if (_entries[i].ts == 0) { idx = i; oldest = 0; break; }
-    if (_entries[i].ts < oldest) { oldest = _entries[i].ts; idx = i; }
-  }
+  const uint64_t h = hashNonce(nonce, len);
+  const uint32_t fp = (uint32_t)(h >> 32) | 1u;
+
+  // Tabela corrente cheia: a da fatia anterior ainda vive >= TTL (ver sliceSecFor)
+  const uint8_t cur = (uint8_t)(_slice % kBuckets);
+  const uint8_t prev = (uint8_t)((_slice - 1) % kBuckets);
+  if (findIn(prev, fp, (uint32_t)h)) return true;
+  return insertIn(cur, fp, (uint32_t)h) || insertIn(prev, fp, (uint32_t)h);
+}
 
-  _entries[idx].ts = now;
-  _entries[idx].nonce = nonce;
+size_t NonceCache::size() const {
+  size_t n = 0;
+  for (uint8_t b = 0; b < kBuckets; b++) n += _count[b];
+  return n;
 }
@@ -0,0 +1,44 @@
+#include "SecureBodyEncoding.h"
+
+#include <string.h>
+#include <strings.h>
+
+const char* secureBodyEncodingName(SecureBodyEncoding e) {
+  switch (e) {
+    case SecureBodyEncoding::Raw: return "raw";
+    case SecureBodyEncoding::Base64Url: return "base64url";
+    case SecureBodyEncoding::Hex:
+    default: return "hex";
+  }
+}
+
+bool parseSecureBodyEncoding(const char* value, SecureBodyEncoding& out) {
+  if (!value || !*value || strcasecmp(value, "hex") == 0) {
+    out = SecureBodyEncoding::Hex;
+    return true;
+  }
+  if (strcasecmp(value, "raw") == 0) {
+    out = SecureBodyEncoding::Raw;
+    return true;
+  }
+  if (strcasecmp(value, "base64url") == 0) {
+    out = SecureBodyEncoding::Base64Url;
+    return true;
+  }
+  return false;
+}
+
+String base64UrlEncode(const uint8_t* data, size_t len) {
+  // Pedaços de 48 bytes (múltiplo de 3: sem resto no meio) -> 64 chars
+  String out;
+  out.reserve(base64UrlEncodedLen(len));
+  char chunk[65];
+  while (len > 0) {
+    const size_t n = (len < 48) ? len : 48;
+    base64UrlEncodeTo(data, n, chunk, sizeof(chunk));
+    out += chunk;
+    data += n;
+    len -= n;
+  }
+  return out;
+}
@@ -0,0 +1,183 @@
+#include "SecureCodec.h"
+
+#include <string.h>
+
+namespace {
+
+// byte -> 2 chars hex (tabela de pares: 1 lookup por byte)
+const char kHexPairs[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+// char -> nibble; 0xFF = inválido (bit 7 acumulado em "bad")
+const uint8_t kHexValue[256] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+const char kB64Url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// char -> 6 bits; 0xFF = inválido
+const uint8_t kB64UrlValue[256] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+  0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+inline void putHexPair(char* out, uint8_t b) {
+  memcpy(out, kHexPairs + 2 * b, 2);
+}
+
+} // namespace
+
+size_t hexEncodeTo(const uint8_t* data, size_t len, char* out, size_t outCap) {
+  if (!out || outCap < 2 * len + 1 || (len > 0 && !data)) return 0;
+
+  // 4 bytes (8 chars) por volta
+  size_t i = 0;
+  char* o = out;
+  for (; i + 4 <= len; i += 4, o += 8) {
+    putHexPair(o, data[i]);
+    putHexPair(o + 2, data[i + 1]);
+    putHexPair(o + 4, data[i + 2]);
+    putHexPair(o + 6, data[i + 3]);
+  }
+  for (; i < len; i++, o += 2) putHexPair(o, data[i]);
+
+  *o = '\0';
+  return 2 * len;
+}
+
+bool hexDecodeSpan(const char* hex, size_t hexLen, uint8_t* out, size_t outLen) {
+  if (!hex || !out || hexLen != outLen * 2) return false;
+
+  // Validação dobrada no laço: inválido vale 0xFF, checado uma vez no fim.
+  // 8 chars lidos antes de escrever 4 bytes (decodificar no lugar continua seguro).
+  const uint8_t* in = (const uint8_t*)hex;
+  uint8_t bad = 0;
+  size_t i = 0;
+  for (; i + 4 <= outLen; i += 4, in += 8) {
+    const uint8_t h0 = kHexValue[in[0]], l0 = kHexValue[in[1]];
+    const uint8_t h1 = kHexValue[in[2]], l1 = kHexValue[in[3]];
+    const uint8_t h2 = kHexValue[in[4]], l2 = kHexValue[in[5]];
+    const uint8_t h3 = kHexValue[in[6]], l3 = kHexValue[in[7]];
+    bad |= (uint8_t)(h0 | l0 | h1 | l1 | h2 | l2 | h3 | l3);
+    out[i] = (uint8_t)((h0 << 4) | l0);
+    out[i + 1] = (uint8_t)((h1 << 4) | l1);
+    out[i + 2] = (uint8_t)((h2 << 4) | l2);
+    out[i + 3] = (uint8_t)((h3 << 4) | l3);
+  }
+  for (; i < outLen; i++, in += 2) {
+    const uint8_t h = kHexValue[in[0]], l = kHexValue[in[1]];
+    bad |= (uint8_t)(h | l);
+    out[i] = (uint8_t)((h << 4) | l);
+  }
+  return (bad & 0x80) == 0;
+}
+
+size_t base64UrlEncodedLen(size_t n) {
+  return (n / 3) * 4 + ((n % 3) ? (n % 3) + 1 : 0);
+}
+
+size_t base64UrlDecodedLen(size_t n) {
+  return (n / 4) * 3 + ((n % 4) ? (n % 4) - 1 : 0);
+}
+
+size_t base64UrlEncodeTo(const uint8_t* data, size_t len, char* out, size_t outCap) {
+  const size_t encLen = base64UrlEncodedLen(len);
+  if (!out || outCap < encLen + 1 || (len > 0 && !data)) return 0;
+
+  size_t i = 0;
+  char* o = out;
+  for (; i + 3 <= len; i += 3, o += 4) {
+    const uint32_t v = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+    o[0] = kB64Url[(v >> 18) & 0x3F];
+    o[1] = kB64Url[(v >> 12) & 0x3F];
+    o[2] = kB64Url[(v >> 6) & 0x3F];
+    o[3] = kB64Url[v & 0x3F];
+  }
+
+  // Resto de 1 ou 2 bytes, sem padding
+  const size_t rest = len - i;
+  if (rest > 0) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    if (rest == 2) v |= (uint32_t)data[i + 1] << 8;
+    *o++ = kB64Url[(v >> 18) & 0x3F];
+    *o++ = kB64Url[(v >> 12) & 0x3F];
+    if (rest == 2) *o++ = kB64Url[(v >> 6) & 0x3F];
+  }
+
+  *o = '\0';
+  return encLen;
+}
+
+bool base64UrlDecodeSpan(const char* in, size_t inLen, uint8_t* out, size_t outCap, size_t& outLen) {
+  outLen = 0;
+  if (!in || !out) return false;
+  if ((inLen % 4) == 1) return false; // 6 bits sobrando não formam um byte
+
+  const size_t need = base64UrlDecodedLen(inLen);
+  if (need > outCap) return false;
+
+  const uint8_t* p = (const uint8_t*)in;
+  uint8_t bad = 0;
+  size_t o = 0;
+  size_t i = 0;
+  for (; i + 4 <= inLen; i += 4, p += 4) {
+    const uint8_t a = kB64UrlValue[p[0]], b = kB64UrlValue[p[1]];
+    const uint8_t c = kB64UrlValue[p[2]], d = kB64UrlValue[p[3]];
+    bad |= (uint8_t)(a | b | c | d);
+    const uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+    out[o] = (uint8_t)(v >> 16);
+    out[o + 1] = (uint8_t)(v >> 8);
+    out[o + 2] = (uint8_t)v;
+    o += 3;
+  }
+
+  const size_t rest = inLen - i;
+  if (rest > 0) {
+    const uint8_t a = kB64UrlValue[p[0]], b = kB64UrlValue[p[1]];
+    const uint8_t c = (rest == 3) ? kB64UrlValue[p[2]] : 0;
+    bad |= (uint8_t)(a | b | c);
+    const uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6);
+    out[o++] = (uint8_t)(v >> 16);
+    if (rest == 3) out[o++] = (uint8_t)(v >> 8);
+  }
+
+  if (bad & 0x80) return false;
+  outLen = o;
+  return true;
+}
@@ -5,14 +5,12 @@
 #include "SecureDeviceAuth.h"
 
 #include <time.h>
+#include <stdlib.h>
 #include <cstring>
 #include <memory>
 
-#include <mbedtls/gcm.h>
-#include <mbedtls/md.h>
-#include <esp_system.h>
-
 #include "SecureHttpConfig.h"
+#include "HexUtils.h"
 
 #ifndef SECUREHTTP_AES256_KEY
 #error "SECUREHTTP_AES256_KEY not defined in SecureHttpConfig.h"
@@ -26,86 +24,16 @@
 #error "SECUREHTTP_HMAC_KEY_LEN not defined in SecureHttpConfig.h"
 #endif
 
-static uint8_t hexNibble(char c) {
-    if (c >= '0' && c <= '9') return (uint8_t)(c - '0');
-    if (c >= 'a' && c <= 'f') return (uint8_t)(10 + (c - 'a'));
-    if (c >= 'A' && c <= 'F') return (uint8_t)(10 + (c - 'A'));
-    return 0xFF;
-}
-
-String SecureDeviceAuth::toHex(const uint8_t *data, size_t len) {
-    static const char *hex = "0123456789abcdef";
-    String out;
-    out.reserve(len * 2);
-    for (size_t i = 0; i < len; i++) {
-        out += hex[(data[i] >> 4) & 0x0F];
-        out += hex[data[i] & 0x0F];
-    }
-    return out;
-}
-
-bool SecureDeviceAuth::fromHex(const String &hex, uint8_t *out, size_t outLen) {
-    if ((hex.length() % 2) != 0) return false;
-    const size_t want = (size_t)hex.length() / 2;
-    if (want != outLen) return false;
-
-    for (size_t i = 0; i < outLen; i++) {
-        const uint8_t hi = hexNibble(hex[2 * i]);
-        const uint8_t lo = hexNibble(hex[2 * i + 1]);
-        if (hi == 0xFF || lo == 0xFF) return false;
-        out[i] = (uint8_t)((hi << 4) | lo);
-    }
-    return true;
-}
-
 String SecureDeviceAuth::randomHex(size_t bytesLen) {
     uint8_t buf[32];
     if (bytesLen > sizeof(buf)) bytesLen = sizeof(buf);
-    for (size_t i = 0; i < bytesLen; i += 4) {
-        uint32_t r = esp_random();
-        size_t n = (bytesLen - i >= 4) ? 4 : (bytesLen - i);
-        memcpy(&buf[i], &r, n);
-    }
-    return toHex(buf, bytesLen);
+    if (!cryptoBackend().random(buf, bytesLen)) return String();
+    return hexEncode(buf, bytesLen);
 }
 
-bool SecureDeviceAuth::aes256gcmEncrypt(const uint8_t *key32,
-                                       const uint8_t *iv12,
-                                       const uint8_t *aad, size_t aadLen,
-                                       const uint8_t *pt, size_t ptLen,
-                                       uint8_t *ct,
-                                       uint8_t *tag16) {
-    mbedtls_gcm_context gcm;
-    mbedtls_gcm_init(&gcm);
-
-    int rc = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key32, 256);
-    if (rc != 0) { mbedtls_gcm_free(&gcm); return false; }
-
-    rc = mbedtls_gcm_crypt_and_tag(&gcm,
-                                  MBEDTLS_GCM_ENCRYPT,
-                                  ptLen,
-                                  iv12, 12,
-                                  aad, aadLen,
-                                  pt,
-                                  ct,
-                                  16, tag16);
-
-    mbedtls_gcm_free(&gcm);
-    return rc == 0;
-}
-
-bool SecureDeviceAuth::hmacSha256Hex(const uint8_t *key, size_t keyLen,
-                                     const uint8_t *msg, size_t msgLen,
-                                     String &outHex) {
-    const mbedtls_md_info_t *info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-    if (!info) return false;
-
-    uint8_t mac[32];
-    int rc = mbedtls_md_hmac(info, key, keyLen, msg, msgLen, mac);
-    if (rc != 0) return false;
-
-    outHex = toHex(mac, sizeof(mac));
-    return true;
+void SecureDeviceAuth::ensureKeys() const {
+    if (!_gcm.ready()) _gcm.setKey(SECUREHTTP_AES256_KEY, sizeof(SECUREHTTP_AES256_KEY));
+    if (!_hmacKey.ready()) _hmacKey.set(SECUREHTTP_HMAC_KEY, SECUREHTTP_HMAC_KEY_LEN);
 }
 
 String SecureDeviceAuth::canonicalToSign(const char *method,
@@ -131,10 +59,48 @@ String SecureDeviceAuth::canonicalToSign(const char *method,
     return s;
 }
 
+const uint8_t *SecureDeviceAuth::Result::bodyData() const {
+    switch (encoding) {
+        case SecureBodyEncoding::Raw: return ciphertext.get();
+        case SecureBodyEncoding::Base64Url: return (const uint8_t *)ciphertextB64.c_str();
+        case SecureBodyEncoding::Hex:
+        default: return (const uint8_t *)ciphertextHex.c_str();
+    }
+}
+
+size_t SecureDeviceAuth::Result::bodyLen() const {
+    switch (encoding) {
+        case SecureBodyEncoding::Raw: return ciphertextLen;
+        case SecureBodyEncoding::Base64Url: return ciphertextB64.length();
+        case SecureBodyEncoding::Hex:
+        default: return ciphertextHex.length();
+    }
+}
+
+String SecureDeviceAuth::Result::packedHeader() const {
+    if (!ok || protocol != SecureProtocol::V2) return String();
+    if (deviceId.length() == 0 || deviceId.length() > SecurePackedMeta::kMaxDeviceIdLen) return String();
+
+    SecurePackedMeta m;
+    m.keyVersion = keyVersion;
+    m.encoding = encoding;
+    m.timestamp = (uint32_t) strtoul(timestamp.c_str(), nullptr, 10);
+    if (!hexDecodeFixed(nonce, m.nonce, sizeof(m.nonce)) ||
+        !hexDecodeFixed(ivHex, m.iv, sizeof(m.iv)) ||
+        !hexDecodeFixed(tagHex, m.tag, sizeof(m.tag))) {
+        return String();
+    }
+    memcpy(m.deviceId, deviceId.c_str(), deviceId.length());
+    m.deviceIdLen = (uint8_t) deviceId.length();
+    return securePackedHeaderValue(m);
+}
+
 SecureDeviceAuth::Result SecureDeviceAuth::encryptAndSign(const char *deviceId,
                                                           const char *method,
                                                           const char *path,
-                                                          const String &plaintextJson) const {
+                                                          const String &plaintextJson,
+                                                          SecureBodyEncoding encoding,
+                                                          SecureProtocol protocol) const {
     Result r;
 
     if (!deviceId || !*deviceId) { r.error = "invalid_device_id"; return r; }
@@ -151,53 +117,83 @@ SecureDeviceAuth::Result SecureDeviceAuth::encryptAndSign(const char *deviceId,
     r.deviceId = deviceId;
     r.timestamp = String((uint32_t)now);
     r.nonce = randomHex(8);
+    if (r.nonce.length() == 0) { r.error = "iv_gen_failed"; return r; }
 
     uint8_t iv[12];
     {
         String ivHex = randomHex(12);
-        if (!fromHex(ivHex, iv, sizeof(iv))) { r.error = "iv_gen_failed"; return r; }
+        if (!hexDecodeFixed(ivHex, iv, sizeof(iv))) { r.error = "iv_gen_failed"; return r; }
         r.ivHex = ivHex;
     }
 
     // AAD MUST match gateway
+    // v1: deviceId|ts|nonce|method|path; v2: secureEnvelopeAadV2() (campos do antigo canonical)
     String aadStr;
-    aadStr.reserve(64);
-    aadStr += r.deviceId;  aadStr += "|";
-    aadStr += r.timestamp; aadStr += "|";
-    aadStr += r.nonce;     aadStr += "|";
-    aadStr += method;      aadStr += "|";
-    aadStr += path;
+    if (protocol == SecureProtocol::V2) {
+        char aad[192];
+        const size_t aadLen = secureEnvelopeAadV2(aad, sizeof(aad), deviceId, r.timestamp.c_str(),
+                                                  r.nonce.c_str(), SECURE_KEY_VERSION, method, path);
+        if (aadLen == 0) { r.error = "invalid_path"; return r; }
+        aadStr = aad;
+    } else {
+        aadStr.reserve(64);
+        aadStr += r.deviceId;  aadStr += "|";
+        aadStr += r.timestamp; aadStr += "|";
+        aadStr += r.nonce;     aadStr += "|";
+        aadStr += method;      aadStr += "|";
+        aadStr += path;
+    }
 
     const uint8_t *pt = (const uint8_t *)plaintextJson.c_str();
     const size_t ptLen = plaintextJson.length();
 
-    std::unique_ptr<uint8_t[]> ct(new uint8_t[ptLen]);
+    r.ciphertext.reset(new uint8_t[ptLen]);
+    r.ciphertextLen = ptLen;
     uint8_t tag[16];
 
-    if (!aes256gcmEncrypt(SECUREHTTP_AES256_KEY, iv,
-                          (const uint8_t*)aadStr.c_str(), aadStr.length(),
-                          pt, ptLen,
-                          ct.get(),
-                          tag)) {
+    ensureKeys();
+    if (!_gcm.encrypt(iv, sizeof(iv),
+                      (const uint8_t*)aadStr.c_str(), aadStr.length(),
+                      pt, ptLen,
+                      r.ciphertext.get(),
+                      tag, sizeof(tag))) {
         r.error = "encrypt_failed";
         return r;
     }
 
-    r.ciphertextHex = toHex(ct.get(), ptLen);
-    r.tagHex = toHex(tag, sizeof(tag));
+    r.encoding = encoding;
+    r.tagHex = hexEncode(tag, sizeof(tag));
+
+    if (encoding == SecureBodyEncoding::Hex) {
+        r.ciphertextHex = hexEncode(r.ciphertext.get(), ptLen);
+    } else if (encoding == SecureBodyEncoding::Base64Url) {
+        r.ciphertextB64 = base64UrlEncode(r.ciphertext.get(), ptLen);
+    }
 
-    const String canonical = canonicalToSign(method, path,
-                                             r.deviceId, r.timestamp, r.nonce,
-                                             r.ivHex, r.tagHex, r.ciphertextHex);
+    r.protocol = protocol;
+    r.keyVersion = SECURE_KEY_VERSION;
 
-    String sigHex;
-    if (!hmacSha256Hex(SECUREHTTP_HMAC_KEY, SECUREHTTP_HMAC_KEY_LEN,
-                       (const uint8_t*)canonical.c_str(), canonical.length(),
-                       sigHex)) {
-        r.error = "hmac_failed";
+    // v2: a tag GCM já autentica tudo, sem segunda passada
+    if (protocol == SecureProtocol::V2) {
+        r.ok = true;
         return r;
     }
 
+    // Canonical sem o último campo; o ciphertext entra direto no HMAC
+    // (hex: texto do body; raw/base64url: bytes)
+    const String prefix = canonicalToSign(method, path,
+                                          r.deviceId, r.timestamp, r.nonce,
+                                          r.ivHex, r.tagHex, String());
+
+    HmacSha256 mac(_hmacKey);
+    mac.update(prefix.c_str(), prefix.length());
+    if (encoding == SecureBodyEncoding::Hex) mac.update(r.ciphertextHex.c_str(), r.ciphertextHex.length());
+    else mac.update(r.ciphertext.get(), ptLen);
+
+    uint8_t sig[HmacSha256::kDigestSize];
+    mac.finish(sig);
+    const String sigHex = hexEncode(sig, sizeof(sig));
+
     r.signatureHex = sigHex;
     r.ok = true;
     return r;
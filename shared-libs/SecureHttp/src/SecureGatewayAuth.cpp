@@ -5,12 +5,20 @@
 #include "AesGcmCodec.h"
 
 #include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
-#include <mbedtls/md.h>   // HMAC-SHA256
-
 SecureGatewayAuth::SecureGatewayAuth()
-  : _nonceCache(SECURE_NONCE_CACHE_CAP, SECURE_NONCE_TTL_SEC) {}
+  : _nonceCache(NonceCache::capacityFor(SECURE_NONCE_RATE_PER_SEC, SECURE_NONCE_TTL_SEC),
+                SECURE_NONCE_TTL_SEC),
+    _sessions(SECURE_SESSION_MAX, SECURE_SESSION_TTL_SEC),
+    _keys(SECURE_KEYSTORE_CAPACITY) {}
+
+void SecureGatewayAuth::ensureKeys() {
+  if (!_keys.loaded()) _keys.begin();
+}
 
 uint32_t SecureGatewayAuth::nowSec() {
   time_t now = time(nullptr);
@@ -18,179 +26,629 @@ uint32_t SecureGatewayAuth::nowSec() {
   return (uint32_t)(millis() / 1000);          // fallback
 }
 
-static bool decodeHexToBuf(const String& hexStr, std::unique_ptr<uint8_t[]>& bufOut, size_t& lenOut) {
-  if (hexStr.isEmpty() || !isHexStringEven(hexStr)) return false;
-  lenOut = (size_t)hexStr.length() / 2;
-  bufOut.reset(new uint8_t[lenOut]);
-  for (size_t i = 0; i < lenOut; i++) {
-    unsigned int v = 0;
-    if (sscanf(hexStr.substring(i * 2, i * 2 + 2).c_str(), "%02x", &v) != 1) return false;
-    bufOut.get()[i] = (uint8_t)v;
-  }
-  return true;
+size_t SecureGatewayAuth::workBytesFor(size_t bodyLen, SecureBodyEncoding encoding) {
+  return SecureStreamVerifier::plaintextBytesFor(bodyLen, encoding);
 }
 
-static String toHexLocal(const uint8_t* data, size_t len) {
-  static const char* hex = "0123456789abcdef";
-  String out;
-  out.reserve(len * 2);
-  for (size_t i = 0; i < len; i++) {
-    out += hex[(data[i] >> 4) & 0x0F];
-    out += hex[data[i] & 0x0F];
+// X-Key-Version: "" = chave atual (0), senão 1..255
+static bool parseKeyVersion(const char* s, uint8_t& out) {
+  out = 0;
+  if (!s || !*s) return true;
+  unsigned v = 0;
+  for (const char* p = s; *p; p++) {
+    if (*p < '0' || *p > '9' || p - s >= 3) return false;
+    v = v * 10 + (unsigned)(*p - '0');
   }
-  return out;
+  if (v == 0 || v > 255) return false;
+  out = (uint8_t)v;
+  return true;
 }
 
-static bool hmacSha256HexBytes(const uint8_t* key, size_t keyLen,
-                              const uint8_t* msg, size_t msgLen,
-                              String& outHex) {
-  const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-  if (!info) return false;
+// X-SecureHttp decodificado na forma texto dos headers avulsos (o AAD v2 é o mesmo)
+struct PackedText {
+  char deviceId[SecurePackedMeta::kMaxDeviceIdLen + 1];
+  char timestamp[11];
+  char nonce[2 * SecurePackedMeta::kNonceBytes + 1];
+  char ivHex[2 * sizeof(SecurePackedMeta::iv) + 1];
+  char tagHex[2 * sizeof(SecurePackedMeta::tag) + 1];
+  char keyVersion[4];
+};
 
-  uint8_t mac[32];
-  int rc = mbedtls_md_hmac(info, key, keyLen, msg, msgLen, mac);
-  if (rc != 0) return false;
+static bool unpackView(const char* value, PackedText& t, SecureRequestView& view) {
+  SecurePackedMeta m;
+  if (!parseSecurePackedHeader(value, m)) return false;
 
-  outHex = toHexLocal(mac, sizeof(mac));
+  memcpy(t.deviceId, m.deviceId, sizeof(t.deviceId));
+  snprintf(t.timestamp, sizeof(t.timestamp), "%lu", (unsigned long)m.timestamp);
+  hexEncodeTo(m.nonce, sizeof(m.nonce), t.nonce, sizeof(t.nonce));
+  hexEncodeTo(m.iv, sizeof(m.iv), t.ivHex, sizeof(t.ivHex));
+  hexEncodeTo(m.tag, sizeof(m.tag), t.tagHex, sizeof(t.tagHex));
+  if (m.keyVersion) snprintf(t.keyVersion, sizeof(t.keyVersion), "%u", (unsigned)m.keyVersion);
+  else t.keyVersion[0] = '\0';
+
+  view.deviceId = t.deviceId;
+  view.timestamp = t.timestamp;
+  view.nonce = t.nonce;
+  view.ivHex = t.ivHex;
+  view.tagHex = t.tagHex;
+  view.signature = "";
+  view.keyVersion = t.keyVersion;
+  view.protocol = secureProtocolName(SecureProtocol::V2);
+  view.bodyEncoding = secureBodyEncodingName(m.encoding);
   return true;
 }
 
-static String canonicalToSign(const String& method,
-                              const String& path,
-                              const String& deviceId,
-                              const String& timestamp,
-                              const String& nonce,
-                              const String& ivHex,
-                              const String& tagHex,
-                              const String& ciphertextHex) {
-  // MUST match device:
-  // METHOD\nPATH\nDEVICE\nTS\nNONCE\nIV\nTAG\nCIPHERTEXT
-  String s;
-  s.reserve(64 + ciphertextHex.length());
-  s += method; s += "\n";
-  s += path; s += "\n";
-  s += deviceId; s += "\n";
-  s += timestamp; s += "\n";
-  s += nonce; s += "\n";
-  s += ivHex; s += "\n";
-  s += tagHex; s += "\n";
-  s += ciphertextHex;
-  return s;
+// Anexa a um buffer fixo; false se não couber
+static bool appendField(char* out, size_t cap, size_t& len, const char* s, char sep) {
+  const size_t n = strlen(s);
+  if (len + n + 1 >= cap) return false;
+  memcpy(out + len, s, n);
+  len += n;
+  if (sep) out[len++] = sep;
+  return true;
 }
 
 SecureAuthResult SecureGatewayAuth::verifyAndDecrypt(WebServer& server, const String& method, const String& path) {
-  SecureAuthResult r;
-
   const String deviceId  = server.header("X-Device-Id");
   const String tsStr     = server.header("X-Timestamp");
   const String nonce     = server.header("X-Nonce");
   const String ivHex     = server.header("X-IV");
   const String tagHex    = server.header("X-Tag");
   const String signature = server.header("X-Signature");
+  const String keyVersion = server.header(SECURE_KEY_VERSION_HEADER);
+  const String protocol  = server.header(SECURE_VERSION_HEADER);
+  const String packed    = server.header(SECURE_PACKED_HEADER);
+  const String encoding  = server.header(SECURE_BODY_ENCODING_HEADER);
+  const String session   = server.header(SECURE_SESSION_HEADER);
+  const String seq       = server.header(SECURE_SEQ_HEADER);
+  const String body      = server.arg("plain"); // body (hex / base64url)
 
-  if (deviceId.isEmpty() || tsStr.isEmpty() || nonce.isEmpty() || ivHex.isEmpty() ||
-      tagHex.isEmpty() || signature.isEmpty()) {
-    r.httpCode = 400;
-    r.error = "missing_headers";
+  // WebServer guarda o body como C string: bytes crus (com NUL) não sobrevivem
+  // (com X-SecureHttp o encoding vem no bloco compacto; inválido: o verificador responde bad_headers)
+  SecureBodyEncoding enc = SecureBodyEncoding::Hex;
+  bool encOk = true;
+  if (packed.length() > 0) {
+    SecurePackedMeta meta;
+    if (parseSecurePackedHeader(packed.c_str(), meta)) enc = meta.encoding;
+  } else {
+    encOk = parseSecureBodyEncoding(encoding.c_str(), enc);
+  }
+  if (!encOk || enc == SecureBodyEncoding::Raw) {
+    SecureAuthResult r;
+    r.httpCode = 415;
+    r.error = "unsupported_encoding";
     return r;
   }
 
-  if (String(SECURE_DEVICE_ID) != deviceId) {
-    r.httpCode = 401;
-    r.error = "unknown_device";
-    return r;
+  SecureRequestView req;
+  req.deviceId  = deviceId.c_str();
+  req.timestamp = tsStr.c_str();
+  req.nonce     = nonce.c_str();
+  req.ivHex     = ivHex.c_str();
+  req.tagHex    = tagHex.c_str();
+  req.signature = signature.c_str();
+  req.keyVersion = keyVersion.c_str();
+  req.protocol  = protocol.c_str();
+  req.packed    = packed.c_str();
+  req.bodyEncoding = encoding.c_str();
+  req.session   = session.c_str();
+  req.seq       = seq.c_str();
+  req.body      = body.c_str();
+  req.bodyLen   = body.length();
+
+  return verifyAndDecrypt(req, method, path);
+}
+
+SecureAuthResult SecureGatewayAuth::verifyAndDecrypt(const SecureRequestView& req, const String& method, const String& path) {
+  // Caminho com String (compatibilidade): buffer de trabalho na heap
+  SecureBodyEncoding enc = SecureBodyEncoding::Hex;
+  SecurePackedMeta meta;
+  if (req.packed && *req.packed && parseSecurePackedHeader(req.packed, meta)) enc = meta.encoding;
+  else parseSecureBodyEncoding(req.bodyEncoding, enc); // inválido: verifyAndDecryptInto() rejeita
+  // Acima do limite verifyAndDecryptInto() devolve 413 sem tocar no buffer
+  const size_t workLen = req.bodyLen > SECURE_MAX_BODY_BYTES ? 1 : workBytesFor(req.bodyLen, enc);
+  std::unique_ptr<uint8_t[]> work(new uint8_t[workLen]);
+  SecureAuthResult r = verifyAndDecryptInto(req, method.c_str(), path.c_str(), work.get(), workLen);
+  if (r.ok) r.plaintextJson = String(r.plaintext);
+  r.plaintext = nullptr;
+  r.plaintextLen = 0;
+  return r;
+}
+
+SecureAuthResult SecureGatewayAuth::verifyAndDecryptInto(const SecureRequestView& req, const char* method,
+                                                         const char* path, uint8_t* work, size_t workCap) {
+  // Body já em memória: o mesmo verificador incremental, alimentado de uma vez
+  SecureRequestView head = req;
+  if (!head.body) head.bodyLen = 0;
+
+  if (_buffered.begin(*this, head, method, path, work, workCap) && _buffered.update(head.body, head.bodyLen)) {
+    _buffered.finish();
   }
+  return _buffered.result();
+}
 
-  const uint32_t ts = (uint32_t)tsStr.toInt();
-  const uint32_t now = nowSec();
-  if (ts == 0) {
-    r.httpCode = 401;
-    r.error = "bad_timestamp";
-    return r;
+// ===== SecureStreamVerifier =====
+
+SecureStreamVerifier::~SecureStreamVerifier() {
+  abort();
+  memset(_gcmKey, 0, sizeof(_gcmKey));
+}
+
+size_t SecureStreamVerifier::plaintextBytesFor(size_t bodyLen, SecureBodyEncoding encoding) {
+  switch (encoding) {
+    case SecureBodyEncoding::Raw: return bodyLen + 1;
+    case SecureBodyEncoding::Base64Url: return (bodyLen / 4) * 3 + ((bodyLen % 4) ? (bodyLen % 4) - 1 : 0) + 1;
+    case SecureBodyEncoding::Hex:
+    default: return bodyLen / 2 + 1;
   }
+}
 
-  const uint32_t diff = (now > ts) ? (now - ts) : (ts - now);
-  if (diff > SECURE_TS_WINDOW_SEC) {
-    r.httpCode = 401;
-    r.error = "timestamp_out_of_window";
-    return r;
+void SecureStreamVerifier::lap(SecureAuthTiming::Stage s) {
+  // Fecha o trecho corrente e soma no estágio s
+  const uint32_t t = micros();
+  _r.timing.us[s] += t - _t0;
+  _r.timing.mask |= (uint8_t)(1u << s);
+  _t0 = t;
+}
+
+bool SecureStreamVerifier::fail(int httpCode, const char* error, SecureAuthTiming::Stage stage) {
+  lap(stage);
+  abort();
+  _r.ok = false;
+  _r.httpCode = httpCode;
+  _r.error = error;
+  _r.plaintext = nullptr;
+  _r.plaintextLen = 0;
+  return false;
+}
+
+void SecureStreamVerifier::abort() {
+  // Texto claro de request não autenticado não fica no buffer
+  if (_out && _outLen > 0) memset(_out, 0, _outLen);
+  memset(_block, 0, sizeof(_block));
+  _out = nullptr;
+  _outLen = 0;
+  _auth = nullptr;
+}
+
+bool SecureStreamVerifier::useKey(const uint8_t* key) {
+  // Mesma chave da request anterior (envelope, ou a mesma sessão): sem re-expandir
+  if (_gcm.ready() && constantTimeEqualsBytes(_gcmKey, key, sizeof(_gcmKey))) return true;
+  memcpy(_gcmKey, key, sizeof(_gcmKey));
+  return _gcm.setKey(key, sizeof(_gcmKey));
+}
+
+bool SecureStreamVerifier::begin(SecureGatewayAuth& auth, const SecureRequestView& req, const char* method,
+                                 const char* path, uint8_t* out, size_t outCap) {
+  abort();
+  _r = SecureAuthResult();
+  _t0 = micros();
+  auth.ensureKeys();
+
+  if (!method) method = "";
+  if (!path) path = "";
+
+  _received = 0;
+  _decoded = 0;
+  _carryLen = 0;
+  _blockLen = 0;
+  _seq = 0;
+  _nonceLen = 0;
+  _session = req.session && *req.session;
+  _hmac = false;
+  _r.session = _session;
+  _auth = &auth;
+
+  // X-SecureHttp: campos compactos convertidos uma vez para a forma texto (só durante o begin)
+  SecureRequestView view = req;
+  PackedText packed;
+  if (!_session && req.packed && *req.packed && !unpackView(req.packed, packed, view)) {
+    return fail(400, "bad_headers", SecureAuthTiming::Headers);
   }
 
-  if (_nonceCache.seenRecently(now, nonce)) {
-    r.httpCode = 401;
-    r.error = "replay_nonce";
-    return r;
+  const bool headersOk = _session ? beginSession(view, method, path) : beginEnvelope(view, method, path);
+  if (!headersOk) return false;
+
+  // Body: tamanho declarado checado antes de ler qualquer byte
+  _bodyLen = req.bodyLen;
+  const size_t tail = _session ? CryptoBackend::kAeadTagBytes : 0;
+  const size_t decodedLen = plaintextBytesFor(_bodyLen, _enc) - 1;
+  const bool shapeOk = (_enc != SecureBodyEncoding::Hex || (_bodyLen % 2) == 0) &&
+                       (_enc != SecureBodyEncoding::Base64Url || (_bodyLen % 4) != 1);
+  if (_bodyLen == 0 || !shapeOk || decodedLen <= tail) {
+    return fail(400, "bad_body", SecureAuthTiming::BodyDecode);
   }
 
-  const String bodyCipherHex = server.arg("plain"); // body raw (hex)
-  if (bodyCipherHex.isEmpty() || !isHexStringEven(bodyCipherHex)) {
-    r.httpCode = 400;
-    r.error = "bad_body";
-    return r;
+  if (_bodyLen > SECURE_MAX_BODY_BYTES || !out || outCap < plaintextBytesFor(_bodyLen, _enc)) {
+    return fail(413, "body_too_large", SecureAuthTiming::BodyDecode);
   }
 
-  // HMAC verify (same canonical as device)
-  const String canonical = canonicalToSign(method, path, deviceId, tsStr, nonce, ivHex, tagHex, bodyCipherHex);
+  _cipherLen = decodedLen - tail;
+  _out = out;
+  _outLen = 0;
+  lap(SecureAuthTiming::Decrypt);
+  return true;
+}
+
+bool SecureStreamVerifier::beginEnvelope(const SecureRequestView& req, const char* method, const char* path) {
+  const char* deviceId  = req.deviceId ? req.deviceId : "";
+  const char* tsStr     = req.timestamp ? req.timestamp : "";
+  const char* nonce     = req.nonce ? req.nonce : "";
+  const char* ivHex     = req.ivHex ? req.ivHex : "";
+  const char* tagHex    = req.tagHex ? req.tagHex : "";
+  const char* signature = req.signature ? req.signature : "";
 
-  String expected;
-  if (!hmacSha256HexBytes(SECUREHTTP_HMAC_KEY, SECUREHTTP_HMAC_KEY_LEN,
-                          (const uint8_t*)canonical.c_str(), canonical.length(),
-                          expected)) {
-    r.httpCode = 401;
-    r.error = "hmac_failed";
-    return r;
+  // v2 não tem X-Signature: a tag GCM autentica os campos (AAD)
+  SecureProtocol protocol = SecureProtocol::V1;
+  const bool protocolOk = parseSecureProtocol(req.protocol, protocol);
+  _hmac = protocol == SecureProtocol::V1;
+  _r.protocol = protocol;
+
+  const bool missing = !*deviceId || !*tsStr || !*nonce || !*ivHex || !*tagHex || (_hmac && !*signature);
+  const bool allowed = !missing && _auth->_keys.find(deviceId) != nullptr;
+  const bool encOk = parseSecureBodyEncoding(req.bodyEncoding, _enc);
+  lap(SecureAuthTiming::Headers);
+
+  if (!protocolOk) return fail(400, "unsupported_protocol", SecureAuthTiming::Headers);
+  if (missing) return fail(400, "missing_headers", SecureAuthTiming::Headers);
+  if (!encOk) return fail(415, "unsupported_encoding", SecureAuthTiming::Headers);
+  if (!allowed) return fail(401, "unknown_device", SecureAuthTiming::Headers);
+
+  // Chave pedida pelo device: atual, ou a anterior dentro da janela de rotação
+  uint8_t version = 0;
+  _now = SecureGatewayAuth::nowSec();
+  const SecureKeyStore::Key* key =
+      parseKeyVersion(req.keyVersion, version) ? _auth->_keys.key(deviceId, version, _now) : nullptr;
+  if (!key) return fail(401, "unknown_key", SecureAuthTiming::Headers);
+  _r.keyVersion = key->version;
+
+  const uint32_t ts = (uint32_t)strtoul(tsStr, nullptr, 10);
+  if (ts == 0) return fail(401, "bad_timestamp", SecureAuthTiming::Replay);
+
+  const uint32_t diff = (_now > ts) ? (_now - ts) : (ts - _now);
+  if (diff > SECURE_TS_WINDOW_SEC) return fail(401, "timestamp_out_of_window", SecureAuthTiming::Replay);
+
+  _nonceLen = strlen(nonce);
+  if (_nonceLen > SECURE_NONCE_MAX_LEN) return fail(400, "bad_nonce", SecureAuthTiming::Replay);
+
+  NonceCache& cache = _auth->_nonceCache;
+  if (cache.seenRecently(_now, nonce, _nonceLen)) return fail(401, "replay_nonce", SecureAuthTiming::Replay);
+
+  // Sem espaço para lembrar o nonce o request poderia ser repetido: recusa
+  if (!cache.hasRoom(_now)) return fail(503, "replay_cache_full", SecureAuthTiming::Replay);
+  lap(SecureAuthTiming::Replay);
+
+  memcpy(_nonce, nonce, _nonceLen + 1);
+  strcpy(_r.deviceId, deviceId); // SecureKeyStore::find() já limitou o tamanho
+
+  if (_hmac && !hexDecodeSpan(signature, strlen(signature), _signature, sizeof(_signature))) {
+    return fail(401, "bad_signature", SecureAuthTiming::Hmac);
   }
 
-  if (expected.isEmpty() || !constantTimeEquals(expected, signature)) {
-    r.httpCode = 401;
-    r.error = "bad_signature";
-    return r;
+  uint8_t iv[CryptoBackend::kAeadIvBytes];
+  if (!hexDecodeSpan(ivHex, strlen(ivHex), iv, sizeof(iv)) ||
+      !hexDecodeSpan(tagHex, strlen(tagHex), _tag, sizeof(_tag))) {
+    return fail(400, "bad_iv_or_tag", SecureAuthTiming::BodyDecode);
   }
 
-  uint8_t iv[12];
-  uint8_t tag[16];
-  if (!hexDecodeFixed(ivHex, iv, sizeof(iv)) || !hexDecodeFixed(tagHex, tag, sizeof(tag))) {
-    r.httpCode = 400;
-    r.error = "bad_iv_or_tag";
-    return r;
+  char aad[192];
+  size_t aadLen = 0;
+  if (_hmac) {
+    // HMAC (mesmo canonical do device), campos agora e o body em update():
+    // METHOD\nPATH\nDEVICE\nTS\nNONCE\nIV\nTAG\nCIPHERTEXT (hex: texto; raw/base64url: bytes)
+    _mac.start(key->hmac);
+    const char* fields[] = {method, path, deviceId, tsStr, nonce, ivHex, tagHex};
+    for (const char* f : fields) {
+      _mac.update(f);
+      _mac.update("\n", 1);
+    }
+    lap(SecureAuthTiming::Hmac);
+
+    // AAD MUST match device: deviceId|ts|nonce|method|path
+    if (!appendField(aad, sizeof(aad), aadLen, deviceId, '|') ||
+        !appendField(aad, sizeof(aad), aadLen, tsStr, '|') ||
+        !appendField(aad, sizeof(aad), aadLen, nonce, '|') ||
+        !appendField(aad, sizeof(aad), aadLen, method, '|') ||
+        !appendField(aad, sizeof(aad), aadLen, path, 0)) {
+      return fail(400, "bad_headers", SecureAuthTiming::Decrypt);
+    }
+  } else {
+    // v2: versão da chave resolvida (não o texto do header) para o AAD ser canônico
+    aadLen = secureEnvelopeAadV2(aad, sizeof(aad), deviceId, tsStr, nonce, key->version, method, path);
+    if (aadLen == 0) return fail(400, "bad_headers", SecureAuthTiming::Decrypt);
   }
 
-  std::unique_ptr<uint8_t[]> cipher;
-  size_t cipherLen = 0;
-  if (!decodeHexToBuf(bodyCipherHex, cipher, cipherLen)) {
-    r.httpCode = 400;
-    r.error = "bad_cipher_hex";
-    return r;
+  if (!useKey(key->aes) || !_gcm.decryptStart(iv, sizeof(iv), (const uint8_t*)aad, aadLen)) {
+    return fail(401, "decrypt_failed", SecureAuthTiming::Decrypt);
   }
+  return true;
+}
 
-  // AAD MUST match device
-  String aadStr;
-  aadStr.reserve(64);
-  aadStr += deviceId; aadStr += "|";
-  aadStr += tsStr;    aadStr += "|";
-  aadStr += nonce;    aadStr += "|";
-  aadStr += method;   aadStr += "|";
-  aadStr += path;
-
-  // Decrypt AES-256-GCM WITH AAD
-  String plain = AesGcmCodec::decryptWithAad(
-      SECUREHTTP_AES256_KEY, sizeof(SECUREHTTP_AES256_KEY),
-      iv, sizeof(iv),
-      (const uint8_t*)aadStr.c_str(), aadStr.length(),
-      cipher.get(), cipherLen,
-      tag, sizeof(tag)
-  );
-
-  if (plain.isEmpty()) {
-    r.httpCode = 401;
-    r.error = "decrypt_failed";
-    return r;
+bool SecureStreamVerifier::beginSession(const SecureRequestView& req, const char* method, const char* path) {
+  const char* sidHex = req.session;
+  const char* seqStr = req.seq ? req.seq : "";
+  const bool encOk = parseSecureBodyEncoding(req.bodyEncoding, _enc);
+
+  // Sequência: só dígitos, cabe em 64 bits, > 0
+  const size_t seqLen = strlen(seqStr);
+  bool seqOk = seqLen > 0 && seqLen <= 20;
+  for (size_t i = 0; seqOk && i < seqLen; i++) seqOk = seqStr[i] >= '0' && seqStr[i] <= '9';
+  _seq = seqOk ? (uint64_t)strtoull(seqStr, nullptr, 10) : 0;
+  seqOk = seqOk && _seq != 0 && _seq != UINT64_MAX; // UINT64_MAX: estouro do strtoull
+  lap(SecureAuthTiming::Headers);
+
+  if (seqLen == 0) return fail(400, "missing_headers", SecureAuthTiming::Headers);
+  if (!encOk) return fail(415, "unsupported_encoding", SecureAuthTiming::Headers);
+  if (!seqOk) return fail(400, "bad_seq", SecureAuthTiming::Headers);
+
+  const SecureSessionTable::Entry* s = _auth->_sessions.find(sidHex, millis());
+  if (!s) return fail(401, "unknown_session", SecureAuthTiming::Replay);
+
+  const SequenceWindow::Verdict verdict = s->window.check(_seq);
+  if (verdict == SequenceWindow::Verdict::TooOld) return fail(401, "seq_too_old", SecureAuthTiming::Replay);
+  if (verdict != SequenceWindow::Verdict::Ok) return fail(401, "replay_seq", SecureAuthTiming::Replay);
+  lap(SecureAuthTiming::Replay);
+
+  memcpy(_sid, s->sidHex, sizeof(_sid));
+  strcpy(_r.deviceId, s->deviceId);
+
+  uint8_t iv[CryptoBackend::kAeadIvBytes];
+  s->iv(_seq, iv);
+
+  char aad[160];
+  const size_t aadLen = secureSessionAad(aad, sizeof(aad), s->sidHex, seqStr, method, path);
+  if (aadLen == 0) return fail(400, "bad_headers", SecureAuthTiming::Decrypt);
+
+  if (!useKey(s->key) || !_gcm.decryptStart(iv, sizeof(iv), (const uint8_t*)aad, aadLen)) {
+    return fail(401, "decrypt_failed", SecureAuthTiming::Decrypt);
   }
+  return true;
+}
 
-  _nonceCache.remember(now, nonce);
+void SecureStreamVerifier::decryptBlocks(const uint8_t* data, size_t len) {
+  // GCM recebe blocos inteiros; o resto espera em _block até completar 16
+  const size_t kBlock = CryptoBackend::kAeadBlockBytes;
+  if (_blockLen > 0) {
+    const size_t n = (len < kBlock - _blockLen) ? len : kBlock - _blockLen;
+    memcpy(_block + _blockLen, data, n);
+    _blockLen = (uint8_t)(_blockLen + n);
+    data += n;
+    len -= n;
+    if (_blockLen < kBlock) return;
 
-  r.ok = true;
-  r.httpCode = 200;
-  r.plaintextJson = plain;
-  return r;
-}
\ No newline at end of file
+    _gcm.decryptUpdate(_block, kBlock, _out + _outLen);
+    _outLen += kBlock;
+    _blockLen = 0;
+  }
+
+  const size_t whole = len - (len % kBlock);
+  if (whole > 0) {
+    _gcm.decryptUpdate(data, whole, _out + _outLen);
+    _outLen += whole;
+  }
+
+  memcpy(_block, data + whole, len - whole);
+  _blockLen = (uint8_t)(len - whole);
+}
+
+void SecureStreamVerifier::feedDecoded(const uint8_t* data, size_t len) {
+  lap(SecureAuthTiming::BodyDecode);
+
+  // raw/base64url: o HMAC cobre os bytes do ciphertext
+  if (_hmac && _enc != SecureBodyEncoding::Hex) {
+    _mac.update(data, len);
+    lap(SecureAuthTiming::Hmac);
+  }
+
+  // Sessão: os últimos 16 bytes são a tag
+  const size_t room = (_decoded < _cipherLen) ? _cipherLen - _decoded : 0;
+  const size_t cipher = (len < room) ? len : room;
+  if (cipher > 0) decryptBlocks(data, cipher);
+  for (size_t i = cipher; i < len; i++) {
+    const size_t t = _decoded + i - _cipherLen;
+    if (t < sizeof(_tag)) _tag[t] = data[i];
+  }
+  _decoded += len;
+  lap(SecureAuthTiming::Decrypt);
+}
+
+bool SecureStreamVerifier::decodeChunk(const char* data, size_t len, bool last) {
+  // Decodifica em pedaços na pilha; grupo incompleto (1 char hex, até 3 base64url) fica em _carry
+  const size_t group = (_enc == SecureBodyEncoding::Hex) ? 2 : 4;
+  uint8_t tmp[48];
+  size_t n = 0;
+
+  auto decode = [this](const char* in, size_t inLen, uint8_t* o, size_t& oLen) {
+    if (_enc == SecureBodyEncoding::Hex) {
+      oLen = inLen / 2;
+      return hexDecodeSpan(in, inLen, o, oLen);
+    }
+    return base64UrlDecodeSpan(in, inLen, o, 36, oLen);
+  };
+
+  if (_carryLen > 0) {
+    while (_carryLen < group && len > 0) {
+      _carry[_carryLen++] = *data++;
+      len--;
+    }
+    if (_carryLen == group) {
+      if (!decode(_carry, group, tmp, n)) return false;
+      feedDecoded(tmp, n);
+      _carryLen = 0;
+    }
+  }
+
+  const size_t perRound = (_enc == SecureBodyEncoding::Hex) ? 2 * sizeof(tmp) : 48; // 48 chars -> 36 bytes
+  while (len >= group) {
+    size_t take = len - (len % group);
+    if (take > perRound) take = perRound;
+    if (!decode(data, take, tmp, n)) return false;
+    feedDecoded(tmp, n);
+    data += take;
+    len -= take;
+  }
+
+  while (len > 0) {
+    _carry[_carryLen++] = *data++;
+    len--;
+  }
+
+  if (last && _carryLen > 0) {
+    // Só base64url termina em grupo parcial (2 ou 3 chars)
+    if (_enc == SecureBodyEncoding::Hex || !decode(_carry, _carryLen, tmp, n)) return false;
+    feedDecoded(tmp, n);
+    _carryLen = 0;
+  }
+  return true;
+}
+
+bool SecureStreamVerifier::update(const void* data, size_t len) {
+  if (!_auth) return false;
+  if (len == 0) return true;
+  _t0 = micros();
+
+  if (!data || len > _bodyLen - _received) return fail(400, "bad_body", SecureAuthTiming::BodyDecode);
+  _received += len;
+  const bool last = (_received == _bodyLen);
+
+  if (_enc == SecureBodyEncoding::Raw) {
+    feedDecoded((const uint8_t*)data, len);
+    return true;
+  }
+
+  // hex: o HMAC cobre o texto do body
+  if (_hmac && _enc == SecureBodyEncoding::Hex) {
+    _mac.update(data, len);
+    lap(SecureAuthTiming::Hmac);
+  }
+
+  if (!decodeChunk((const char*)data, len, last)) return fail(400, "bad_body", SecureAuthTiming::BodyDecode);
+  lap(SecureAuthTiming::BodyDecode);
+  return true;
+}
+
+const SecureAuthResult& SecureStreamVerifier::finish() {
+  if (!_auth) return _r;
+  _t0 = micros();
+
+  if (_received != _bodyLen || _carryLen != 0) {
+    fail(400, "bad_body", SecureAuthTiming::BodyDecode);
+    return _r;
+  }
+
+  if (_hmac) {
+    uint8_t expected[HmacSha256::kDigestSize];
+    _mac.finish(expected);
+    const bool sigOk = constantTimeEqualsBytes(expected, _signature, sizeof(expected));
+    if (!sigOk) {
+      fail(401, "bad_signature", SecureAuthTiming::Hmac);
+      return _r;
+    }
+    lap(SecureAuthTiming::Hmac);
+  }
+
+  if (_blockLen > 0) {
+    _gcm.decryptUpdate(_block, _blockLen, _out + _outLen);
+    _outLen += _blockLen;
+    _blockLen = 0;
+  }
+  if (!_gcm.decryptFinish(_tag, sizeof(_tag))) {
+    fail(401, "decrypt_failed", SecureAuthTiming::Decrypt);
+    return _r;
+  }
+  lap(SecureAuthTiming::Decrypt);
+
+  // Anti-replay só com request autenticado (e de novo: outro stream pode ter usado o mesmo nonce/seq)
+  if (_session) {
+    SecureSessionTable::Entry* s = _auth->_sessions.find(_sid, millis());
+    if (!s) {
+      fail(401, "unknown_session", SecureAuthTiming::Replay);
+      return _r;
+    }
+    const SequenceWindow::Verdict verdict = s->window.check(_seq);
+    if (verdict != SequenceWindow::Verdict::Ok) {
+      fail(401, verdict == SequenceWindow::Verdict::TooOld ? "seq_too_old" : "replay_seq", SecureAuthTiming::Replay);
+      return _r;
+    }
+    s->window.accept(_seq);
+    s->lastUsedMs = millis();
+  } else {
+    NonceCache& cache = _auth->_nonceCache;
+    if (cache.seenRecently(_now, _nonce, _nonceLen)) {
+      fail(401, "replay_nonce", SecureAuthTiming::Replay);
+      return _r;
+    }
+    if (!cache.remember(_now, _nonce, _nonceLen)) {
+      fail(503, "replay_cache_full", SecureAuthTiming::Replay);
+      return _r;
+    }
+  }
+  lap(SecureAuthTiming::Replay);
+
+  _out[_outLen] = 0;
+  _r.ok = true;
+  _r.httpCode = 200;
+  _r.plaintext = (const char*)_out;
+  _r.plaintextLen = _outLen;
+
+  // Span entregue: o verificador solta o buffer sem apagá-lo
+  _out = nullptr;
+  _outLen = 0;
+  _auth = nullptr;
+  return _r;
+}
+
+SecureSessionGrant SecureGatewayAuth::openSession(const SecureAuthResult& auth, const char* plaintext,
+                                                  size_t plaintextLen) {
+  SecureSessionGrant g;
+  if (!auth.ok || !auth.deviceId[0] || !plaintext) {
+    g.httpCode = 401;
+    g.error = "unauthorized";
+    return g;
+  }
+
+  // {"cr":"<32 hex>"}
+  static const char key[] = "\"cr\":\"";
+  const char* p = strstr(plaintext, key);
+  uint8_t cr[SecureSessionKeys::kRandomBytes];
+  const size_t crHexLen = 2 * sizeof(cr);
+  if (!p || (size_t)(p - plaintext) + sizeof(key) - 1 + crHexLen >= plaintextLen ||
+      p[sizeof(key) - 1 + crHexLen] != '"' ||
+      !hexDecodeSpan(p + sizeof(key) - 1, crHexLen, cr, sizeof(cr))) {
+    g.error = "bad_session_request";
+    return g;
+  }
+
+  // Sessão herda o segredo da chave que autenticou o handshake
+  ensureKeys();
+  const SecureKeyStore::Key* deviceKey = _keys.key(auth.deviceId, auth.keyVersion, nowSec());
+  if (!deviceKey) {
+    g.httpCode = 401;
+    g.error = "unknown_key";
+    return g;
+  }
+
+  uint8_t sr[SecureSessionKeys::kRandomBytes];
+  const SecureSessionTable::Entry* s = _sessions.open(auth.deviceId, deviceKey->hmacSecret, deviceKey->hmacLen, cr, millis(), sr);
+  if (!s) {
+    g.httpCode = 503;
+    g.error = "session_failed";
+    return g;
+  }
+
+  char crHex[2 * sizeof(cr) + 1];
+  memcpy(crHex, p + sizeof(key) - 1, crHexLen);
+  crHex[crHexLen] = '\0';
+  for (char* c = crHex; *c; c++) {
+    if (*c >= 'A' && *c <= 'F') *c = (char)(*c - 'A' + 'a'); // prova usa hex minúsculo
+  }
+
+  memcpy(g.sid, s->sidHex, sizeof(g.sid));
+  const String srHex = hexEncode(sr, sizeof(sr));
+  memcpy(g.sr, srHex.c_str(), sizeof(g.sr));
+  g.ttlSec = _sessions.ttlSec();
+  g.mac = secureSessionProofHex(deviceKey->hmacSecret, deviceKey->hmacLen, auth.deviceId, g.sid, crHex, g.sr, g.ttlSec);
+  g.ok = true;
+  g.httpCode = 200;
+  return g;
+}
@@ -0,0 +1,135 @@
+#include "SecureHttpBench.h"
+
+#include <memory>
+#include <string.h>
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+// Chaves fixas: o benchmark mede custo, não segurança
+static const uint8_t kBenchAesKey[32] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+};
+static const uint8_t kBenchHmacKey[32] = {
+  0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a,
+  0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5
+};
+
+static const uint16_t kSizes[] = {64, 256, 1024};
+static const size_t kSizeCount = sizeof(kSizes) / sizeof(kSizes[0]);
+
+static uint32_t benchMicros() {
+#ifdef ARDUINO
+  return (uint32_t) micros();
+#else
+  using namespace std::chrono;
+  return (uint32_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static uint32_t perMessageNs(uint32_t startUs, uint16_t iterations) {
+  const uint32_t elapsedUs = benchMicros() - startUs;
+  return (uint32_t)(((uint64_t) elapsedUs * 1000u) / iterations);
+}
+
+size_t secureHttpCryptoBench(const CryptoBackend& backend, SecureHttpBenchRow* rows, size_t cap,
+                             uint16_t iterations) {
+  if (!rows || iterations == 0) return 0;
+
+  const size_t maxLen = kSizes[kSizeCount - 1];
+  std::unique_ptr<uint8_t[]> pt(new uint8_t[maxLen]);
+  std::unique_ptr<uint8_t[]> ct(new uint8_t[maxLen]);
+  for (size_t i = 0; i < maxLen; i++) pt.get()[i] = (uint8_t)(i * 31u);
+
+  uint8_t iv[CryptoBackend::kAeadIvBytes] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  uint8_t tag[CryptoBackend::kAeadTagBytes];
+  uint8_t mac[CryptoBackend::kSha256Bytes];
+  static const char aad[] = "vehicle-device-01|1760000000|0011223344556677|POST|/telemetry";
+  const size_t aadLen = sizeof(aad) - 1;
+
+  std::unique_ptr<CryptoBackend::AeadKey> gcm(backend.newAeadKey(kBenchAesKey, sizeof(kBenchAesKey)));
+  if (!gcm) return 0;
+
+  CryptoBackend::HashState inner, outer;
+  backend.hmacSha256Pads(kBenchHmacKey, sizeof(kBenchHmacKey), inner, outer);
+
+  size_t n = 0;
+  for (size_t s = 0; s < kSizeCount && n < cap; s++) {
+    const size_t len = kSizes[s];
+    SecureHttpBenchRow& row = rows[n++];
+    row.backend = backend.name();
+    row.payloadBytes = (uint16_t) len;
+
+    uint32_t t0 = benchMicros();
+    for (uint16_t i = 0; i < iterations; i++) {
+      std::unique_ptr<CryptoBackend::AeadKey> k(backend.newAeadKey(kBenchAesKey, sizeof(kBenchAesKey)));
+      if (k) k->seal(iv, (const uint8_t*) aad, aadLen, pt.get(), len, ct.get(), tag);
+    }
+    row.gcmOneShotNs = perMessageNs(t0, iterations);
+
+    t0 = benchMicros();
+    for (uint16_t i = 0; i < iterations; i++) gcm->seal(iv, (const uint8_t*) aad, aadLen, pt.get(), len, ct.get(), tag);
+    row.gcmPersistentNs = perMessageNs(t0, iterations);
+
+    t0 = benchMicros();
+    for (uint16_t i = 0; i < iterations; i++) backend.hmacSha256(kBenchHmacKey, sizeof(kBenchHmacKey), ct.get(), len, mac);
+    row.hmacOneShotNs = perMessageNs(t0, iterations);
+
+    // Mesmo caminho de HmacSha256(const HmacSha256Key&)
+    t0 = benchMicros();
+    for (uint16_t i = 0; i < iterations; i++) {
+      CryptoBackend::HashState mi, mo;
+      uint8_t innerHash[CryptoBackend::kSha256Bytes];
+      backend.sha256Copy(mi, inner);
+      backend.sha256Copy(mo, outer);
+      backend.sha256Update(mi, ct.get(), len);
+      backend.sha256Finish(mi, innerHash);
+      backend.sha256Update(mo, innerHash, sizeof(innerHash));
+      backend.sha256Finish(mo, mac);
+      backend.sha256Release(mi);
+      backend.sha256Release(mo);
+    }
+    row.hmacPersistentNs = perMessageNs(t0, iterations);
+  }
+
+  backend.sha256Release(inner);
+  backend.sha256Release(outer);
+  return n;
+}
+
+size_t secureHttpCryptoBenchAll(SecureHttpBenchRow* rows, size_t cap, uint16_t iterations) {
+  const CryptoBackend* backends[4];
+  const size_t count = cryptoBackends(backends, 4);
+
+  size_t n = 0;
+  for (size_t b = 0; b < count && n < cap; b++) {
+    if (!cryptoBackendSelfTest(*backends[b])) continue;
+    n += secureHttpCryptoBench(*backends[b], rows + n, cap - n, iterations);
+  }
+  return n;
+}
+
+#ifdef ARDUINO
+void secureHttpCryptoBenchPrint(Print& out, uint16_t iterations) {
+  const CryptoBackend* backends[4];
+  const size_t count = cryptoBackends(backends, 4);
+  for (size_t b = 0; b < count; b++) {
+    out.printf("[SecureHttpBench] backend %s self-test %s\n",
+               backends[b]->name(), cryptoBackendSelfTest(*backends[b]) ? "ok" : "FAILED");
+  }
+
+  SecureHttpBenchRow rows[4 * kSizeCount];
+  const size_t n = secureHttpCryptoBenchAll(rows, sizeof(rows) / sizeof(rows[0]), iterations);
+
+  out.printf("[SecureHttpBench] %u msgs/size, us per message (one-shot -> persistent)\n", (unsigned) iterations);
+  for (size_t i = 0; i < n; i++) {
+    const SecureHttpBenchRow& r = rows[i];
+    out.printf("[SecureHttpBench] %-8s %4u B  gcm %7.1f -> %7.1f  hmac %7.1f -> %7.1f\n",
+               r.backend, (unsigned) r.payloadBytes,
+               r.gcmOneShotNs / 1000.0, r.gcmPersistentNs / 1000.0,
+               r.hmacOneShotNs / 1000.0, r.hmacPersistentNs / 1000.0);
+  }
+}
+#endif
@@ -0,0 +1,321 @@
+#include "SecureKeyStore.h"
+
+#include "SecureHttpConfig.h"
+
+#include <Preferences.h>
+#include <stdio.h>
+#include <string.h>
+
+constexpr size_t SecureKeyStore::kMaxIdLen;
+constexpr size_t SecureKeyStore::kMaxHmacBytes;
+constexpr uint8_t SecureKeyStore::kNone;
+
+namespace {
+
+// Layout gravado no NVS (1 blob por device)
+const uint8_t kRecordFormat = 1;
+
+struct StoredKey {
+  uint8_t version;
+  uint8_t hmacLen;
+  uint8_t aes[CryptoBackend::kAeadKeyBytes];
+  uint8_t hmac[SecureKeyStore::kMaxHmacBytes];
+};
+
+struct Record {
+  uint8_t format;
+  char id[SecureKeyStore::kMaxIdLen + 1];
+  StoredKey current;
+  StoredKey previous;
+  uint32_t previousUntil;
+};
+
+void wipeBytes(void* p, size_t n) {
+  volatile uint8_t* b = (volatile uint8_t*)p;
+  while (n--) *b++ = 0;
+}
+
+void rowKey(uint8_t row, char* out, size_t cap) {
+  snprintf(out, cap, "k%u", (unsigned)row);
+}
+
+void store(const SecureKeyStore::Key& k, StoredKey& out) {
+  out.version = k.version;
+  out.hmacLen = k.hmacLen;
+  memcpy(out.aes, k.aes, sizeof(out.aes));
+  memcpy(out.hmac, k.hmacSecret, sizeof(out.hmac));
+}
+
+} // namespace
+
+SecureKeyStore::SecureKeyStore(size_t capacity, const char* nvsNamespace) : _ns(nvsNamespace) {
+  if (capacity == 0) capacity = 1;
+  if (capacity >= kNone) capacity = kNone - 1;
+  _capacity = (uint8_t)capacity;
+
+  // potência de 2 >= 2 * capacidade (carga <= 50%)
+  _indexSize = 2;
+  while (_indexSize < 2 * _capacity) _indexSize = (uint16_t)(_indexSize << 1);
+
+  _rows = new Entry[_capacity];
+  _index = new uint8_t[_indexSize];
+  memset(_index, kNone, _indexSize);
+}
+
+SecureKeyStore::~SecureKeyStore() {
+  for (uint8_t r = 0; r < _count; r++) {
+    clearKey(_rows[r].current);
+    clearKey(_rows[r].previous);
+  }
+  delete[] _rows;
+  delete[] _index;
+}
+
+uint32_t SecureKeyStore::hashId(const char* id, size_t len) {
+  // FNV-1a 32 bits (mesmo hash da DeviceTable do gateway)
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)id[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+bool SecureKeyStore::setKey(Key& k, uint8_t version, const uint8_t* aes, const uint8_t* hmacSecret, size_t hmacLen) {
+  if (version == 0 || !aes || !hmacSecret || hmacLen == 0 || hmacLen > kMaxHmacBytes) return false;
+
+  clearKey(k);
+  k.version = version;
+  memcpy(k.aes, aes, sizeof(k.aes));
+  memcpy(k.hmacSecret, hmacSecret, hmacLen);
+  k.hmacLen = (uint8_t)hmacLen;
+  k.hmac.set(hmacSecret, hmacLen);
+  return true;
+}
+
+void SecureKeyStore::clearKey(Key& k) {
+  k.version = 0;
+  wipeBytes(k.aes, sizeof(k.aes));
+  wipeBytes(k.hmacSecret, sizeof(k.hmacSecret));
+  k.hmacLen = 0;
+  if (k.hmac.ready()) {
+    // Pads equivalem à chave: sobrescreve com os de uma chave nula
+    static const uint8_t zero = 0;
+    k.hmac.set(&zero, 1);
+  }
+}
+
+uint16_t SecureKeyStore::probe(uint32_t hash, const char* id, size_t len) const {
+  uint16_t slot = (uint16_t)(hash & (_indexSize - 1));
+  for (;;) {
+    const uint8_t row = _index[slot];
+    if (row == kNone) return slot;
+    const Entry& e = _rows[row];
+    if (e.hash == hash && e.idLen == len && memcmp(e.id, id, len) == 0) return slot;
+    slot = (uint16_t)((slot + 1) & (_indexSize - 1));
+  }
+}
+
+void SecureKeyStore::rebuildIndex() {
+  memset(_index, kNone, _indexSize);
+  for (uint8_t r = 0; r < _count; r++) {
+    _index[probe(_rows[r].hash, _rows[r].id, _rows[r].idLen)] = r;
+  }
+}
+
+uint8_t SecureKeyStore::insertRow(const char* id, size_t len) {
+  const uint32_t h = hashId(id, len);
+  const uint16_t slot = probe(h, id, len);
+  if (_index[slot] != kNone) return _index[slot];
+  if (_count >= _capacity) return kNone;
+
+  const uint8_t row = _count++;
+  Entry& e = _rows[row];
+  memcpy(e.id, id, len);
+  e.id[len] = '\0';
+  e.idLen = (uint8_t)len;
+  e.hash = h;
+  e.previousUntil = 0;
+  _index[slot] = row;
+  return row;
+}
+
+const SecureKeyStore::Entry* SecureKeyStore::find(const char* deviceId) const {
+  if (!deviceId) return nullptr;
+  const size_t len = strlen(deviceId);
+  if (len == 0 || len > kMaxIdLen) return nullptr;
+
+  const uint8_t row = _index[probe(hashId(deviceId, len), deviceId, len)];
+  return row == kNone ? nullptr : &_rows[row];
+}
+
+const SecureKeyStore::Key* SecureKeyStore::key(const char* deviceId, uint8_t version, uint32_t nowSec) const {
+  const Entry* e = find(deviceId);
+  if (!e) return nullptr;
+
+  if (version == 0 || version == e->current.version) return e->current.valid() ? &e->current : nullptr;
+
+  // Chave anterior só dentro da janela de rotação
+  if (version == e->previous.version && e->previous.valid() && nowSec < e->previousUntil) return &e->previous;
+  return nullptr;
+}
+
+bool SecureKeyStore::put(const char* deviceId, uint8_t version, const uint8_t* aes,
+                         const uint8_t* hmacSecret, size_t hmacLen) {
+  const size_t len = deviceId ? strlen(deviceId) : 0;
+  if (len == 0 || len > kMaxIdLen) return false;
+  if (version == 0 || !aes || !hmacSecret || hmacLen == 0 || hmacLen > kMaxHmacBytes) return false;
+
+  const uint8_t row = insertRow(deviceId, len);
+  if (row == kNone) return false;
+
+  Entry& e = _rows[row];
+  setKey(e.current, version, aes, hmacSecret, hmacLen);
+  clearKey(e.previous);
+  e.previousUntil = 0;
+  return persist(row);
+}
+
+bool SecureKeyStore::rotate(const char* deviceId, uint8_t version, const uint8_t* aes,
+                            const uint8_t* hmacSecret, size_t hmacLen, uint32_t graceSec, uint32_t nowSec) {
+  const Entry* found = find(deviceId);
+  if (!found || version == 0 || version == found->current.version) return false;
+  if (!aes || !hmacSecret || hmacLen == 0 || hmacLen > kMaxHmacBytes) return false;
+
+  // Atual vira anterior (aceita por graceSec); pads re-preparados uma vez aqui
+  Entry& e = _rows[found - _rows];
+  setKey(e.previous, e.current.version, e.current.aes, e.current.hmacSecret, e.current.hmacLen);
+  e.previousUntil = nowSec + graceSec;
+  setKey(e.current, version, aes, hmacSecret, hmacLen);
+  return persist((uint8_t)(found - _rows));
+}
+
+bool SecureKeyStore::remove(const char* deviceId) {
+  const Entry* found = find(deviceId);
+  if (!found) return false;
+
+  // Rows contíguas: a última ocupa o lugar da removida
+  const uint8_t row = (uint8_t)(found - _rows);
+  const uint8_t last = (uint8_t)(_count - 1);
+  Entry& e = _rows[row];
+  if (row != last) {
+    const Entry& l = _rows[last];
+    memcpy(e.id, l.id, sizeof(e.id));
+    e.idLen = l.idLen;
+    e.hash = l.hash;
+    setKey(e.current, l.current.version, l.current.aes, l.current.hmacSecret, l.current.hmacLen);
+    if (!setKey(e.previous, l.previous.version, l.previous.aes, l.previous.hmacSecret, l.previous.hmacLen)) {
+      clearKey(e.previous);
+    }
+    e.previousUntil = l.previousUntil;
+  }
+
+  Entry& gone = _rows[last];
+  clearKey(gone.current);
+  clearKey(gone.previous);
+  gone.id[0] = '\0';
+  gone.idLen = 0;
+  _count--;
+  rebuildIndex();
+
+  if (_ns) {
+    Preferences prefs;
+    if (prefs.begin(_ns, false)) {
+      char k[8];
+      rowKey(last, k, sizeof(k));
+      prefs.remove(k);
+      prefs.end();
+    }
+  }
+  if (row != last) persist(row);
+  persistCount();
+  return true;
+}
+
+bool SecureKeyStore::persist(uint8_t row) {
+  persistCount();
+  if (!_ns) return true;
+
+  const Entry& e = _rows[row];
+  Record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.format = kRecordFormat;
+  memcpy(rec.id, e.id, sizeof(rec.id));
+  store(e.current, rec.current);
+  store(e.previous, rec.previous);
+  rec.previousUntil = e.previousUntil;
+
+  Preferences prefs;
+  bool ok = prefs.begin(_ns, false);
+  if (ok) {
+    char k[8];
+    rowKey(row, k, sizeof(k));
+    ok = prefs.putBytes(k, &rec, sizeof(rec)) == sizeof(rec);
+    prefs.end();
+  }
+  wipeBytes(&rec, sizeof(rec));
+  return ok;
+}
+
+void SecureKeyStore::persistCount() {
+  if (!_ns) return;
+  Preferences prefs;
+  if (!prefs.begin(_ns, false)) return;
+  prefs.putBytes("n", &_count, sizeof(_count));
+  prefs.end();
+}
+
+bool SecureKeyStore::loadRow(uint8_t row) {
+  Preferences prefs;
+  if (!prefs.begin(_ns, true)) return false;
+
+  char k[8];
+  rowKey(row, k, sizeof(k));
+  Record rec;
+  const bool read = prefs.getBytesLength(k) == sizeof(rec) && prefs.getBytes(k, &rec, sizeof(rec)) == sizeof(rec);
+  prefs.end();
+
+  bool ok = read && rec.format == kRecordFormat;
+  if (ok) {
+    rec.id[kMaxIdLen] = '\0';
+    const size_t len = strlen(rec.id);
+    const uint8_t r = (len > 0) ? insertRow(rec.id, len) : kNone;
+    ok = r != kNone &&
+         setKey(_rows[r].current, rec.current.version, rec.current.aes, rec.current.hmac, rec.current.hmacLen);
+    if (ok && setKey(_rows[r].previous, rec.previous.version, rec.previous.aes, rec.previous.hmac,
+                     rec.previous.hmacLen)) {
+      _rows[r].previousUntil = rec.previousUntil;
+    }
+  }
+  wipeBytes(&rec, sizeof(rec));
+  return ok;
+}
+
+size_t SecureKeyStore::begin() {
+  if (_loaded) return _count;
+  _loaded = true;
+
+  uint8_t stored = 0;
+  if (_ns) {
+    Preferences prefs;
+    if (prefs.begin(_ns, true)) {
+      if (prefs.getBytesLength("n") == sizeof(stored)) prefs.getBytes("n", &stored, sizeof(stored));
+      prefs.end();
+    }
+  }
+
+  // Row ilegível é pulada (volta abaixo se estiver no SecureHttpConfig.h)
+  for (uint8_t r = 0; r < stored && r < _capacity; r++) loadRow(r);
+  if (_count != stored) {
+    for (uint8_t r = 0; r < _count; r++) persist(r);
+  }
+
+  // Devices do SecureHttpConfig.h ausentes do NVS (1º boot ou ID novo na lista):
+  // segredos compilados; quem já está no NVS mantém suas chaves (rotacionadas)
+  for (size_t i = 0; i < SECURE_ALLOWED_DEVICE_COUNT; i++) {
+    if (find(SECURE_ALLOWED_DEVICE_IDS[i])) continue;
+    put(SECURE_ALLOWED_DEVICE_IDS[i], SECURE_KEY_VERSION, SECUREHTTP_AES256_KEY,
+        SECUREHTTP_HMAC_KEY, SECUREHTTP_HMAC_KEY_LEN);
+  }
+  return _count;
+}
@@ -0,0 +1,108 @@
+#include "SecureProtocol.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char* secureProtocolName(SecureProtocol p) {
+  return p == SecureProtocol::V2 ? "2" : "1";
+}
+
+bool parseSecureProtocol(const char* value, SecureProtocol& out) {
+  if (!value || !*value || (value[0] == '1' && value[1] == '\0')) {
+    out = SecureProtocol::V1;
+    return true;
+  }
+  if (value[0] == '2' && value[1] == '\0') {
+    out = SecureProtocol::V2;
+    return true;
+  }
+  return false;
+}
+
+size_t secureEnvelopeAadV2(char* out, size_t cap, const char* deviceId, const char* timestamp,
+                           const char* nonce, uint8_t keyVersion, const char* method, const char* path) {
+  const int n = snprintf(out, cap, "securehttp-v2|%s|%s|%s|%u|%s|%s",
+                         deviceId, timestamp, nonce, (unsigned)keyVersion, method, path);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+// ===== X-SecureHttp (metadados compactos) =====
+
+constexpr uint8_t SecurePackedMeta::kFormat;
+constexpr size_t SecurePackedMeta::kNonceBytes;
+constexpr size_t SecurePackedMeta::kFixedBytes;
+constexpr size_t SecurePackedMeta::kMaxDeviceIdLen;
+constexpr size_t SecurePackedMeta::kMaxBytes;
+
+namespace {
+
+// Offsets fixos do layout (ver SecureProtocol.h)
+const size_t kOffKeyVersion = 1;
+const size_t kOffEncoding = 2;
+const size_t kOffTimestamp = 3;
+const size_t kOffNonce = 7;
+const size_t kOffIv = 15;
+const size_t kOffTag = 27;
+const size_t kOffIdLen = 43;
+
+static_assert(kOffIdLen + 1 == SecurePackedMeta::kFixedBytes, "SecurePackedMeta layout");
+static_assert(kOffIv + sizeof(SecurePackedMeta::iv) == kOffTag, "SecurePackedMeta layout");
+static_assert(kOffTag + sizeof(SecurePackedMeta::tag) == kOffIdLen, "SecurePackedMeta layout");
+
+} // namespace
+
+size_t SecurePackedMeta::pack(uint8_t* out, size_t cap) const {
+  const size_t total = kFixedBytes + deviceIdLen;
+  if (deviceIdLen == 0 || deviceIdLen > kMaxDeviceIdLen || !out || cap < total) return 0;
+
+  out[0] = kFormat;
+  out[kOffKeyVersion] = keyVersion;
+  out[kOffEncoding] = (uint8_t)encoding;
+  out[kOffTimestamp] = (uint8_t)(timestamp >> 24);
+  out[kOffTimestamp + 1] = (uint8_t)(timestamp >> 16);
+  out[kOffTimestamp + 2] = (uint8_t)(timestamp >> 8);
+  out[kOffTimestamp + 3] = (uint8_t)timestamp;
+  memcpy(out + kOffNonce, nonce, sizeof(nonce));
+  memcpy(out + kOffIv, iv, sizeof(iv));
+  memcpy(out + kOffTag, tag, sizeof(tag));
+  out[kOffIdLen] = deviceIdLen;
+  memcpy(out + kFixedBytes, deviceId, deviceIdLen);
+  return total;
+}
+
+bool SecurePackedMeta::unpack(const uint8_t* in, size_t len) {
+  if (!in || len < kFixedBytes || in[0] != kFormat) return false;
+  if (in[kOffEncoding] > (uint8_t)SecureBodyEncoding::Base64Url) return false;
+
+  const uint8_t idLen = in[kOffIdLen];
+  if (idLen == 0 || idLen > kMaxDeviceIdLen || len != kFixedBytes + idLen) return false;
+  for (size_t i = 0; i < idLen; i++) {
+    const uint8_t c = in[kFixedBytes + i];
+    if (c <= ' ' || c >= 0x7F) return false; // id vai para AAD/métricas como texto
+  }
+
+  keyVersion = in[kOffKeyVersion];
+  encoding = (SecureBodyEncoding)in[kOffEncoding];
+  timestamp = ((uint32_t)in[kOffTimestamp] << 24) | ((uint32_t)in[kOffTimestamp + 1] << 16) |
+              ((uint32_t)in[kOffTimestamp + 2] << 8) | (uint32_t)in[kOffTimestamp + 3];
+  memcpy(nonce, in + kOffNonce, sizeof(nonce));
+  memcpy(iv, in + kOffIv, sizeof(iv));
+  memcpy(tag, in + kOffTag, sizeof(tag));
+  memcpy(deviceId, in + kFixedBytes, idLen);
+  deviceId[idLen] = '\0';
+  deviceIdLen = idLen;
+  return true;
+}
+
+String securePackedHeaderValue(const SecurePackedMeta& meta) {
+  uint8_t buf[SecurePackedMeta::kMaxBytes];
+  const size_t n = meta.pack(buf, sizeof(buf));
+  return n > 0 ? base64UrlEncode(buf, n) : String();
+}
+
+bool parseSecurePackedHeader(const char* value, SecurePackedMeta& out) {
+  if (!value) return false;
+  uint8_t buf[SecurePackedMeta::kMaxBytes];
+  size_t n = 0;
+  return base64UrlDecodeSpan(value, strlen(value), buf, sizeof(buf), n) && out.unpack(buf, n);
+}
@@ -0,0 +1,378 @@
+#include "SecureSession.h"
+
+#include "SecureHttpConfig.h"
+#include "HexUtils.h"
+#include "CryptoUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+constexpr size_t SecureSessionKeys::kRandomBytes;
+constexpr size_t SecureSessionKeys::kSaltBytes;
+constexpr uint32_t SequenceWindow::kSize;
+constexpr uint32_t SecureSessionClient::kRenewMarginMs;
+
+static const char kInfoPrefix[] = "securehttp-session-v1|";
+static const char kProofPrefix[] = "securehttp-session-ok|";
+
+static void wipeBytes(void* p, size_t n) {
+  volatile uint8_t* b = (volatile uint8_t*)p;
+  while (n--) *b++ = 0;
+}
+
+static void writeSeqBe(uint64_t seq, uint8_t* out) {
+  for (int i = 7; i >= 0; i--) {
+    out[i] = (uint8_t)(seq & 0xFF);
+    seq >>= 8;
+  }
+}
+
+// ===== Chaves =====
+
+void SecureSessionKeys::derive(const uint8_t* secret, size_t secretLen,
+                               const char* deviceId, const char* sidHex,
+                               const uint8_t* cr, const uint8_t* sr,
+                               const CryptoBackend& backend) {
+  // HKDF-Extract: salt = cr || sr, IKM = segredo HMAC
+  uint8_t salt[2 * kRandomBytes];
+  memcpy(salt, cr, kRandomBytes);
+  memcpy(salt + kRandomBytes, sr, kRandomBytes);
+
+  uint8_t prk[HmacSha256::kDigestSize];
+  backend.hmacSha256(salt, sizeof(salt), secret, secretLen, prk);
+
+  // HKDF-Expand: 2 blocos (chave AES e salt do IV)
+  uint8_t t[HmacSha256::kDigestSize];
+  const uint8_t one = 0x01, two = 0x02;
+  {
+    HmacSha256 mac(prk, sizeof(prk), backend);
+    mac.update(kInfoPrefix);
+    mac.update(deviceId);
+    mac.update("|", 1);
+    mac.update(sidHex);
+    mac.update(&one, 1);
+    mac.finish(t);
+  }
+  memcpy(aesKey, t, sizeof(aesKey));
+  {
+    HmacSha256 mac(prk, sizeof(prk), backend);
+    mac.update(t, sizeof(t));
+    mac.update(kInfoPrefix);
+    mac.update(deviceId);
+    mac.update("|", 1);
+    mac.update(sidHex);
+    mac.update(&two, 1);
+    mac.finish(t);
+  }
+  memcpy(ivSalt, t, sizeof(ivSalt));
+
+  wipeBytes(salt, sizeof(salt));
+  wipeBytes(prk, sizeof(prk));
+  wipeBytes(t, sizeof(t));
+}
+
+void SecureSessionKeys::wipe() {
+  wipeBytes(aesKey, sizeof(aesKey));
+  wipeBytes(ivSalt, sizeof(ivSalt));
+}
+
+String secureSessionProofHex(const uint8_t* secret, size_t secretLen,
+                             const char* deviceId, const char* sidHex,
+                             const char* crHex, const char* srHex, uint32_t ttlSec) {
+  char ttl[11];
+  snprintf(ttl, sizeof(ttl), "%lu", (unsigned long)ttlSec);
+
+  HmacSha256 mac(secret, secretLen);
+  mac.update(kProofPrefix);
+  const char* fields[] = {deviceId, sidHex, crHex, srHex};
+  for (const char* f : fields) {
+    mac.update(f);
+    mac.update("|", 1);
+  }
+  mac.update(ttl);
+
+  uint8_t out[HmacSha256::kDigestSize];
+  mac.finish(out);
+  return hexEncode(out, sizeof(out));
+}
+
+size_t secureSessionAad(char* out, size_t cap, const char* sidHex, const char* seq,
+                        const char* method, const char* path) {
+  const int n = snprintf(out, cap, "%s|%s|%s|%s", sidHex, seq, method, path);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+// ===== Janela de sequência =====
+
+SequenceWindow::Verdict SequenceWindow::check(uint64_t seq) const {
+  if (seq == 0) return Verdict::Invalid;
+  if (seq > _top) return Verdict::Ok;
+
+  const uint64_t back = _top - seq;
+  if (back >= kSize) return Verdict::TooOld;
+  return (_bits & (1ull << back)) ? Verdict::Replayed : Verdict::Ok;
+}
+
+void SequenceWindow::accept(uint64_t seq) {
+  if (seq == 0) return;
+
+  if (seq > _top) {
+    // Janela anda: bits antigos deslizam, o novo topo é o bit 0
+    const uint64_t shift = seq - _top;
+    _bits = (shift >= kSize) ? 0 : (_bits << shift);
+    _bits |= 1;
+    _top = seq;
+    return;
+  }
+
+  const uint64_t back = _top - seq;
+  if (back < kSize) _bits |= 1ull << back;
+}
+
+// ===== Tabela de sessões (gateway) =====
+
+void SecureSessionTable::Entry::iv(uint64_t seq, uint8_t out[CryptoBackend::kAeadIvBytes]) const {
+  memcpy(out, ivSalt, SecureSessionKeys::kSaltBytes);
+  writeSeqBe(seq, out + SecureSessionKeys::kSaltBytes);
+}
+
+SecureSessionTable::SecureSessionTable(size_t capacity, uint32_t ttlSec)
+  : _capacity(capacity ? capacity : 1), _ttlMs(ttlSec * 1000) {
+  _entries = new Entry[_capacity];
+}
+
+SecureSessionTable::~SecureSessionTable() {
+  delete[] _entries;
+}
+
+void SecureSessionTable::clear(Entry& e) {
+  e.sid = 0;
+  e.sidHex[0] = '\0';
+  e.deviceId[0] = '\0';
+  wipeBytes(e.key, sizeof(e.key));
+  wipeBytes(e.ivSalt, sizeof(e.ivSalt));
+  e.window.reset();
+  e.openedMs = 0;
+  e.lastUsedMs = 0;
+}
+
+SecureSessionTable::Entry* SecureSessionTable::open(const char* deviceId, const uint8_t* secret, size_t secretLen,
+                                                    const uint8_t* cr, uint32_t nowMs, uint8_t* srOut) {
+  if (!deviceId || !secret || !cr || !srOut) return nullptr;
+  const size_t idLen = strlen(deviceId);
+  if (idLen == 0 || idLen >= sizeof(Entry::deviceId)) return nullptr;
+
+  // Slot: sessão anterior do device > livre/expirado > menos usado recentemente
+  Entry* slot = nullptr;
+  for (size_t i = 0; i < _capacity; i++) {
+    Entry& e = _entries[i];
+    if (e.sid != 0 && strcmp(e.deviceId, deviceId) == 0) {
+      slot = &e;
+      break;
+    }
+    if (expired(e, nowMs)) {
+      if (!slot || !expired(*slot, nowMs)) slot = &e;
+    } else if (!slot || (!expired(*slot, nowMs) && nowMs - e.lastUsedMs > nowMs - slot->lastUsedMs)) {
+      slot = &e;
+    }
+  }
+  clear(*slot);
+
+  // sid aleatório, != 0 e sem colisão com sessão viva
+  uint32_t sid = 0;
+  for (int attempt = 0; attempt < 8 && sid == 0; attempt++) {
+    if (!cryptoBackend().random((uint8_t*)&sid, sizeof(sid))) return nullptr;
+    for (size_t i = 0; i < _capacity && sid != 0; i++) {
+      if (_entries[i].sid == sid) sid = 0;
+    }
+  }
+  if (sid == 0) return nullptr;
+  if (!cryptoBackend().random(srOut, SecureSessionKeys::kRandomBytes)) return nullptr;
+
+  char sidHex[sizeof(Entry::sidHex)];
+  snprintf(sidHex, sizeof(sidHex), "%08lx", (unsigned long)sid);
+
+  SecureSessionKeys keys;
+  keys.derive(secret, secretLen, deviceId, sidHex, cr, srOut);
+  memcpy(slot->key, keys.aesKey, sizeof(slot->key));
+  memcpy(slot->ivSalt, keys.ivSalt, sizeof(slot->ivSalt));
+  keys.wipe();
+
+  slot->sid = sid;
+  memcpy(slot->sidHex, sidHex, sizeof(sidHex));
+  memcpy(slot->deviceId, deviceId, idLen + 1);
+  slot->openedMs = nowMs;
+  slot->lastUsedMs = nowMs;
+  return slot;
+}
+
+SecureSessionTable::Entry* SecureSessionTable::find(const char* sidHex, uint32_t nowMs) {
+  if (!sidHex || strlen(sidHex) != 8) return nullptr;
+
+  uint8_t raw[4];
+  if (!hexDecodeSpan(sidHex, 8, raw, sizeof(raw))) return nullptr;
+  const uint32_t sid = ((uint32_t)raw[0] << 24) | ((uint32_t)raw[1] << 16) | ((uint32_t)raw[2] << 8) | raw[3];
+  if (sid == 0) return nullptr;
+
+  for (size_t i = 0; i < _capacity; i++) {
+    Entry& e = _entries[i];
+    if (e.sid != sid) continue;
+    if (expired(e, nowMs)) {
+      clear(e);
+      return nullptr;
+    }
+    return &e;
+  }
+  return nullptr;
+}
+
+size_t SecureSessionTable::size(uint32_t nowMs) const {
+  size_t n = 0;
+  for (size_t i = 0; i < _capacity; i++) {
+    if (!expired(_entries[i], nowMs)) n++;
+  }
+  return n;
+}
+
+// ===== Cliente (device) =====
+
+const uint8_t* SecureSessionClient::Message::bodyData() const {
+  return encoding == SecureBodyEncoding::Raw ? sealed.get() : (const uint8_t*)encoded.c_str();
+}
+
+size_t SecureSessionClient::Message::bodyLen() const {
+  return encoding == SecureBodyEncoding::Raw ? sealedLen : encoded.length();
+}
+
+// Valor de "key" num JSON plano (string ou número); vazio se ausente
+static String jsonField(const String& json, const char* key) {
+  const String pattern = String("\"") + key + "\":";
+  int p = json.indexOf(pattern);
+  if (p < 0) return String();
+  p += pattern.length();
+  while (p < (int)json.length() && json[p] == ' ') p++;
+
+  if (p < (int)json.length() && json[p] == '"') {
+    const int end = json.indexOf('"', p + 1);
+    return end > p ? json.substring(p + 1, end) : String();
+  }
+
+  int end = p;
+  while (end < (int)json.length() && json[end] >= '0' && json[end] <= '9') end++;
+  return json.substring(p, end);
+}
+
+String SecureSessionClient::handshakeBody() {
+  reset();
+  if (!cryptoBackend().random(_cr, sizeof(_cr))) return String();
+  _crPending = true;
+  return String("{\"cr\":\"") + hexEncode(_cr, sizeof(_cr)) + "\"}";
+}
+
+bool SecureSessionClient::accept(const char* deviceId, const String& responseJson, uint32_t nowMs) {
+  if (!_crPending || !deviceId) return false;
+  _crPending = false;
+
+  const String sid = jsonField(responseJson, "sid");
+  const String srHex = jsonField(responseJson, "sr");
+  const String ttlStr = jsonField(responseJson, "ttl");
+  const String macHex = jsonField(responseJson, "mac");
+
+  uint8_t sr[SecureSessionKeys::kRandomBytes];
+  uint8_t sidRaw[4];
+  if (sid.length() != 8 || !hexDecodeSpan(sid.c_str(), sid.length(), sidRaw, sizeof(sidRaw)) ||
+      !hexDecodeFixed(srHex, sr, sizeof(sr)) || ttlStr.length() == 0) {
+    return false;
+  }
+
+  const uint32_t ttlSec = (uint32_t)strtoul(ttlStr.c_str(), nullptr, 10);
+  const String crHex = hexEncode(_cr, sizeof(_cr));
+  // Device: segredo compilado (SecureHttpConfig.h)
+  const String expected = secureSessionProofHex(SECUREHTTP_HMAC_KEY, SECUREHTTP_HMAC_KEY_LEN,
+                                                deviceId, sid.c_str(), crHex.c_str(), srHex.c_str(), ttlSec);
+  if (ttlSec == 0 || !constantTimeEquals(expected, macHex)) return false;
+
+  SecureSessionKeys keys;
+  keys.derive(SECUREHTTP_HMAC_KEY, SECUREHTTP_HMAC_KEY_LEN, deviceId, sid.c_str(), _cr, sr);
+  const bool keyed = _gcm.setKey(keys.aesKey, sizeof(keys.aesKey));
+  memcpy(_ivSalt, keys.ivSalt, sizeof(_ivSalt));
+  keys.wipe();
+  wipeBytes(_cr, sizeof(_cr));
+  if (!keyed) {
+    reset();
+    return false;
+  }
+
+  _sid = sid;
+  _seq = 0;
+  _openedMs = nowMs;
+  _ttlMs = ttlSec * 1000;
+  return true;
+}
+
+bool SecureSessionClient::active(uint32_t nowMs) const {
+  if (_sid.length() == 0 || !_gcm.ready()) return false;
+  const uint32_t margin = (_ttlMs > 2 * kRenewMarginMs) ? kRenewMarginMs : _ttlMs / 2;
+  return nowMs - _openedMs < _ttlMs - margin;
+}
+
+SecureSessionClient::Message SecureSessionClient::seal(const char* method, const char* path,
+                                                       const String& plaintextJson,
+                                                       SecureBodyEncoding encoding) {
+  Message m;
+  if (_sid.length() == 0 || !_gcm.ready()) { m.error = "no_session"; return m; }
+  if (!method || !*method || !path || !*path) { m.error = "invalid_path"; return m; }
+  if (plaintextJson.length() == 0) { m.error = "empty_body"; return m; }
+
+  // Contador nunca repete com a mesma chave (IV único por mensagem)
+  if (_seq == UINT64_MAX) { m.error = "seq_exhausted"; return m; }
+  const uint64_t seq = ++_seq;
+
+  char seqStr[21];
+  snprintf(seqStr, sizeof(seqStr), "%llu", (unsigned long long)seq);
+
+  char aad[160];
+  const size_t aadLen = secureSessionAad(aad, sizeof(aad), _sid.c_str(), seqStr, method, path);
+  if (aadLen == 0) { m.error = "invalid_path"; return m; }
+
+  uint8_t iv[CryptoBackend::kAeadIvBytes];
+  memcpy(iv, _ivSalt, sizeof(_ivSalt));
+  writeSeqBe(seq, iv + sizeof(_ivSalt));
+
+  const size_t ptLen = plaintextJson.length();
+  m.sealedLen = ptLen + CryptoBackend::kAeadTagBytes;
+  m.sealed.reset(new uint8_t[m.sealedLen]);
+
+  if (!_gcm.encrypt(iv, sizeof(iv),
+                    (const uint8_t*)aad, aadLen,
+                    (const uint8_t*)plaintextJson.c_str(), ptLen,
+                    m.sealed.get(),
+                    m.sealed.get() + ptLen, CryptoBackend::kAeadTagBytes)) {
+    m.error = "encrypt_failed";
+    return m;
+  }
+
+  m.encoding = encoding;
+  if (encoding == SecureBodyEncoding::Hex) {
+    m.encoded = hexEncode(m.sealed.get(), m.sealedLen);
+  } else if (encoding == SecureBodyEncoding::Base64Url) {
+    m.encoded = base64UrlEncode(m.sealed.get(), m.sealedLen);
+  }
+
+  m.sid = _sid;
+  m.seq = seqStr;
+  m.ok = true;
+  return m;
+}
+
+void SecureSessionClient::reset() {
+  wipeBytes(_cr, sizeof(_cr));
+  _crPending = false;
+  _sid = String();
+  _gcm.reset();
+  wipeBytes(_ivSalt, sizeof(_ivSalt));
+  _seq = 0;
+  _openedMs = 0;
+  _ttlMs = 0;
+}
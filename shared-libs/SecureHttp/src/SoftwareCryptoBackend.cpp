@@ -0,0 +1,478 @@
+#include "CryptoBackend.h"
+
+#include <new>
+#include <string.h>
+
+// Implementação portável (sem dependências): AES-256 com T-table, GHASH com
+// tabela de 4 bits (Shoup) e SHA-256 (FIPS 180-4). Serve para rodar a camada
+// de segurança fora do ESP32 e como referência de desempenho.
+
+namespace {
+
+inline uint32_t load32be(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline void store32be(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+inline void store64be(uint8_t* p, uint64_t v) {
+  store32be(p, (uint32_t)(v >> 32));
+  store32be(p + 4, (uint32_t)v);
+}
+
+// Zera segredos sem o compilador remover a escrita
+void wipe(void* p, size_t len) {
+  volatile uint8_t* v = (volatile uint8_t*)p;
+  while (len--) *v++ = 0;
+}
+
+inline uint32_t ror32(uint32_t v, unsigned n) {
+  return (v >> n) | (v << (32 - n));
+}
+
+// ===== AES-256 (só cifra: o GCM usa AES em modo contador) =====
+
+struct AesTables {
+  uint8_t sbox[256];
+  uint32_t te[256]; // coluna {2s, s, s, 3s}; as outras 3 são rotações
+};
+
+uint8_t rotl8(uint8_t x, unsigned n) {
+  return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+AesTables makeAesTables() {
+  AesTables t;
+
+  // S-box: p percorre o grupo multiplicativo (x3), q = 1/p (/3)
+  uint8_t p = 1, q = 1;
+  do {
+    p = (uint8_t)(p ^ (uint8_t)(p << 1) ^ ((p & 0x80) ? 0x1B : 0));
+    q = (uint8_t)(q ^ (uint8_t)(q << 1));
+    q = (uint8_t)(q ^ (uint8_t)(q << 2));
+    q = (uint8_t)(q ^ (uint8_t)(q << 4));
+    if (q & 0x80) q ^= 0x09;
+    t.sbox[p] = (uint8_t)(q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63);
+  } while (p != 1);
+  t.sbox[0] = 0x63;
+
+  for (int i = 0; i < 256; i++) {
+    const uint8_t s = t.sbox[i];
+    const uint8_t s2 = (uint8_t)((s << 1) ^ ((s & 0x80) ? 0x1B : 0));
+    const uint8_t s3 = (uint8_t)(s2 ^ s);
+    t.te[i] = ((uint32_t)s2 << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) | (uint32_t)s3;
+  }
+  return t;
+}
+
+const AesTables& aesTables() {
+  static const AesTables tables = makeAesTables();
+  return tables;
+}
+
+struct Aes256 {
+  static constexpr int kRounds = 14;
+  uint32_t rk[4 * (kRounds + 1)];
+
+  void expand(const uint8_t key[32]) {
+    const uint8_t* sbox = aesTables().sbox;
+    uint8_t rcon = 0x01;
+
+    for (int i = 0; i < 8; i++) rk[i] = load32be(key + 4 * i);
+    for (int i = 8; i < 4 * (kRounds + 1); i++) {
+      uint32_t t = rk[i - 1];
+      if (i % 8 == 0) {
+        t = ((uint32_t)sbox[(t >> 16) & 0xFF] << 24) | ((uint32_t)sbox[(t >> 8) & 0xFF] << 16) |
+            ((uint32_t)sbox[t & 0xFF] << 8) | (uint32_t)sbox[t >> 24];
+        t ^= (uint32_t)rcon << 24;
+        rcon = (uint8_t)((rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0));
+      } else if (i % 8 == 4) {
+        t = ((uint32_t)sbox[t >> 24] << 24) | ((uint32_t)sbox[(t >> 16) & 0xFF] << 16) |
+            ((uint32_t)sbox[(t >> 8) & 0xFF] << 8) | (uint32_t)sbox[t & 0xFF];
+      }
+      rk[i] = rk[i - 8] ^ t;
+    }
+  }
+
+  void encryptBlock(const uint8_t in[16], uint8_t out[16]) const {
+    const AesTables& T = aesTables();
+    const uint32_t* te = T.te;
+    const uint32_t* k = rk;
+
+    uint32_t s0 = load32be(in) ^ k[0];
+    uint32_t s1 = load32be(in + 4) ^ k[1];
+    uint32_t s2 = load32be(in + 8) ^ k[2];
+    uint32_t s3 = load32be(in + 12) ^ k[3];
+
+    for (int r = 1; r < kRounds; r++) {
+      k += 4;
+      const uint32_t t0 = te[s0 >> 24] ^ ror32(te[(s1 >> 16) & 0xFF], 8) ^
+                          ror32(te[(s2 >> 8) & 0xFF], 16) ^ ror32(te[s3 & 0xFF], 24) ^ k[0];
+      const uint32_t t1 = te[s1 >> 24] ^ ror32(te[(s2 >> 16) & 0xFF], 8) ^
+                          ror32(te[(s3 >> 8) & 0xFF], 16) ^ ror32(te[s0 & 0xFF], 24) ^ k[1];
+      const uint32_t t2 = te[s2 >> 24] ^ ror32(te[(s3 >> 16) & 0xFF], 8) ^
+                          ror32(te[(s0 >> 8) & 0xFF], 16) ^ ror32(te[s1 & 0xFF], 24) ^ k[2];
+      const uint32_t t3 = te[s3 >> 24] ^ ror32(te[(s0 >> 16) & 0xFF], 8) ^
+                          ror32(te[(s1 >> 8) & 0xFF], 16) ^ ror32(te[s2 & 0xFF], 24) ^ k[3];
+      s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // Última rodada: sem MixColumns
+    k += 4;
+    const uint8_t* sb = T.sbox;
+    store32be(out, (((uint32_t)sb[s0 >> 24] << 24) | ((uint32_t)sb[(s1 >> 16) & 0xFF] << 16) |
+                    ((uint32_t)sb[(s2 >> 8) & 0xFF] << 8) | (uint32_t)sb[s3 & 0xFF]) ^ k[0]);
+    store32be(out + 4, (((uint32_t)sb[s1 >> 24] << 24) | ((uint32_t)sb[(s2 >> 16) & 0xFF] << 16) |
+                        ((uint32_t)sb[(s3 >> 8) & 0xFF] << 8) | (uint32_t)sb[s0 & 0xFF]) ^ k[1]);
+    store32be(out + 8, (((uint32_t)sb[s2 >> 24] << 24) | ((uint32_t)sb[(s3 >> 16) & 0xFF] << 16) |
+                        ((uint32_t)sb[(s0 >> 8) & 0xFF] << 8) | (uint32_t)sb[s1 & 0xFF]) ^ k[2]);
+    store32be(out + 12, (((uint32_t)sb[s3 >> 24] << 24) | ((uint32_t)sb[(s0 >> 16) & 0xFF] << 16) |
+                         ((uint32_t)sb[(s1 >> 8) & 0xFF] << 8) | (uint32_t)sb[s2 & 0xFF]) ^ k[3]);
+  }
+};
+
+// ===== GCM =====
+
+class SoftwareAeadKey : public CryptoBackend::AeadKey {
+public:
+  explicit SoftwareAeadKey(const uint8_t key[32]) {
+    _aes.expand(key);
+
+    uint8_t h[16] = {0};
+    _aes.encryptBlock(h, h);
+    makeTable(h);
+  }
+
+  ~SoftwareAeadKey() override {
+    // Não deixa o key schedule no heap liberado
+    wipe(_aes.rk, sizeof(_aes.rk));
+    wipe(_hl, sizeof(_hl));
+    wipe(_hh, sizeof(_hh));
+  }
+
+  bool seal(const uint8_t* iv,
+            const uint8_t* aad, size_t aadLen,
+            const uint8_t* plain, size_t len,
+            uint8_t* cipher, uint8_t* tag) override {
+    uint8_t j0[16];
+    counterBlock(iv, j0);
+
+    ctr(j0, plain, len, cipher);
+    computeTag(j0, aad, aadLen, cipher, len, tag);
+    return true;
+  }
+
+  bool open(const uint8_t* iv,
+            const uint8_t* aad, size_t aadLen,
+            const uint8_t* cipher, size_t len,
+            const uint8_t* tag, uint8_t* out) override {
+    uint8_t j0[16];
+    counterBlock(iv, j0);
+
+    // Autentica antes de decifrar: nada de plaintext sem tag válida
+    uint8_t expected[16];
+    computeTag(j0, aad, aadLen, cipher, len, expected);
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(expected); i++) diff |= (uint8_t)(expected[i] ^ tag[i]);
+    if (diff != 0) return false;
+
+    ctr(j0, cipher, len, out);
+    return true;
+  }
+
+  bool openStart(const uint8_t* iv, const uint8_t* aad, size_t aadLen) override {
+    counterBlock(iv, _j0);
+    memcpy(_cb, _j0, sizeof(_cb));
+    memset(_y, 0, sizeof(_y));
+    ghashUpdate(_y, aad, aadLen);
+    _aadLen = aadLen;
+    _len = 0;
+    return true;
+  }
+
+  bool openUpdate(const uint8_t* cipher, size_t len, uint8_t* out) override {
+    // GHASH sobre o ciphertext antes de decifrar o bloco (aceita só blocos
+    // inteiros exceto no fim, então o padding de zeros do GHASH fica correto)
+    ghashUpdate(_y, cipher, len);
+    uint8_t ks[16];
+    while (len > 0) {
+      increment(_cb);
+      _aes.encryptBlock(_cb, ks);
+
+      const size_t n = len < 16 ? len : 16;
+      for (size_t i = 0; i < n; i++) out[i] = (uint8_t)(cipher[i] ^ ks[i]);
+      cipher += n;
+      out += n;
+      len -= n;
+      _len += n;
+    }
+    wipe(ks, sizeof(ks));
+    return true;
+  }
+
+  bool openFinish(const uint8_t* tag) override {
+    uint8_t lens[16];
+    store64be(lens, (uint64_t)_aadLen * 8);
+    store64be(lens + 8, (uint64_t)_len * 8);
+    ghashUpdate(_y, lens, sizeof(lens));
+
+    uint8_t ek[16];
+    _aes.encryptBlock(_j0, ek);
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(ek); i++) diff |= (uint8_t)(_y[i] ^ ek[i] ^ tag[i]);
+    return diff == 0;
+  }
+
+private:
+  static void counterBlock(const uint8_t* iv, uint8_t j0[16]) {
+    // IV de 96 bits: J0 = IV || 0^31 || 1
+    memcpy(j0, iv, 12);
+    j0[12] = 0; j0[13] = 0; j0[14] = 0; j0[15] = 1;
+  }
+
+  static void increment(uint8_t cb[16]) {
+    for (int i = 15; i >= 12; i--) {
+      if (++cb[i] != 0) break;
+    }
+  }
+
+  // Bloco a bloco: a entrada de cada bloco é lida antes de escrever a saída
+  void ctr(const uint8_t j0[16], const uint8_t* in, size_t len, uint8_t* out) const {
+    uint8_t cb[16];
+    uint8_t ks[16];
+    memcpy(cb, j0, sizeof(cb));
+
+    while (len > 0) {
+      increment(cb);
+      _aes.encryptBlock(cb, ks);
+
+      const size_t n = len < 16 ? len : 16;
+      for (size_t i = 0; i < n; i++) out[i] = (uint8_t)(in[i] ^ ks[i]);
+      in += n;
+      out += n;
+      len -= n;
+    }
+  }
+
+  void computeTag(const uint8_t j0[16], const uint8_t* aad, size_t aadLen,
+                  const uint8_t* cipher, size_t len, uint8_t tag[16]) const {
+    uint8_t y[16] = {0};
+    ghashUpdate(y, aad, aadLen);
+    ghashUpdate(y, cipher, len);
+
+    uint8_t lens[16];
+    store64be(lens, (uint64_t)aadLen * 8);
+    store64be(lens + 8, (uint64_t)len * 8);
+    ghashUpdate(y, lens, sizeof(lens));
+
+    uint8_t ek[16];
+    _aes.encryptBlock(j0, ek);
+    for (size_t i = 0; i < 16; i++) tag[i] = (uint8_t)(y[i] ^ ek[i]);
+  }
+
+  void ghashUpdate(uint8_t y[16], const uint8_t* data, size_t len) const {
+    while (len > 0) {
+      const size_t n = len < 16 ? len : 16; // último bloco completado com zeros
+      for (size_t i = 0; i < n; i++) y[i] ^= data[i];
+      mult(y, y);
+      data += n;
+      len -= n;
+    }
+  }
+
+  // Tabela de 4 bits (Shoup), mesma organização do gcm.c do mbedtls
+  void makeTable(const uint8_t h[16]) {
+    uint64_t vh = ((uint64_t)load32be(h) << 32) | load32be(h + 4);
+    uint64_t vl = ((uint64_t)load32be(h + 8) << 32) | load32be(h + 12);
+
+    _hl[8] = vl;
+    _hh[8] = vh;
+    _hl[0] = 0;
+    _hh[0] = 0;
+
+    for (int i = 4; i > 0; i >>= 1) {
+      const uint32_t t = (uint32_t)(vl & 1) * 0xE1000000U;
+      vl = (vh << 63) | (vl >> 1);
+      vh = (vh >> 1) ^ ((uint64_t)t << 32);
+      _hl[i] = vl;
+      _hh[i] = vh;
+    }
+
+    for (int i = 2; i <= 8; i *= 2) {
+      for (int j = 1; j < i; j++) {
+        _hh[i + j] = _hh[i] ^ _hh[j];
+        _hl[i + j] = _hl[i] ^ _hl[j];
+      }
+    }
+  }
+
+  void mult(const uint8_t x[16], uint8_t out[16]) const {
+    static const uint64_t last4[16] = {
+      0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+      0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+    };
+
+    uint8_t lo = (uint8_t)(x[15] & 0x0F);
+    uint64_t zh = _hh[lo];
+    uint64_t zl = _hl[lo];
+
+    for (int i = 15; i >= 0; i--) {
+      lo = (uint8_t)(x[i] & 0x0F);
+      const uint8_t hi = (uint8_t)((x[i] >> 4) & 0x0F);
+
+      if (i != 15) {
+        const uint8_t rem = (uint8_t)(zl & 0x0F);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (last4[rem] << 48);
+        zh ^= _hh[lo];
+        zl ^= _hl[lo];
+      }
+
+      const uint8_t rem = (uint8_t)(zl & 0x0F);
+      zl = (zh << 60) | (zl >> 4);
+      zh = (zh >> 4) ^ (last4[rem] << 48);
+      zh ^= _hh[hi];
+      zl ^= _hl[hi];
+    }
+
+    store64be(out, zh);
+    store64be(out + 8, zl);
+  }
+
+  Aes256 _aes;
+  uint64_t _hl[16];
+  uint64_t _hh[16];
+
+  // Estado do open em streaming
+  uint8_t _j0[16];
+  uint8_t _cb[16];
+  uint8_t _y[16];
+  size_t _aadLen = 0;
+  size_t _len = 0;
+};
+
+// ===== SHA-256 =====
+
+struct Sha256State {
+  uint32_t h[8];
+  uint64_t total;   // bytes já processados
+  uint8_t buf[64];
+  uint32_t bufLen;
+};
+
+static_assert(sizeof(Sha256State) <= CryptoBackend::kHashStateBytes, "grow CryptoBackend::kHashStateBytes");
+
+Sha256State* stateOf(CryptoBackend::HashState& s) {
+  return reinterpret_cast<Sha256State*>(s.raw);
+}
+
+const uint32_t kSha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+void sha256Compress(uint32_t h[8], const uint8_t block[64]) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) w[i] = load32be(block + 4 * i);
+  for (int i = 16; i < 64; i++) {
+    const uint32_t s0 = ror32(w[i - 15], 7) ^ ror32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32_t s1 = ror32(w[i - 2], 17) ^ ror32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+  for (int i = 0; i < 64; i++) {
+    const uint32_t t1 = k + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+    const uint32_t t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    k = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+  h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+class SoftwareCryptoBackend : public CryptoBackend {
+public:
+  const char* name() const override { return "software"; }
+
+  AeadKey* newAeadKey(const uint8_t* key, size_t keyLen) const override {
+    if (!key || keyLen != kAeadKeyBytes) return nullptr;
+    return new (std::nothrow) SoftwareAeadKey(key);
+  }
+
+  void sha256Start(HashState& s) const override {
+    static const uint32_t iv[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    Sha256State* st = stateOf(s);
+    memcpy(st->h, iv, sizeof(iv));
+    st->total = 0;
+    st->bufLen = 0;
+  }
+
+  void sha256Copy(HashState& dst, const HashState& src) const override {
+    memcpy(dst.raw, src.raw, sizeof(Sha256State));
+  }
+
+  void sha256Update(HashState& s, const void* data, size_t len) const override {
+    Sha256State* st = stateOf(s);
+    const uint8_t* p = (const uint8_t*)data;
+    st->total += len;
+
+    if (st->bufLen > 0) {
+      const size_t n = (64 - st->bufLen) < len ? (64 - st->bufLen) : len;
+      memcpy(st->buf + st->bufLen, p, n);
+      st->bufLen += (uint32_t)n;
+      p += n;
+      len -= n;
+      if (st->bufLen < 64) return;
+      sha256Compress(st->h, st->buf);
+      st->bufLen = 0;
+    }
+
+    for (; len >= 64; p += 64, len -= 64) sha256Compress(st->h, p);
+
+    memcpy(st->buf, p, len);
+    st->bufLen = (uint32_t)len;
+  }
+
+  void sha256Finish(HashState& s, uint8_t out[kSha256Bytes]) const override {
+    Sha256State* st = stateOf(s);
+    const uint64_t bits = st->total * 8;
+
+    // 0x80, zeros até 56 mod 64, tamanho em bits (64 bits BE)
+    uint8_t pad[72];
+    const size_t padLen = (st->bufLen < 56) ? (56 - st->bufLen) : (120 - st->bufLen);
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    store64be(pad + padLen, bits);
+    sha256Update(s, pad, padLen + 8);
+
+    for (int i = 0; i < 8; i++) store32be(out + 4 * i, st->h[i]);
+  }
+
+  void sha256Release(HashState& s) const override {
+    wipe(s.raw, sizeof(Sha256State));
+  }
+};
+
+} // namespace
+
+const CryptoBackend& softwareCryptoBackend() {
+  static const SoftwareCryptoBackend backend;
+  return backend;
+}
@@ -0,0 +1,157 @@
+// Simulação do AdcFilter no host com um ADC sintético (ver Makefile).
+//
+//   ./adc_filter_bench [seconds]
+//
+// Fonte: nível constante + ruído gaussiano + picos isolados (glitch de ADC) e um
+// degrau no meio, amostrados a 1 kHz como no AdcSampler. Para cada filtro mede o
+// custo por leitura, o erro em regime (RMS e máximo) e a latência do degrau
+// (tempo até a saída cobrir 50 % e 90 % do salto).
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "AdcFilter.h"
+
+namespace {
+
+const double kRateHz = 1000.0; // ADC_PERIOD_US = 1000
+const double kLevel = 1200.0; // LSB antes do degrau
+const double kStep = 1500.0; // salto do degrau (LSB)
+const double kNoiseLsb = 25.0; // desvio do ruído gaussiano
+const double kSpikeProb = 0.01; // 1 % das leituras com pico
+const double kSpikeLsb = 900.0;
+
+// xorshift32 determinístico: todas as linhas veem a mesma sequência
+struct Rng {
+    uint32_t s = 0x9E3779B9u;
+
+    uint32_t next() {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+
+    double uniform() { return (next() + 0.5) / 4294967296.0; }
+
+    double gauss() { return sqrt(-2.0 * log(uniform())) * cos(6.283185307179586 * uniform()); }
+};
+
+struct Signal {
+    std::vector<uint16_t> raw;
+    std::vector<double> clean;
+    size_t stepAt = 0;
+};
+
+Signal makeSignal(size_t n) {
+    Signal sig;
+    sig.raw.resize(n);
+    sig.clean.resize(n);
+    sig.stepAt = n / 2;
+
+    Rng rng;
+    for (size_t i = 0; i < n; i++) {
+        const double c = kLevel + (i >= sig.stepAt ? kStep : 0.0);
+        double v = c + kNoiseLsb * rng.gauss();
+        if (rng.uniform() < kSpikeProb) v += (rng.next() & 1) ? kSpikeLsb : -kSpikeLsb;
+        if (v < 0) v = 0;
+        if (v > 4095) v = 4095;
+        sig.raw[i] = (uint16_t) lround(v);
+        sig.clean[i] = c;
+    }
+    return sig;
+}
+
+struct Row {
+    const char *name;
+    AdcFilter::Config cfg;
+};
+
+void run(const Row &row, const Signal &sig) {
+    AdcFilter f(row.cfg);
+    const size_t n = sig.raw.size();
+    const size_t settle = (size_t) kRateHz / 2; // 500 ms fora da conta do erro após início/degrau
+
+    double sq = 0, maxErr = 0;
+    size_t outs = 0, errSamples = 0;
+    double t50 = -1, t90 = -1;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!f.push(sig.raw[i])) continue;
+        outs++;
+
+        const double out = f.output();
+        const bool steady = (i >= settle && i < sig.stepAt) || i >= sig.stepAt + settle;
+        if (steady) {
+            const double e = out - sig.clean[i];
+            sq += e * e;
+            if (fabs(e) > maxErr) maxErr = fabs(e);
+            errSamples++;
+        }
+
+        if (i >= sig.stepAt) {
+            const double frac = (out - kLevel) / kStep;
+            const double ms = (double) (i - sig.stepAt + 1) * 1000.0 / kRateHz;
+            if (t50 < 0 && frac >= 0.5) t50 = ms;
+            if (t90 < 0 && frac >= 0.9) t90 = ms;
+        }
+    }
+
+    // Custo: só push() (cópia do sinal já pronta), média de várias passadas
+    volatile uint32_t sink = 0;
+    const int passes = 20;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        f.reset();
+        for (size_t i = 0; i < n; i++) {
+            if (f.push(sig.raw[i])) sink += f.output();
+        }
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() /
+                      ((double) n * passes);
+    (void) sink;
+
+    printf("%-22s %8.1f %8.1f %9.1f %9.1f %7.1f %7.1f\n", row.name, ns,
+           (double) outs * kRateHz / (double) n, errSamples ? sqrt(sq / errSamples) : 0.0, maxErr, t50, t90);
+}
+
+AdcFilter::Config cfg(AdcFilter::Type type, uint8_t window, uint8_t decimation) {
+    AdcFilter::Config c;
+    c.type = type;
+    c.window = window;
+    c.decimation = decimation;
+    return c;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const long seconds = (argc > 1) ? strtol(argv[1], nullptr, 10) : 20;
+    if (seconds <= 1) {
+        fprintf(stderr, "seconds: > 1\n");
+        return 2;
+    }
+
+    const Signal sig = makeSignal((size_t) (seconds * kRateHz));
+
+    // "sem filtro" = uma leitura por saída (o que o loop via antes, sem a média de 5)
+    const Row rows[] = {
+        {"raw (no filter)", cfg(AdcFilter::Type::Mean, 1, 1)},
+        {"mean 5 (readAdcFast)", cfg(AdcFilter::Type::Mean, 5, 5)},
+        {"mean 16 / 16 (fuel)", cfg(AdcFilter::Type::Mean, 16, 16)},
+        {"median 5 / 5 (accel)", cfg(AdcFilter::Type::Median, 5, 5)},
+        {"median 5 / 1 sliding", cfg(AdcFilter::Type::Median, 5, 1)},
+        {"median 9 / 9", cfg(AdcFilter::Type::Median, 9, 9)},
+        {"median 15 / 15", cfg(AdcFilter::Type::Median, 15, 15)},
+    };
+
+    printf("%ld s at %.0f Hz, noise %.0f LSB rms, %.0f %% spikes of %.0f LSB, step %.0f LSB\n",
+           seconds, kRateHz, kNoiseLsb, kSpikeProb * 100, kSpikeLsb, kStep);
+    printf("%-22s %8s %8s %9s %9s %7s %7s\n", "filter", "ns/read", "out Hz", "rms LSB", "max LSB", "t50 ms",
+           "t90 ms");
+    for (const Row &r : rows) run(r, sig);
+    return 0;
+}
@@ -0,0 +1,64 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef VEHICLE_DEVICE_ADCFILTER_H
+#define VEHICLE_DEVICE_ADCFILTER_H
+
+#pragma once
+#include <stdint.h>
+
+#ifndef ADC_FILTER_WINDOW_MAX
+#define ADC_FILTER_WINDOW_MAX 16 // amostras na janela (RAM fixa)
+#endif
+
+// Filtro de decimação de um canal de ADC: guarda as últimas `window` leituras e
+// a cada `decimation` leituras produz uma saída (média ou mediana da janela).
+// decimation == window: blocos sem sobreposição; menor: janela deslizante.
+// Sem Arduino nem alocação (roda no host em bench/host).
+class AdcFilter {
+public:
+    enum class Type : uint8_t {
+        Mean = 0, // soma corrente: O(1) por leitura
+        Median // ordena uma cópia da janela a cada saída (rejeita picos isolados)
+    };
+
+    struct Config {
+        Type type = Type::Mean;
+        uint8_t window = 8; // 1..ADC_FILTER_WINDOW_MAX
+        uint8_t decimation = 8; // leituras por saída (1 = uma saída por leitura)
+    };
+
+    AdcFilter();
+
+    explicit AdcFilter(const Config &cfg);
+
+    void configure(const Config &cfg);
+
+    void reset();
+
+    // Acrescenta uma leitura; true quando gerou saída nova (output())
+    bool push(uint16_t raw);
+
+    uint16_t output() const noexcept { return _output; }
+
+    // Janela já cheia desde o reset (antes disso a saída usa só o que chegou)
+    bool primed() const noexcept { return _count >= _cfg.window; }
+
+    const Config &config() const noexcept { return _cfg; }
+
+private:
+    Config _cfg{};
+
+    uint16_t _buf[ADC_FILTER_WINDOW_MAX]; // ring da janela
+    uint8_t _head = 0; // próxima posição de escrita
+    uint8_t _count = 0; // leituras válidas na janela
+    uint8_t _sinceOutput = 0;
+    uint32_t _sum = 0; // soma da janela (Mean)
+    uint16_t _output = 0;
+
+    uint16_t median() const;
+};
+
+
+#endif //VEHICLE_DEVICE_ADCFILTER_H
@@ -0,0 +1,88 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef VEHICLE_DEVICE_ADCSAMPLER_H
+#define VEHICLE_DEVICE_ADCSAMPLER_H
+
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+
+#include "AdcFilter.h"
+
+#ifndef ADC_SAMPLER_MAX_CHANNELS
+#define ADC_SAMPLER_MAX_CHANNELS 4
+#endif
+
+// Amostragem de ADC em taxa fixa, fora do loop().
+//
+// Um esp_timer periódico (task do esp_timer, não ISR: analogRead pode bloquear)
+// lê todos os canais a cada periodUs e passa cada leitura pelo AdcFilter do canal.
+// A janela do filtro só é tocada pelo timer; o loop lê o último valor filtrado
+// (e a última leitura bruta) de palavras atômicas: O(1), sem lock e sem esperar ADC.
+class AdcSampler {
+public:
+    struct Channel {
+        uint8_t pin = 0xFF; // ADC1 (32..39): ADC2 não funciona com o WiFi ligado
+        AdcFilter::Config filter{};
+    };
+
+    struct Config {
+        uint32_t periodUs = 1000; // 1 kHz por canal
+        uint8_t resolutionBits = 12;
+    };
+
+    explicit AdcSampler(const Config &cfg);
+
+    ~AdcSampler();
+
+    // Canais antes do begin(); retorna o índice (ou -1)
+    int addChannel(const Channel &ch);
+
+    // Cria e inicia o timer (lê cada canal uma vez para já ter valor)
+    bool begin();
+
+    void end();
+
+    // Último valor filtrado do canal
+    uint16_t value(uint8_t ch) const;
+
+    // Saídas do filtro desde o begin() (16 bits, dá a volta): mudou = valor novo
+    uint16_t outputs(uint8_t ch) const;
+
+    // Última leitura bruta do canal
+    uint16_t raw(uint8_t ch) const;
+
+    uint8_t channels() const noexcept { return _channelCount; }
+
+    // Diagnóstico do timer
+    uint32_t ticks() const noexcept { return _ticks.load(std::memory_order_relaxed); }
+    uint32_t maxTickUs() const noexcept { return _maxTickUs.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        uint8_t pin = 0xFF;
+        AdcFilter filter;
+        std::atomic<uint32_t> out{0}; // valor | saídas << 16
+        std::atomic<uint32_t> last{0}; // bruto
+    };
+
+    Config _cfg{};
+    Slot _slots[ADC_SAMPLER_MAX_CHANNELS];
+    uint8_t _channelCount = 0;
+    esp_timer_handle_t _timer = nullptr;
+
+    std::atomic<uint32_t> _ticks{0};
+    std::atomic<uint32_t> _maxTickUs{0};
+
+    static void onTimer(void *arg);
+
+    void sample();
+
+    void sampleChannel(Slot &s);
+};
+
+
+#endif //VEHICLE_DEVICE_ADCSAMPLER_H
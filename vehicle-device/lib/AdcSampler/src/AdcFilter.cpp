@@ -0,0 +1,64 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+#include "AdcFilter.h"
+
+AdcFilter::AdcFilter() {
+    reset();
+}
+
+AdcFilter::AdcFilter(const Config &cfg) {
+    configure(cfg);
+}
+
+void AdcFilter::configure(const Config &cfg) {
+    _cfg = cfg;
+    if (_cfg.window == 0) _cfg.window = 1;
+    if (_cfg.window > ADC_FILTER_WINDOW_MAX) _cfg.window = ADC_FILTER_WINDOW_MAX;
+    if (_cfg.decimation == 0) _cfg.decimation = 1;
+    reset();
+}
+
+void AdcFilter::reset() {
+    _head = 0;
+    _count = 0;
+    _sinceOutput = 0;
+    _sum = 0;
+    _output = 0;
+}
+
+bool AdcFilter::push(uint16_t raw) {
+    // Janela cheia: a leitura mais antiga sai da soma
+    if (_count == _cfg.window) {
+        _sum -= _buf[_head];
+    } else {
+        _count++;
+    }
+    _buf[_head] = raw;
+    _sum += raw;
+    _head = (uint8_t) ((_head + 1) % _cfg.window);
+
+    if (++_sinceOutput < _cfg.decimation) return false;
+    _sinceOutput = 0;
+
+    _output = (_cfg.type == Type::Median) ? median() : (uint16_t) ((_sum + _count / 2) / _count);
+    return true;
+}
+
+uint16_t AdcFilter::median() const {
+    // Insertion sort de uma cópia: janela pequena, sem alocação
+    uint16_t v[ADC_FILTER_WINDOW_MAX];
+    for (uint8_t i = 0; i < _count; i++) {
+        const uint16_t x = _buf[i];
+        uint8_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+
+    // Par: média dos dois do meio
+    const uint8_t mid = (uint8_t) (_count / 2);
+    return (_count & 1) ? v[mid] : (uint16_t) ((v[mid - 1] + v[mid] + 1) / 2);
+}
@@ -0,0 +1,101 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+#include "AdcSampler.h"
+
+AdcSampler::AdcSampler(const Config &cfg) : _cfg(cfg) {
+}
+
+AdcSampler::~AdcSampler() {
+    end();
+}
+
+int AdcSampler::addChannel(const Channel &ch) {
+    if (_timer || _channelCount >= ADC_SAMPLER_MAX_CHANNELS || ch.pin == 0xFF) return -1;
+
+    Slot &s = _slots[_channelCount];
+    s.pin = ch.pin;
+    s.filter.configure(ch.filter);
+    return _channelCount++;
+}
+
+bool AdcSampler::begin() {
+    if (_timer) return true;
+    if (_channelCount == 0 || _cfg.periodUs == 0) return false;
+
+    analogReadResolution(_cfg.resolutionBits);
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        pinMode(_slots[i].pin, INPUT);
+        analogSetPinAttenuation(_slots[i].pin, ADC_11db);
+        // 1ª leitura publicada na hora (value() válido antes da 1ª saída do filtro)
+        const uint16_t v = (uint16_t) analogRead(_slots[i].pin);
+        _slots[i].last.store(v, std::memory_order_relaxed);
+        _slots[i].out.store(v, std::memory_order_release);
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = &AdcSampler::onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "adc_sampler";
+    args.skip_unhandled_events = true; // atraso da task não vira rajada de leituras
+
+    if (esp_timer_create(&args, &_timer) != ESP_OK) {
+        _timer = nullptr;
+        return false;
+    }
+    if (esp_timer_start_periodic(_timer, _cfg.periodUs) != ESP_OK) {
+        esp_timer_delete(_timer);
+        _timer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AdcSampler::end() {
+    if (!_timer) return;
+    esp_timer_stop(_timer);
+    esp_timer_delete(_timer);
+    _timer = nullptr;
+}
+
+void AdcSampler::onTimer(void *arg) {
+    static_cast<AdcSampler *>(arg)->sample();
+}
+
+void AdcSampler::sample() {
+    const int64_t t0 = esp_timer_get_time();
+
+    for (uint8_t i = 0; i < _channelCount; i++) sampleChannel(_slots[i]);
+
+    // Só o timer escreve: load + store basta (sem CAS)
+    const uint32_t dt = (uint32_t) (esp_timer_get_time() - t0);
+    if (dt > _maxTickUs.load(std::memory_order_relaxed)) _maxTickUs.store(dt, std::memory_order_relaxed);
+    _ticks.store(_ticks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void AdcSampler::sampleChannel(Slot &s) {
+    const uint16_t v = (uint16_t) analogRead(s.pin);
+    s.last.store(v, std::memory_order_relaxed);
+
+    if (!s.filter.push(v)) return;
+
+    // Valor e contador numa palavra só: o leitor nunca vê metade de uma atualização
+    const uint32_t seq = (s.out.load(std::memory_order_relaxed) >> 16) + 1;
+    s.out.store((seq << 16) | s.filter.output(), std::memory_order_release);
+}
+
+uint16_t AdcSampler::value(uint8_t ch) const {
+    if (ch >= _channelCount) return 0;
+    return (uint16_t) (_slots[ch].out.load(std::memory_order_acquire) & 0xFFFF);
+}
+
+uint16_t AdcSampler::outputs(uint8_t ch) const {
+    if (ch >= _channelCount) return 0;
+    return (uint16_t) (_slots[ch].out.load(std::memory_order_acquire) >> 16);
+}
+
+uint16_t AdcSampler::raw(uint8_t ch) const {
+    if (ch >= _channelCount) return 0;
+    return (uint16_t) _slots[ch].last.load(std::memory_order_relaxed);
+}
@@ -8,6 +8,8 @@
 #pragma once
 #include <Arduino.h>
 
+class AdcSampler;
+
 class FuelLevel {
 public:
     struct Config {
@@ -16,6 +18,10 @@ public:
         int adcMax = 3800; // calibração: leitura máxima real (pot no 100%)
         bool invert = false; // se o sentido ficar invertido
         uint8_t samples = 10; // média simples
+
+        // Com sampler: lê o valor já filtrado em segundo plano (O(1), sem analogRead/delay)
+        const AdcSampler *sampler = nullptr;
+        uint8_t samplerChannel = 0;
     };
 
     explicit FuelLevel(const Config &cfg);
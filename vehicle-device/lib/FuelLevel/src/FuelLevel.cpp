@@ -3,14 +3,19 @@
 //
 #include "FuelLevel.h"
 
+#include <AdcSampler.h>
+
 FuelLevel::FuelLevel(const Config &cfg) : _cfg(cfg) {
 }
 
 void FuelLevel::begin() {
+    if (_cfg.sampler) return; // pino configurado pelo AdcSampler
     pinMode(_cfg.adcPin, INPUT);
 }
 
 int FuelLevel::readRawAveraged() const {
+    if (_cfg.sampler) return _cfg.sampler->value(_cfg.samplerChannel);
+
     long sum = 0;
     const uint8_t n = (_cfg.samples == 0) ? 1 : _cfg.samples;
 
@@ -22,6 +27,7 @@ int FuelLevel::readRawAveraged() const {
 }
 
 int FuelLevel::readRaw() {
+    if (_cfg.sampler) return _cfg.sampler->raw(_cfg.samplerChannel);
     return analogRead(_cfg.adcPin);
 }
 
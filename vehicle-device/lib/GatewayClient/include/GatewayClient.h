@@ -1,10 +1,30 @@
 #pragma once
 
 #include <Arduino.h>
+#include <WiFiClient.h>
+#include <atomic>
+#include <functional>
+#include <lwip/ip_addr.h>
+
+#ifndef GATEWAY_CLIENT_BATCH_MAX
+#define GATEWAY_CLIENT_BATCH_MAX 10 // amostras acumuladas no máximo (RAM fixa)
+#endif
+
+#ifndef GATEWAY_CLIENT_TX_BYTES
+#define GATEWAY_CLIENT_TX_BYTES 3072 // request HTTP inteiro (cabeçalho + body cifrado)
+#endif
+
+#ifndef GATEWAY_CLIENT_RX_BYTES
+#define GATEWAY_CLIENT_RX_BYTES 1024 // resposta guardada (o excedente do body é descartado)
+#endif
 
 // SecureHttp (device side)
 #include <SecureDeviceAuth.h>
+#include <SecureSession.h>
 
+// publishTelemetry() só enfileira; connect/write/read andam em update(), que
+// nunca espera pela rede. O fim de cada envio chega pelo onSendResult() (ou
+// por busy()/lastError()/lastHttpStatus()).
 class GatewayClient {
 public:
     struct Config {
@@ -15,28 +35,90 @@ public:
         // SecureHttp
         const char *deviceId = "vehicle-device-01";
 
-        uint32_t minIntervalMs = 2000; // evita flood
-        uint32_t timeoutMs = 3000; // timeout de response
+        uint32_t minIntervalMs = 2000; // evita flood (entre inícios de envio)
+        uint32_t timeoutMs = 3000; // timeout de connect e de response
+
+        // Conexão HTTP/1.1 persistente reaproveitada entre envios (sem handshake TCP por amostra).
+        // Fechada após keepAliveIdleMs sem uso (fique abaixo do keepAliveIdleMs do gateway);
+        // se o gateway fechou antes, reconecta e reenvia uma vez
+        bool keepAlive = true;
+        uint32_t keepAliveIdleMs = 10000;
+
+        // Lote: acumula N amostras com timestamp e envia num único envelope SecureHttp
+        uint8_t batchSize = 1; // 1 = envio imediato (sem lote)
+        const char *batchPath = "/telemetry/batch";
+        uint32_t batchMaxAgeMs = 10000; // envia mesmo incompleto após esse tempo
+
+        // Body do ciphertext: Raw (metade do hex no ar). Se o gateway recusar
+        // (415, ou 400 bad_body de gateway antigo) cai para Base64Url e depois Hex
+        SecureBodyEncoding bodyEncoding = SecureBodyEncoding::Raw;
+
+        // Envelope: V2 só AES-GCM (sem HMAC/X-Signature). Gateway antigo
+        // (400 missing_headers / unsupported_protocol) -> V1
+        SecureProtocol protocol = SecureProtocol::V2;
+
+        // V2: metadados do envelope num único header X-SecureHttp (base64url).
+        // Gateway sem suporte (400 missing_headers) -> headers avulsos
+        bool compactHeader = true;
+
+        // Modo sessão: 1 handshake (POST /session) e depois só X-Session/X-Seq,
+        // sem relógio/RNG/HMAC por envio. Gateway sem /session (404) -> envelope completo
+        bool useSession = false;
     };
 
     enum class Error : uint8_t {
         None = 0,
         InvalidConfig,
         WifiNotConnected,
-        RateLimited,
+        RateLimited, // não é mais retornado (o intervalo só adia o envio)
         ConnectFailed,
         Timeout,
         BadHttpStatus,
-        SecureBuildFailed
+        SecureBuildFailed,
+        RequestTooLarge // request não cabe em GATEWAY_CLIENT_TX_BYTES
     };
 
+    // Amostra com o instante de captura (POD: pode ir direto para o flash)
+    struct Sample {
+        uint32_t ts; // epoch (s); 0 = relógio não sincronizado
+        uint32_t ms; // millis() da captura (completa o ts quando o relógio sincroniza)
+        float temperature;
+        float humidity;
+        int8_t fuelLevel; // <0 = ausente
+        float stepperSpeed; // <0 = ausente
+        float stepperRpm; // <0 = ausente
+    };
+
+    // Envio concluído (sucesso ou desistência)
+    struct SendResult {
+        bool ok = false;
+        Error error = Error::None;
+        int httpStatus = -1;
+        uint8_t samples = 0; // amostras que iam no envio
+        bool stored = false; // envio de publishStored()
+        bool rejected = false; // 400 bad_batch/empty_batch: conteúdo recusado, reenviar não adianta
+    };
+
+    using ResultCallback = std::function<void(const SendResult &)>;
+    using SampleCallback = std::function<void(const Sample &)>;
+
     explicit GatewayClient(const Config &cfg);
 
     void begin(); // reservado
-    void update(); // reservado
+    void update(); // avança o envio em curso / inicia o próximo; fecha keep-alive ocioso
 
     void setDebugStream(Stream *s);
 
+    // Chamado em update() ao fim de cada envio
+    void onSendResult(ResultCallback cb);
+
+    // Chamado para cada amostra que o cliente desiste de enviar: fila cheia, amostra
+    // substituída pela mais nova ou envio sem lote que falhou (ex.: gravar no flash)
+    void onSampleDropped(SampleCallback cb);
+
+    // Enfileiram a amostra e retornam na hora (false só com config inválida).
+    // Sem lote, uma amostra ainda não enviada é substituída pela nova (vale a mais recente)
+
     // Compatível com versão anterior
     bool publishTelemetry(float temperature, float humidity);
 
@@ -47,25 +129,221 @@ public:
     bool publishTelemetry(float temperature, float humidity, int fuelLevelPercent, float stepperSpeed,
                           float stepperRpm);
 
+    // Envia as amostras acumuladas no próximo update(), sem esperar o lote completar
+    bool flush();
+
+    // Envia amostras guardadas fora do cliente (com o ts original) num POST em batchPath,
+    // no intervalo livre entre envios da fila. O lote vai marcado "stored":true: o gateway
+    // só grava no histórico (sem ts a amostra é ignorada), nunca como estado atual.
+    // Copia as amostras; false se já há um envio desses pendente. Falha não passa por
+    // onSampleDropped (quem chamou ainda as tem)
+    bool publishStored(const Sample *samples, uint8_t count);
+
+    // Preenche ts (se 0) a partir do ms da captura; false se o relógio ainda não sincronizou.
+    // Só vale no mesmo boot em que a amostra foi capturada
+    static bool resolveTs(Sample &s);
+
+    // publishStored() aguardando ou em curso
+    bool storedPending() const noexcept { return _storedCount > 0; }
+
+    // Envio em curso (connect/write/read)
+    bool busy() const noexcept { return _state != State::Idle; }
+
+    uint8_t pendingSamples() const noexcept { return _pendingCount; }
+    uint32_t droppedSamples() const noexcept { return _droppedSamples; }
+
     Error lastError() const noexcept { return _lastError; }
     int lastHttpStatus() const noexcept { return _lastHttpStatus; }
     uint32_t lastPublishMs() const noexcept { return _lastPublishMs; }
 
+    // Encoding em uso (após eventual fallback)
+    SecureBodyEncoding bodyEncoding() const noexcept { return _encoding; }
+
+    // Versão do envelope em uso (após eventual fallback)
+    SecureProtocol protocol() const noexcept { return _protocol; }
+
+    // Sessão SecureHttp aberta agora
+    bool sessionActive() const { return _session.active(millis()); }
+
+    // Conexões TCP abertas / requests enviados numa conexão já aberta
+    uint32_t connectionsOpened() const noexcept { return _connectionsOpened; }
+    uint32_t reusedRequests() const noexcept { return _reusedRequests; }
+
+    // Fecha a conexão keep-alive (ex.: antes de desligar o WiFi); aborta envio em curso
+    void closeConnection();
+
 private:
+    enum class State : uint8_t {
+        Idle = 0,
+        Resolving, // DNS do host em andamento no lwIP (sem esperar)
+        Connecting, // connect() não-bloqueante em andamento (ou aguardando a 2ª tentativa)
+        Writing, // request saindo aos pedaços (send sem bloquear)
+        Reading // esperando/lendo a resposta
+    };
+
+    // Request do envio em curso
+    enum class Step : uint8_t {
+        Handshake = 0, // POST /session
+        Post // amostras (envelope completo ou sessão)
+    };
+
     Config _cfg{};
     Stream *_dbg = nullptr;
+    ResultCallback _onResult;
+    SampleCallback _onDropped;
+
+    WiFiClient _conn; // keep-alive com o gateway
+    bool _connOpen = false;
+    uint32_t _connLastUseMs = 0;
+    uint32_t _connectionsOpened = 0;
+    uint32_t _reusedRequests = 0;
+
+    IPAddress _hostIp;
+    bool _hostResolved = false;
+
+    // Resultado do DNS assíncrono: escrito pelo callback do lwIP (task tcpip)
+    enum DnsState : uint8_t { DnsIdle = 0, DnsPending, DnsDone, DnsFailed };
+    std::atomic<uint8_t> _dnsState{DnsIdle};
+    std::atomic<uint32_t> _dnsIp{0};
 
     SecureDeviceAuth _secure;
+    SecureSessionClient _session;
+    bool _sessionUnsupported = false; // gateway respondeu 404 em /session
+    SecureBodyEncoding _encoding = SecureBodyEncoding::Raw;
+    SecureProtocol _protocol = SecureProtocol::V2;
+    bool _compactHeader = true; // X-SecureHttp em vez dos headers avulsos
 
     Error _lastError = Error::None;
     int _lastHttpStatus = -1;
     uint32_t _lastPublishMs = 0;
+    uint32_t _lastAttemptMs = 0;
+    bool _attempted = false;
+
+    Sample _pending[GATEWAY_CLIENT_BATCH_MAX];
+    uint8_t _pendingHead = 0; // amostra mais antiga
+    uint8_t _pendingCount = 0;
+    uint32_t _firstPendingMs = 0;
+    uint32_t _droppedSamples = 0;
+    bool _flushRequested = false;
+
+    Sample _stored[GATEWAY_CLIENT_BATCH_MAX]; // publishStored()
+    uint8_t _storedCount = 0;
+
+    // Envio em curso: as _jobSamples amostras mais antigas da fila
+    State _state = State::Idle;
+    Step _step = Step::Post;
+    bool _stepSession = false; // Post via X-Session/X-Seq
+    bool _sessionRetried = false; // unknown_session já refez o handshake neste envio
+    bool _jobStored = false; // envio de _stored (não da fila)
+    bool _jobRejected = false; // gateway recusou o conteúdo do lote (SendResult.rejected)
+    const char *_jobPath = nullptr;
+    String _jobBody; // plaintext JSON
+    uint8_t _jobSamples = 0;
+    uint32_t _jobStartMs = 0;
+
+    // Rede do request atual
+    int _connectFd = -1; // socket em connect(); -1 = aguardando _retryAtMs
+    uint8_t _connectAttempt = 0;
+    uint32_t _retryAtMs = 0;
+    uint32_t _stateMs = 0; // início do estado (timeout)
+    bool _reqReused = false; // request numa conexão reaproveitada
+    bool _resent = false; // já reenviado após a conexão cair sem resposta
+
+    uint8_t _tx[GATEWAY_CLIENT_TX_BYTES];
+    size_t _txLen = 0;
+    size_t _txSent = 0;
+
+    char _rx[GATEWAY_CLIENT_RX_BYTES + 1];
+    size_t _rxLen = 0; // bytes guardados em _rx
+    size_t _rxTotal = 0; // bytes recebidos (inclui os descartados)
+    size_t _rxHeadEnd = 0; // 0 = cabeçalho incompleto
+    long _rxContentLength = -1;
+    bool _rxKeepAlive = false;
+    int _rxStatus = -1;
+
+    bool batching() const noexcept { return _cfg.batchSize > 1; }
+
+    // Amostras da fila no envio em curso (envio de _stored não tira nada da fila)
+    uint8_t queueInFlight() const noexcept { return _jobStored ? 0 : _jobSamples; }
+
+    const Sample &pendingAt(uint8_t i) const {
+        return _pending[(_pendingHead + i) % GATEWAY_CLIENT_BATCH_MAX];
+    }
+
+    void enqueue(const Sample &s);
+
+    // Remove as n amostras mais antigas
+    void popSamples(uint8_t n);
+
+    static void appendSampleJson(String &out, const Sample &s);
 
     bool canPublishNow(uint32_t now) const;
 
+    bool readyToSend(uint32_t now) const;
+
+    void dropSample(const Sample &s);
+
     void dbgln(const String &s);
 
     bool isConfigValid() const;
 
-    bool sendSecurePost(const String &plaintextJson);
+    // Monta o body do envio (1 amostra, lote ou _stored) e dispara o 1º request
+    void startJob(bool stored);
+
+    // Próximo request do envio: handshake se a sessão não está aberta, senão o POST
+    void startStep();
+
+    bool buildHandshake();
+
+    bool buildPost();
+
+    // Cabeçalho HTTP + body em _tx
+    bool buildRequest(const char *path, const String &headers, const uint8_t *body, size_t bodyLen);
+
+    // Reaproveita a conexão aberta ou inicia um connect
+    void beginExchange();
+
+    void startConnect();
+
+    // Pede o IP do host ao lwIP; a resposta chega em onDnsFound()
+    void startResolve();
+
+    static void onDnsFound(const char *name, const ip_addr_t *addr, void *arg);
+
+    void serviceResolve();
+
+    // socket() + connect() não-bloqueante para _hostIp
+    void openSocket();
+
+    void serviceConnect();
+
+    void serviceWrite();
+
+    void serviceRead();
+
+    // Parse do cabeçalho em _rx; false se malformado
+    bool parseResponseHead();
+
+    // Conexão caiu antes de qualquer byte da resposta
+    void onConnectionLost();
+
+    // Resposta completa: decide fallback/próximo request ou conclui
+    void handleResponse();
+
+    void failJob(Error e, const char *msg);
+
+    // Fecha o socket keep-alive (não mexe no envio em curso)
+    void dropConnection();
+
+    void finishJob(bool ok);
+
+    bool downgradeEncoding();
+
+    // X-SecureHttp -> headers avulsos -> V1
+    bool downgradeProtocol();
+
+    String envelopeHeaders(const SecureDeviceAuth::Result &req) const;
+
+    // Resposta de gateway que não aceita o envelope v2
+    bool protocolRejected(const String &respBody) const;
 };
@@ -2,6 +2,16 @@
 
 #include <WiFi.h>
 #include <WiFiClient.h>
+#include <errno.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+#include <lwip/tcpip.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <SecureKeyStore.h> // SECURE_KEY_VERSION_HEADER
+#include <SecureProtocol.h>
 
 static void dbgNet(Stream *dbg, const char *host, uint16_t port) {
     if (!dbg) return;
@@ -15,7 +25,64 @@ static void dbgNet(Stream *dbg, const char *host, uint16_t port) {
     dbg->println(port);
 }
 
-GatewayClient::GatewayClient(const Config &cfg) : _cfg(cfg) {
+// dns_gethostbyname() tem de rodar na task tcpip (como WiFi.hostByName() faz), mas
+// sem esperar a resposta: ERR_INPROGRESS e o callback chega depois
+struct DnsCall {
+    struct tcpip_api_call_data call; // 1º membro: o lwIP devolve este ponteiro
+    const char *host;
+    dns_found_callback found;
+    void *arg;
+    ip_addr_t addr;
+    err_t err;
+};
+
+static err_t dnsCallTcpip(struct tcpip_api_call_data *data) {
+    DnsCall *c = (DnsCall *) data;
+    c->err = dns_gethostbyname(c->host, &c->addr, c->found, c->arg);
+    return ERR_OK;
+}
+
+static String encodingHeader(SecureBodyEncoding encoding) {
+    if (encoding == SecureBodyEncoding::Hex) return String();
+    return String(SECURE_BODY_ENCODING_HEADER ": ") + secureBodyEncodingName(encoding) + "\r\n";
+}
+
+// Procura "\r\n\r\n"; retorna o offset do início do body ou 0
+static size_t findHeadEnd(const char *buf, size_t len) {
+    for (size_t i = 0; i + 3 < len; i++) {
+        if (buf[i] == '\r' && buf[i + 1] == '\n' && buf[i + 2] == '\r' && buf[i + 3] == '\n') return i + 4;
+    }
+    return 0;
+}
+
+// Headers do envelope SecureHttp completo
+String GatewayClient::envelopeHeaders(const SecureDeviceAuth::Result &req) const {
+    if (_compactHeader && req.protocol == SecureProtocol::V2) {
+        // Device, timestamp, nonce, IV, tag, versão da chave e encoding num header só
+        const String packed = req.packedHeader();
+        if (packed.length() > 0) return String(SECURE_PACKED_HEADER ": ") + packed + "\r\n";
+    }
+
+    String h;
+    h.reserve(220);
+    h += String("X-Device-Id: ") + req.deviceId + "\r\n";
+    h += String("X-Timestamp: ") + req.timestamp + "\r\n";
+    h += String("X-Nonce: ") + req.nonce + "\r\n";
+    h += String("X-IV: ") + req.ivHex + "\r\n";
+    h += String("X-Tag: ") + req.tagHex + "\r\n";
+    if (req.protocol == SecureProtocol::V1) {
+        h += String("X-Signature: ") + req.signatureHex + "\r\n";
+    } else {
+        h += String(SECURE_VERSION_HEADER ": ") + secureProtocolName(req.protocol) + "\r\n";
+    }
+    h += String(SECURE_KEY_VERSION_HEADER ": ") + String(req.keyVersion) + "\r\n";
+    h += encodingHeader(req.encoding);
+    return h;
+}
+
+GatewayClient::GatewayClient(const Config &cfg) : _cfg(cfg), _encoding(cfg.bodyEncoding), _protocol(cfg.protocol),
+                                                     _compactHeader(cfg.compactHeader) {
+    if (_cfg.batchSize > GATEWAY_CLIENT_BATCH_MAX) _cfg.batchSize = GATEWAY_CLIENT_BATCH_MAX;
 }
 
 void GatewayClient::begin() {
@@ -23,13 +90,63 @@ void GatewayClient::begin() {
 }
 
 void GatewayClient::update() {
-    // reservado
+    const uint32_t now = millis();
+
+    if (_state != State::Idle && WiFi.status() != WL_CONNECTED) {
+        failJob(Error::WifiNotConnected, "[Gateway] WiFi lost during send");
+        return;
+    }
+
+    // Cada estado só usa o que já está no socket; o que terminar passa ao próximo na mesma chamada
+    if (_state == State::Resolving) serviceResolve();
+    if (_state == State::Connecting) serviceConnect();
+    if (_state == State::Writing) serviceWrite();
+    if (_state == State::Reading) serviceRead();
+    if (_state != State::Idle) return;
+
+    // Conexão parada além do keep-alive: fecha antes que o gateway feche (libera o socket)
+    if (_connOpen && now - _connLastUseMs >= _cfg.keepAliveIdleMs) dropConnection();
+
+    if (readyToSend(now)) {
+        startJob(false);
+    } else if (_storedCount > 0 && canPublishNow(now) && WiFi.status() == WL_CONNECTED) {
+        // Amostras guardadas só ocupam o intervalo em que a fila não tem envio pronto
+        startJob(true);
+    }
 }
 
 void GatewayClient::setDebugStream(Stream *s) {
     _dbg = s;
 }
 
+void GatewayClient::onSendResult(ResultCallback cb) {
+    _onResult = cb;
+}
+
+void GatewayClient::onSampleDropped(SampleCallback cb) {
+    _onDropped = cb;
+}
+
+void GatewayClient::dropSample(const Sample &s) {
+    _droppedSamples++;
+    if (!_onDropped) return;
+
+    // Sai com o epoch da captura se o relógio já sincronizou (ts 0 fica para quem recebe)
+    Sample out = s;
+    resolveTs(out);
+    _onDropped(out);
+}
+
+bool GatewayClient::resolveTs(Sample &s) {
+    if (s.ts != 0) return true;
+    const time_t epoch = time(nullptr);
+    if (epoch < 1700000000) return false;
+
+    const uint32_t ageSec = (millis() - s.ms) / 1000;
+    s.ts = (uint32_t) epoch - ageSec;
+    return true;
+}
+
 void GatewayClient::dbgln(const String &s) {
     if (_dbg) _dbg->println(s);
 }
@@ -38,12 +155,22 @@ bool GatewayClient::isConfigValid() const {
     return _cfg.host && _cfg.host[0] != '\0' &&
            _cfg.port != 0 &&
            _cfg.path && _cfg.path[0] != '\0' &&
+           (!batching() || (_cfg.batchPath && _cfg.batchPath[0] != '\0')) &&
            _cfg.deviceId && _cfg.deviceId[0] != '\0';
 }
 
 bool GatewayClient::canPublishNow(uint32_t now) const {
-    if (_lastPublishMs == 0) return true;
-    return (now - _lastPublishMs) >= _cfg.minIntervalMs;
+    if (!_attempted) return true;
+    return (now - _lastAttemptMs) >= _cfg.minIntervalMs;
+}
+
+bool GatewayClient::readyToSend(uint32_t now) const {
+    if (_pendingCount == 0 || !isConfigValid() || !canPublishNow(now)) return false;
+    if (WiFi.status() != WL_CONNECTED) return false;
+    if (!batching() || _flushRequested) return true;
+
+    // Lote completo, ou incompleto parado há batchMaxAgeMs
+    return _pendingCount >= _cfg.batchSize || now - _firstPendingMs >= _cfg.batchMaxAgeMs;
 }
 
 bool GatewayClient::publishTelemetry(float temperature, float humidity) {
@@ -62,144 +189,681 @@ bool GatewayClient::publishTelemetry(float temperature, float humidity,
                                      int fuelLevelPercent,
                                      float stepperSpeed,
                                      float stepperRpm) {
-    _lastError = Error::None;
-    _lastHttpStatus = -1;
-
     if (!isConfigValid()) {
         _lastError = Error::InvalidConfig;
         dbgln("[Gateway] invalid config (host/port/path/deviceId)");
         return false;
     }
 
-    const uint32_t now = millis();
-    if (!canPublishNow(now)) {
-        _lastError = Error::RateLimited;
-        dbgln("[Gateway] rate-limited (min interval not reached)");
-        return false;
+    Sample ps;
+    const time_t epoch = time(nullptr);
+    ps.ts = (epoch >= 1700000000) ? (uint32_t) epoch : 0;
+    ps.ms = millis();
+    ps.temperature = temperature;
+    ps.humidity = humidity;
+    ps.fuelLevel = (int8_t) (fuelLevelPercent >= 0 ? constrain(fuelLevelPercent, 0, 100) : -1);
+    ps.stepperSpeed = stepperSpeed;
+    ps.stepperRpm = stepperRpm;
+
+    if (!batching() && _pendingCount > queueInFlight()) {
+        // Sem lote: a amostra ainda não enviada é trocada pela mais recente
+        Sample &last = _pending[(_pendingHead + _pendingCount - 1) % GATEWAY_CLIENT_BATCH_MAX];
+        dropSample(last);
+        last = ps;
+        return true;
     }
 
-    if (WiFi.status() != WL_CONNECTED) {
-        _lastError = Error::WifiNotConnected;
-        dbgln("[Gateway] WiFi not connected");
+    enqueue(ps);
+    return true;
+}
+
+void GatewayClient::enqueue(const Sample &s) {
+    const uint8_t inFlight = queueInFlight();
+    if (_pendingCount == inFlight) _firstPendingMs = millis();
+
+    if (_pendingCount == GATEWAY_CLIENT_BATCH_MAX) {
+        // Fila cheia (gateway fora do ar): descarta a mais antiga que não está em envio
+        if (inFlight >= _pendingCount) {
+            dropSample(s);
+            return;
+        }
+        dropSample(pendingAt(inFlight));
+        for (uint8_t i = inFlight; i + 1 < _pendingCount; i++) {
+            _pending[(_pendingHead + i) % GATEWAY_CLIENT_BATCH_MAX] = pendingAt((uint8_t) (i + 1));
+        }
+        _pendingCount--;
+    }
+
+    _pending[(_pendingHead + _pendingCount) % GATEWAY_CLIENT_BATCH_MAX] = s;
+    _pendingCount++;
+}
+
+void GatewayClient::popSamples(uint8_t n) {
+    if (n > _pendingCount) n = _pendingCount;
+    _pendingHead = (uint8_t) ((_pendingHead + n) % GATEWAY_CLIENT_BATCH_MAX);
+    _pendingCount = (uint8_t) (_pendingCount - n);
+}
+
+void GatewayClient::appendSampleJson(String &out, const Sample &sample) {
+    // Capturada antes do NTP e enviada depois: leva o epoch da captura, não o do envio
+    Sample s = sample;
+    resolveTs(s);
+
+    out += '{';
+    if (s.ts != 0) {
+        out += "\"ts\":" + String(s.ts) + ",";
+    }
+    out += "\"temperature\":" + String(s.temperature, 2);
+    out += ",\"humidity\":" + String(s.humidity, 2);
+    if (s.fuelLevel >= 0) out += ",\"fuelLevel\":" + String((int) s.fuelLevel);
+    if (s.stepperSpeed >= 0.0f) out += ",\"stepperSpeed\":" + String(s.stepperSpeed, 1);
+    if (s.stepperRpm >= 0.0f) out += ",\"stepperRpm\":" + String(s.stepperRpm, 2);
+    out += '}';
+}
+
+bool GatewayClient::flush() {
+    if (_pendingCount > queueInFlight()) _flushRequested = true;
+    return true;
+}
+
+bool GatewayClient::publishStored(const Sample *samples, uint8_t count) {
+    if (!samples || count == 0 || _storedCount > 0) return false;
+    if (!isConfigValid() || !_cfg.batchPath || _cfg.batchPath[0] == '\0') {
+        _lastError = Error::InvalidConfig;
         return false;
     }
+    if (count > GATEWAY_CLIENT_BATCH_MAX) count = GATEWAY_CLIENT_BATCH_MAX;
+
+    memcpy(_stored, samples, sizeof(Sample) * count);
+    _storedCount = count;
+    return true;
+}
 
-    // plaintext JSON (será criptografado)
-    String body = "{";
-    body += "\"temperature\":" + String(temperature, 2);
-    body += ",\"humidity\":" + String(humidity, 2);
+void GatewayClient::startJob(bool stored) {
+    _lastError = Error::None;
+    _lastHttpStatus = -1;
 
-    if (fuelLevelPercent >= 0) {
-        fuelLevelPercent = constrain(fuelLevelPercent, 0, 100);
-        body += ",\"fuelLevel\":" + String(fuelLevelPercent);
+    _jobStartMs = millis();
+    _lastAttemptMs = _jobStartMs;
+    _attempted = true;
+    _sessionRetried = false;
+    _jobStored = stored;
+
+    if (stored) {
+        // Sempre no endpoint de lote: cada amostra leva o ts da captura e o lote vai
+        // marcado como guardado (o gateway não aplica como estado atual)
+        _jobSamples = _storedCount;
+        _jobPath = _cfg.batchPath;
+        _jobBody = String();
+        _jobBody.reserve(32 + (size_t) _jobSamples * 110);
+        _jobBody += "{\"stored\":true,\"samples\":[";
+        for (uint8_t i = 0; i < _jobSamples; i++) {
+            if (i > 0) _jobBody += ',';
+            appendSampleJson(_jobBody, _stored[i]);
+        }
+        _jobBody += "]}";
+    } else if (!batching()) {
+        _flushRequested = false;
+        // Amostra única em /telemetry
+        _jobSamples = 1;
+        _jobPath = _cfg.path;
+        _jobBody = String();
+        appendSampleJson(_jobBody, pendingAt(0));
+    } else {
+        // {"samples":[{...},{...}]} em ordem de captura
+        _flushRequested = false;
+        _jobSamples = _pendingCount;
+        _jobPath = _cfg.batchPath;
+        _jobBody = String();
+        _jobBody.reserve(16 + (size_t) _jobSamples * 110);
+        _jobBody += "{\"samples\":[";
+        for (uint8_t i = 0; i < _jobSamples; i++) {
+            if (i > 0) _jobBody += ',';
+            appendSampleJson(_jobBody, pendingAt(i));
+        }
+        _jobBody += "]}";
+    }
+
+    startStep();
+}
+
+void GatewayClient::startStep() {
+    _resent = false;
+
+    // Handshake no envelope completo só quando não há sessão (precisa de relógio sincronizado)
+    const bool handshake = _cfg.useSession && !_sessionUnsupported && !_session.active(millis());
+    if (!(handshake ? buildHandshake() : buildPost())) {
+        finishJob(false);
+        return;
     }
-    if (stepperSpeed >= 0.0f) body += ",\"stepperSpeed\":" + String(stepperSpeed, 1);
-    if (stepperRpm >= 0.0f) body += ",\"stepperRpm\":" + String(stepperRpm, 2);
+    beginExchange();
+}
+
+bool GatewayClient::buildHandshake() {
+    _step = Step::Handshake;
+    _stepSession = false;
 
-    body += "}";
+    const String hello = _session.handshakeBody();
+    auto req = _secure.encryptAndSign(_cfg.deviceId, "POST", SECURE_SESSION_PATH, hello, _encoding, _protocol);
+    if (hello.length() == 0 || !req.ok) {
+        _lastError = Error::SecureBuildFailed;
+        dbgln(String("[Gateway] session build failed: ") + req.error);
+        return false;
+    }
 
-    const bool ok = sendSecurePost(body);
-    if (ok) _lastPublishMs = now;
-    return ok;
+    return buildRequest(SECURE_SESSION_PATH, envelopeHeaders(req), req.bodyData(), req.bodyLen());
 }
 
-bool GatewayClient::sendSecurePost(const String &plaintextJson) {
-    auto req = _secure.encryptAndSign(_cfg.deviceId, "POST", _cfg.path, plaintextJson);
+bool GatewayClient::buildPost() {
+    _step = Step::Post;
+    _stepSession = _cfg.useSession && !_sessionUnsupported;
+
+    if (_stepSession) {
+        auto msg = _session.seal("POST", _jobPath, _jobBody, _encoding);
+        if (!msg.ok) {
+            _lastError = Error::SecureBuildFailed;
+            dbgln(String("[Gateway] session seal failed: ") + msg.error);
+            return false;
+        }
+
+        String headers;
+        headers += String(SECURE_SESSION_HEADER ": ") + msg.sid + "\r\n";
+        headers += String(SECURE_SEQ_HEADER ": ") + msg.seq + "\r\n";
+        headers += encodingHeader(_encoding);
+        return buildRequest(_jobPath, headers, msg.bodyData(), msg.bodyLen());
+    }
+
+    auto req = _secure.encryptAndSign(_cfg.deviceId, "POST", _jobPath, _jobBody, _encoding, _protocol);
     if (!req.ok) {
         _lastError = Error::SecureBuildFailed;
         dbgln(String("[Gateway] secure build failed: ") + req.error);
         return false;
     }
 
-    WiFiClient client;
+    return buildRequest(_jobPath, envelopeHeaders(req), req.bodyData(), req.bodyLen());
+}
+
+bool GatewayClient::buildRequest(const char *path, const String &headers, const uint8_t *body, size_t bodyLen) {
+    String head;
+    head.reserve(160 + headers.length());
+    head += String("POST ") + path + " HTTP/1.1\r\n";
+    head += String("Host: ") + _cfg.host + "\r\n";
+    head += "User-Agent: vehicle-device/1.0\r\n";
+    head += "Content-Type: application/octet-stream\r\n";
+    head += String("Content-Length: ") + (unsigned) bodyLen + "\r\n";
+    head += headers;
+    head += _cfg.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    if (head.length() + bodyLen > sizeof(_tx)) {
+        _lastError = Error::RequestTooLarge;
+        dbgln(String("[Gateway] request too large: ") + (unsigned) (head.length() + bodyLen));
+        return false;
+    }
+
+    // Request inteiro num buffer só: sai em um send() quando o socket tem espaço
+    memcpy(_tx, head.c_str(), head.length());
+    if (bodyLen > 0) memcpy(_tx + head.length(), body, bodyLen);
+    _txLen = head.length() + bodyLen;
+    return true;
+}
+
+void GatewayClient::beginExchange() {
+    _txSent = 0;
+    _rxLen = 0;
+    _rxTotal = 0;
+    _rxHeadEnd = 0;
+    _rxContentLength = -1;
+    _rxKeepAlive = false;
+    _rxStatus = -1;
+
+    // Ociosa demais (o gateway pode ter fechado), sobra de resposta ou peer fechou: descarta
+    _reqReused = _connOpen && millis() - _connLastUseMs < _cfg.keepAliveIdleMs &&
+                 _conn.connected() && _conn.available() == 0;
+    if (_reqReused) {
+        _state = State::Writing;
+        _stateMs = millis();
+        return;
+    }
+
+    dropConnection();
+    _connectAttempt = 0;
+    startConnect();
+}
+
+void GatewayClient::startConnect() {
+    _connectAttempt++;
+    _stateMs = millis();
+    _connectFd = -1;
+
+    // IP literal não consulta DNS; nome vai ao lwIP e o connect() espera a resposta em update()
+    if (!_hostResolved) _hostResolved = _hostIp.fromString(_cfg.host);
+    if (!_hostResolved) {
+        _state = State::Resolving;
+        startResolve();
+        return;
+    }
+    openSocket();
+}
+
+void GatewayClient::startResolve() {
+    // Consulta de um envio anterior (que expirou) ainda no lwIP: aguarda a resposta dela
+    if (_dnsState.load() == DnsPending) return;
+    _dnsState.store(DnsPending);
+
+    DnsCall c;
+    memset(&c, 0, sizeof(c));
+    c.host = _cfg.host;
+    c.found = &GatewayClient::onDnsFound;
+    c.arg = this;
+    c.err = ERR_ARG;
+    tcpip_api_call(dnsCallTcpip, &c.call);
+
+    if (c.err == ERR_OK) onDnsFound(_cfg.host, &c.addr, this); // já estava no cache do lwIP
+    else if (c.err != ERR_INPROGRESS) _dnsState.store(DnsFailed);
+}
+
+// Task tcpip (ou startResolve() com o nome em cache). addr nulo = nome não encontrado
+void GatewayClient::onDnsFound(const char *name, const ip_addr_t *addr, void *arg) {
+    (void) name;
+    GatewayClient *self = static_cast<GatewayClient *>(arg);
+    if (addr && IP_IS_V4(addr)) {
+        self->_dnsIp.store(ip_2_ip4(addr)->addr);
+        self->_dnsState.store(DnsDone);
+    } else {
+        self->_dnsState.store(DnsFailed);
+    }
+}
+
+void GatewayClient::serviceResolve() {
+    const uint8_t dns = _dnsState.load();
+    if (dns == DnsPending) {
+        if (millis() - _stateMs > _cfg.timeoutMs) failJob(Error::ConnectFailed, "[Gateway] DNS timeout");
+        return;
+    }
+
+    _dnsState.store(DnsIdle);
+    if (dns != DnsDone) {
+        failJob(Error::ConnectFailed, "[Gateway] cannot resolve host");
+        return;
+    }
+    _hostIp = IPAddress(_dnsIp.load());
+    _hostResolved = true;
+    _stateMs = millis(); // timeout do connect conta a partir daqui
+    openSocket();
+}
+
+void GatewayClient::openSocket() {
+    _state = State::Connecting;
 
-    // "best effort" (Arduino core), a gente controla timeout no loop abaixo
-    client.setTimeout(1);
+    const int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        failJob(Error::ConnectFailed, "[Gateway] socket() failed");
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_cfg.port);
+    const uint32_t ip = _hostIp;
+    memcpy(&addr.sin_addr.s_addr, &ip, 4);
+
+    // Não-bloqueante: EINPROGRESS e o resultado chega em serviceConnect()
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        _retryAtMs = millis() + 50;
+        return;
+    }
+    _connectFd = fd;
+}
 
-    bool connected = false;
-    for (int attempt = 1; attempt <= 2; attempt++) {
-        if (client.connect(_cfg.host, _cfg.port)) {
-            connected = true;
-            break;
+void GatewayClient::serviceConnect() {
+    if (_connectFd < 0) {
+        // Tentativa falhou na hora: 2ª tentativa após 50 ms (sem delay())
+        if (_connectAttempt >= 2) {
+            dbgNet(_dbg, _cfg.host, _cfg.port);
+            _hostResolved = false; // IP do gateway pode ter mudado (DHCP): próximo envio resolve de novo
+            failJob(Error::ConnectFailed, "[Gateway] connect failed");
+        } else if ((int32_t) (millis() - _retryAtMs) >= 0) {
+            dbgln("[Gateway] connect failed, retrying");
+            startConnect();
         }
-        if (attempt == 1) {
-            dbgln("[Gateway] connect failed");
+        return;
+    }
+
+    fd_set wset;
+    FD_ZERO(&wset);
+    FD_SET(_connectFd, &wset);
+    struct timeval tv = {0, 0};
+    const int r = select(_connectFd + 1, nullptr, &wset, nullptr, &tv);
+
+    if (r == 0) {
+        if (millis() - _stateMs > _cfg.timeoutMs) {
+            close(_connectFd);
+            _connectFd = -1;
             dbgNet(_dbg, _cfg.host, _cfg.port);
+            _hostResolved = false;
+            failJob(Error::ConnectFailed, "[Gateway] connect timeout");
         }
-        delay(50);
+        return;
     }
 
-    if (!connected) {
-        _lastError = Error::ConnectFailed;
-        return false;
+    int err = 0;
+    socklen_t errLen = sizeof(err);
+    if (r < 0 || getsockopt(_connectFd, SOL_SOCKET, SO_ERROR, &err, &errLen) < 0 || err != 0) {
+        close(_connectFd);
+        _connectFd = -1;
+        _retryAtMs = millis() + 50;
+        return;
     }
 
-    const String &cipherHex = req.ciphertextHex;
-
-    // HTTP POST SecureHttp
-    client.print(String("POST ") + _cfg.path + " HTTP/1.1\r\n");
-    client.print(String("Host: ") + _cfg.host + "\r\n");
-    client.print("User-Agent: vehicle-device/1.0\r\n");
-    client.print("Content-Type: application/octet-stream\r\n");
-    client.print(String("Content-Length: ") + cipherHex.length() + "\r\n");
-
-    client.print(String("X-Device-Id: ") + req.deviceId + "\r\n");
-    client.print(String("X-Timestamp: ") + req.timestamp + "\r\n");
-    client.print(String("X-Nonce: ") + req.nonce + "\r\n");
-    client.print(String("X-IV: ") + req.ivHex + "\r\n");
-    client.print(String("X-Tag: ") + req.tagHex + "\r\n");
-    client.print(String("X-Signature: ") + req.signatureHex + "\r\n");
-
-    client.print("Connection: close\r\n\r\n");
-    client.print(cipherHex);
-
-    // Aguarda status line
-    const uint32_t t0 = millis();
-    while (!client.available()) {
-        if (millis() - t0 > _cfg.timeoutMs) {
-            _lastError = Error::Timeout;
-            dbgln("[Gateway] timeout waiting response");
-            client.stop();
-            return false;
+    // Socket conectado passa a ser do WiFiClient (stop() fecha)
+    _conn = WiFiClient(_connectFd);
+    _connectFd = -1;
+    _conn.setNoDelay(true); // request sai de uma vez; sem esperar ACK (Nagle)
+    _connOpen = true;
+    _connectionsOpened++;
+    _state = State::Writing;
+    _stateMs = millis();
+}
+
+void GatewayClient::serviceWrite() {
+    const int fd = _conn.fd();
+    if (fd < 0) {
+        onConnectionLost();
+        return;
+    }
+
+    // Só o que cabe no buffer TCP agora; o resto no próximo update()
+    const ssize_t n = send(fd, _tx + _txSent, _txLen - _txSent, MSG_DONTWAIT);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (millis() - _stateMs > _cfg.timeoutMs) failJob(Error::Timeout, "[Gateway] timeout sending request");
+            return;
         }
-        delay(2);
+        onConnectionLost();
+        return;
     }
 
-    String statusLine = client.readStringUntil('\n');
-    statusLine.trim();
+    _txSent += (size_t) n;
+    if (_txSent < _txLen) return;
+
+    _state = State::Reading;
+    _stateMs = millis();
+}
+
+bool GatewayClient::parseResponseHead() {
+    // Status line "HTTP/1.1 200 OK"
+    _rx[_rxHeadEnd - 2] = '\0';
+    char *line = _rx;
+    char *eol = strstr(line, "\r\n");
+    if (eol) *eol = '\0';
+
+    const char *sp = strchr(line, ' ');
+    if (strncmp(line, "HTTP/1.", 7) != 0 || !sp) return false;
+    _rxStatus = atoi(sp + 1);
+    _rxKeepAlive = strncmp(line, "HTTP/1.1", 8) == 0;
+
+    // Headers: Content-Length delimita a resposta (a conexão continua aberta)
+    char *p = eol ? eol + 2 : nullptr;
+    while (p && *p) {
+        char *next = strstr(p, "\r\n");
+        if (next) *next = '\0';
+
+        if (strncasecmp(p, "Content-Length:", 15) == 0) {
+            _rxContentLength = strtol(p + 15, nullptr, 10);
+        } else if (strncasecmp(p, "Connection:", 11) == 0) {
+            const char *v = p + 11;
+            while (*v == ' ') v++;
+            if (strcasecmp(v, "close") == 0) _rxKeepAlive = false;
+        }
 
-    // Parse "HTTP/1.1 200 OK"
-    int code = -1;
-    int p1 = statusLine.indexOf(' ');
-    if (p1 > 0) {
-        int p2 = statusLine.indexOf(' ', p1 + 1);
-        if (p2 > p1) code = statusLine.substring(p1 + 1, p2).toInt();
+        p = next ? next + 2 : nullptr;
     }
-    _lastHttpStatus = code;
+    return true;
+}
 
-    // Consome headers
-    while (client.available()) {
-        String line = client.readStringUntil('\n');
-        line.trim();
-        if (line.length() == 0) break;
+void GatewayClient::serviceRead() {
+    char scratch[64];
+
+    for (;;) {
+        const int avail = _conn.available();
+        if (avail <= 0) break;
+
+        // Guarda até GATEWAY_CLIENT_RX_BYTES; além disso o body é lido e descartado
+        const size_t space = GATEWAY_CLIENT_RX_BYTES - _rxLen;
+        char *dst = space > 0 ? _rx + _rxLen : scratch;
+        size_t n = (size_t) avail;
+        const size_t cap = space > 0 ? space : sizeof(scratch);
+        if (n > cap) n = cap;
+
+        const int got = _conn.read((uint8_t *) dst, n);
+        if (got <= 0) break;
+        if (space > 0) _rxLen += (size_t) got;
+        _rxTotal += (size_t) got;
+
+        if (_rxHeadEnd == 0) {
+            _rxHeadEnd = findHeadEnd(_rx, _rxLen);
+            if (_rxHeadEnd == 0) {
+                if (_rxLen == GATEWAY_CLIENT_RX_BYTES) {
+                    failJob(Error::BadHttpStatus, "[Gateway] response head too large");
+                    return;
+                }
+                continue;
+            }
+            if (!parseResponseHead()) {
+                failJob(Error::BadHttpStatus, "[Gateway] malformed response");
+                return;
+            }
+        }
+
+        if (_rxContentLength >= 0 && _rxTotal - _rxHeadEnd >= (size_t) _rxContentLength) {
+            handleResponse();
+            return;
+        }
     }
 
-    // Lê body (útil em erro)
-    String respBody;
-    const uint32_t t1 = millis();
-    while (millis() - t1 < 250 && client.available()) {
-        respBody += client.readString();
+    if (!_conn.connected()) {
+        if (_rxTotal == 0) {
+            onConnectionLost();
+        } else if (_rxHeadEnd > 0 && _rxContentLength < 0) {
+            // Sem Content-Length: a resposta termina quando o gateway fecha
+            _rxKeepAlive = false;
+            handleResponse();
+        } else {
+            failJob(Error::Timeout, "[Gateway] connection closed mid-response");
+        }
+        return;
     }
 
-    client.stop();
+    if (millis() - _stateMs > _cfg.timeoutMs) failJob(Error::Timeout, "[Gateway] timeout waiting response");
+}
+
+void GatewayClient::onConnectionLost() {
+    dropConnection();
+
+    // Conexão reaproveitada pode ter sido fechada pelo gateway sem aviso:
+    // nada chegou de volta -> reconecta e reenvia uma vez
+    if (_reqReused && !_resent) {
+        _resent = true;
+        _reqReused = false;
+        dbgln("[Gateway] keep-alive connection closed by gateway, reconnecting");
+        _txSent = 0;
+        _connectAttempt = 0;
+        startConnect();
+        return;
+    }
+
+    failJob(Error::ConnectFailed, "[Gateway] connection closed before response");
+}
+
+void GatewayClient::handleResponse() {
+    // Body (guardado até GATEWAY_CLIENT_RX_BYTES): útil em erro; no handshake traz a sessão
+    size_t bodyEnd = _rxLen;
+    if (_rxContentLength >= 0 && _rxHeadEnd + (size_t) _rxContentLength < bodyEnd) {
+        bodyEnd = _rxHeadEnd + (size_t) _rxContentLength;
+    }
+    _rx[bodyEnd] = '\0';
+    const String respBody(_rx + _rxHeadEnd);
 
-    if (code < 200 || code >= 300) {
+    const int code = _rxStatus;
+    _lastHttpStatus = code;
+    if (_reqReused) _reusedRequests++;
+
+    _connLastUseMs = millis();
+    if (!(_cfg.keepAlive && _rxKeepAlive && _rxContentLength >= 0)) dropConnection();
+    _state = State::Idle;
+
+    const bool ok = code >= 200 && code < 300;
+    bool encodingRejected = false;
+    if (ok) {
+        dbgln(String("[Gateway] OK HTTP=") + code);
+    } else {
+        // 415: gateway sem suporte ao encoding; 400 bad_body: gateway antigo (só hex)
+        encodingRejected = _encoding != SecureBodyEncoding::Hex &&
+                           (code == 415 || (code == 400 && respBody.indexOf("bad_body") >= 0));
         _lastError = Error::BadHttpStatus;
         dbgln(String("[Gateway] bad HTTP status=") + code + " resp=" + respBody);
-        return false;
     }
 
-    _lastError = Error::None;
-    dbgln(String("[Gateway] OK HTTP=") + code);
+    // Encoding/versão recusados: cai para o próximo e reenvia
+    // (no máximo Raw -> Base64Url -> Hex, X-SecureHttp -> headers avulsos -> V1)
+    if (_step == Step::Handshake) {
+        if (ok) {
+            if (!_session.accept(_cfg.deviceId, respBody, millis())) {
+                _lastError = Error::SecureBuildFailed;
+                dbgln("[Gateway] session handshake rejected (bad mac)");
+                finishJob(false);
+                return;
+            }
+            dbgln(String("[Gateway] session opened sid=") + _session.sid());
+            startStep();
+            return;
+        }
+        if (code == 404) {
+            // Gateway sem /session: envelope completo por request
+            _sessionUnsupported = true;
+            dbgln("[Gateway] no /session on gateway -> per-request envelope");
+            startStep();
+            return;
+        }
+    } else if (ok) {
+        finishJob(true);
+        return;
+    } else if (_stepSession && code == 401 && respBody.indexOf("unknown_session") >= 0 && !_sessionRetried) {
+        // Gateway reiniciado/sessão expirada: novo handshake, 1 vez
+        _sessionRetried = true;
+        _session.reset();
+        startStep();
+        return;
+    }
+
+    if (!_stepSession && protocolRejected(respBody) && downgradeProtocol()) {
+        startStep();
+        return;
+    }
+    if (encodingRejected && downgradeEncoding()) {
+        startStep();
+        return;
+    }
+
+    // Só o parse do lote decide que o conteúdo é ruim; 400 de header/protocolo/body é do envelope
+    _jobRejected = code == 400 &&
+                   (respBody.indexOf("\"bad_batch\"") >= 0 || respBody.indexOf("\"empty_batch\"") >= 0);
+    finishJob(false);
+}
+
+void GatewayClient::failJob(Error e, const char *msg) {
+    _lastError = e;
+    dbgln(msg);
+    if (_connectFd >= 0) {
+        close(_connectFd);
+        _connectFd = -1;
+    }
+    _state = State::Idle;
+    dropConnection();
+    finishJob(false);
+}
+
+void GatewayClient::finishJob(bool ok) {
+    _state = State::Idle;
+
+    const uint8_t sent = _jobSamples;
+    const bool stored = _jobStored;
+    const bool rejected = _jobRejected;
+    _jobSamples = 0;
+    _jobStored = false;
+    _jobRejected = false;
+    _jobBody = String();
+
+    if (stored) {
+        // Quem chamou publishStored() decide (ex.: SampleLog::consume() só com ok)
+        _storedCount = 0;
+        if (ok) _lastError = Error::None;
+    } else if (ok) {
+        _lastError = Error::None;
+        _lastPublishMs = _jobStartMs;
+        popSamples(sent);
+        if (_pendingCount > 0) _firstPendingMs = millis();
+        if (batching()) dbgln(String("[Gateway] batch sent samples=") + sent);
+    } else if (!batching()) {
+        // Amostra única não é reenviada (a próxima leitura a substitui). Sem resposta ou 5xx
+        // ela vai para onSampleDropped; 4xx = gateway recusou o conteúdo, não adianta guardar
+        if (sent > 0 && (_lastHttpStatus < 0 || _lastHttpStatus >= 500)) dropSample(pendingAt(0));
+        else _droppedSamples += sent;
+        popSamples(sent);
+    }
+    // Lote com falha continua na fila; nova tentativa após minIntervalMs
+
+    if (_onResult) {
+        SendResult r;
+        r.ok = ok;
+        r.error = _lastError;
+        r.httpStatus = _lastHttpStatus;
+        r.samples = sent;
+        r.stored = stored;
+        r.rejected = rejected;
+        _onResult(r);
+    }
+}
+
+void GatewayClient::closeConnection() {
+    if (_state != State::Idle) {
+        // Envio em curso perde o socket: aborta (update() não o retoma)
+        failJob(Error::ConnectFailed, "[Gateway] connection closed by caller");
+        return;
+    }
+    dropConnection();
+}
+
+void GatewayClient::dropConnection() {
+    if (!_connOpen) return;
+    _conn.stop();
+    _connOpen = false;
+}
+
+bool GatewayClient::downgradeEncoding() {
+    if (_encoding == SecureBodyEncoding::Hex) return false;
+    _encoding = (_encoding == SecureBodyEncoding::Raw) ? SecureBodyEncoding::Base64Url : SecureBodyEncoding::Hex;
+    dbgln(String("[Gateway] body encoding fallback -> ") + secureBodyEncodingName(_encoding));
+    return true;
+}
+
+bool GatewayClient::downgradeProtocol() {
+    if (_protocol == SecureProtocol::V2 && _compactHeader) {
+        _compactHeader = false;
+        dbgln("[Gateway] X-SecureHttp fallback -> separate headers");
+        return true;
+    }
+    if (_protocol == SecureProtocol::V1) return false;
+    _protocol = SecureProtocol::V1;
+    dbgln("[Gateway] envelope fallback -> v1 (HMAC)");
     return true;
 }
+
+bool GatewayClient::protocolRejected(const String &respBody) const {
+    // Gateway só v1 não acha X-Signature; gateway mais novo não conhece a versão
+    return _protocol != SecureProtocol::V1 && _lastHttpStatus == 400 &&
+           (respBody.indexOf("missing_headers") >= 0 || respBody.indexOf("unsupported_protocol") >= 0);
+}
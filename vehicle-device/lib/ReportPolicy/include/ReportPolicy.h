@@ -0,0 +1,85 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef VEHICLE_DEVICE_REPORTPOLICY_H
+#define VEHICLE_DEVICE_REPORTPOLICY_H
+
+#pragma once
+#include <Arduino.h>
+
+// Decide se uma leitura vale um envio (reporte por mudança, com deadband).
+//
+// Cada campo tem deadband absoluto e relativo: a leitura é "mudança" quando algum
+// campo se afasta do último valor enviado mais que max(absolute, relative * |último|).
+// Sem mudança, só envia quando passa heartbeatMs do último envio (o gateway sabe
+// que o device está vivo). Fica na frente do GatewayClient::publishTelemetry().
+class ReportPolicy {
+public:
+    // absolute e relative = 0: qualquer diferença conta
+    struct Deadband {
+        float absolute; // mesma unidade do campo
+        float relative; // fração do último valor enviado (0.05 = 5 %)
+
+        Deadband(float a = 0.0f, float r = 0.0f) : absolute(a), relative(r) {
+        }
+    };
+
+    struct Config {
+        Deadband temperature{0.5f, 0.0f}; // °C
+        Deadband humidity{2.0f, 0.0f}; // %
+        Deadband fuelLevel{1.0f, 0.0f}; // %
+        Deadband stepperSpeed{5.0f, 0.0f}; // aceleração (%)
+        Deadband stepperRpm{100.0f, 0.05f}; // rpm: 5 %, no mínimo 100
+
+        uint32_t heartbeatMs = 30000; // intervalo máximo sem envio
+    };
+
+    // Campos negativos = ausentes (mesma convenção do publishTelemetry)
+    struct Reading {
+        float temperature = 0.0f;
+        float humidity = 0.0f;
+        int fuelLevel = -1;
+        float stepperSpeed = -1.0f;
+        float stepperRpm = -1.0f;
+    };
+
+    enum class Decision : uint8_t {
+        Suppress = 0, // dentro do deadband: não envia
+        Changed, // mudança significativa: envia já
+        Heartbeat // nada mudou, mas passou heartbeatMs
+    };
+
+    explicit ReportPolicy(const Config &cfg);
+
+    // Avalia a leitura; fora de Suppress ela vira a referência do próximo deadband
+    Decision evaluate(const Reading &r, uint32_t nowMs);
+
+    // Próxima evaluate() envia (ex.: após reconectar)
+    void reset();
+
+    uint32_t suppressed() const noexcept { return _suppressed; }
+    uint32_t changed() const noexcept { return _changed; }
+    uint32_t heartbeats() const noexcept { return _heartbeats; }
+
+private:
+    Config _cfg{};
+
+    bool _hasLast = false;
+    Reading _last{};
+    uint32_t _lastSendMs = 0;
+
+    uint32_t _suppressed = 0;
+    uint32_t _changed = 0;
+    uint32_t _heartbeats = 0;
+
+    static bool exceeds(float value, float last, const Deadband &db);
+
+    // Campo opcional: aparecer/sumir também é mudança
+    static bool optionalExceeds(float value, float last, const Deadband &db);
+
+    bool significant(const Reading &r) const;
+};
+
+
+#endif //VEHICLE_DEVICE_REPORTPOLICY_H
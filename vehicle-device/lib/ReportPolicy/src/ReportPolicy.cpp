@@ -0,0 +1,58 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+#include "ReportPolicy.h"
+
+#include <math.h>
+
+ReportPolicy::ReportPolicy(const Config &cfg) : _cfg(cfg) {
+}
+
+void ReportPolicy::reset() {
+    _hasLast = false;
+}
+
+bool ReportPolicy::exceeds(float value, float last, const Deadband &db) {
+    if (isnan(value) || isnan(last)) return isnan(value) != isnan(last);
+
+    // O maior dos dois: o absoluto segura o ruído perto de zero, o relativo os valores altos
+    float threshold = db.relative * fabsf(last);
+    if (db.absolute > threshold) threshold = db.absolute;
+
+    const float delta = fabsf(value - last);
+    return threshold > 0.0f ? delta > threshold : delta > 0.0f;
+}
+
+bool ReportPolicy::optionalExceeds(float value, float last, const Deadband &db) {
+    const bool present = value >= 0.0f;
+    if (present != (last >= 0.0f)) return true;
+    return present && exceeds(value, last, db);
+}
+
+bool ReportPolicy::significant(const Reading &r) const {
+    return exceeds(r.temperature, _last.temperature, _cfg.temperature) ||
+           exceeds(r.humidity, _last.humidity, _cfg.humidity) ||
+           optionalExceeds((float) r.fuelLevel, (float) _last.fuelLevel, _cfg.fuelLevel) ||
+           optionalExceeds(r.stepperSpeed, _last.stepperSpeed, _cfg.stepperSpeed) ||
+           optionalExceeds(r.stepperRpm, _last.stepperRpm, _cfg.stepperRpm);
+}
+
+ReportPolicy::Decision ReportPolicy::evaluate(const Reading &r, uint32_t nowMs) {
+    Decision d;
+    if (!_hasLast || significant(r)) {
+        d = Decision::Changed;
+        _changed++;
+    } else if (nowMs - _lastSendMs >= _cfg.heartbeatMs) {
+        d = Decision::Heartbeat;
+        _heartbeats++;
+    } else {
+        _suppressed++;
+        return Decision::Suppress;
+    }
+
+    // Referência é o último valor enviado (deriva lenta acumula até passar o deadband)
+    _last = r;
+    _hasLast = true;
+    _lastSendMs = nowMs;
+    return d;
+}
@@ -0,0 +1,109 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef VEHICLE_DEVICE_SAMPLELOG_H
+#define VEHICLE_DEVICE_SAMPLELOG_H
+
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+
+#ifndef SAMPLE_LOG_MAX_SEGMENTS
+#define SAMPLE_LOG_MAX_SEGMENTS 32 // índice dos segmentos fica em RAM
+#endif
+
+#ifndef SAMPLE_LOG_RECORD_MAX
+#define SAMPLE_LOG_RECORD_MAX 32 // bytes de payload por registro
+#endif
+
+// Fila persistente (store-and-forward) de registros de tamanho fixo no flash.
+//
+// Log só de append dividido em segmentos (um arquivo cada) usados em rodízio:
+// append() escreve no fim do segmento atual (O(1)); cheio, passa ao próximo, e se
+// o próximo ainda é o mais antigo com dados ele é apagado (no flash no máximo
+// segments * recordsPerSegment registros; após encher, ficam ao menos
+// (segments - 1) * recordsPerSegment). O rodízio espalha a escrita pelo flash e
+// cada segmento é apagado inteiro, sem reescrita no lugar.
+//
+// Leitura do mais antigo para o mais novo: peek() sem remover e consume() depois
+// que o envio deu certo; o cursor de leitura fica num arquivo próprio, então após
+// reboot nada já confirmado é reenviado. Cada registro leva seq + CRC: um registro
+// cortado por queda de energia é ignorado no begin().
+class SampleLog {
+public:
+    struct Config {
+        const char *dir = "/slog";
+        size_t recordSize = 0; // bytes por registro (<= SAMPLE_LOG_RECORD_MAX)
+        uint8_t segments = 16; // <= SAMPLE_LOG_MAX_SEGMENTS
+        uint16_t recordsPerSegment = 256;
+    };
+
+    SampleLog(fs::FS &fs, const Config &cfg);
+
+    // Recupera o estado a partir dos arquivos (FS já montado). false = config inválida
+    bool begin();
+
+    // Grava um registro de recordSize bytes; cheio, descarta o segmento mais antigo
+    bool append(const void *record);
+
+    // Copia até maxRecords registros mais antigos (sem remover); retorna quantos
+    size_t peek(void *out, size_t maxRecords);
+
+    // Remove os n primeiros registros entregues pelo último peek() (após envio confirmado)
+    void consume(size_t n);
+
+    // Registros ainda não consumidos
+    uint32_t size() const noexcept { return _nextSeq - _readSeq; }
+    bool empty() const noexcept { return _nextSeq == _readSeq; }
+
+    uint32_t capacity() const noexcept { return (uint32_t) _cfg.segments * _cfg.recordsPerSegment; }
+
+    // Registros perdidos: log cheio (segmento mais antigo apagado) ou CRC inválido
+    uint32_t droppedRecords() const noexcept { return _dropped; }
+
+private:
+    struct Segment {
+        uint32_t firstSeq; // seq do 1º registro
+        uint16_t count; // registros válidos no arquivo
+        bool sealed; // não aceita mais append (cheio ou com registro cortado)
+    };
+
+    fs::FS &_fs;
+    Config _cfg{};
+    bool _ready = false;
+
+    Segment _seg[SAMPLE_LOG_MAX_SEGMENTS];
+    uint8_t _head = 0; // segmento que recebe append
+    uint32_t _nextSeq = 0; // seq do próximo append
+    uint32_t _readSeq = 0; // seq do próximo registro a entregar
+    uint32_t _peekSeq = 0; // seq do 1º registro do último peek()
+    uint32_t _dropped = 0;
+
+    fs::File _appendFile; // aberto em "a" enquanto o segmento _head recebe registros
+
+    size_t slotBytes() const noexcept { return 4 + _cfg.recordSize + 2; }
+
+    String segmentPath(uint8_t i) const;
+
+    String cursorPath() const;
+
+    // Lê o índice de um segmento; false se vazio/ilegível
+    bool scanSegment(uint8_t i);
+
+    // Apaga o arquivo do segmento e zera o índice
+    void clearSegment(uint8_t i);
+
+    // Segmento que contém seq (ou -1)
+    int findSegment(uint32_t seq) const;
+
+    // Passa _head para o próximo segmento (apaga o mais antigo se preciso)
+    void advanceHead();
+
+    void saveCursor();
+
+    bool loadCursor(uint32_t &seq);
+};
+
+
+#endif //VEHICLE_DEVICE_SAMPLELOG_H
@@ -0,0 +1,64 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+
+#ifndef VEHICLE_DEVICE_UNSYNCEDSAMPLES_H
+#define VEHICLE_DEVICE_UNSYNCEDSAMPLES_H
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SampleLog.h"
+
+// Amostras descartadas antes do relógio sincronizar (NTP): sem epoch, não podem ir
+// para o SampleLog (no reenvio o gateway não teria como datá-las). Ficam em RAM, com
+// o instante da captura, até release() conseguir o epoch de cada uma e gravá-las no
+// log em ordem. Cheio, descarta a mais antiga; reboot antes do NTP perde o que está aqui.
+template <typename T, uint16_t N>
+class UnsyncedSamples {
+public:
+    static_assert(N > 0, "UnsyncedSamples: N must be > 0");
+
+    // Guarda uma cópia (cheio: a mais antiga sai)
+    void hold(const T &s) {
+        if (_count == N) {
+            _head = (uint16_t) ((_head + 1) % N);
+            _count--;
+            _dropped++;
+        }
+        _items[(_head + _count) % N] = s;
+        _count++;
+    }
+
+    // stamp(T&) preenche o epoch da amostra; false = relógio ainda sem sincronizar (nada
+    // sai). Grava no log da mais antiga para a mais nova; retorna quantas foram gravadas
+    template <typename Stamp>
+    size_t release(SampleLog &log, Stamp stamp) {
+        size_t released = 0;
+        while (_count > 0) {
+            T s = _items[_head];
+            if (!stamp(s)) break;
+            if (!log.append(&s)) break;
+            _head = (uint16_t) ((_head + 1) % N);
+            _count--;
+            released++;
+        }
+        return released;
+    }
+
+    uint16_t size() const noexcept { return _count; }
+    bool empty() const noexcept { return _count == 0; }
+
+    // Descartadas com a RAM cheia
+    uint32_t dropped() const noexcept { return _dropped; }
+
+private:
+    T _items[N];
+    uint16_t _head = 0; // mais antiga
+    uint16_t _count = 0;
+    uint32_t _dropped = 0;
+};
+
+
+#endif //VEHICLE_DEVICE_UNSYNCEDSAMPLES_H
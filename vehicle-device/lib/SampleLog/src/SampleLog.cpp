@@ -0,0 +1,300 @@
+//
+// Created by Josemar Carvalho on 17/10/26.
+//
+#include "SampleLog.h"
+
+#include <string.h>
+
+// Registro no arquivo: seq (u32 LE) | payload (recordSize) | CRC-16/CCITT (u16 LE) de seq + payload
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t) data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+static uint32_t getU32(const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// Confere o CRC do slot e devolve o seq
+static bool checkSlot(const uint8_t *slot, size_t payloadLen, uint32_t &seq) {
+    const size_t n = 4 + payloadLen;
+    const uint16_t crc = (uint16_t) (slot[n] | (slot[n + 1] << 8));
+    if (crc16(slot, n) != crc) return false;
+    seq = getU32(slot);
+    return true;
+}
+
+SampleLog::SampleLog(fs::FS &fs, const Config &cfg) : _fs(fs), _cfg(cfg) {
+    memset(_seg, 0, sizeof(_seg));
+}
+
+String SampleLog::segmentPath(uint8_t i) const {
+    return String(_cfg.dir) + "/s" + String(i);
+}
+
+String SampleLog::cursorPath() const {
+    return String(_cfg.dir) + "/cursor";
+}
+
+bool SampleLog::begin() {
+    _ready = false;
+    if (!_cfg.dir || _cfg.dir[0] != '/' ||
+        _cfg.recordSize == 0 || _cfg.recordSize > SAMPLE_LOG_RECORD_MAX ||
+        _cfg.segments < 2 || _cfg.segments > SAMPLE_LOG_MAX_SEGMENTS ||
+        _cfg.recordsPerSegment == 0) {
+        return false;
+    }
+
+    if (!_fs.exists(_cfg.dir)) _fs.mkdir(_cfg.dir);
+
+    // Segmento mais novo (maior firstSeq) vira o _head; o mais antigo define o início da fila
+    bool any = false;
+    uint32_t oldest = 0;
+    _head = 0;
+    _nextSeq = 0;
+    for (uint8_t i = 0; i < _cfg.segments; i++) {
+        if (!scanSegment(i)) continue;
+        const Segment &s = _seg[i];
+        if (!any || s.firstSeq < oldest) oldest = s.firstSeq;
+        if (!any || s.firstSeq + s.count > _nextSeq) {
+            _nextSeq = s.firstSeq + s.count;
+            _head = i;
+        }
+        any = true;
+    }
+
+    uint32_t cursor = 0;
+    const bool hasCursor = loadCursor(cursor);
+    if (!any) {
+        // Fila vazia: mantém a numeração (seq nunca volta)
+        _nextSeq = hasCursor ? cursor : 0;
+        _readSeq = _nextSeq;
+    } else {
+        _readSeq = hasCursor ? cursor : oldest;
+        if (_readSeq < oldest) _readSeq = oldest; // segmento descartado antes do cursor ser salvo
+        if (_readSeq > _nextSeq) _nextSeq = _readSeq;
+    }
+
+    // Segmentos já consumidos (reboot entre consume() e a remoção)
+    for (uint8_t i = 0; i < _cfg.segments; i++) {
+        if (_seg[i].count > 0 && _seg[i].firstSeq + _seg[i].count <= _readSeq) clearSegment(i);
+    }
+
+    _ready = true;
+    return true;
+}
+
+bool SampleLog::scanSegment(uint8_t i) {
+    Segment &s = _seg[i];
+    s.firstSeq = 0;
+    s.count = 0;
+    s.sealed = false;
+
+    const String path = segmentPath(i);
+    if (!_fs.exists(path)) return false;
+
+    fs::File f = _fs.open(path, "r");
+    if (!f) return false;
+
+    const size_t slot = slotBytes();
+    const size_t size = f.size();
+    uint8_t buf[4 + SAMPLE_LOG_RECORD_MAX + 2];
+    uint32_t seq = 0;
+    const bool ok = size >= slot && f.read(buf, slot) == slot && checkSlot(buf, _cfg.recordSize, seq);
+    f.close();
+
+    if (!ok) {
+        // Vazio ou 1º registro ilegível: segmento inteiro é descartado
+        if (size >= slot) _dropped += (uint32_t) (size / slot);
+        _fs.remove(path);
+        return false;
+    }
+
+    size_t count = size / slot;
+    if (count > _cfg.recordsPerSegment) count = _cfg.recordsPerSegment;
+    s.firstSeq = seq;
+    s.count = (uint16_t) count;
+    // Sobra de registro cortado no fim: não recebe mais append (o resto continua legível)
+    s.sealed = (size % slot) != 0 || count >= _cfg.recordsPerSegment;
+    return true;
+}
+
+void SampleLog::clearSegment(uint8_t i) {
+    if (i == _head && _appendFile) _appendFile.close();
+    const String path = segmentPath(i);
+    if (_fs.exists(path)) _fs.remove(path);
+    _seg[i].firstSeq = 0;
+    _seg[i].count = 0;
+    _seg[i].sealed = false;
+}
+
+int SampleLog::findSegment(uint32_t seq) const {
+    for (uint8_t i = 0; i < _cfg.segments; i++) {
+        const Segment &s = _seg[i];
+        if (s.count > 0 && seq >= s.firstSeq && seq - s.firstSeq < s.count) return i;
+    }
+    return -1;
+}
+
+void SampleLog::advanceHead() {
+    if (_appendFile) _appendFile.close();
+    _head = (uint8_t) ((_head + 1) % _cfg.segments);
+
+    const Segment &s = _seg[_head];
+    if (s.count > 0) {
+        // Log cheio: o segmento mais antigo dá lugar aos registros novos
+        const uint32_t end = s.firstSeq + s.count;
+        if (end > _readSeq) {
+            _dropped += end - (_readSeq > s.firstSeq ? _readSeq : s.firstSeq);
+            _readSeq = end;
+            clearSegment(_head);
+            saveCursor();
+            return;
+        }
+        clearSegment(_head);
+    }
+}
+
+bool SampleLog::append(const void *record) {
+    if (!_ready || !record) return false;
+
+    Segment *h = &_seg[_head];
+    if (h->count > 0 && (h->sealed || h->count >= _cfg.recordsPerSegment)) {
+        advanceHead();
+        h = &_seg[_head];
+    }
+
+    if (!_appendFile) {
+        // Segmento novo começa truncado (sobra de um arquivo antigo não vale)
+        _appendFile = _fs.open(segmentPath(_head), h->count == 0 ? "w" : "a");
+        if (!_appendFile) return false;
+    }
+
+    uint8_t slot[4 + SAMPLE_LOG_RECORD_MAX + 2];
+    const size_t n = 4 + _cfg.recordSize;
+    putU32(slot, _nextSeq);
+    memcpy(slot + 4, record, _cfg.recordSize);
+    const uint16_t crc = crc16(slot, n);
+    slot[n] = (uint8_t) crc;
+    slot[n + 1] = (uint8_t) (crc >> 8);
+
+    if (_appendFile.write(slot, n + 2) != n + 2) {
+        // Escrita parcial: o segmento fecha aqui e o próximo append vai para outro
+        _appendFile.close();
+        if (h->count > 0) h->sealed = true;
+        return false;
+    }
+    _appendFile.flush(); // sobrevive a queda de energia
+
+    if (h->count == 0) h->firstSeq = _nextSeq;
+    h->count++;
+    _nextSeq++;
+
+    if (h->count >= _cfg.recordsPerSegment) {
+        h->sealed = true;
+        _appendFile.close();
+    }
+    return true;
+}
+
+size_t SampleLog::peek(void *out, size_t maxRecords) {
+    if (!_ready || !out) return 0;
+
+    uint8_t *dst = static_cast<uint8_t *>(out);
+    const size_t slot = slotBytes();
+    uint8_t buf[4 + SAMPLE_LOG_RECORD_MAX + 2];
+    size_t got = 0;
+    uint32_t seq = _readSeq;
+
+    while (got < maxRecords && seq < _nextSeq) {
+        const int i = findSegment(seq);
+        if (i < 0) {
+            // Buraco (segmento ilegível no boot): pula para o próximo segmento
+            if (got > 0) break; // consume(got) precisa de registros contíguos
+            uint32_t next = _nextSeq;
+            for (uint8_t k = 0; k < _cfg.segments; k++) {
+                if (_seg[k].count > 0 && _seg[k].firstSeq > seq && _seg[k].firstSeq < next) next = _seg[k].firstSeq;
+            }
+            _dropped += next - seq;
+            _readSeq = seq = next;
+            continue;
+        }
+
+        const Segment &s = _seg[i];
+        fs::File f = _fs.open(segmentPath((uint8_t) i), "r");
+        if (!f || !f.seek((size_t) (seq - s.firstSeq) * slot)) break;
+
+        bool stop = false;
+        while (got < maxRecords && seq - s.firstSeq < s.count) {
+            uint32_t recSeq = 0;
+            if (f.read(buf, slot) != slot || !checkSlot(buf, _cfg.recordSize, recSeq) || recSeq != seq) {
+                if (got > 0) {
+                    stop = true; // entrega o que já leu; o registro ruim é pulado no próximo peek()
+                    break;
+                }
+                _dropped++;
+                _readSeq = ++seq;
+                continue;
+            }
+            memcpy(dst + got * _cfg.recordSize, buf + 4, _cfg.recordSize);
+            got++;
+            seq++;
+        }
+        f.close();
+        if (stop) break;
+    }
+    _peekSeq = _readSeq;
+    return got;
+}
+
+void SampleLog::consume(size_t n) {
+    if (!_ready || n == 0) return;
+
+    // Conta a partir do peek(): se o log encheu no meio do envio, _readSeq já passou desses
+    uint32_t target = _peekSeq + (uint32_t) n;
+    if (target > _nextSeq) target = _nextSeq;
+    if (target <= _readSeq) return;
+    _readSeq = target;
+
+    // Segmento totalmente lido é apagado (libera o flash para o rodízio)
+    for (uint8_t i = 0; i < _cfg.segments; i++) {
+        if (_seg[i].count > 0 && _seg[i].firstSeq + _seg[i].count <= _readSeq) clearSegment(i);
+    }
+    saveCursor();
+}
+
+void SampleLog::saveCursor() {
+    // seq + complemento: cursor corrompido é ignorado no begin()
+    uint8_t buf[8];
+    putU32(buf, _readSeq);
+    putU32(buf + 4, ~_readSeq);
+    fs::File f = _fs.open(cursorPath(), "w");
+    if (!f) return;
+    f.write(buf, sizeof(buf));
+    f.close();
+}
+
+bool SampleLog::loadCursor(uint32_t &seq) {
+    const String path = cursorPath();
+    if (!_fs.exists(path)) return false;
+    fs::File f = _fs.open(path, "r");
+    if (!f) return false;
+    uint8_t buf[8];
+    const bool ok = f.read(buf, sizeof(buf)) == sizeof(buf) && getU32(buf) == (uint32_t) ~getU32(buf + 4);
+    f.close();
+    if (ok) seq = getU32(buf);
+    return ok;
+}
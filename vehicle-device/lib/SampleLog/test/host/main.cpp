@@ -0,0 +1,307 @@
+// Teste do SampleLog no host: cenários de store-and-forward do vehicle-device (ver Makefile).
+//
+//   ./sample_log_test
+//
+// Log pequeno (4 segmentos x 8 registros) para o overflow acontecer com poucas
+// amostras. Cada "reboot" é um SampleLog novo sobre o mesmo FS em memória.
+// O registro leva um ts crescente; a ordem de entrega é conferida por ele.
+
+#include <stdio.h>
+
+#include "SampleLog.h"
+#include "UnsyncedSamples.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(cond)                                                  \
+    do {                                                             \
+        if (!(cond)) {                                               \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                             \
+        }                                                            \
+    } while (0)
+
+struct Rec {
+    uint32_t ts;
+    float value;
+};
+
+const size_t kSlotBytes = 4 + sizeof(Rec) + 2; // seq + payload + CRC (SampleLog.cpp)
+
+SampleLog::Config config() {
+    SampleLog::Config c;
+    c.recordSize = sizeof(Rec);
+    c.segments = 4;
+    c.recordsPerSegment = 8;
+    return c;
+}
+
+bool appendTs(SampleLog &log, uint32_t ts) {
+    Rec r;
+    r.ts = ts;
+    r.value = (float) ts * 0.5f;
+    return log.append(&r);
+}
+
+// Drena em lotes de `batch`; false se algum ts sair fora de ordem/repetido
+bool drainInOrder(SampleLog &log, size_t batch, uint32_t &first, uint32_t &count) {
+    Rec out[16];
+    bool ordered = true;
+    count = 0;
+    for (;;) {
+        const size_t n = log.peek(out, batch);
+        if (n == 0) break;
+        for (size_t i = 0; i < n; i++) {
+            if (count == 0 && i == 0) first = out[0].ts;
+            else if (out[i].ts != first + count + (uint32_t) i) ordered = false;
+        }
+        log.consume(n);
+        count += (uint32_t) n;
+    }
+    return ordered;
+}
+
+// Gateway fora: amostras acumulam, envio que falha não consome, drena na ordem
+void testOutage() {
+    printf("outage\n");
+    fs::FS fs;
+    SampleLog log(fs, config());
+    CHECK(log.begin());
+    CHECK(log.empty());
+
+    for (uint32_t ts = 0; ts < 20; ts++) CHECK(appendTs(log, ts));
+    CHECK(log.size() == 20);
+
+    Rec out[5];
+    CHECK(log.peek(out, 5) == 5 && out[0].ts == 0 && out[4].ts == 4);
+    // Envio falhou (sem consume): o próximo peek entrega o mesmo lote
+    CHECK(log.peek(out, 5) == 5 && out[0].ts == 0);
+    log.consume(5);
+    CHECK(log.size() == 15);
+
+    uint32_t first = 0, count = 0;
+    CHECK(drainInOrder(log, 5, first, count));
+    CHECK(first == 5 && count == 15);
+    CHECK(log.empty() && log.droppedRecords() == 0);
+}
+
+// Log cheio enquanto um lote está em envio: consume() não pode pular registros
+// que não foram no lote nem devolver os que o overflow já apagou
+void testOverflowDuringBatch() {
+    printf("overflow during in-flight batch\n");
+    fs::FS fs;
+    SampleLog log(fs, config());
+    CHECK(log.begin());
+
+    // 50 amostras num log de 32: segmentos mais antigos apagados inteiros
+    for (uint32_t ts = 100; ts < 150; ts++) CHECK(appendTs(log, ts));
+    CHECK(log.size() <= log.capacity());
+    CHECK(log.size() + log.droppedRecords() == 50);
+
+    Rec batch[4];
+    CHECK(log.peek(batch, 4) == 4);
+    const uint32_t batchFirst = batch[0].ts;
+
+    // Mais 10 amostras chegam antes da resposta: o lote em envio some do flash
+    for (uint32_t ts = 150; ts < 160; ts++) CHECK(appendTs(log, ts));
+    const uint32_t oldest = 160 - log.size(); // mais antigo que sobrou no flash
+    CHECK(oldest > batchFirst);
+    log.consume(4);
+
+    // Próximo = o 1º depois do lote, ou o mais antigo que sobrou se o lote todo sumiu
+    const uint32_t expected = oldest > batchFirst + 4 ? oldest : batchFirst + 4;
+    Rec next;
+    CHECK(log.peek(&next, 1) == 1);
+    CHECK(next.ts == expected);
+
+    uint32_t first = 0, count = 0;
+    CHECK(drainInOrder(log, 7, first, count));
+    CHECK(first == next.ts && first + count == 160); // do próximo até o último, sem buraco
+    CHECK(log.empty());
+}
+
+// Reboot no meio da drenagem: o cursor persistido não reenvia o que já saiu
+void testRebootRecovery() {
+    printf("reboot recovery\n");
+    fs::FS fs;
+    {
+        SampleLog log(fs, config());
+        CHECK(log.begin());
+        for (uint32_t ts = 0; ts < 20; ts++) CHECK(appendTs(log, ts));
+        Rec out[5];
+        CHECK(log.peek(out, 5) == 5);
+        log.consume(5);
+        CHECK(log.peek(out, 5) == 5); // lote em envio quando a placa reinicia
+    }
+
+    SampleLog log(fs, config());
+    CHECK(log.begin());
+    CHECK(log.size() == 15);
+
+    uint32_t first = 0, count = 0;
+    CHECK(drainInOrder(log, 5, first, count));
+    CHECK(first == 5 && count == 15);
+
+    // Vazio: só o cursor fica no FS (segmentos drenados são apagados)
+    CHECK(fs.files.size() == 1 && fs.files.count("/slog/cursor") == 1);
+
+    // Reboot com o log vazio continua vazio
+    SampleLog again(fs, config());
+    CHECK(again.begin());
+    CHECK(again.empty());
+}
+
+// Queda de energia no meio de um append: o registro cortado é ignorado no begin()
+void testTornWrite() {
+    printf("torn write\n");
+    fs::FS fs;
+    {
+        SampleLog log(fs, config());
+        CHECK(log.begin());
+        for (uint32_t ts = 200; ts < 203; ts++) CHECK(appendTs(log, ts));
+        fs.writeBudget = 5; // grava só 5 bytes do próximo registro
+        CHECK(!appendTs(log, 203));
+        fs.writeBudget = -1;
+    }
+
+    SampleLog log(fs, config());
+    CHECK(log.begin());
+    CHECK(log.size() == 3);
+    CHECK(appendTs(log, 204)); // segmento com o registro cortado está selado: vai para outro
+
+    uint32_t first = 0, count = 0;
+    drainInOrder(log, 10, first, count); // 203 se perdeu: 200..202, 204
+    CHECK(first == 200 && count == 4);
+    CHECK(log.empty());
+}
+
+// Byte trocado no flash: o registro falha no CRC, é pulado e contado como perdido
+void testCorruptRecord() {
+    printf("corrupt record\n");
+    fs::FS fs;
+    {
+        SampleLog log(fs, config());
+        CHECK(log.begin());
+        for (uint32_t ts = 300; ts < 306; ts++) CHECK(appendTs(log, ts));
+    }
+
+    // 4º registro (ts 303) do único segmento com dados
+    bool corrupted = false;
+    for (auto &f : fs.files) {
+        if (f.first == "/slog/cursor" || f.second->size() < kSlotBytes * 4) continue;
+        (*f.second)[kSlotBytes * 3 + 4] ^= 0xFF;
+        corrupted = true;
+    }
+    CHECK(corrupted);
+
+    SampleLog log(fs, config());
+    CHECK(log.begin());
+    const uint32_t dropped = log.droppedRecords();
+
+    Rec out[10];
+    uint32_t got = 0;
+    bool sawCorrupt = false;
+    for (;;) {
+        const size_t n = log.peek(out, 10);
+        if (n == 0) break;
+        for (size_t i = 0; i < n; i++) sawCorrupt |= out[i].ts == 303;
+        got += (uint32_t) n;
+        log.consume(n);
+    }
+    CHECK(got == 5 && !sawCorrupt);
+    CHECK(log.droppedRecords() - dropped == 1);
+    CHECK(log.empty());
+}
+
+// Registro como o GatewayClient::Sample: ts 0 até o NTP, ms da captura
+struct TimedRec {
+    uint32_t ts;
+    uint32_t ms;
+    float value;
+};
+
+// Relógio de mentira: epoch 0 = ainda sem NTP
+struct FakeClock {
+    uint32_t epoch = 0;
+    uint32_t nowMs = 0;
+
+    // Mesma conta do GatewayClient::resolveTs()
+    bool stamp(TimedRec &r) const {
+        if (r.ts != 0) return true;
+        if (epoch == 0) return false;
+        r.ts = epoch - (nowMs - r.ms) / 1000;
+        return true;
+    }
+};
+
+// Boot sem rede: amostras sem ts não podem ir para o flash (no reenvio o gateway as
+// trataria como atuais). Ficam em RAM e só entram no log com o epoch da captura
+void testPreNtpSamples() {
+    printf("pre-NTP samples\n");
+    fs::FS fs;
+    SampleLog::Config cfg = config();
+    cfg.recordSize = sizeof(TimedRec);
+    SampleLog log(fs, cfg);
+    CHECK(log.begin());
+
+    FakeClock clock;
+    auto stamp = [&clock](TimedRec &r) { return clock.stamp(r); };
+    UnsyncedSamples<TimedRec, 8> unsynced;
+
+    // 10 amostras a 1 Hz antes do NTP: as 2 mais antigas não cabem
+    for (uint32_t i = 0; i < 10; i++) {
+        TimedRec r;
+        r.ts = 0;
+        r.ms = 1000 + i * 1000;
+        r.value = (float) i;
+        unsynced.hold(r);
+    }
+    CHECK(unsynced.size() == 8 && unsynced.dropped() == 2);
+
+    // Ainda sem relógio: nada vai para o flash
+    clock.nowMs = 15000;
+    CHECK(unsynced.release(log, stamp) == 0);
+    CHECK(log.empty() && unsynced.size() == 8);
+
+    // Flash falhando: as amostras continuam em RAM
+    clock.epoch = 1760000100;
+    clock.nowMs = 20000;
+    fs.writeBudget = 0;
+    CHECK(unsynced.release(log, stamp) == 0);
+    CHECK(unsynced.size() == 8);
+    fs.writeBudget = -1;
+
+    // NTP sincronizou 20 s após o boot: cada uma sai com o epoch da sua captura
+    CHECK(unsynced.release(log, stamp) == 8);
+    CHECK(unsynced.empty());
+    CHECK(log.size() == 8);
+
+    TimedRec out[8];
+    CHECK(log.peek(out, 8) == 8);
+    for (uint32_t i = 0; i < 8; i++) {
+        const uint32_t captureMs = 3000 + i * 1000; // as 2 primeiras (1 s, 2 s) se perderam
+        CHECK(out[i].ts != 0);
+        CHECK(out[i].ts == 1760000100u - (20000 - captureMs) / 1000);
+        CHECK(out[i].value == (float) (i + 2));
+    }
+}
+
+} // namespace
+
+int main() {
+    testOutage();
+    testOverflowDuringBatch();
+    testRebootRecovery();
+    testTornWrite();
+    testCorruptRecord();
+    testPreNtpSamples();
+
+    if (gFailures) {
+        printf("%d check(s) failed\n", gFailures);
+        return 1;
+    }
+    printf("all SampleLog tests passed\n");
+    return 0;
+}
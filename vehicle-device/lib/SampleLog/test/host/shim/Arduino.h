@@ -0,0 +1,43 @@
+// Shim do core Arduino para o teste do SampleLog no host (só o que ele usa).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+class String {
+public:
+    String() {}
+
+    String(const char *s) : _s(s ? s : "") {}
+
+    explicit String(unsigned v) : _s(std::to_string(v)) {}
+
+    explicit String(uint8_t v) : _s(std::to_string((unsigned) v)) {}
+
+    explicit String(int v) : _s(std::to_string(v)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+
+    unsigned length() const { return (unsigned) _s.size(); }
+
+    String &operator+=(const String &o) {
+        _s += o._s;
+        return *this;
+    }
+
+    friend String operator+(const String &a, const String &b) {
+        String r(a);
+        r += b;
+        return r;
+    }
+
+    friend String operator+(const String &a, const char *b) { return a + String(b); }
+
+private:
+    std::string _s;
+};
@@ -0,0 +1,104 @@
+// fs::FS em memória para o teste do SampleLog (mesma API do FS do arduino-esp32).
+//
+// Cada arquivo é um vetor de bytes compartilhado pelos File abertos, então um
+// SampleLog novo sobre o mesmo FS enxerga o que o anterior gravou (reboot).
+// writeBudget simula queda de energia: acabado o orçamento, write() grava só
+// uma parte e as escritas seguintes não gravam nada.
+
+#pragma once
+
+#include "Arduino.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs {
+
+typedef std::shared_ptr<std::vector<uint8_t>> Blob;
+
+class File {
+public:
+    explicit operator bool() const { return (bool) _data; }
+
+    size_t write(const uint8_t *p, size_t n) {
+        if (!_data) return 0;
+        size_t w = n;
+        if (_budget && *_budget >= 0) {
+            if ((long) w > *_budget) w = (size_t) *_budget;
+            *_budget -= (long) w;
+        }
+        _data->insert(_data->end(), p, p + w);
+        _pos = _data->size();
+        return w;
+    }
+
+    size_t read(uint8_t *p, size_t n) {
+        if (!_data) return 0;
+        size_t r = 0;
+        while (r < n && _pos < _data->size()) p[r++] = (*_data)[_pos++];
+        return r;
+    }
+
+    bool seek(uint32_t pos) {
+        if (!_data || pos > _data->size()) return false;
+        _pos = pos;
+        return true;
+    }
+
+    size_t size() const { return _data ? _data->size() : 0; }
+
+    void flush() {}
+
+    void close() { _data.reset(); }
+
+private:
+    friend class FS;
+
+    Blob _data;
+    size_t _pos = 0;
+    long *_budget = nullptr;
+};
+
+class FS {
+public:
+    std::map<std::string, Blob> files;
+    long writeBudget = -1; // bytes até a "queda de energia" (-1 = ilimitado)
+
+    File open(const String &path, const char *mode = "r") {
+        File f;
+        const std::string p = path.c_str();
+        auto it = files.find(p);
+        if (mode[0] == 'r') {
+            if (it == files.end()) return f;
+            f._data = it->second;
+        } else if (mode[0] == 'w' || it == files.end()) {
+            f._data = std::make_shared<std::vector<uint8_t>>();
+            files[p] = f._data;
+        } else {
+            f._data = it->second;
+        }
+        if (mode[0] == 'a') f._pos = f._data->size();
+        f._budget = &writeBudget;
+        return f;
+    }
+
+    bool exists(const String &path) const {
+        const std::string p = path.c_str();
+        return files.count(p) > 0 || dirs.count(p) > 0;
+    }
+
+    bool remove(const String &path) { return files.erase(path.c_str()) > 0; }
+
+    bool mkdir(const String &path) {
+        dirs.insert(path.c_str());
+        return true;
+    }
+
+private:
+    std::set<std::string> dirs;
+};
+
+} // namespace fs
@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include <LittleFS.h>
 #include <WiFi.h>
 #include <math.h>
 #include <time.h>
@@ -6,14 +7,22 @@
 #include "secrets.h"
 #include <WiFiManager.h>
 
+#include <AdcSampler.h>
 #include <DhtSensor.h>
 #include <GatewayClient.h>
 #include <FuelLevel.h>
+#include <ReportPolicy.h>
+#include <SampleLog.h>
+#include <UnsyncedSamples.h>
 
 // Se você quiser usar SECURE_DEVICE_ID aqui, inclua o config do SecureHttp.
 // (Só faça isso se o vehicle-device tiver acesso ao shared-libs/SecureHttp/include)
 #include "SecureHttpConfig.h"
 
+#ifdef SECUREHTTP_BENCH
+#include "SecureHttpBench.h"
+#endif
+
 #define DHT_PIN 4
 
 #define FUEL_ADC_PIN 34
@@ -23,7 +32,15 @@
 #define GATEWAY_PORT 8045
 
 static const uint32_t PRINT_INTERVAL_MS = 5000;
-static const uint32_t SEND_INTERVAL_MS = 5000;
+static const uint32_t SEND_INTERVAL_MS = 1000; // amostragem 1 Hz
+static const uint8_t SEND_BATCH_SIZE = 5; // 5 amostras por POST /telemetry/batch
+static const uint32_t HEARTBEAT_MS = 30000; // sem mudança, 1 amostra a cada 30 s
+
+// Store-and-forward: amostras que não saem (sem WiFi/gateway) vão para o LittleFS
+// e são reenviadas, da mais antiga para a mais nova, após reconectar
+static const uint32_t DRAIN_INTERVAL_MS = 2000; // 1 lote guardado a cada 2 s (não disputa com o envio ao vivo)
+static const uint8_t DRAIN_BATCH = 10; // <= TELEMETRY_BATCH_MAX do gateway
+static const uint16_t UNSYNCED_MAX = 120; // antes do NTP: até 2 min a 1 Hz em RAM (~3,4 KB)
 
 static const float ACCEL_CURVE_GAMMA = 2.2f;
 
@@ -35,14 +52,27 @@ static const float SIM_RPM_MAX = 8000.0f;
 
 static const uint8_t EMA_ALPHA_PCT = 15; // 0..100
 
+// ADC em taxa fixa (esp_timer): 1 kHz por canal, filtrado antes de chegar ao loop()
+static const uint32_t ADC_PERIOD_US = 1000;
+static const uint8_t FUEL_WINDOW = 15; // mediana de 15 -> 66,7 Hz (nível muda devagar; corta glitches)
+static const uint8_t ACCEL_WINDOW = 5; // mediana de 5 -> 200 Hz (corta picos, pouca latência)
+
 WiFiManager *wifi = nullptr;
 DhtSensor *dht = nullptr;
 GatewayClient *gateway = nullptr;
 FuelLevel *fuel = nullptr;
+AdcSampler *adc = nullptr;
+SampleLog *sampleLog = nullptr;
+ReportPolicy *report = nullptr;
+static UnsyncedSamples<GatewayClient::Sample, UNSYNCED_MAX> unsyncedSamples;
 
 static bool lastWifiConnected = false;
 static uint32_t lastPrintMs = 0;
 static uint32_t lastSendAttemptMs = 0;
+static uint32_t lastDrainMs = 0;
+
+static int fuelAdcCh = -1;
+static int accelAdcCh = -1;
 
 // -----------------------------
 // NTP / time sync helpers
@@ -111,11 +141,26 @@ static float accelToSimRpm(float accelPct) {
     return SIM_RPM_MIN + t * (SIM_RPM_MAX - SIM_RPM_MIN);
 }
 
-static void logGatewayFail() {
+static void logGatewayResult(const GatewayClient::SendResult &r) {
+    if (r.stored && sampleLog) {
+        // Sai do flash só com confirmação ou com o lote recusado pelo conteúdo (reenviar não
+        // adianta); erro de transporte, auth ou envelope mantém as amostras para a próxima drenagem
+        if (r.ok || r.rejected) sampleLog->consume(r.samples);
+        if (r.ok) {
+            Serial.printf("[Store] Sent %u stored samples, %lu left\n",
+                          (unsigned) r.samples, (unsigned long) sampleLog->size());
+            return;
+        }
+    }
+
+    if (r.ok) {
+        Serial.printf("[Gateway] Telemetry sent samples=%u\n", (unsigned) r.samples);
+        return;
+    }
     Serial.print("[Gateway] Send failed err=");
-    Serial.print((int) gateway->lastError());
+    Serial.print((int) r.error);
     Serial.print(" http=");
-    Serial.println(gateway->lastHttpStatus());
+    Serial.println(r.httpStatus);
 }
 
 void setup() {
@@ -123,6 +168,11 @@ void setup() {
     delay(300);
     Serial.println("\nBoot vehicle-device (no stepper / no led)");
 
+#ifdef SECUREHTTP_BENCH
+    // Custo de cripto por mensagem (compile com -DSECUREHTTP_BENCH)
+    secureHttpCryptoBenchPrint(Serial);
+#endif
+
     // Wi-Fi
     WiFiManager::Config cfg;
     cfg.ssid = WIFI_SSID;
@@ -157,6 +207,30 @@ void setup() {
     dht = new DhtSensor(dcfg);
     dht->begin();
 
+    // ADC (combustível + potenciômetro) em segundo plano
+    AdcSampler::Config acfg;
+    acfg.periodUs = ADC_PERIOD_US;
+    adc = new AdcSampler(acfg);
+    {
+        AdcSampler::Channel ch;
+        ch.pin = FUEL_ADC_PIN;
+        ch.filter.type = AdcFilter::Type::Median;
+        ch.filter.window = FUEL_WINDOW;
+        ch.filter.decimation = FUEL_WINDOW;
+        fuelAdcCh = adc->addChannel(ch);
+
+        ch.pin = SPEED_ADC_PIN;
+        ch.filter.type = AdcFilter::Type::Median;
+        ch.filter.window = ACCEL_WINDOW;
+        ch.filter.decimation = ACCEL_WINDOW;
+        accelAdcCh = adc->addChannel(ch);
+    }
+    if (!adc->begin()) {
+        Serial.println("[ADC] sampler timer failed (falling back to analogRead in loop)");
+        delete adc;
+        adc = nullptr;
+    }
+
     // Fuel
     FuelLevel::Config fcfg;
     fcfg.adcPin = FUEL_ADC_PIN;
@@ -164,6 +238,10 @@ void setup() {
     fcfg.adcMax = 3800;
     fcfg.invert = false;
     fcfg.samples = 10;
+    if (adc) {
+        fcfg.sampler = adc;
+        fcfg.samplerChannel = (uint8_t) fuelAdcCh;
+    }
 
     fuel = new FuelLevel(fcfg);
     fuel->begin();
@@ -176,6 +254,30 @@ void setup() {
     analogSetPinAttenuation(FUEL_ADC_PIN, ADC_11db);
     analogSetPinAttenuation(SPEED_ADC_PIN, ADC_11db);
 
+    // Store-and-forward (LittleFS na partição "spiffs"; formata se não montar)
+    if (LittleFS.begin(true)) {
+        SampleLog::Config lcfg;
+        lcfg.recordSize = sizeof(GatewayClient::Sample);
+        lcfg.segments = 16;
+        lcfg.recordsPerSegment = 256; // 4096 amostras (~68 min a 1 Hz), ~136 KB de flash
+
+        sampleLog = new SampleLog(LittleFS, lcfg);
+        if (sampleLog->begin()) {
+            Serial.printf("[Store] %lu stored samples pending (capacity %lu)\n",
+                          (unsigned long) sampleLog->size(), (unsigned long) sampleLog->capacity());
+        } else {
+            delete sampleLog;
+            sampleLog = nullptr;
+        }
+    } else {
+        Serial.println("[Store] LittleFS mount failed (samples will be lost while offline)");
+    }
+
+    // Reporte por mudança: amostra a 1 Hz, envia só fora do deadband ou no heartbeat
+    ReportPolicy::Config rcfg;
+    rcfg.heartbeatMs = HEARTBEAT_MS;
+    report = new ReportPolicy(rcfg);
+
     // Gateway
     GatewayClient::Config gcfg;
     gcfg.host = GATEWAY_HOST;
@@ -183,14 +285,21 @@ void setup() {
     gcfg.path = "/telemetry";
     gcfg.minIntervalMs = SEND_INTERVAL_MS;
     gcfg.timeoutMs = 800;
+    gcfg.batchSize = SEND_BATCH_SIZE; // 1 handshake/HMAC/AES-GCM a cada 5 amostras
+    gcfg.batchPath = "/telemetry/batch";
+    gcfg.deviceId = SECURE_DEVICE_ID; // 1 ID por veículo (gateway mantém estado por device)
+    gcfg.useSession = true; // envios só com X-Session/X-Seq após o handshake
 
     gateway = new GatewayClient(gcfg);
     gateway->setDebugStream(&Serial);
-
-    // Se seu GatewayClient tiver suporte a deviceId (não sei sua API),
-    // o ideal é setar aqui para bater com SECURE_DEVICE_ID no gateway.
-    // Exemplo (descomente se existir no seu client):
-    // gateway->setDeviceId(SECURE_DEVICE_ID);
+    gateway->onSendResult(logGatewayResult); // envio conclui em update(), sem bloquear o loop
+    gateway->onSampleDropped([](const GatewayClient::Sample &s) {
+        // Fila em RAM cheia ou envio falhou: guarda com o ts da captura.
+        // Sem ts (antes do NTP) espera em RAM: no flash seria reenviada sem data
+        if (!sampleLog) return;
+        if (s.ts != 0) sampleLog->append(&s);
+        else unsyncedSamples.hold(s);
+    });
 
     gateway->begin();
 
@@ -216,12 +325,16 @@ void loop() {
 
             // ✅ assim que conectar, tenta sincronizar horário
             if (!isTimeSynced()) syncTimeNtp();
+
+            // Gateway recebe o estado atual logo após reconectar
+            if (report) report->reset();
         } else {
             Serial.println("[WiFi] Disconnected");
         }
     }
 
     if (dht) dht->update();
+    if (gateway) gateway->update(); // connect/write/read sem bloquear; lote por idade
 
     const uint32_t now = millis();
 
@@ -234,9 +347,17 @@ void loop() {
     static float accelPct = 0.0f;
     static float simRpm = 0.0f;
     static bool accelInit = false;
-
-    {
-        accelRaw = readAdcFast(SPEED_ADC_PIN, 5);
+    static uint16_t accelOutputs = 0;
+
+    // Com sampler: EMA só quando sai valor novo do filtro (taxa fixa, não a do loop)
+    const bool accelFresh = !adc || !accelInit || adc->outputs((uint8_t) accelAdcCh) != accelOutputs;
+    if (accelFresh) {
+        if (adc) {
+            accelOutputs = adc->outputs((uint8_t) accelAdcCh);
+            accelRaw = adc->value((uint8_t) accelAdcCh);
+        } else {
+            accelRaw = readAdcFast(SPEED_ADC_PIN, 5);
+        }
         const float targetPct = adcToAccelPct(accelRaw);
 
         const float a = (float) EMA_ALPHA_PCT / 100.0f;
@@ -259,6 +380,16 @@ void loop() {
 
         Serial.printf("[Fuel] raw=%d | level=%d %%\n", fuelRaw, fuelPct);
         Serial.printf("[Accel] raw=%d | accel=%.1f %% | rpm(sim)=%.0f\n", accelRaw, accelPct, simRpm);
+        if (adc) {
+            Serial.printf("[ADC] ticks=%lu | max tick=%lu us\n",
+                          (unsigned long) adc->ticks(), (unsigned long) adc->maxTickUs());
+        }
+
+        if (report) {
+            Serial.printf("[Report] changed=%lu heartbeat=%lu suppressed=%lu\n",
+                          (unsigned long) report->changed(), (unsigned long) report->heartbeats(),
+                          (unsigned long) report->suppressed());
+        }
 
         // Ajuda a diagnosticar SecureHttp
         if (!isTimeSynced()) {
@@ -266,30 +397,56 @@ void loop() {
         }
     }
 
-    // Send telemetry
-    if (connectedNow && dht && dht->hasData() && gateway && fuel) {
+    // Send telemetry (também offline: o que não couber na fila vai para o flash)
+    if (dht && dht->hasData() && gateway && fuel && report) {
         if (now - lastSendAttemptMs >= SEND_INTERVAL_MS) {
             lastSendAttemptMs = now;
 
             const auto &r = dht->data();
 
-            // Reaproveitando contrato atual do gateway:
-            // stepperSpeed -> aceleração (%)
-            // stepperRpm   -> rpm simulado
-            const bool ok = gateway->publishTelemetry(
-                r.temperature, r.humidity,
-                fuelPct,
-                accelPct,
-                simRpm
-            );
-
-            if (ok) {
-                Serial.println("[Gateway] Telemetry sent");
-            } else {
-                if (gateway->lastError() != GatewayClient::Error::RateLimited) {
-                    logGatewayFail();
-                }
+            ReportPolicy::Reading reading;
+            reading.temperature = r.temperature;
+            reading.humidity = r.humidity;
+            reading.fuelLevel = fuelPct;
+            reading.stepperSpeed = accelPct;
+            reading.stepperRpm = simRpm;
+
+            // Dentro do deadband e antes do heartbeat: nada a enviar
+            const ReportPolicy::Decision decision = report->evaluate(reading, now);
+            if (decision != ReportPolicy::Decision::Suppress) {
+                // Reaproveitando contrato atual do gateway:
+                // stepperSpeed -> aceleração (%)
+                // stepperRpm   -> rpm simulado
+                // Só enfileira: o resultado chega em logGatewayResult()
+                gateway->publishTelemetry(
+                    r.temperature, r.humidity,
+                    fuelPct,
+                    accelPct,
+                    simRpm
+                );
+
+                // Mudança não espera o lote completar
+                if (decision == ReportPolicy::Decision::Changed) gateway->flush();
             }
         }
     }
+
+    // Relógio sincronizou: amostras de antes do NTP vão para o flash já com o epoch da captura
+    if (sampleLog && !unsyncedSamples.empty() && isTimeSynced()) {
+        const size_t n = unsyncedSamples.release(*sampleLog, GatewayClient::resolveTs);
+        if (n > 0) {
+            Serial.printf("[Store] %u pre-NTP samples stored (%lu lost)\n",
+                          (unsigned) n, (unsigned long) unsyncedSamples.dropped());
+        }
+    }
+
+    // Drain do flash: lote a lote, mais antigas primeiro, só com o gateway alcançável
+    if (connectedNow && sampleLog && gateway && !sampleLog->empty() && !gateway->storedPending() &&
+        now - lastDrainMs >= DRAIN_INTERVAL_MS) {
+        lastDrainMs = now;
+
+        static GatewayClient::Sample batch[DRAIN_BATCH];
+        const size_t n = sampleLog->peek(batch, DRAIN_BATCH);
+        if (n > 0) gateway->publishStored(batch, (uint8_t) n);
+    }
 }
\ No newline at end of file